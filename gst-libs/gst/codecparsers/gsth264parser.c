@@ -85,6 +85,7 @@
 #endif
 
 #include "gsth264parser.h"
+#include "scanutils.h"
 
 #include <gst/base/gstbytereader.h>
 #include <gst/base/gstbitreader.h>
@@ -171,8 +172,16 @@ typedef struct
   guint bits_in_cache;          /* bitpos in the cache of next bit */
   guint8 first_byte;
   guint64 cache;                /* cached bytes */
+
+  guint epb;                    /* Position of the next emulation prevention
+                                 * byte, or G_MAXUINT if none before scanned */
+  guint scanned;                /* End of the bytes looked at for epb */
 } NalReader;
 
+/* Headers are short but slices can be big, so emulation prevention bytes
+ * are only looked for this many bytes ahead */
+#define NAL_READER_EPB_WINDOW 64
+
 static void
 nal_reader_init (NalReader * nr, const guint8 * data, guint size)
 {
@@ -181,9 +190,27 @@ nal_reader_init (NalReader * nr, const guint8 * data, guint size)
 
   nr->byte = 0;
   nr->bits_in_cache = 0;
-  /* fill with something other than 0 to detect emulation prevention bytes */
   nr->first_byte = 0xff;
   nr->cache = 0xff;
+
+  nr->epb = G_MAXUINT;
+  nr->scanned = 0;
+}
+
+/* Finds the first emulation_prevention_three_byte at or after @from in the
+ * next window, including one whose 0x0000 prefix is before @from */
+static void
+nal_reader_scan_epb (NalReader * nr, guint from)
+{
+  guint start, end;
+  gint off;
+
+  start = from >= 2 ? from - 2 : 0;
+  end = MIN (from + NAL_READER_EPB_WINDOW, nr->size);
+
+  off = scan_for_emulation_prevention_byte (nr->data + start, end - start);
+  nr->epb = off < 0 ? G_MAXUINT : start + off;
+  nr->scanned = end;
 }
 
 static gboolean
@@ -197,22 +224,22 @@ nal_reader_read (NalReader * nr, guint nbits)
 
   while (nr->bits_in_cache < nbits) {
     guint8 byte;
-    gboolean check_three_byte;
 
-    check_three_byte = TRUE;
-  next_byte:
+    if (G_UNLIKELY (nr->byte >= nr->scanned || nr->byte > nr->epb))
+      nal_reader_scan_epb (nr, nr->byte);
+
+    /* skip the emulation_prevention_three_byte, the next one can only start
+     * after it */
+    if (G_UNLIKELY (nr->byte == nr->epb)) {
+      nr->byte++;
+      nal_reader_scan_epb (nr, nr->byte);
+    }
+
     if (G_UNLIKELY (nr->byte >= nr->size))
       return FALSE;
 
     byte = nr->data[nr->byte++];
 
-    /* check if the byte is a emulation_prevention_three_byte */
-    if (check_three_byte && byte == 0x03 && nr->first_byte == 0x00 &&
-        ((nr->cache & 0xff) == 0)) {
-      /* next byte goes unconditionally to the cache, even if it's 0x03 */
-      check_three_byte = FALSE;
-      goto next_byte;
-    }
     nr->cache = (nr->cache << 8) | nr->first_byte;
     nr->first_byte = byte;
     nr->bits_in_cache += 8;
@@ -459,17 +486,6 @@ set_nalu_datas (GstH264NalUnit * nalu)
   GST_DEBUG ("Nal type %u, ref_idc %u", nalu->type, nalu->ref_idc);
 }
 
-static inline gint
-scan_for_start_codes (const guint8 * data, guint size)
-{
-  GstByteReader br;
-  gst_byte_reader_init (&br, data, size);
-
-  /* NALU not empty, so we can at least expect 1 (even 2) bytes following sc */
-  return gst_byte_reader_masked_scan_uint32 (&br, 0xffffff00, 0x00000100,
-      0, size);
-}
-
 static gboolean
 gst_h264_parser_more_data (NalReader * nr)
 {
@@ -1713,6 +1729,64 @@ gst_h264_parser_parse_pps (GstH264NalParser * nalparser,
   return res;
 }
 
+/**
+ * gst_h264_parser_set_last_sps:
+ * @nalparser: a #GstH264NalParser
+ * @sps_id: The id of a sequence parameter set parsed before
+ *
+ * Makes the sequence parameter set with @sps_id the last one, as parsing it
+ * again would. Use this when it is repeated unchanged in the stream.
+ *
+ * Returns: %TRUE if there is a valid sequence parameter set with @sps_id
+ */
+gboolean
+gst_h264_parser_set_last_sps (GstH264NalParser * nalparser, guint8 sps_id)
+{
+  GstH264SPS *sps;
+
+  g_return_val_if_fail (nalparser != NULL, FALSE);
+
+  if (sps_id >= GST_H264_MAX_SPS_COUNT)
+    return FALSE;
+
+  sps = gst_h264_parser_get_sps (nalparser, sps_id);
+  if (!sps)
+    return FALSE;
+
+  nalparser->last_sps = sps;
+
+  return TRUE;
+}
+
+/**
+ * gst_h264_parser_set_last_pps:
+ * @nalparser: a #GstH264NalParser
+ * @pps_id: The id of a picture parameter set parsed before
+ *
+ * Makes the picture parameter set with @pps_id the last one, as parsing it
+ * again would. Use this when it is repeated unchanged in the stream.
+ *
+ * Returns: %TRUE if there is a valid picture parameter set with @pps_id
+ */
+gboolean
+gst_h264_parser_set_last_pps (GstH264NalParser * nalparser, guint8 pps_id)
+{
+  GstH264PPS *pps;
+
+  g_return_val_if_fail (nalparser != NULL, FALSE);
+
+  if (pps_id >= GST_H264_MAX_PPS_COUNT)
+    return FALSE;
+
+  pps = gst_h264_parser_get_pps (nalparser, pps_id);
+  if (!pps)
+    return FALSE;
+
+  nalparser->last_pps = pps;
+
+  return TRUE;
+}
+
 /**
  * gst_h264_parser_parse_slice_hdr:
  * @nalparser: a #GstH264NalParser
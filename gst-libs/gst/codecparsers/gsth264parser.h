@@ -704,6 +704,10 @@ GstH264ParserResult gst_h264_parser_parse_pps         (GstH264NalParser *nalpars
 GstH264ParserResult gst_h264_parser_parse_sei         (GstH264NalParser *nalparser,
                                                        GstH264NalUnit *nalu, GstH264SEIMessage *sei);
 
+gboolean gst_h264_parser_set_last_sps                 (GstH264NalParser *nalparser, guint8 sps_id);
+
+gboolean gst_h264_parser_set_last_pps                 (GstH264NalParser *nalparser, guint8 pps_id);
+
 void gst_h264_nal_parser_free                         (GstH264NalParser *nalparser);
 
 GstH264ParserResult gst_h264_parse_sps                (GstH264NalUnit *nalu,
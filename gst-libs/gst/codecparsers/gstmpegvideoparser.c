@@ -41,6 +41,7 @@
 
 #include "gstmpegvideoparser.h"
 #include "parserutils.h"
+#include "scanutils.h"
 
 #include <string.h>
 #include <gst/base/gstbitreader.h>
@@ -230,55 +231,6 @@ failed:
   }
 }
 
-static inline guint
-scan_for_start_codes (const GstByteReader * reader, guint offset, guint size)
-{
-  const guint8 *data;
-  guint32 state;
-  guint i;
-
-  g_return_val_if_fail (size > 0, -1);
-  g_return_val_if_fail ((guint64) offset + size <= reader->size - reader->byte,
-      -1);
-
-  /* we can't find the pattern with less than 4 bytes */
-  if (G_UNLIKELY (size < 4))
-    return -1;
-
-  data = reader->data + reader->byte + offset;
-
-  /* set the state to something that does not match */
-  state = 0xffffffff;
-
-  /* now find data */
-  for (i = 0; i < size; i++) {
-    /* throw away one byte and move in the next byte */
-    state = ((state << 8) | data[i]);
-    if (G_UNLIKELY ((state & 0xffffff00) == 0x00000100)) {
-      /* we have a match but we need to have skipped at
-       * least 4 bytes to fill the state. */
-      if (G_LIKELY (i >= 3))
-        return offset + i - 3;
-    }
-
-    /* TODO: reimplement making 010001 not detected as a sc
-     * Accelerate search for start code
-     * if (data[i] > 1) {
-     * while (i < (size - 4) && data[i] > 1) {
-     *   if (data[i + 3] > 1)
-     *     i += 4;
-     *   else
-     *     i += 1;
-     * }
-     * state = 0x00000100;
-     *}
-     */
-  }
-
-  /* nothing found */
-  return -1;
-}
-
 /****** API *******/
 
 /**
@@ -314,7 +266,7 @@ gst_mpeg_video_parse (const guint8 * data, gsize size, guint offset)
 
   gst_byte_reader_init (&br, &data[offset], size);
 
-  off = scan_for_start_codes (&br, 0, size);
+  off = scan_for_start_codes (&data[offset], size);
 
   if (off < 0) {
     GST_DEBUG ("No start code prefix in this buffer");
@@ -337,7 +289,8 @@ gst_mpeg_video_parse (const guint8 * data, gsize size, guint offset)
       break;
     }
 
-    off = scan_for_start_codes (&br, 0, rsize);
+    off = scan_for_start_codes (&data[offset + gst_byte_reader_get_pos (&br)],
+        rsize);
 
     codoffsize->size = off;
 
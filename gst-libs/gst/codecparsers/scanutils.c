@@ -0,0 +1,88 @@
+/* Gstreamer
+ * Copyright (C) <2012> Collabora Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "scanutils.h"
+
+#include <string.h>
+
+/* Non-zero if any of the 8 bytes of @v is 0 */
+#define HAS_ZERO_BYTE(v) \
+  (((v) - G_GUINT64_CONSTANT (0x0101010101010101)) & ~(v) & \
+      G_GUINT64_CONSTANT (0x8080808080808080))
+
+/* Returns the offset of the first 0x00 0x00 @byte sequence that ends
+ * before @size, or -1.
+ *
+ * Every such sequence starts with a zero byte, so data is read 8 bytes
+ * at a time and only words with a zero byte are looked at closely. */
+static gint
+scan_for_zero_zero_byte (const guint8 * data, guint size, guint8 byte)
+{
+  const guint8 *p = data, *end;
+  guint64 v;
+  guint i;
+
+  if (size < 3)
+    return -1;
+
+  /* one after the last possible start */
+  end = data + size - 2;
+
+  /* the bytes checked for a match at p + 7 end at p + 9 */
+  while (end - p >= 8) {
+    memcpy (&v, p, 8);
+    if (G_UNLIKELY (HAS_ZERO_BYTE (v))) {
+      for (i = 0; i < 8; i++) {
+        if (p[i] == 0x00 && p[i + 1] == 0x00 && p[i + 2] == byte)
+          return p - data + i;
+      }
+    }
+    p += 8;
+  }
+
+  for (; p < end; p++) {
+    if (p[0] == 0x00 && p[1] == 0x00 && p[2] == byte)
+      return p - data;
+  }
+
+  return -1;
+}
+
+/* Returns the offset of the first 0x000001 start code prefix in @data that
+ * is followed by at least one byte, or -1 */
+gint
+scan_for_start_codes (const guint8 * data, guint size)
+{
+  if (size < 4)
+    return -1;
+
+  return scan_for_zero_zero_byte (data, size - 1, 0x01);
+}
+
+/* Returns the offset of the 0x03 of the first 0x000003 sequence in @data,
+ * or -1 */
+gint
+scan_for_emulation_prevention_byte (const guint8 * data, guint size)
+{
+  gint off;
+
+  off = scan_for_zero_zero_byte (data, size, 0x03);
+
+  return off < 0 ? -1 : off + 2;
+}
@@ -0,0 +1,31 @@
+/* Gstreamer
+ * Copyright (C) <2012> Collabora Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __SCAN_UTILS__
+#define __SCAN_UTILS__
+
+#include <glib.h>
+
+gint
+scan_for_start_codes (const guint8 * data, guint size);
+
+gint
+scan_for_emulation_prevention_byte (const guint8 * data, guint size);
+
+#endif /* __SCAN_UTILS__ */
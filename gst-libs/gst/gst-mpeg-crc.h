@@ -0,0 +1,99 @@
+/* GStreamer
+ *
+ * gst-mpeg-crc.h: CRC-32/MPEG-2 as used by MPEG-TS/PS PSI sections
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GST_MPEG_CRC_H__
+#define __GST_MPEG_CRC_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* The CRC-32/MPEG-2 (polynomial 0x04c11db7, initial value 0xffffffff, not
+ * reflected, no final xor) shared by the MPEG demuxers and muxers.
+ *
+ * Data is processed 8 bytes at a time with the slice-by-8 algorithm, which
+ * needs 8 lookup tables of 256 entries. gst_mpeg_crc_tab[0] is the classic
+ * byte-at-a-time table, gst_mpeg_crc_tab[k] advances a table entry by k
+ * more zero bytes. The tables are computed on first use.
+ *
+ * Running the CRC over a whole section including its CRC_32 field yields 0
+ * for a valid section. */
+
+#define GST_MPEG_CRC_POLY 0x04c11db7
+
+static guint32 gst_mpeg_crc_tab[8][256];
+
+static inline void
+gst_mpeg_crc_init (void)
+{
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized)) {
+    guint32 crc;
+    gint i, j;
+
+    for (i = 0; i < 256; i++) {
+      crc = ((guint32) i) << 24;
+      for (j = 0; j < 8; j++)
+        crc = (crc & 0x80000000) ? (crc << 1) ^ GST_MPEG_CRC_POLY : crc << 1;
+      gst_mpeg_crc_tab[0][i] = crc;
+    }
+
+    for (j = 1; j < 8; j++) {
+      for (i = 0; i < 256; i++) {
+        crc = gst_mpeg_crc_tab[j - 1][i];
+        gst_mpeg_crc_tab[j][i] = (crc << 8) ^ gst_mpeg_crc_tab[0][crc >> 24];
+      }
+    }
+
+    g_once_init_leave (&initialized, 1);
+  }
+}
+
+static inline guint32
+gst_mpeg_crc32 (const guint8 * data, guint datalen)
+{
+  guint32 crc = 0xffffffff;
+
+  gst_mpeg_crc_init ();
+
+  while (datalen >= 8) {
+    crc ^= ((guint32) data[0] << 24) | ((guint32) data[1] << 16) |
+        ((guint32) data[2] << 8) | data[3];
+    crc = gst_mpeg_crc_tab[7][crc >> 24] ^
+        gst_mpeg_crc_tab[6][(crc >> 16) & 0xff] ^
+        gst_mpeg_crc_tab[5][(crc >> 8) & 0xff] ^
+        gst_mpeg_crc_tab[4][crc & 0xff] ^
+        gst_mpeg_crc_tab[3][data[4]] ^
+        gst_mpeg_crc_tab[2][data[5]] ^
+        gst_mpeg_crc_tab[1][data[6]] ^ gst_mpeg_crc_tab[0][data[7]];
+    data += 8;
+    datalen -= 8;
+  }
+
+  while (datalen--)
+    crc = (crc << 8) ^ gst_mpeg_crc_tab[0][((crc >> 24) ^ *data++) & 0xff];
+
+  return crc;
+}
+
+G_END_DECLS
+
+#endif /* __GST_MPEG_CRC_H__ */
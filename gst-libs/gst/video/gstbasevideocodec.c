@@ -37,10 +37,18 @@ enum
 
 enum
 {
-  ARG_0
+  ARG_0,
+  ARG_FRAMES_ALLOCATED,
+  ARG_FRAMES_REUSED
 };
 
+/* Upper bound of released frames kept for reuse, a few more than the
+ * usual reordering depth */
+#define MAX_FREE_FRAMES 32
+
 static void gst_base_video_codec_finalize (GObject * object);
+static void gst_base_video_codec_get_property (GObject * object,
+    guint prop_id, GValue * value, GParamSpec * pspec);
 
 static GstStateChangeReturn gst_base_video_codec_change_state (GstElement *
     element, GstStateChange transition);
@@ -67,6 +75,16 @@ gst_base_video_codec_class_init (GstBaseVideoCodecClass * klass)
   element_class = GST_ELEMENT_CLASS (klass);
 
   gobject_class->finalize = gst_base_video_codec_finalize;
+  gobject_class->get_property = gst_base_video_codec_get_property;
+
+  g_object_class_install_property (gobject_class, ARG_FRAMES_ALLOCATED,
+      g_param_spec_uint64 ("frames-allocated", "Frames allocated",
+          "Number of frames that were newly allocated", 0, G_MAXUINT64, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, ARG_FRAMES_REUSED,
+      g_param_spec_uint64 ("frames-reused", "Frames reused",
+          "Number of frames that were taken from the released frames",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 
   element_class->change_state = gst_base_video_codec_change_state;
 }
@@ -97,6 +115,8 @@ gst_base_video_codec_init (GstBaseVideoCodec * base_video_codec,
 
   gst_segment_init (&base_video_codec->segment, GST_FORMAT_TIME);
 
+  base_video_codec->frame_index = g_hash_table_new (NULL, NULL);
+
   g_static_rec_mutex_init (&base_video_codec->stream_lock);
 }
 
@@ -109,10 +129,17 @@ gst_base_video_codec_reset (GstBaseVideoCodec * base_video_codec)
 
   GST_BASE_VIDEO_CODEC_STREAM_LOCK (base_video_codec);
   for (g = base_video_codec->frames; g; g = g_list_next (g)) {
-    gst_base_video_codec_free_frame ((GstVideoFrame *) g->data);
+    gst_base_video_codec_release_frame (base_video_codec,
+        (GstVideoFrame *) g->data);
   }
   g_list_free (base_video_codec->frames);
   base_video_codec->frames = NULL;
+  base_video_codec->frames_tail = NULL;
+  g_hash_table_remove_all (base_video_codec->frame_index);
+
+  GST_DEBUG_OBJECT (base_video_codec, "%" G_GUINT64_FORMAT " frames "
+      "allocated, %" G_GUINT64_FORMAT " reused",
+      base_video_codec->frames_allocated, base_video_codec->frames_reused);
 
   base_video_codec->bytes = 0;
   base_video_codec->time = 0;
@@ -128,12 +155,42 @@ static void
 gst_base_video_codec_finalize (GObject * object)
 {
   GstBaseVideoCodec *base_video_codec = GST_BASE_VIDEO_CODEC (object);
+  GstVideoFrame *frame;
+
+  while ((frame = g_trash_stack_pop (&base_video_codec->free_frames)))
+    g_slice_free (GstVideoFrame, frame);
+  base_video_codec->n_free_frames = 0;
+
+  g_hash_table_destroy (base_video_codec->frame_index);
 
   g_static_rec_mutex_free (&base_video_codec->stream_lock);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
+static void
+gst_base_video_codec_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstBaseVideoCodec *base_video_codec = GST_BASE_VIDEO_CODEC (object);
+
+  switch (prop_id) {
+    case ARG_FRAMES_ALLOCATED:
+      GST_BASE_VIDEO_CODEC_STREAM_LOCK (base_video_codec);
+      g_value_set_uint64 (value, base_video_codec->frames_allocated);
+      GST_BASE_VIDEO_CODEC_STREAM_UNLOCK (base_video_codec);
+      break;
+    case ARG_FRAMES_REUSED:
+      GST_BASE_VIDEO_CODEC_STREAM_LOCK (base_video_codec);
+      g_value_set_uint64 (value, base_video_codec->frames_reused);
+      GST_BASE_VIDEO_CODEC_STREAM_UNLOCK (base_video_codec);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
 static GstStateChangeReturn
 gst_base_video_codec_change_state (GstElement * element,
     GstStateChange transition)
@@ -175,9 +232,17 @@ gst_base_video_codec_new_frame (GstBaseVideoCodec * base_video_codec)
 {
   GstVideoFrame *frame;
 
-  frame = g_slice_new0 (GstVideoFrame);
-
   GST_BASE_VIDEO_CODEC_STREAM_LOCK (base_video_codec);
+  frame = g_trash_stack_pop (&base_video_codec->free_frames);
+  if (frame) {
+    base_video_codec->n_free_frames--;
+    base_video_codec->frames_reused++;
+    memset (frame, 0, sizeof (GstVideoFrame));
+  } else {
+    base_video_codec->frames_allocated++;
+    frame = g_slice_new0 (GstVideoFrame);
+  }
+
   frame->system_frame_number = base_video_codec->system_frame_number;
   base_video_codec->system_frame_number++;
   GST_BASE_VIDEO_CODEC_STREAM_UNLOCK (base_video_codec);
@@ -185,11 +250,9 @@ gst_base_video_codec_new_frame (GstBaseVideoCodec * base_video_codec)
   return frame;
 }
 
-void
-gst_base_video_codec_free_frame (GstVideoFrame * frame)
+static void
+gst_base_video_codec_clear_frame (GstVideoFrame * frame)
 {
-  g_return_if_fail (frame != NULL);
-
   if (frame->sink_buffer) {
     gst_buffer_unref (frame->sink_buffer);
   }
@@ -203,6 +266,125 @@ gst_base_video_codec_free_frame (GstVideoFrame * frame)
 
   if (frame->coder_hook_destroy_notify && frame->coder_hook)
     frame->coder_hook_destroy_notify (frame->coder_hook);
+}
+
+void
+gst_base_video_codec_free_frame (GstVideoFrame * frame)
+{
+  g_return_if_fail (frame != NULL);
+
+  gst_base_video_codec_clear_frame (frame);
 
   g_slice_free (GstVideoFrame, frame);
 }
+
+/**
+ * gst_base_video_codec_release_frame:
+ * @base_video_codec: a #GstBaseVideoCodec
+ * @frame: a #GstVideoFrame from gst_base_video_codec_new_frame()
+ *
+ * Like gst_base_video_codec_free_frame(), but keeps @frame around for
+ * reuse by the next gst_base_video_codec_new_frame(). @frame must not be
+ * in the pending frames anymore.
+ */
+void
+gst_base_video_codec_release_frame (GstBaseVideoCodec * base_video_codec,
+    GstVideoFrame * frame)
+{
+  g_return_if_fail (frame != NULL);
+
+  gst_base_video_codec_clear_frame (frame);
+
+  GST_BASE_VIDEO_CODEC_STREAM_LOCK (base_video_codec);
+  if (base_video_codec->n_free_frames < MAX_FREE_FRAMES) {
+    g_trash_stack_push (&base_video_codec->free_frames, frame);
+    base_video_codec->n_free_frames++;
+    frame = NULL;
+  }
+  GST_BASE_VIDEO_CODEC_STREAM_UNLOCK (base_video_codec);
+
+  if (frame)
+    g_slice_free (GstVideoFrame, frame);
+}
+
+/**
+ * gst_base_video_codec_append_frame:
+ * @base_video_codec: a #GstBaseVideoCodec
+ * @frame: a #GstVideoFrame
+ *
+ * Adds @frame to the end of the pending frames.
+ */
+void
+gst_base_video_codec_append_frame (GstBaseVideoCodec * base_video_codec,
+    GstVideoFrame * frame)
+{
+  GList *link;
+
+  GST_BASE_VIDEO_CODEC_STREAM_LOCK (base_video_codec);
+  link = g_list_alloc ();
+  link->data = frame;
+  link->prev = base_video_codec->frames_tail;
+  if (base_video_codec->frames_tail)
+    base_video_codec->frames_tail->next = link;
+  else
+    base_video_codec->frames = link;
+  base_video_codec->frames_tail = link;
+
+  g_hash_table_insert (base_video_codec->frame_index,
+      GINT_TO_POINTER (frame->system_frame_number), link);
+  GST_BASE_VIDEO_CODEC_STREAM_UNLOCK (base_video_codec);
+}
+
+/**
+ * gst_base_video_codec_remove_frame:
+ * @base_video_codec: a #GstBaseVideoCodec
+ * @frame: a pending #GstVideoFrame
+ *
+ * Removes @frame from the pending frames, without freeing it.
+ */
+void
+gst_base_video_codec_remove_frame (GstBaseVideoCodec * base_video_codec,
+    GstVideoFrame * frame)
+{
+  GList *link;
+
+  GST_BASE_VIDEO_CODEC_STREAM_LOCK (base_video_codec);
+  link = g_hash_table_lookup (base_video_codec->frame_index,
+      GINT_TO_POINTER (frame->system_frame_number));
+  if (link && link->data == frame) {
+    g_hash_table_remove (base_video_codec->frame_index,
+        GINT_TO_POINTER (frame->system_frame_number));
+  } else {
+    /* The frame numbers restarted while @frame was pending */
+    link = g_list_find (base_video_codec->frames, frame);
+  }
+
+  if (link) {
+    if (link == base_video_codec->frames_tail)
+      base_video_codec->frames_tail = link->prev;
+    base_video_codec->frames =
+        g_list_delete_link (base_video_codec->frames, link);
+  }
+  GST_BASE_VIDEO_CODEC_STREAM_UNLOCK (base_video_codec);
+}
+
+/**
+ * gst_base_video_codec_find_frame:
+ * @base_video_codec: a #GstBaseVideoCodec
+ * @frame_number: system_frame_number of a frame
+ *
+ * Returns: the pending #GstVideoFrame identified by @frame_number, or %NULL.
+ */
+GstVideoFrame *
+gst_base_video_codec_find_frame (GstBaseVideoCodec * base_video_codec,
+    int frame_number)
+{
+  GList *link;
+
+  GST_BASE_VIDEO_CODEC_STREAM_LOCK (base_video_codec);
+  link = g_hash_table_lookup (base_video_codec->frame_index,
+      GINT_TO_POINTER (frame_number));
+  GST_BASE_VIDEO_CODEC_STREAM_UNLOCK (base_video_codec);
+
+  return link ? link->data : NULL;
+}
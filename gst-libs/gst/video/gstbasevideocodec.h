@@ -167,6 +167,17 @@ struct _GstBaseVideoCodec
   gint64 bytes;
   gint64 time;
 
+  /* Pending frames by system_frame_number, and the last link of frames.
+   * Protected with the STREAM_LOCK like frames */
+  GHashTable *frame_index;
+  GList *frames_tail;
+
+  /* Released frames for reuse */
+  GTrashStack *free_frames;
+  guint n_free_frames;
+  guint64 frames_allocated;
+  guint64 frames_reused;
+
   /* FIXME before moving to base */
   void *padding[GST_PADDING_LARGE];
 };
@@ -183,6 +194,15 @@ GType gst_base_video_codec_get_type (void);
 
 GstVideoFrame * gst_base_video_codec_new_frame (GstBaseVideoCodec *base_video_codec);
 void gst_base_video_codec_free_frame (GstVideoFrame *frame);
+void gst_base_video_codec_release_frame (GstBaseVideoCodec *base_video_codec,
+    GstVideoFrame *frame);
+
+void gst_base_video_codec_append_frame (GstBaseVideoCodec *base_video_codec,
+    GstVideoFrame *frame);
+void gst_base_video_codec_remove_frame (GstBaseVideoCodec *base_video_codec,
+    GstVideoFrame *frame);
+GstVideoFrame * gst_base_video_codec_find_frame (GstBaseVideoCodec *base_video_codec,
+    int frame_number);
 
 G_END_DECLS
 
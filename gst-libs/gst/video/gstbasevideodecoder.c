@@ -913,6 +913,18 @@ gst_base_video_decoder_get_timestamp_at_offset (GstBaseVideoDecoder *
       GST_TIME_ARGS (offset), GST_TIME_ARGS (*timestamp));
 }
 
+static void
+gst_base_video_decoder_release_frames (GstBaseVideoDecoder * dec,
+    GList ** frames)
+{
+  GList *l;
+
+  for (l = *frames; l; l = l->next)
+    gst_base_video_codec_release_frame (GST_BASE_VIDEO_CODEC (dec), l->data);
+  g_list_free (*frames);
+  *frames = NULL;
+}
+
 static void
 gst_base_video_decoder_clear_queues (GstBaseVideoDecoder * dec)
 {
@@ -922,16 +934,11 @@ gst_base_video_decoder_clear_queues (GstBaseVideoDecoder * dec)
   g_list_foreach (dec->gather, (GFunc) gst_mini_object_unref, NULL);
   g_list_free (dec->gather);
   dec->gather = NULL;
-  g_list_foreach (dec->decode, (GFunc) gst_base_video_codec_free_frame, NULL);
-  g_list_free (dec->decode);
-  dec->decode = NULL;
+  gst_base_video_decoder_release_frames (dec, &dec->decode);
   g_list_foreach (dec->parse, (GFunc) gst_mini_object_unref, NULL);
   g_list_free (dec->parse);
   dec->parse = NULL;
-  g_list_foreach (dec->parse_gather, (GFunc) gst_base_video_codec_free_frame,
-      NULL);
-  g_list_free (dec->parse_gather);
-  dec->parse_gather = NULL;
+  gst_base_video_decoder_release_frames (dec, &dec->parse_gather);
 }
 
 static void
@@ -965,7 +972,8 @@ gst_base_video_decoder_reset (GstBaseVideoDecoder * base_video_decoder,
   base_video_decoder->timestamps = NULL;
 
   if (base_video_decoder->current_frame) {
-    gst_base_video_codec_free_frame (base_video_decoder->current_frame);
+    gst_base_video_codec_release_frame (GST_BASE_VIDEO_CODEC
+        (base_video_decoder), base_video_decoder->current_frame);
     base_video_decoder->current_frame = NULL;
   }
 
@@ -1094,7 +1102,8 @@ gst_base_video_decoder_flush_decode (GstBaseVideoDecoder * dec)
 
     next = g_list_next (walk);
     if (dec->current_frame)
-      gst_base_video_codec_free_frame (dec->current_frame);
+      gst_base_video_codec_release_frame (GST_BASE_VIDEO_CODEC (dec),
+          dec->current_frame);
     dec->current_frame = frame;
     /* decode buffer, resulting data prepended to queue */
     res = gst_base_video_decoder_have_frame_2 (dec);
@@ -1376,7 +1385,8 @@ gst_base_video_decoder_prepare_finish_frame (GstBaseVideoDecoder *
 
 #ifndef GST_DISABLE_GST_DEBUG
   GST_LOG_OBJECT (base_video_decoder, "n %d in %d out %d",
-      g_list_length (GST_BASE_VIDEO_CODEC (base_video_decoder)->frames),
+      g_hash_table_size (GST_BASE_VIDEO_CODEC (base_video_decoder)->
+          frame_index),
       gst_adapter_available (base_video_decoder->input_adapter),
       gst_adapter_available (base_video_decoder->output_adapter));
 #endif
@@ -1468,13 +1478,8 @@ static void
 gst_base_video_decoder_do_finish_frame (GstBaseVideoDecoder * dec,
     GstVideoFrame * frame)
 {
-  GST_BASE_VIDEO_CODEC (dec)->frames =
-      g_list_remove (GST_BASE_VIDEO_CODEC (dec)->frames, frame);
-
-  if (frame->src_buffer)
-    gst_buffer_unref (frame->src_buffer);
-
-  gst_base_video_codec_free_frame (frame);
+  gst_base_video_codec_remove_frame (GST_BASE_VIDEO_CODEC (dec), frame);
+  gst_base_video_codec_release_frame (GST_BASE_VIDEO_CODEC (dec), frame);
 }
 
 /**
@@ -1845,8 +1850,8 @@ gst_base_video_decoder_have_frame_2 (GstBaseVideoDecoder * base_video_decoder)
       GST_TIME_ARGS (frame->decode_timestamp));
   GST_LOG_OBJECT (base_video_decoder, "dist %d", frame->distance_from_sync);
 
-  GST_BASE_VIDEO_CODEC (base_video_decoder)->frames =
-      g_list_append (GST_BASE_VIDEO_CODEC (base_video_decoder)->frames, frame);
+  gst_base_video_codec_append_frame (GST_BASE_VIDEO_CODEC (base_video_decoder),
+      frame);
 
   frame->deadline =
       gst_segment_to_running_time (&GST_BASE_VIDEO_CODEC
@@ -1953,22 +1958,8 @@ GstVideoFrame *
 gst_base_video_decoder_get_frame (GstBaseVideoDecoder * base_video_decoder,
     int frame_number)
 {
-  GList *g;
-  GstVideoFrame *frame = NULL;
-
-  GST_BASE_VIDEO_CODEC_STREAM_LOCK (base_video_decoder);
-  for (g = g_list_first (GST_BASE_VIDEO_CODEC (base_video_decoder)->frames);
-      g; g = g_list_next (g)) {
-    GstVideoFrame *tmp = g->data;
-
-    if (frame->system_frame_number == frame_number) {
-      frame = tmp;
-      break;
-    }
-  }
-  GST_BASE_VIDEO_CODEC_STREAM_UNLOCK (base_video_decoder);
-
-  return frame;
+  return gst_base_video_codec_find_frame (GST_BASE_VIDEO_CODEC
+      (base_video_decoder), frame_number);
 }
 
 /**
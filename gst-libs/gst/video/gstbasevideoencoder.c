@@ -865,8 +865,8 @@ gst_base_video_encoder_chain (GstPad * pad, GstBuffer * buf)
   }
   GST_OBJECT_UNLOCK (base_video_encoder);
 
-  GST_BASE_VIDEO_CODEC (base_video_encoder)->frames =
-      g_list_append (GST_BASE_VIDEO_CODEC (base_video_encoder)->frames, frame);
+  gst_base_video_codec_append_frame (GST_BASE_VIDEO_CODEC (base_video_encoder),
+      frame);
 
   /* new data, more finish needed */
   base_video_encoder->drained = FALSE;
@@ -1118,10 +1118,10 @@ gst_base_video_encoder_finish_frame (GstBaseVideoEncoder * base_video_encoder,
 
 done:
   /* handed out */
-  GST_BASE_VIDEO_CODEC (base_video_encoder)->frames =
-      g_list_remove (GST_BASE_VIDEO_CODEC (base_video_encoder)->frames, frame);
-
-  gst_base_video_codec_free_frame (frame);
+  gst_base_video_codec_remove_frame (GST_BASE_VIDEO_CODEC (base_video_encoder),
+      frame);
+  gst_base_video_codec_release_frame (GST_BASE_VIDEO_CODEC
+      (base_video_encoder), frame);
 
   GST_BASE_VIDEO_CODEC_STREAM_UNLOCK (base_video_encoder);
 
@@ -28,13 +28,12 @@
 #include "gstcolorspaceorc.h"
 
 
-static void colorspace_convert_generic (ColorspaceConvert * convert,
-    guint8 * dest, const guint8 * src);
 static void colorspace_convert_lookup_fastpath (ColorspaceConvert * convert);
 static void colorspace_convert_lookup_getput (ColorspaceConvert * convert);
 static void colorspace_dither_none (ColorspaceConvert * convert, int j);
 static void colorspace_dither_verterr (ColorspaceConvert * convert, int j);
 static void colorspace_dither_halftone (ColorspaceConvert * convert, int j);
+static void colorspace_threads_free (ColorspaceThreads * threads);
 
 
 ColorspaceConvert *
@@ -141,6 +140,8 @@ colorspace_convert_new (GstVideoFormat to_format, ColorSpaceColorSpec to_spec,
 void
 colorspace_convert_free (ColorspaceConvert * convert)
 {
+  if (convert->threads)
+    colorspace_threads_free (convert->threads);
   g_free (convert->palette);
   g_free (convert->tmpline);
   g_free (convert->tmpline16);
@@ -189,11 +190,191 @@ colorspace_convert_get_palette (ColorspaceConvert * convert)
   return convert->palette;
 }
 
+/* Multithreaded conversion
+ *
+ * The frame is cut into horizontal bands, and every band is converted by
+ * the unmodified single threaded code working on a copy of the
+ * ColorspaceConvert with its own scratch lines, and with the height and
+ * the component offsets of the band.  Bands start on a multiple of 8 lines,
+ * so that subsampled chroma lines and the halftone pattern line up exactly
+ * like in the single threaded case and the output is identical. */
+
+#define COLORSPACE_BAND_ALIGN 8
+
+typedef struct
+{
+  ColorspaceConvert convert;
+  ColorspaceThreads *threads;
+
+  guint8 *tmpline;
+  guint16 *tmpline16;
+  guint16 *errline;
+
+  guint8 *dest;
+  const guint8 *src;
+} ColorspaceBand;
+
+struct _ColorspaceThreads
+{
+  int n_threads;
+  ColorspaceBand *bands;
+
+  /* n_threads - 1 workers, the calling thread converts the first band */
+  GThreadPool *pool;
+  GMutex *lock;
+  GCond *cond;
+  int n_pending;
+};
+
+static void
+colorspace_band_convert (gpointer data, gpointer user_data)
+{
+  ColorspaceBand *band = data;
+  ColorspaceThreads *threads = band->threads;
+
+  band->convert.convert (&band->convert, band->dest, band->src);
+
+  if (band != &threads->bands[0]) {
+    g_mutex_lock (threads->lock);
+    if (--threads->n_pending == 0)
+      g_cond_signal (threads->cond);
+    g_mutex_unlock (threads->lock);
+  }
+}
+
+static ColorspaceThreads *
+colorspace_threads_new (ColorspaceConvert * convert, int n_threads)
+{
+  ColorspaceThreads *threads;
+  ColorspaceBand *band;
+  int width = convert->width;
+  int i;
+
+  threads = g_new0 (ColorspaceThreads, 1);
+  threads->n_threads = n_threads;
+  threads->bands = g_new0 (ColorspaceBand, n_threads);
+  for (i = 0; i < n_threads; i++) {
+    band = &threads->bands[i];
+    band->threads = threads;
+    band->tmpline = g_malloc (sizeof (guint8) * (width + 8) * 4);
+    band->tmpline16 = g_malloc (sizeof (guint16) * (width + 8) * 4);
+    band->errline = g_malloc (sizeof (guint16) * width * 4);
+  }
+
+  threads->pool = g_thread_pool_new (colorspace_band_convert, NULL,
+      n_threads - 1, TRUE, NULL);
+  if (threads->pool == NULL) {
+    colorspace_threads_free (threads);
+    return NULL;
+  }
+  threads->lock = g_mutex_new ();
+  threads->cond = g_cond_new ();
+
+  return threads;
+}
+
+static void
+colorspace_threads_free (ColorspaceThreads * threads)
+{
+  int i;
+
+  if (threads->pool)
+    g_thread_pool_free (threads->pool, FALSE, TRUE);
+  if (threads->lock)
+    g_mutex_free (threads->lock);
+  if (threads->cond)
+    g_cond_free (threads->cond);
+
+  for (i = 0; i < threads->n_threads; i++) {
+    g_free (threads->bands[i].tmpline);
+    g_free (threads->bands[i].tmpline16);
+    g_free (threads->bands[i].errline);
+  }
+  g_free (threads->bands);
+  g_free (threads);
+}
+
+/* restrict a copy of @convert to the lines @y to @y + @height */
+static void
+colorspace_band_setup (ColorspaceBand * band, ColorspaceConvert * convert,
+    int y, int height, guint8 * dest, const guint8 * src)
+{
+  int i;
+
+  memcpy (&band->convert, convert, sizeof (ColorspaceConvert));
+  band->convert.threads = NULL;
+  band->convert.tmpline = band->tmpline;
+  band->convert.tmpline16 = band->tmpline16;
+  band->convert.errline = band->errline;
+  band->convert.height = height;
+
+  if (y > 0) {
+    for (i = 0; i < 4; i++) {
+      band->convert.dest_offset[i] += convert->dest_stride[i] *
+          gst_video_format_get_component_height (convert->to_format, i, y);
+      band->convert.src_offset[i] += convert->src_stride[i] *
+          gst_video_format_get_component_height (convert->from_format, i, y);
+    }
+  }
+
+  band->dest = dest;
+  band->src = src;
+}
+
+static void
+colorspace_convert_threaded (ColorspaceConvert * convert, guint8 * dest,
+    const guint8 * src)
+{
+  ColorspaceThreads *threads = convert->threads;
+  int band_height, n_bands, y, i;
+
+  band_height = (convert->height + threads->n_threads - 1) /
+      threads->n_threads;
+  band_height = (band_height + COLORSPACE_BAND_ALIGN - 1) &
+      ~(COLORSPACE_BAND_ALIGN - 1);
+
+  n_bands = 0;
+  for (y = 0; y < convert->height; y += band_height) {
+    colorspace_band_setup (&threads->bands[n_bands], convert, y,
+        MIN (band_height, convert->height - y), dest, src);
+    n_bands++;
+  }
+
+  threads->n_pending = n_bands - 1;
+  for (i = 1; i < n_bands; i++)
+    g_thread_pool_push (threads->pool, &threads->bands[i], NULL);
+
+  colorspace_band_convert (&threads->bands[0], NULL);
+
+  g_mutex_lock (threads->lock);
+  while (threads->n_pending > 0)
+    g_cond_wait (threads->cond, threads->lock);
+  g_mutex_unlock (threads->lock);
+}
+
+void
+colorspace_convert_set_n_threads (ColorspaceConvert * convert, int n_threads)
+{
+  if (convert->threads) {
+    if (convert->threads->n_threads == n_threads)
+      return;
+    colorspace_threads_free (convert->threads);
+    convert->threads = NULL;
+  }
+
+  if (n_threads > 1)
+    convert->threads = colorspace_threads_new (convert, n_threads);
+}
+
 void
 colorspace_convert_convert (ColorspaceConvert * convert,
     guint8 * dest, const guint8 * src)
 {
-  convert->convert (convert, dest, src);
+  /* error diffusion carries state from line to line */
+  if (convert->threads && convert->dither16 != colorspace_dither_verterr)
+    colorspace_convert_threaded (convert, dest, src);
+  else
+    convert->convert (convert, dest, src);
 }
 
 /* Line conversion to AYUV */
@@ -412,7 +593,7 @@ putline_v210 (ColorspaceConvert * convert, guint8 * dest, const guint8 * src,
   int i;
   guint8 *destline = FRAME_GET_LINE (dest, 0, j);
 
-  for (i = 0; i < convert->width + 5; i += 6) {
+  for (i = 0; i < convert->width; i += 6) {
     guint32 a0, a1, a2, a3;
     guint16 y0, y1, y2, y3, y4, y5;
     guint16 u0, u1, u2;
@@ -518,7 +699,7 @@ putline16_v210 (ColorspaceConvert * convert, guint8 * dest, const guint16 * src,
   int i;
   guint8 *destline = FRAME_GET_LINE (dest, 0, j);
 
-  for (i = 0; i < convert->width + 5; i += 6) {
+  for (i = 0; i < convert->width; i += 6) {
     guint32 a0, a1, a2, a3;
     guint16 y0, y1, y2, y3, y4, y5;
     guint16 u0, u1, u2;
@@ -1753,7 +1934,7 @@ colorspace_convert_lookup_getput (ColorspaceConvert * convert)
   }
 }
 
-static void
+void
 colorspace_convert_generic (ColorspaceConvert * convert, guint8 * dest,
     const guint8 * src)
 {
@@ -2286,6 +2467,294 @@ convert_Y444_AYUV (ColorspaceConvert * convert, guint8 * dest,
       convert->src_stride[2], convert->width, convert->height);
 }
 
+/* 10 bit fast paths
+ *
+ * These give the same result as the generic 16 bit path without dithering,
+ * but unpack to and pack from 10 bit planar lines instead of going through
+ * an AYUV64 line, the matrix and, for 8 bit formats, an AYUV line. */
+
+static gboolean
+convert_needs_generic (ColorspaceConvert * convert, guint8 * dest,
+    const guint8 * src)
+{
+  if (convert->dither16 == colorspace_dither_none)
+    return FALSE;
+
+  colorspace_convert_generic (convert, dest, src);
+  return TRUE;
+}
+
+/* the 10 bit planar lines are stored in tmpline16, which is large enough
+ * to hold the lines rounded up to a v210 group of 6 pixels */
+#define V210_LINES(convert, ly, lu, lv) G_STMT_START {                  \
+  ly = (convert)->tmpline16;                                            \
+  lu = ly + (((convert)->width + 5) / 6) * 6;                           \
+  lv = lu + (((convert)->width + 5) / 6) * 3;                           \
+} G_STMT_END
+
+static void
+unpack_v210_line (guint16 * y, guint16 * u, guint16 * v, const guint8 * src,
+    int width)
+{
+  int i;
+
+  for (i = 0; i < width; i += 6) {
+    guint32 a0, a1, a2, a3;
+
+    a0 = GST_READ_UINT32_LE (src + 0);
+    a1 = GST_READ_UINT32_LE (src + 4);
+    a2 = GST_READ_UINT32_LE (src + 8);
+    a3 = GST_READ_UINT32_LE (src + 12);
+
+    u[0] = (a0 >> 0) & 0x3ff;
+    y[0] = (a0 >> 10) & 0x3ff;
+    v[0] = (a0 >> 20) & 0x3ff;
+    y[1] = (a1 >> 0) & 0x3ff;
+    u[1] = (a1 >> 10) & 0x3ff;
+    y[2] = (a1 >> 20) & 0x3ff;
+    v[1] = (a2 >> 0) & 0x3ff;
+    y[3] = (a2 >> 10) & 0x3ff;
+    u[2] = (a2 >> 20) & 0x3ff;
+    y[4] = (a3 >> 0) & 0x3ff;
+    v[2] = (a3 >> 10) & 0x3ff;
+    y[5] = (a3 >> 20) & 0x3ff;
+
+    src += 16;
+    y += 6;
+    u += 3;
+    v += 3;
+  }
+}
+
+static void
+pack_v210_line (guint8 * dest, const guint16 * y, const guint16 * u,
+    const guint16 * v, int width)
+{
+  int i;
+
+  for (i = 0; i < width; i += 6) {
+    GST_WRITE_UINT32_LE (dest + 0, u[0] | (y[0] << 10) | (v[0] << 20));
+    GST_WRITE_UINT32_LE (dest + 4, y[1] | (u[1] << 10) | (y[2] << 20));
+    GST_WRITE_UINT32_LE (dest + 8, v[1] | (y[3] << 10) | (u[2] << 20));
+    GST_WRITE_UINT32_LE (dest + 12, y[4] | (v[2] << 10) | (y[5] << 20));
+
+    dest += 16;
+    y += 6;
+    u += 3;
+    v += 3;
+  }
+}
+
+/* the part of the last v210 group past the end of the line */
+static void
+clear_v210_tail (guint16 * y, guint16 * u, guint16 * v, int width)
+{
+  int i, n = ((width + 5) / 6) * 6;
+
+  for (i = width; i < n; i++)
+    y[i] = 0;
+  for (i = (width + 1) / 2; i < n / 2; i++) {
+    u[i] = 0;
+    v[i] = 0;
+  }
+}
+
+static void
+convert_v210_I420 (ColorspaceConvert * convert, guint8 * dest,
+    const guint8 * src)
+{
+  int i, j, n = convert->width / 2;
+  guint16 *ly, *lu, *lv;
+  guint8 *dy, *du, *dv;
+
+  if (convert_needs_generic (convert, dest, src))
+    return;
+
+  V210_LINES (convert, ly, lu, lv);
+  for (j = 0; j < convert->height; j++) {
+    unpack_v210_line (ly, lu, lv, FRAME_GET_LINE (src, 0, j), convert->width);
+
+    dy = FRAME_GET_LINE (dest, 0, j);
+    for (i = 0; i < 2 * n; i++)
+      dy[i] = ly[i] >> 2;
+
+    /* like putline_I420, the second line of a pair provides the chroma */
+    if ((j & 1) || j == convert->height - 1) {
+      du = FRAME_GET_LINE (dest, 1, j >> 1);
+      dv = FRAME_GET_LINE (dest, 2, j >> 1);
+      for (i = 0; i < n; i++) {
+        du[i] = lu[i] >> 2;
+        dv[i] = lv[i] >> 2;
+      }
+    }
+  }
+}
+
+static void
+convert_v210_UYVY (ColorspaceConvert * convert, guint8 * dest,
+    const guint8 * src)
+{
+  int i, j, n = convert->width / 2;
+  guint16 *ly, *lu, *lv;
+  guint8 *d;
+
+  if (convert_needs_generic (convert, dest, src))
+    return;
+
+  V210_LINES (convert, ly, lu, lv);
+  for (j = 0; j < convert->height; j++) {
+    unpack_v210_line (ly, lu, lv, FRAME_GET_LINE (src, 0, j), convert->width);
+
+    d = FRAME_GET_LINE (dest, 0, j);
+    for (i = 0; i < n; i++) {
+      d[4 * i + 0] = lu[i] >> 2;
+      d[4 * i + 1] = ly[2 * i + 0] >> 2;
+      d[4 * i + 2] = lv[i] >> 2;
+      d[4 * i + 3] = ly[2 * i + 1] >> 2;
+    }
+  }
+}
+
+static void
+convert_I420_v210 (ColorspaceConvert * convert, guint8 * dest,
+    const guint8 * src)
+{
+  int i, j;
+  guint16 *ly, *lu, *lv;
+  const guint8 *sy, *su, *sv;
+
+  if (convert_needs_generic (convert, dest, src))
+    return;
+
+  V210_LINES (convert, ly, lu, lv);
+  clear_v210_tail (ly, lu, lv, convert->width);
+  for (j = 0; j < convert->height; j++) {
+    sy = FRAME_GET_LINE (src, 0, j);
+    su = FRAME_GET_LINE (src, 1, j >> 1);
+    sv = FRAME_GET_LINE (src, 2, j >> 1);
+    for (i = 0; i < convert->width; i++)
+      ly[i] = sy[i] << 2;
+    for (i = 0; i < (convert->width + 1) / 2; i++) {
+      lu[i] = su[i] << 2;
+      lv[i] = sv[i] << 2;
+    }
+
+    pack_v210_line (FRAME_GET_LINE (dest, 0, j), ly, lu, lv, convert->width);
+  }
+}
+
+static void
+convert_UYVY_v210 (ColorspaceConvert * convert, guint8 * dest,
+    const guint8 * src)
+{
+  int i, j, n = (convert->width + 1) / 2;
+  guint16 *ly, *lu, *lv;
+  const guint8 *s;
+
+  if (convert_needs_generic (convert, dest, src))
+    return;
+
+  V210_LINES (convert, ly, lu, lv);
+  clear_v210_tail (ly, lu, lv, 2 * n);
+  for (j = 0; j < convert->height; j++) {
+    s = FRAME_GET_LINE (src, 0, j);
+    for (i = 0; i < n; i++) {
+      lu[i] = s[4 * i + 0] << 2;
+      ly[2 * i + 0] = s[4 * i + 1] << 2;
+      lv[i] = s[4 * i + 2] << 2;
+      ly[2 * i + 1] = s[4 * i + 3] << 2;
+    }
+
+    pack_v210_line (FRAME_GET_LINE (dest, 0, j), ly, lu, lv, convert->width);
+  }
+}
+
+static void
+convert_v210_AYUV64 (ColorspaceConvert * convert, guint8 * dest,
+    const guint8 * src)
+{
+  int i, j;
+  guint16 *ly, *lu, *lv;
+  guint16 *d;
+
+  if (convert_needs_generic (convert, dest, src))
+    return;
+
+  V210_LINES (convert, ly, lu, lv);
+  for (j = 0; j < convert->height; j++) {
+    unpack_v210_line (ly, lu, lv, FRAME_GET_LINE (src, 0, j), convert->width);
+
+    d = (guint16 *) FRAME_GET_LINE (dest, 0, j);
+    for (i = 0; i < convert->width; i++) {
+      d[4 * i + 0] = 0xffff;
+      d[4 * i + 1] = ly[i] << 6;
+      d[4 * i + 2] = lu[i >> 1] << 6;
+      d[4 * i + 3] = lv[i >> 1] << 6;
+    }
+  }
+}
+
+static void
+convert_AYUV64_v210 (ColorspaceConvert * convert, guint8 * dest,
+    const guint8 * src)
+{
+  int i, j, n = convert->width / 2;
+  guint16 *ly, *lu, *lv;
+  const guint16 *s;
+
+  if (convert_needs_generic (convert, dest, src))
+    return;
+
+  V210_LINES (convert, ly, lu, lv);
+  clear_v210_tail (ly, lu, lv, convert->width);
+  for (j = 0; j < convert->height; j++) {
+    s = (const guint16 *) FRAME_GET_LINE (src, 0, j);
+    for (i = 0; i < convert->width; i++)
+      ly[i] = s[4 * i + 1] >> 6;
+    /* like putline16_v210, the chroma of a pair is averaged */
+    for (i = 0; i < n; i++) {
+      lu[i] = (s[8 * i + 2] + s[8 * i + 6] + 1) >> 7;
+      lv[i] = (s[8 * i + 3] + s[8 * i + 7] + 1) >> 7;
+    }
+    if (convert->width & 1) {
+      lu[n] = s[8 * n + 2] >> 6;
+      lv[n] = s[8 * n + 3] >> 6;
+    }
+
+    pack_v210_line (FRAME_GET_LINE (dest, 0, j), ly, lu, lv, convert->width);
+  }
+}
+
+/* The r210 line functions already work on AYUV64 lines, which is what
+ * ARGB64 frames consist of, so use them on the frames directly instead of
+ * going through tmpline16 and the identity matrix */
+static void
+convert_r210_ARGB64 (ColorspaceConvert * convert, guint8 * dest,
+    const guint8 * src)
+{
+  int j;
+
+  if (convert_needs_generic (convert, dest, src))
+    return;
+
+  for (j = 0; j < convert->height; j++)
+    getline16_r210 (convert, (guint16 *) FRAME_GET_LINE (dest, 0, j), src, j);
+}
+
+static void
+convert_ARGB64_r210 (ColorspaceConvert * convert, guint8 * dest,
+    const guint8 * src)
+{
+  int j;
+
+  if (convert_needs_generic (convert, dest, src))
+    return;
+
+  for (j = 0; j < convert->height; j++)
+    putline16_r210 (convert, dest,
+        (const guint16 *) FRAME_GET_LINE (src, 0, j), j);
+}
+
 #if G_BYTE_ORDER == G_LITTLE_ENDIAN
 static void
 convert_AYUV_ARGB (ColorspaceConvert * convert, guint8 * dest,
@@ -2437,6 +2906,24 @@ static const ColorspaceTransform transforms[] = {
   {GST_VIDEO_FORMAT_Y444, COLOR_SPEC_NONE, GST_VIDEO_FORMAT_Y42B,
       COLOR_SPEC_NONE, TRUE, convert_Y444_Y42B},
 
+  {GST_VIDEO_FORMAT_v210, COLOR_SPEC_NONE, GST_VIDEO_FORMAT_I420,
+      COLOR_SPEC_NONE, TRUE, convert_v210_I420},
+  {GST_VIDEO_FORMAT_v210, COLOR_SPEC_NONE, GST_VIDEO_FORMAT_UYVY,
+      COLOR_SPEC_NONE, TRUE, convert_v210_UYVY},
+  {GST_VIDEO_FORMAT_I420, COLOR_SPEC_NONE, GST_VIDEO_FORMAT_v210,
+      COLOR_SPEC_NONE, TRUE, convert_I420_v210},
+  {GST_VIDEO_FORMAT_UYVY, COLOR_SPEC_NONE, GST_VIDEO_FORMAT_v210,
+      COLOR_SPEC_NONE, TRUE, convert_UYVY_v210},
+  {GST_VIDEO_FORMAT_v210, COLOR_SPEC_NONE, GST_VIDEO_FORMAT_AYUV64,
+      COLOR_SPEC_NONE, TRUE, convert_v210_AYUV64},
+  {GST_VIDEO_FORMAT_AYUV64, COLOR_SPEC_NONE, GST_VIDEO_FORMAT_v210,
+      COLOR_SPEC_NONE, TRUE, convert_AYUV64_v210},
+
+  {GST_VIDEO_FORMAT_r210, COLOR_SPEC_NONE, GST_VIDEO_FORMAT_ARGB64,
+      COLOR_SPEC_NONE, TRUE, convert_r210_ARGB64},
+  {GST_VIDEO_FORMAT_ARGB64, COLOR_SPEC_NONE, GST_VIDEO_FORMAT_r210,
+      COLOR_SPEC_NONE, TRUE, convert_ARGB64_r210},
+
 #if G_BYTE_ORDER == G_LITTLE_ENDIAN
   {GST_VIDEO_FORMAT_AYUV, COLOR_SPEC_YUV_BT470_6, GST_VIDEO_FORMAT_ARGB,
       COLOR_SPEC_RGB, FALSE, convert_AYUV_ARGB},
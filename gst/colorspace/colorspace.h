@@ -26,6 +26,7 @@ G_BEGIN_DECLS
 
 typedef struct _ColorspaceConvert ColorspaceConvert;
 typedef struct _ColorspaceFrame ColorspaceComponent;
+typedef struct _ColorspaceThreads ColorspaceThreads;
 
 typedef enum {
   COLOR_SPEC_NONE = 0,
@@ -77,6 +78,9 @@ struct _ColorspaceConvert {
   void (*putline16) (ColorspaceConvert *convert, guint8 *dest, const guint16 *src, int j);
   void (*matrix16) (ColorspaceConvert *convert);
   void (*dither16) (ColorspaceConvert *convert, int j);
+
+  /* worker threads and per band state, NULL when converting on one thread */
+  ColorspaceThreads *threads;
 };
 
 ColorspaceConvert * colorspace_convert_new (GstVideoFormat to_format,
@@ -85,12 +89,17 @@ ColorspaceConvert * colorspace_convert_new (GstVideoFormat to_format,
 void colorspace_convert_set_dither (ColorspaceConvert * convert, int type);
 void colorspace_convert_set_interlaced (ColorspaceConvert *convert,
     gboolean interlaced);
+void colorspace_convert_set_n_threads (ColorspaceConvert *convert,
+    int n_threads);
 void colorspace_convert_set_palette (ColorspaceConvert *convert,
     const guint32 *palette);
 const guint32 * colorspace_convert_get_palette (ColorspaceConvert *convert);
 void colorspace_convert_free (ColorspaceConvert * convert);
 void colorspace_convert_convert (ColorspaceConvert * convert,
     guint8 *dest, const guint8 *src);
+/* line by line through the generic path, bypassing any fast path */
+void colorspace_convert_generic (ColorspaceConvert * convert,
+    guint8 *dest, const guint8 *src);
 
 
 G_END_DECLS
@@ -57,6 +57,7 @@ struct _GstCsp {
 
   ColorspaceConvert *convert;
   gboolean dither;
+  guint n_threads;
 };
 
 struct _GstCspClass
@@ -24,8 +24,10 @@
 #include "config.h"
 #endif
 #include <string.h>
+#include <math.h>
 
 #include <gst/gst.h>
+#include <gst/gst-i18n-plugin.h>
 #include <gst/base/gstcollectpads.h>
 #include <gst/video/video.h>
 
@@ -77,6 +79,31 @@ gst_compare_method_get_type (void)
   return method_type;
 }
 
+enum GstCompareReportFormat
+{
+  GST_COMPARE_REPORT_CSV,
+  GST_COMPARE_REPORT_BINARY
+};
+
+#define GST_COMPARE_REPORT_FORMAT_TYPE (gst_compare_report_format_get_type())
+static GType
+gst_compare_report_format_get_type (void)
+{
+  static GType format_type = 0;
+
+  static const GEnumValue format_types[] = {
+    {GST_COMPARE_REPORT_CSV, "Comma separated values", "csv"},
+    {GST_COMPARE_REPORT_BINARY, "Binary records", "binary"},
+    {0, NULL, NULL}
+  };
+
+  if (!format_type) {
+    format_type = g_enum_register_static ("GstCompareReportFormat",
+        format_types);
+  }
+  return format_type;
+}
+
 /* Filter signals and args */
 enum
 {
@@ -92,6 +119,10 @@ enum
   PROP_METHOD,
   PROP_THRESHOLD,
   PROP_UPPER,
+  PROP_LOCATION,
+  PROP_REPORT_FORMAT,
+  PROP_N_THREADS,
+  PROP_MAX_PENDING,
   PROP_LAST
 };
 
@@ -100,6 +131,10 @@ enum
 #define DEFAULT_METHOD           GST_COMPARE_METHOD_MEM
 #define DEFAULT_THRESHOLD        0
 #define DEFAULT_UPPER            TRUE
+#define DEFAULT_LOCATION         NULL
+#define DEFAULT_REPORT_FORMAT    GST_COMPARE_REPORT_CSV
+#define DEFAULT_N_THREADS        1
+#define DEFAULT_MAX_PENDING      0
 
 static void gst_compare_set_property (GObject * object,
     guint prop_id, const GValue * value, GParamSpec * pspec);
@@ -138,6 +173,7 @@ gst_compare_finalize (GObject * object)
   GstCompare *comp = GST_COMPARE (object);
 
   gst_object_unref (comp->cpads);
+  g_free (comp->location);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -182,6 +218,28 @@ gst_compare_class_init (GstCompareClass * klass)
       g_param_spec_boolean ("upper", "Threshold Upper Bound",
           "Whether threshold value is upper bound or lower bound for difference measure",
           DEFAULT_UPPER, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_LOCATION,
+      g_param_spec_string ("location", "Report Location",
+          "File to write the PSNR, SSIM and maximum difference of every plane "
+          "of every frame to (NULL = no report)",
+          DEFAULT_LOCATION, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_REPORT_FORMAT,
+      g_param_spec_enum ("report-format", "Report Format",
+          "Format of the records of the report",
+          GST_COMPARE_REPORT_FORMAT_TYPE, DEFAULT_REPORT_FORMAT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Threads",
+          "Number of threads measuring the frames for the report",
+          1, 64, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_MAX_PENDING,
+      g_param_spec_uint ("max-pending", "Maximum Pending",
+          "Maximum number of frames waiting to be measured for the report, "
+          "further frames are only checked against the threshold "
+          "(0 = unlimited)",
+          0, G_MAXUINT, DEFAULT_MAX_PENDING,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -216,6 +274,10 @@ gst_compare_init (GstCompare * comp, GstCompareClass * klass)
   comp->method = DEFAULT_METHOD;
   comp->threshold = DEFAULT_THRESHOLD;
   comp->upper = DEFAULT_UPPER;
+  comp->location = DEFAULT_LOCATION;
+  comp->report_format = DEFAULT_REPORT_FORMAT;
+  comp->n_threads = DEFAULT_N_THREADS;
+  comp->max_pending = DEFAULT_MAX_PENDING;
 
   gst_compare_reset (comp);
 }
@@ -247,7 +309,8 @@ gst_compare_getcaps (GstPad * pad)
 }
 
 static void
-gst_compare_meta (GstCompare * comp, GstBuffer * buf1, GstBuffer * buf2)
+gst_compare_meta (GstCompare * comp, GstBuffer * buf1, GstBuffer * buf2,
+    guint64 frame)
 {
   gint flags = 0;
 
@@ -304,7 +367,10 @@ gst_compare_meta (GstCompare * comp, GstBuffer * buf1, GstBuffer * buf2)
 
     gst_element_post_message (GST_ELEMENT (comp),
         gst_message_new_element (GST_OBJECT (comp),
-            gst_structure_new ("delta", "meta", G_TYPE_INT, flags, NULL)));
+            gst_structure_new ("delta", "meta", G_TYPE_INT, flags,
+                "frame", G_TYPE_UINT64, frame,
+                "timestamp", G_TYPE_UINT64, GST_BUFFER_TIMESTAMP (buf1),
+                NULL)));
   }
 }
 
@@ -371,11 +437,11 @@ gst_compare_ssim_window (GstCompare * comp, guint8 * data1, guint8 * data2,
     data2 += stride;
   }
 
-  avg1 = sum1 / count;
-  avg2 = sum2 / count;
-  var1 = ssum1 / count - avg1 * avg1;
-  var2 = ssum2 / count - avg2 * avg2;
-  cov = acov / count - avg1 * avg2;
+  avg1 = (gdouble) sum1 / count;
+  avg2 = (gdouble) sum2 / count;
+  var1 = (gdouble) ssum1 / count - avg1 * avg1;
+  var2 = (gdouble) ssum2 / count - avg2 * avg2;
+  cov = (gdouble) acov / count - avg1 * avg2;
 
   return (2 * avg1 * avg2 + c1) * (2 * cov + c2) /
       ((avg1 * avg1 + avg2 * avg2 + c1) * (var1 + var2 + c2));
@@ -404,6 +470,11 @@ gst_compare_ssim_component (GstCompare * comp, guint8 * data1, guint8 * data2,
     }
   }
 
+  /* too small for overlapping windows */
+  if (count == 0)
+    return gst_compare_ssim_window (comp, data1, data2, width, height, step,
+        stride);
+
   return (ssim_sum / count);
 }
 
@@ -492,13 +563,11 @@ unsupported_input:
 }
 
 static void
-gst_compare_buffers (GstCompare * comp, GstBuffer * buf1, GstBuffer * buf2)
+gst_compare_content (GstCompare * comp, GstBuffer * buf1, GstBuffer * buf2,
+    guint64 frame)
 {
   gdouble delta = 0;
 
-  /* first check metadata */
-  gst_compare_meta (comp, buf1, buf2);
-
   /* check content according to method */
   /* but at least size should match */
   if (GST_BUFFER_SIZE (buf1) != GST_BUFFER_SIZE (buf2)) {
@@ -532,10 +601,335 @@ gst_compare_buffers (GstCompare * comp, GstBuffer * buf1, GstBuffer * buf2)
     gst_element_post_message (GST_ELEMENT (comp),
         gst_message_new_element (GST_OBJECT (comp),
             gst_structure_new ("delta", "content", G_TYPE_DOUBLE, delta,
+                "frame", G_TYPE_UINT64, frame,
+                "timestamp", G_TYPE_UINT64, GST_BUFFER_TIMESTAMP (buf1),
                 NULL)));
   }
 }
 
+static void
+gst_compare_buffers (GstCompare * comp, GstBuffer * buf1, GstBuffer * buf2,
+    guint64 frame)
+{
+  /* first check metadata */
+  gst_compare_meta (comp, buf1, buf2, frame);
+
+  gst_compare_content (comp, buf1, buf2, frame);
+}
+
+/* Report
+ *
+ * With a location set, the content of every pair of buffers is compared by
+ * a pool of workers instead of on the streaming thread, which only queues
+ * the buffers and goes on pushing.  The workers measure the PSNR, SSIM and
+ * maximum difference of every plane of raw 8 bit video, and the records are
+ * written in frame order by whichever worker finishes the oldest pending
+ * frame.  Frames beyond max-pending are left out of the report, their
+ * content is compared on the streaming thread.
+ *
+ * CSV reports have a header line and a line per plane:
+ *   frame,timestamp,plane,psnr,ssim,max-diff
+ * with the timestamp in nanoseconds (-1 if none) and the psnr inf for
+ * identical planes.
+ *
+ * Binary reports are a sequence of little endian records:
+ *   guint64 frame, guint64 timestamp, guint8 n_planes,
+ *   n_planes * (gfloat psnr, gfloat ssim, guint8 max-diff)
+ *
+ * Frames that are no raw 8 bit video or whose sizes differ have no planes.
+ */
+
+#define GST_COMPARE_MAX_PLANES 4
+
+typedef struct
+{
+  gdouble psnr;
+  gdouble ssim;
+  gint max;
+} GstComparePlaneMetrics;
+
+typedef struct
+{
+  GstBuffer *buf1;
+  GstBuffer *buf2;
+  guint64 frame;
+  GstClockTime timestamp;
+
+  gboolean done;
+  gint n_planes;
+  GstComparePlaneMetrics planes[GST_COMPARE_MAX_PLANES];
+} GstCompareJob;
+
+static void
+gst_compare_plane_metrics (GstCompare * comp, guint8 * data1, guint8 * data2,
+    gint width, gint height, gint step, gint stride,
+    GstComparePlaneMetrics * metrics)
+{
+  guint64 sse = 0;
+  gint i, j, max = 0;
+
+  for (j = 0; j < height; j++) {
+    guint8 *line1 = data1 + j * stride, *line2 = data2 + j * stride;
+
+    for (i = 0; i < width; i++) {
+      gint diff = ABS (line1[i * step] - line2[i * step]);
+
+      sse += diff * diff;
+      max = MAX (max, diff);
+    }
+  }
+
+  metrics->max = max;
+  if (sse == 0)
+    metrics->psnr = HUGE_VAL;
+  else
+    metrics->psnr = 10 * log10 (255.0 * 255.0 * width * height / sse);
+  metrics->ssim = gst_compare_ssim_component (comp, data1, data2, width,
+      height, step, stride);
+}
+
+/* returns the number of planes measured */
+static gint
+gst_compare_frame_metrics (GstCompare * comp, GstBuffer * buf1,
+    GstBuffer * buf2, GstComparePlaneMetrics * planes)
+{
+  GstVideoFormat format, f;
+  gint width, height, w, h, i, comps;
+
+  if (GST_BUFFER_SIZE (buf1) != GST_BUFFER_SIZE (buf2))
+    return 0;
+
+  if (!GST_BUFFER_CAPS (buf1) || !GST_BUFFER_CAPS (buf2) ||
+      !gst_video_format_parse_caps (GST_BUFFER_CAPS (buf1), &format, &width,
+          &height) ||
+      !gst_video_format_parse_caps (GST_BUFFER_CAPS (buf2), &f, &w, &h) ||
+      f != format || w != width || h != height)
+    return 0;
+
+  comps = gst_video_format_is_gray (format) ? 1 : 3;
+  if (gst_video_format_has_alpha (format))
+    comps += 1;
+
+  for (i = 0; i < comps; i++) {
+    gint offset, cw, ch, step, stride;
+
+    if (gst_video_format_get_component_depth (format, i) != 8)
+      return 0;
+    offset = gst_video_format_get_component_offset (format, i, width, height);
+    cw = gst_video_format_get_component_width (format, i, width);
+    ch = gst_video_format_get_component_height (format, i, height);
+    step = gst_video_format_get_pixel_stride (format, i);
+    stride = gst_video_format_get_row_stride (format, i, width);
+
+    gst_compare_plane_metrics (comp, GST_BUFFER_DATA (buf1) + offset,
+        GST_BUFFER_DATA (buf2) + offset, cw, ch, step, stride, &planes[i]);
+  }
+
+  return comps;
+}
+
+/* returns FALSE with errno set if writing failed */
+static gboolean
+gst_compare_write_record (GstCompare * comp, GstCompareJob * job)
+{
+  gint i;
+
+  if (comp->report_format == GST_COMPARE_REPORT_CSV) {
+    for (i = 0; i < job->n_planes; i++) {
+      gchar psnr[G_ASCII_DTOSTR_BUF_SIZE], ssim[G_ASCII_DTOSTR_BUF_SIZE];
+
+      g_ascii_formatd (psnr, sizeof (psnr), "%.4f", job->planes[i].psnr);
+      g_ascii_formatd (ssim, sizeof (ssim), "%.6f", job->planes[i].ssim);
+      if (fprintf (comp->report, "%" G_GUINT64_FORMAT ",%" G_GINT64_FORMAT
+              ",%d,%s,%s,%d\n", job->frame, (gint64) job->timestamp, i, psnr,
+              ssim, job->planes[i].max) < 0)
+        return FALSE;
+    }
+  } else {
+    guint8 record[17 + GST_COMPARE_MAX_PLANES * 9], *data;
+
+    GST_WRITE_UINT64_LE (record, job->frame);
+    GST_WRITE_UINT64_LE (record + 8, job->timestamp);
+    GST_WRITE_UINT8 (record + 16, job->n_planes);
+    data = record + 17;
+    for (i = 0; i < job->n_planes; i++) {
+      GST_WRITE_FLOAT_LE (data, job->planes[i].psnr);
+      GST_WRITE_FLOAT_LE (data + 4, job->planes[i].ssim);
+      GST_WRITE_UINT8 (data + 8, job->planes[i].max);
+      data += 9;
+    }
+    if (fwrite (record, data - record, 1, comp->report) != 1)
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+static void
+gst_compare_job_func (gpointer data, gpointer user_data)
+{
+  GstCompareJob *job = data;
+  GstCompare *comp = user_data;
+
+  gst_compare_content (comp, job->buf1, job->buf2, job->frame);
+  job->n_planes = gst_compare_frame_metrics (comp, job->buf1, job->buf2,
+      job->planes);
+  gst_buffer_unref (job->buf1);
+  gst_buffer_unref (job->buf2);
+  job->buf1 = job->buf2 = NULL;
+
+  g_mutex_lock (comp->report_lock);
+  job->done = TRUE;
+  g_mutex_unlock (comp->report_lock);
+
+  /* The records are written in frame order by whichever worker gets the
+   * write lock, the others leave their finished jobs to it.  The streaming
+   * thread only takes report_lock, so it never waits for the file */
+  for (;;) {
+    GQueue done = G_QUEUE_INIT;
+    gboolean more;
+
+    if (!g_mutex_trylock (comp->write_lock))
+      return;
+
+    g_mutex_lock (comp->report_lock);
+    while ((job = g_queue_peek_head (comp->jobs)) && job->done)
+      g_queue_push_tail (&done, g_queue_pop_head (comp->jobs));
+    g_mutex_unlock (comp->report_lock);
+
+    while ((job = g_queue_pop_head (&done))) {
+      /* the remaining records are dropped after an error */
+      if (!comp->write_failed && !gst_compare_write_record (comp, job)) {
+        comp->write_failed = TRUE;
+        GST_ELEMENT_ERROR (comp, RESOURCE, WRITE,
+            (_("Could not write to file \"%s\"."), comp->location),
+            GST_ERROR_SYSTEM);
+      }
+      g_slice_free (GstCompareJob, job);
+    }
+    g_mutex_unlock (comp->write_lock);
+
+    /* a job finished while we were writing, and its worker saw the write
+     * lock taken */
+    g_mutex_lock (comp->report_lock);
+    more = (job = g_queue_peek_head (comp->jobs)) && job->done;
+    g_mutex_unlock (comp->report_lock);
+    if (!more)
+      return;
+  }
+}
+
+static void
+gst_compare_queue_job (GstCompare * comp, GstBuffer * buf1, GstBuffer * buf2,
+    guint64 frame)
+{
+  GstCompareJob *job;
+
+  g_mutex_lock (comp->report_lock);
+  if (comp->max_pending > 0 &&
+      g_queue_get_length (comp->jobs) >= comp->max_pending) {
+    g_mutex_unlock (comp->report_lock);
+    comp->skipped++;
+    GST_WARNING_OBJECT (comp, "%u frames pending, not measuring frame %"
+        G_GUINT64_FORMAT, comp->max_pending, frame);
+    /* it still has to match the reference */
+    gst_compare_content (comp, buf1, buf2, frame);
+    return;
+  }
+
+  job = g_slice_new0 (GstCompareJob);
+  job->buf1 = gst_buffer_ref (buf1);
+  job->buf2 = gst_buffer_ref (buf2);
+  job->frame = frame;
+  job->timestamp = GST_BUFFER_TIMESTAMP (buf1);
+  g_queue_push_tail (comp->jobs, job);
+  g_mutex_unlock (comp->report_lock);
+
+  g_thread_pool_push (comp->pool, job, NULL);
+}
+
+static gboolean
+gst_compare_report_start (GstCompare * comp)
+{
+  comp->frames = 0;
+  comp->skipped = 0;
+  comp->write_failed = FALSE;
+
+  if (comp->location == NULL || comp->location[0] == '\0')
+    return TRUE;
+
+  comp->report = fopen (comp->location, "wb");
+  if (comp->report == NULL)
+    goto open_failed;
+  if (comp->report_format == GST_COMPARE_REPORT_CSV &&
+      fputs ("frame,timestamp,plane,psnr,ssim,max-diff\n", comp->report) < 0)
+    goto write_failed;
+
+  comp->pool = g_thread_pool_new (gst_compare_job_func, comp, comp->n_threads,
+      TRUE, NULL);
+  if (comp->pool == NULL)
+    goto no_threads;
+  comp->report_lock = g_mutex_new ();
+  comp->jobs = g_queue_new ();
+  comp->write_lock = g_mutex_new ();
+
+  return TRUE;
+
+  /* ERRORS */
+open_failed:
+  {
+    GST_ELEMENT_ERROR (comp, RESOURCE, OPEN_WRITE,
+        (_("Could not open file \"%s\" for writing."), comp->location),
+        GST_ERROR_SYSTEM);
+    return FALSE;
+  }
+write_failed:
+  {
+    GST_ELEMENT_ERROR (comp, RESOURCE, WRITE,
+        (_("Could not write to file \"%s\"."), comp->location),
+        GST_ERROR_SYSTEM);
+    fclose (comp->report);
+    comp->report = NULL;
+    return FALSE;
+  }
+no_threads:
+  {
+    GST_ELEMENT_ERROR (comp, CORE, FAILED, (NULL),
+        ("could not create %u threads", comp->n_threads));
+    fclose (comp->report);
+    comp->report = NULL;
+    return FALSE;
+  }
+}
+
+static void
+gst_compare_report_stop (GstCompare * comp)
+{
+  if (comp->pool == NULL)
+    return;
+
+  /* measures and writes all pending frames */
+  g_thread_pool_free (comp->pool, FALSE, TRUE);
+  comp->pool = NULL;
+  g_assert (g_queue_is_empty (comp->jobs));
+  g_queue_free (comp->jobs);
+  comp->jobs = NULL;
+  g_mutex_free (comp->report_lock);
+  comp->report_lock = NULL;
+  g_mutex_free (comp->write_lock);
+  comp->write_lock = NULL;
+
+  /* buffered records may only fail to be written here */
+  if (fclose (comp->report) != 0 && !comp->write_failed)
+    GST_ELEMENT_ERROR (comp, RESOURCE, WRITE,
+        (_("Could not write to file \"%s\"."), comp->location),
+        GST_ERROR_SYSTEM);
+  comp->report = NULL;
+
+  GST_INFO_OBJECT (comp, "reported %" G_GUINT64_FORMAT " of %"
+      G_GUINT64_FORMAT " frames", comp->frames - comp->skipped, comp->frames);
+}
+
 static GstFlowReturn
 gst_compare_collect_pads (GstCollectPads * cpads, GstCompare * comp)
 {
@@ -551,7 +945,14 @@ gst_compare_collect_pads (GstCollectPads * cpads, GstCompare * comp)
     gst_pad_push_event (comp->srcpad, gst_event_new_eos ());
     return GST_FLOW_UNEXPECTED;
   } else if (buf1 && buf2) {
-    gst_compare_buffers (comp, buf1, buf2);
+    guint64 frame = comp->frames++;
+
+    if (comp->pool) {
+      gst_compare_meta (comp, buf1, buf2, frame);
+      gst_compare_queue_job (comp, buf1, buf2, frame);
+    } else {
+      gst_compare_buffers (comp, buf1, buf2, frame);
+    }
   } else {
     GST_WARNING_OBJECT (comp, "buffer %p != NULL", buf1 ? buf1 : buf2);
 
@@ -593,6 +994,19 @@ gst_compare_set_property (GObject * object, guint prop_id,
     case PROP_UPPER:
       comp->upper = g_value_get_boolean (value);
       break;
+    case PROP_LOCATION:
+      g_free (comp->location);
+      comp->location = g_value_dup_string (value);
+      break;
+    case PROP_REPORT_FORMAT:
+      comp->report_format = g_value_get_enum (value);
+      break;
+    case PROP_N_THREADS:
+      comp->n_threads = g_value_get_uint (value);
+      break;
+    case PROP_MAX_PENDING:
+      comp->max_pending = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -621,6 +1035,18 @@ gst_compare_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_UPPER:
       g_value_set_boolean (value, comp->upper);
       break;
+    case PROP_LOCATION:
+      g_value_set_string (value, comp->location);
+      break;
+    case PROP_REPORT_FORMAT:
+      g_value_set_enum (value, comp->report_format);
+      break;
+    case PROP_N_THREADS:
+      g_value_set_uint (value, comp->n_threads);
+      break;
+    case PROP_MAX_PENDING:
+      g_value_set_uint (value, comp->max_pending);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -635,7 +1061,11 @@ gst_compare_change_state (GstElement * element, GstStateChange transition)
 
   switch (transition) {
     case GST_STATE_CHANGE_NULL_TO_READY:
+      gst_collect_pads_start (comp->cpads);
+      break;
     case GST_STATE_CHANGE_READY_TO_PAUSED:
+      if (!gst_compare_report_start (comp))
+        return GST_STATE_CHANGE_FAILURE;
       gst_collect_pads_start (comp->cpads);
       break;
     case GST_STATE_CHANGE_PAUSED_TO_READY:
@@ -652,6 +1082,7 @@ gst_compare_change_state (GstElement * element, GstStateChange transition)
 
   switch (transition) {
     case GST_STATE_CHANGE_PAUSED_TO_READY:
+      gst_compare_report_stop (comp);
       gst_compare_reset (comp);
       break;
     default:
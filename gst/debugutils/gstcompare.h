@@ -27,6 +27,8 @@
 
 #include <gst/gst.h>
 
+#include <stdio.h>
+
 G_BEGIN_DECLS
 
 #define GST_TYPE_COMPARE \
@@ -62,6 +64,23 @@ struct _GstCompare {
   gint method;
   gdouble threshold;
   gboolean upper;
+  gchar *location;
+  gint report_format;
+  guint n_threads;
+  guint max_pending;
+
+  /* report, frames are measured by a pool of workers */
+  FILE *report;
+  GThreadPool *pool;
+  GMutex *report_lock;
+  /* frames waiting to be measured or written, oldest first */
+  GQueue *jobs;
+  /* held while writing to report, never while holding report_lock */
+  GMutex *write_lock;
+  /* writing to report failed, protected by write_lock */
+  gboolean write_failed;
+  guint64 frames;
+  guint64 skipped;
 };
 
 struct _GstCompareClass {
@@ -76,7 +76,8 @@ static GstVideoFilterClass *parent_class = NULL;
 enum
 {
   PROP_0,
-  PROP_OFF_EDGE_PIXELS
+  PROP_OFF_EDGE_PIXELS,
+  PROP_N_THREADS
 };
 
 #define GST_GT_OFF_EDGES_PIXELS_METHOD_TYPE ( \
@@ -102,6 +103,45 @@ gst_geometric_transform_off_edges_pixels_method_get_type (void)
 }
 
 #define DEFAULT_OFF_EDGE_PIXELS GST_GT_OFF_EDGES_PIXELS_IGNORE
+#define DEFAULT_N_THREADS 1
+
+/* Returns the offset of the input pixel to copy for an output pixel
+ * mapped to (@in_x, @in_y), or -1 if there is none */
+static gint32
+gst_geometric_transform_source_offset (GstGeometricTransform * gt,
+    gdouble in_x, gdouble in_y)
+{
+  gint trunc_x, trunc_y;
+
+  /* operate on out of edge pixels */
+  switch (gt->off_edge_pixels) {
+    case GST_GT_OFF_EDGES_PIXELS_CLAMP:
+      in_x = CLAMP (in_x, 0, gt->width - 1);
+      in_y = CLAMP (in_y, 0, gt->height - 1);
+      break;
+
+    case GST_GT_OFF_EDGES_PIXELS_WRAP:
+      in_x = mod_float (in_x, gt->width);
+      in_y = mod_float (in_y, gt->height);
+      if (in_x < 0)
+        in_x += gt->width;
+      if (in_y < 0)
+        in_y += gt->height;
+      break;
+
+    default:
+      break;
+  }
+
+  trunc_x = (gint) in_x;
+  trunc_y = (gint) in_y;
+  /* only valid positions have an input pixel */
+  if (trunc_x < 0 || trunc_x >= gt->width || trunc_y < 0 ||
+      trunc_y >= gt->height)
+    return -1;
+
+  return trunc_y * gt->row_stride + trunc_x * gt->pixel_stride;
+}
 
 /* must be called with the object lock */
 static gboolean
@@ -111,7 +151,7 @@ gst_geometric_transform_generate_map (GstGeometricTransform * gt)
   gdouble in_x, in_y;
   gboolean ret = TRUE;
   GstGeometricTransformClass *klass;
-  gdouble *ptr;
+  gint32 *ptr;
 
   /* cleanup old map */
   g_free (gt->map);
@@ -123,9 +163,10 @@ gst_geometric_transform_generate_map (GstGeometricTransform * gt)
   g_return_val_if_fail (klass->map_func, FALSE);
 
   /*
-   * (x,y) pairs of the inverse mapping
+   * input pixel offsets of the inverse mapping, the off edge pixels method
+   * is applied here once instead of for every frame
    */
-  gt->map = g_malloc0 (sizeof (gdouble) * gt->width * gt->height * 2);
+  gt->map = g_malloc (sizeof (gint32) * gt->width * gt->height);
   ptr = gt->map;
 
   for (y = 0; y < gt->height; y++) {
@@ -136,16 +177,15 @@ gst_geometric_transform_generate_map (GstGeometricTransform * gt)
         goto end;
       }
 
-      ptr[0] = in_x;
-      ptr[1] = in_y;
-      ptr += 2;
+      *ptr++ = gst_geometric_transform_source_offset (gt, in_x, in_y);
     }
   }
 
 end:
-  if (!ret)
+  if (!ret) {
     g_free (gt->map);
-  else
+    gt->map = NULL;
+  } else
     gt->needs_remap = FALSE;
   return ret;
 }
@@ -158,6 +198,7 @@ gst_geometric_transform_set_caps (GstBaseTransform * btrans, GstCaps * incaps,
   gboolean ret;
   gint old_width;
   gint old_height;
+  GstVideoFormat old_format;
   GstGeometricTransformClass *klass;
 
   gt = GST_GEOMETRIC_TRANSFORM_CAST (btrans);
@@ -165,6 +206,7 @@ gst_geometric_transform_set_caps (GstBaseTransform * btrans, GstCaps * incaps,
 
   old_width = gt->width;
   old_height = gt->height;
+  old_format = gt->format;
 
   ret = gst_video_format_parse_caps (incaps, &gt->format, &gt->width,
       &gt->height);
@@ -183,6 +225,9 @@ gst_geometric_transform_set_caps (GstBaseTransform * btrans, GstCaps * incaps,
         }
       if (gt->precalc_map)
         gst_geometric_transform_generate_map (gt);
+    } else if (gt->format != old_format) {
+      /* the offsets in the map depend on the pixel and row strides */
+      gt->needs_remap = TRUE;
     }
     GST_OBJECT_UNLOCK (gt);
   }
@@ -193,43 +238,194 @@ static void
 gst_geometric_transform_do_map (GstGeometricTransform * gt, GstBuffer * inbuf,
     GstBuffer * outbuf, gint x, gint y, gdouble in_x, gdouble in_y)
 {
-  gint in_offset;
+  gint32 in_offset;
   gint out_offset;
 
   out_offset = y * gt->row_stride + x * gt->pixel_stride;
+  in_offset = gst_geometric_transform_source_offset (gt, in_x, in_y);
 
-  /* operate on out of edge pixels */
-  switch (gt->off_edge_pixels) {
-    case GST_GT_OFF_EDGES_PIXELS_CLAMP:
-      in_x = CLAMP (in_x, 0, gt->width - 1);
-      in_y = CLAMP (in_y, 0, gt->height - 1);
-      break;
+  /* only set the values if the values are valid */
+  if (in_offset >= 0)
+    memcpy (GST_BUFFER_DATA (outbuf) + out_offset,
+        GST_BUFFER_DATA (inbuf) + in_offset, gt->pixel_stride);
+}
 
-    case GST_GT_OFF_EDGES_PIXELS_WRAP:
-      in_x = mod_float (in_x, gt->width);
-      in_y = mod_float (in_y, gt->height);
-      if (in_x < 0)
-        in_x += gt->width;
-      if (in_y < 0)
-        in_y += gt->height;
-      break;
+/* copies the input pixels of the lines @y_start to @y_end of the output
+ * according to the map.  Pixels without an input pixel and the padding at
+ * the end of the lines are black.  There is a loop per pixel size, so that
+ * the fixed size copies become single loads and stores */
+static void
+gst_geometric_transform_remap_lines (GstGeometricTransform * gt,
+    const guint8 * in, guint8 * out, gint y_start, gint y_end)
+{
+  const gint32 *map;
+  gint x, y, width = gt->width;
+  gint padding = gt->row_stride - width * gt->pixel_stride;
+
+  for (y = y_start; y < y_end; y++) {
+    guint8 *dest = out + y * gt->row_stride;
+
+    map = gt->map + y * width;
+    switch (gt->pixel_stride) {
+      case 1:
+        for (x = 0; x < width; x++)
+          dest[x] = (map[x] >= 0) ? in[map[x]] : 0;
+        break;
+      case 2:
+        for (x = 0; x < width; x++) {
+          guint16 v = 0;
+
+          if (map[x] >= 0)
+            memcpy (&v, in + map[x], 2);
+          memcpy (dest + x * 2, &v, 2);
+        }
+        break;
+      case 4:
+        for (x = 0; x < width; x++) {
+          guint32 v = 0;
+
+          if (map[x] >= 0)
+            memcpy (&v, in + map[x], 4);
+          memcpy (dest + x * 4, &v, 4);
+        }
+        break;
+      default:
+        for (x = 0; x < width; x++) {
+          if (map[x] >= 0)
+            memcpy (dest, in + map[x], gt->pixel_stride);
+          else
+            memset (dest, 0, gt->pixel_stride);
+          dest += gt->pixel_stride;
+        }
+        break;
+    }
+    if (padding > 0)
+      memset (out + y * gt->row_stride + width * gt->pixel_stride, 0, padding);
+  }
+}
 
-    default:
-      break;
+/* The map and the input are only read, so bands of output lines can be
+ * remapped concurrently */
+
+typedef struct
+{
+  GstGeometricTransform *gt;
+  GstGeometricTransformThreads *threads;
+
+  const guint8 *in;
+  guint8 *out;
+  gint y_start;
+  gint y_end;
+} GstGeometricTransformBand;
+
+struct _GstGeometricTransformThreads
+{
+  guint n_threads;
+  GstGeometricTransformBand *bands;
+
+  GThreadPool *pool;
+  GMutex *lock;
+  GCond *cond;
+  gint n_pending;
+};
+
+static void
+gst_geometric_transform_band_func (gpointer data, gpointer user_data)
+{
+  GstGeometricTransformBand *band = data;
+  GstGeometricTransformThreads *threads = band->threads;
+
+  gst_geometric_transform_remap_lines (band->gt, band->in, band->out,
+      band->y_start, band->y_end);
+
+  if (band != &threads->bands[0]) {
+    g_mutex_lock (threads->lock);
+    if (--threads->n_pending == 0)
+      g_cond_signal (threads->cond);
+    g_mutex_unlock (threads->lock);
   }
+}
 
-  {
-    gint trunc_x = (gint) in_x;
-    gint trunc_y = (gint) in_y;
-    /* only set the values if the values are valid */
-    if (trunc_x >= 0 && trunc_x < gt->width && trunc_y >= 0 &&
-        trunc_y < gt->height) {
-      in_offset = trunc_y * gt->row_stride + trunc_x * gt->pixel_stride;
+static void
+gst_geometric_transform_threads_free (GstGeometricTransformThreads * threads)
+{
+  if (threads->pool)
+    g_thread_pool_free (threads->pool, FALSE, TRUE);
+  if (threads->lock)
+    g_mutex_free (threads->lock);
+  if (threads->cond)
+    g_cond_free (threads->cond);
+  g_free (threads->bands);
+  g_free (threads);
+}
 
-      memcpy (GST_BUFFER_DATA (outbuf) + out_offset,
-          GST_BUFFER_DATA (inbuf) + in_offset, gt->pixel_stride);
-    }
+static GstGeometricTransformThreads *
+gst_geometric_transform_threads_new (guint n_threads)
+{
+  GstGeometricTransformThreads *threads;
+
+  threads = g_new0 (GstGeometricTransformThreads, 1);
+  threads->n_threads = n_threads;
+  threads->bands = g_new0 (GstGeometricTransformBand, n_threads);
+  threads->pool = g_thread_pool_new (gst_geometric_transform_band_func, NULL,
+      n_threads - 1, TRUE, NULL);
+  if (threads->pool == NULL) {
+    gst_geometric_transform_threads_free (threads);
+    return NULL;
   }
+  threads->lock = g_mutex_new ();
+  threads->cond = g_cond_new ();
+
+  return threads;
+}
+
+/* must be called with the object lock */
+static void
+gst_geometric_transform_remap (GstGeometricTransform * gt, const guint8 * in,
+    guint8 * out)
+{
+  GstGeometricTransformThreads *threads;
+  gint band_height, n_bands, y, i;
+
+  if (gt->threads && gt->threads->n_threads != gt->n_threads) {
+    gst_geometric_transform_threads_free (gt->threads);
+    gt->threads = NULL;
+  }
+  if (gt->threads == NULL && gt->n_threads > 1) {
+    gt->threads = gst_geometric_transform_threads_new (gt->n_threads);
+    if (gt->threads == NULL)
+      GST_WARNING_OBJECT (gt, "could not create %u threads", gt->n_threads);
+  }
+
+  threads = gt->threads;
+  if (threads == NULL) {
+    gst_geometric_transform_remap_lines (gt, in, out, 0, gt->height);
+    return;
+  }
+
+  band_height = (gt->height + threads->n_threads - 1) / threads->n_threads;
+  n_bands = 0;
+  for (y = 0; y < gt->height; y += band_height) {
+    GstGeometricTransformBand *band = &threads->bands[n_bands++];
+
+    band->gt = gt;
+    band->threads = threads;
+    band->in = in;
+    band->out = out;
+    band->y_start = y;
+    band->y_end = MIN (y + band_height, gt->height);
+  }
+
+  threads->n_pending = n_bands - 1;
+  for (i = 1; i < n_bands; i++)
+    g_thread_pool_push (threads->pool, &threads->bands[i], NULL);
+
+  gst_geometric_transform_band_func (&threads->bands[0], NULL);
+
+  g_mutex_lock (threads->lock);
+  while (threads->n_pending > 0)
+    g_cond_wait (threads->cond, threads->lock);
+  g_mutex_unlock (threads->lock);
 }
 
 static void
@@ -257,13 +453,10 @@ gst_geometric_transform_transform (GstBaseTransform * trans, GstBuffer * buf,
   GstGeometricTransformClass *klass;
   gint x, y;
   GstFlowReturn ret = GST_FLOW_OK;
-  gdouble *ptr;
 
   gt = GST_GEOMETRIC_TRANSFORM_CAST (trans);
   klass = GST_GEOMETRIC_TRANSFORM_GET_CLASS (gt);
 
-  memset (GST_BUFFER_DATA (outbuf), 0, GST_BUFFER_SIZE (outbuf));
-
   GST_OBJECT_LOCK (gt);
   if (gt->precalc_map) {
     if (gt->needs_remap) {
@@ -274,16 +467,15 @@ gst_geometric_transform_transform (GstBaseTransform * trans, GstBuffer * buf,
         }
       gst_geometric_transform_generate_map (gt);
     }
-    g_return_val_if_fail (gt->map, GST_FLOW_ERROR);
-    ptr = gt->map;
-    for (y = 0; y < gt->height; y++) {
-      for (x = 0; x < gt->width; x++) {
-        /* do the mapping */
-        gst_geometric_transform_do_map (gt, buf, outbuf, x, y, ptr[0], ptr[1]);
-        ptr += 2;
-      }
+    if (G_UNLIKELY (gt->map == NULL)) {
+      GST_OBJECT_UNLOCK (gt);
+      g_return_val_if_reached (GST_FLOW_ERROR);
     }
+    /* every output byte is written */
+    gst_geometric_transform_remap (gt, GST_BUFFER_DATA (buf),
+        GST_BUFFER_DATA (outbuf));
   } else {
+    memset (GST_BUFFER_DATA (outbuf), 0, GST_BUFFER_SIZE (outbuf));
     for (y = 0; y < gt->height; y++) {
       for (x = 0; x < gt->width; x++) {
         gdouble in_x, in_y;
@@ -313,8 +505,22 @@ gst_geometric_transform_set_property (GObject * object, guint prop_id,
 
   switch (prop_id) {
     case PROP_OFF_EDGE_PIXELS:
+    {
+      gint v;
+
+      GST_OBJECT_LOCK (gt);
+      v = g_value_get_enum (value);
+      if (v != gt->off_edge_pixels) {
+        gt->off_edge_pixels = v;
+        /* the map has the method applied */
+        gst_geometric_transform_set_need_remap (gt);
+      }
+      GST_OBJECT_UNLOCK (gt);
+      break;
+    }
+    case PROP_N_THREADS:
       GST_OBJECT_LOCK (gt);
-      gt->off_edge_pixels = g_value_get_enum (value);
+      gt->n_threads = g_value_get_uint (value);
       GST_OBJECT_UNLOCK (gt);
       break;
     default:
@@ -335,6 +541,9 @@ gst_geometric_transform_get_property (GObject * object, guint prop_id,
     case PROP_OFF_EDGE_PIXELS:
       g_value_set_enum (value, gt->off_edge_pixels);
       break;
+    case PROP_N_THREADS:
+      g_value_set_uint (value, gt->n_threads);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -348,6 +557,11 @@ gst_geometric_transform_stop (GstBaseTransform * trans)
   GstGeometricTransform *gt = GST_GEOMETRIC_TRANSFORM_CAST (trans);
 
   g_free (gt->map);
+  gt->map = NULL;
+  if (gt->threads) {
+    gst_geometric_transform_threads_free (gt->threads);
+    gt->threads = NULL;
+  }
 
   return TRUE;
 }
@@ -391,6 +605,11 @@ gst_geometric_transform_class_init (gpointer klass, gpointer class_data)
           "What to do with off edge pixels",
           GST_GT_OFF_EDGES_PIXELS_METHOD_TYPE, DEFAULT_OFF_EDGE_PIXELS,
           GST_PARAM_CONTROLLABLE | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (obj_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Threads",
+          "Number of threads remapping horizontal bands of the frame",
+          1, 64, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -399,6 +618,7 @@ gst_geometric_transform_init (GTypeInstance * instance, gpointer g_class)
   GstGeometricTransform *gt = GST_GEOMETRIC_TRANSFORM_CAST (instance);
 
   gt->off_edge_pixels = DEFAULT_OFF_EDGE_PIXELS;
+  gt->n_threads = DEFAULT_N_THREADS;
   gt->precalc_map = TRUE;
   gt->needs_remap = TRUE;
 }
@@ -48,6 +48,7 @@ enum
 
 typedef struct _GstGeometricTransform GstGeometricTransform;
 typedef struct _GstGeometricTransformClass GstGeometricTransformClass;
+typedef struct _GstGeometricTransformThreads GstGeometricTransformThreads;
 
 /**
  * GstGeometricTransformMapFunc:
@@ -99,8 +100,12 @@ struct _GstGeometricTransform {
 
   /* properties */
   gint off_edge_pixels;
+  guint n_threads;
 
-  gdouble *map;
+  /* offset of the input pixel of every output pixel, for the current
+   * off_edge_pixels method, or -1 if the output pixel is black */
+  gint32 *map;
+  GstGeometricTransformThreads *threads;
 };
 
 struct _GstGeometricTransformClass {
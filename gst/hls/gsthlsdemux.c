@@ -70,6 +70,7 @@ enum
 
   PROP_FRAGMENTS_CACHE,
   PROP_BITRATE_SWITCH_TOLERANCE,
+  PROP_CONCURRENT_DOWNLOADS,
   PROP_LAST
 };
 
@@ -78,6 +79,10 @@ static const float update_interval_factor[] = { 1, 0.5, 1.5, 3 };
 #define DEFAULT_FRAGMENTS_CACHE 3
 #define DEFAULT_FAILED_COUNT 3
 #define DEFAULT_BITRATE_SWITCH_TOLERANCE 0.4
+#define DEFAULT_CONCURRENT_DOWNLOADS 2
+
+/* weight of the newest measurement in the bandwidth moving average */
+#define BANDWIDTH_EWMA_WEIGHT 0.3
 
 /* GObject */
 static void gst_hls_demux_set_property (GObject * object, guint prop_id,
@@ -103,14 +108,15 @@ static gboolean gst_hls_demux_fetcher_sink_event (GstPad * pad,
     GstEvent * event);
 static void gst_hls_demux_loop (GstHLSDemux * demux);
 static void gst_hls_demux_stop (GstHLSDemux * demux);
-static void gst_hls_demux_stop_fetcher_locked (GstHLSDemux * demux,
+static void gst_hls_demux_stop_fetchers_locked (GstHLSDemux * demux,
     gboolean cancelled);
 static void gst_hls_demux_stop_update (GstHLSDemux * demux);
 static gboolean gst_hls_demux_start_update (GstHLSDemux * demux);
 static gboolean gst_hls_demux_cache_fragments (GstHLSDemux * demux);
 static gboolean gst_hls_demux_schedule (GstHLSDemux * demux);
 static gboolean gst_hls_demux_switch_playlist (GstHLSDemux * demux);
-static gboolean gst_hls_demux_get_next_fragment (GstHLSDemux * demux);
+static guint gst_hls_demux_get_next_fragments (GstHLSDemux * demux,
+    guint n_fragments);
 static gboolean gst_hls_demux_update_playlist (GstHLSDemux * demux);
 static void gst_hls_demux_reset (GstHLSDemux * demux, gboolean dispose);
 static gboolean gst_hls_demux_set_location (GstHLSDemux * demux,
@@ -148,6 +154,11 @@ static void
 gst_hls_demux_dispose (GObject * obj)
 {
   GstHLSDemux *demux = GST_HLS_DEMUX (obj);
+  gint i;
+
+  g_mutex_lock (demux->fetcher_lock);
+  gst_hls_demux_stop_fetchers_locked (demux, TRUE);
+  g_mutex_unlock (demux->fetcher_lock);
 
   g_cond_free (demux->fetcher_cond);
   g_mutex_free (demux->fetcher_lock);
@@ -159,13 +170,17 @@ gst_hls_demux_dispose (GObject * obj)
   gst_object_unref (demux->task);
   g_static_rec_mutex_free (&demux->task_lock);
 
-  gst_object_unref (demux->fetcher_bus);
-  gst_object_unref (demux->fetcherpad);
-
   gst_hls_demux_reset (demux, TRUE);
 
+  for (i = 0; i < GST_HLS_DEMUX_MAX_DOWNLOADS; i++) {
+    GstHLSDemuxFetcher *fetcher = &demux->fetchers[i];
+
+    gst_object_unref (fetcher->bus);
+    gst_object_unref (fetcher->pad);
+    g_object_unref (fetcher->download);
+  }
+
   g_queue_free (demux->queue);
-  gst_object_unref (demux->download);
 
   G_OBJECT_CLASS (parent_class)->dispose (obj);
 }
@@ -192,11 +207,17 @@ gst_hls_demux_class_init (GstHLSDemuxClass * klass)
   g_object_class_install_property (gobject_class, PROP_BITRATE_SWITCH_TOLERANCE,
       g_param_spec_float ("bitrate-switch-tolerance",
           "Bitrate switch tolerance",
-          "Tolerance with respect of the fragment duration to switch to "
-          "a different bitrate if the client is too slow/fast.",
+          "Part of the estimated bandwidth kept as headroom when choosing "
+          "the bitrate to switch to.",
           0, 1, DEFAULT_BITRATE_SWITCH_TOLERANCE,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_CONCURRENT_DOWNLOADS,
+      g_param_spec_uint ("concurrent-downloads", "Concurrent downloads",
+          "Maximum number of fragments downloaded at the same time",
+          1, GST_HLS_DEMUX_MAX_DOWNLOADS, DEFAULT_CONCURRENT_DOWNLOADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state =
       GST_DEBUG_FUNCPTR (gst_hls_demux_change_state);
 }
@@ -204,6 +225,8 @@ gst_hls_demux_class_init (GstHLSDemuxClass * klass)
 static void
 gst_hls_demux_init (GstHLSDemux * demux, GstHLSDemuxClass * klass)
 {
+  gint i;
+
   /* sink pad */
   demux->sinkpad = gst_pad_new_from_static_template (&sinktemplate, "sink");
   gst_pad_set_chain_function (demux->sinkpad,
@@ -212,26 +235,32 @@ gst_hls_demux_init (GstHLSDemux * demux, GstHLSDemuxClass * klass)
       GST_DEBUG_FUNCPTR (gst_hls_demux_sink_event));
   gst_element_add_pad (GST_ELEMENT (demux), demux->sinkpad);
 
-  /* fetcher pad */
-  demux->fetcherpad =
-      gst_pad_new_from_static_template (&fetchertemplate, "sink");
-  gst_pad_set_chain_function (demux->fetcherpad,
-      GST_DEBUG_FUNCPTR (gst_hls_demux_fetcher_chain));
-  gst_pad_set_event_function (demux->fetcherpad,
-      GST_DEBUG_FUNCPTR (gst_hls_demux_fetcher_sink_event));
-  gst_pad_set_element_private (demux->fetcherpad, demux);
-  gst_pad_activate_push (demux->fetcherpad, TRUE);
+  /* fetchers */
+  for (i = 0; i < GST_HLS_DEMUX_MAX_DOWNLOADS; i++) {
+    GstHLSDemuxFetcher *fetcher = &demux->fetchers[i];
+
+    fetcher->demux = demux;
+    fetcher->pad = gst_pad_new_from_static_template (&fetchertemplate, "sink");
+    gst_pad_set_chain_function (fetcher->pad,
+        GST_DEBUG_FUNCPTR (gst_hls_demux_fetcher_chain));
+    gst_pad_set_event_function (fetcher->pad,
+        GST_DEBUG_FUNCPTR (gst_hls_demux_fetcher_sink_event));
+    gst_pad_set_element_private (fetcher->pad, fetcher);
+    gst_pad_activate_push (fetcher->pad, TRUE);
+
+    fetcher->download = gst_adapter_new ();
+    fetcher->bus = gst_bus_new ();
+    gst_bus_set_sync_handler (fetcher->bus,
+        gst_hls_demux_fetcher_bus_handler, fetcher);
+  }
 
   demux->do_typefind = TRUE;
 
   /* Properties */
   demux->fragments_cache = DEFAULT_FRAGMENTS_CACHE;
   demux->bitrate_switch_tol = DEFAULT_BITRATE_SWITCH_TOLERANCE;
+  demux->concurrent_downloads = DEFAULT_CONCURRENT_DOWNLOADS;
 
-  demux->download = gst_adapter_new ();
-  demux->fetcher_bus = gst_bus_new ();
-  gst_bus_set_sync_handler (demux->fetcher_bus,
-      gst_hls_demux_fetcher_bus_handler, demux);
   demux->thread_cond = g_cond_new ();
   demux->thread_lock = g_mutex_new ();
   demux->fetcher_cond = g_cond_new ();
@@ -256,6 +285,9 @@ gst_hls_demux_set_property (GObject * object, guint prop_id,
     case PROP_BITRATE_SWITCH_TOLERANCE:
       demux->bitrate_switch_tol = g_value_get_float (value);
       break;
+    case PROP_CONCURRENT_DOWNLOADS:
+      demux->concurrent_downloads = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -275,6 +307,9 @@ gst_hls_demux_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_BITRATE_SWITCH_TOLERANCE:
       g_value_set_float (value, demux->bitrate_switch_tol);
       break;
+    case PROP_CONCURRENT_DOWNLOADS:
+      g_value_set_uint (value, demux->concurrent_downloads);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -336,7 +371,8 @@ gst_hls_demux_src_event (GstPad * pad, GstEvent * event)
       GstSeekFlags flags;
       GstSeekType start_type, stop_type;
       gint64 start, stop;
-      GList *walk;
+      GPtrArray *files;
+      guint i;
       gint current_pos;
       gint current_sequence;
       gint target_second;
@@ -360,13 +396,13 @@ gst_hls_demux_src_event (GstPad * pad, GstEvent * event)
           GST_TIME_ARGS (stop));
 
       GST_M3U8_CLIENT_LOCK (demux->client);
-      file = GST_M3U8_MEDIA_FILE (demux->client->current->files->data);
-      current_sequence = file->sequence;
+      files = demux->client->current->files;
+      current_sequence = 0;
       current_pos = 0;
       target_second = start / GST_SECOND;
       GST_DEBUG_OBJECT (demux, "Target seek to %d", target_second);
-      for (walk = demux->client->current->files; walk; walk = walk->next) {
-        file = walk->data;
+      for (i = 0; i < files->len; i++) {
+        file = g_ptr_array_index (files, i);
 
         current_sequence = file->sequence;
         if (current_pos <= target_second
@@ -377,7 +413,7 @@ gst_hls_demux_src_event (GstPad * pad, GstEvent * event)
       }
       GST_M3U8_CLIENT_UNLOCK (demux->client);
 
-      if (walk == NULL) {
+      if (i == files->len) {
         GST_WARNING_OBJECT (demux, "Could not find seeked fragment");
         return FALSE;
       }
@@ -390,7 +426,7 @@ gst_hls_demux_src_event (GstPad * pad, GstEvent * event)
       demux->cancelled = TRUE;
       gst_task_pause (demux->task);
       g_mutex_lock (demux->fetcher_lock);
-      gst_hls_demux_stop_fetcher_locked (demux, TRUE);
+      gst_hls_demux_stop_fetchers_locked (demux, TRUE);
       g_mutex_unlock (demux->fetcher_lock);
       gst_hls_demux_stop_update (demux);
       gst_task_pause (demux->task);
@@ -404,7 +440,6 @@ gst_hls_demux_src_event (GstPad * pad, GstEvent * event)
         gst_buffer_unref (buf);
       }
       g_queue_clear (demux->queue);
-      gst_adapter_clear (demux->download);
 
       GST_M3U8_CLIENT_LOCK (demux->client);
       GST_DEBUG_OBJECT (demux, "seeking to sequence %d", current_sequence);
@@ -571,14 +606,19 @@ gst_hls_demux_src_query (GstPad * pad, GstQuery * query)
 static gboolean
 gst_hls_demux_fetcher_sink_event (GstPad * pad, GstEvent * event)
 {
-  GstHLSDemux *demux = GST_HLS_DEMUX (gst_pad_get_element_private (pad));
+  GstHLSDemuxFetcher *fetcher = gst_pad_get_element_private (pad);
+  GstHLSDemux *demux = fetcher->demux;
 
   switch (event->type) {
     case GST_EVENT_EOS:{
       GST_DEBUG_OBJECT (demux, "Got EOS on the fetcher pad");
       /* signal we have fetched the URI */
       if (!demux->cancelled) {
+        g_mutex_lock (demux->fetcher_lock);
+        fetcher->end_time = gst_util_get_timestamp ();
+        fetcher->done = TRUE;
         g_cond_broadcast (demux->fetcher_cond);
+        g_mutex_unlock (demux->fetcher_lock);
       }
     }
     default:
@@ -607,19 +647,23 @@ gst_hls_demux_chain (GstPad * pad, GstBuffer * buf)
 static GstFlowReturn
 gst_hls_demux_fetcher_chain (GstPad * pad, GstBuffer * buf)
 {
-  GstHLSDemux *demux = GST_HLS_DEMUX (gst_pad_get_element_private (pad));
+  GstHLSDemuxFetcher *fetcher = gst_pad_get_element_private (pad);
 
   /* The source element can be an http source element. In case we get a 404,
    * the html response will be sent downstream and the adapter
    * will not be null, which might make us think that the request proceed
    * successfully. But it will also post an error message in the bus that
-   * is handled synchronously and that will set demux->fetcher_error to TRUE,
+   * is handled synchronously and that will set fetcher->error to TRUE,
    * which is used to discard this buffer with the html response. */
-  if (demux->fetcher_error) {
+  if (fetcher->error) {
+    gst_buffer_unref (buf);
     goto done;
   }
 
-  gst_adapter_push (demux->download, buf);
+  if (G_UNLIKELY (!GST_CLOCK_TIME_IS_VALID (fetcher->first_data_time)))
+    fetcher->first_data_time = gst_util_get_timestamp ();
+
+  gst_adapter_push (fetcher->download, buf);
 
 done:
   {
@@ -627,36 +671,76 @@ done:
   }
 }
 
+/* The streaming thread of a fetcher element takes the fetcher lock to
+ * signal EOS and errors, so the element's state is changed without it.
+ * fetcher->stopping is set meanwhile, and nothing may touch the fetcher
+ * until it is cleared again */
+static void
+gst_hls_demux_wait_fetcher_locked (GstHLSDemux * demux,
+    GstHLSDemuxFetcher * fetcher)
+{
+  while (fetcher->stopping)
+    g_cond_wait (demux->fetcher_cond, demux->fetcher_lock);
+}
+
 static void
-gst_hls_demux_stop_fetcher_locked (GstHLSDemux * demux, gboolean cancelled)
+gst_hls_demux_stop_fetcher_locked (GstHLSDemux * demux,
+    GstHLSDemuxFetcher * fetcher, gboolean cancelled)
 {
   GstPad *pad;
+  gboolean keep;
 
   /* When the fetcher is stopped while it's downloading, we will get an EOS that
    * unblocks the fetcher thread and tries to stop it again from that thread.
-   * Here we check if the fetcher as already been stopped before continuing */
-  if (demux->fetcher == NULL || demux->stopping_fetcher)
+   * Here we wait for the other stop to finish before checking if the fetcher
+   * has already been stopped */
+  gst_hls_demux_wait_fetcher_locked (demux, fetcher);
+  if (fetcher->element == NULL)
+    return;
+
+  fetcher->active = FALSE;
+
+  /* Keep the element for the next download, in READY it can be given a new
+   * URI without being recreated and relinked */
+  keep = !cancelled && !fetcher->error;
+  GST_DEBUG_OBJECT (demux, keep ? "Pausing fetcher." : "Stopping fetcher.");
+
+  fetcher->stopping = TRUE;
+  g_mutex_unlock (demux->fetcher_lock);
+  gst_element_set_state (fetcher->element,
+      keep ? GST_STATE_READY : GST_STATE_NULL);
+  gst_element_get_state (fetcher->element, NULL, NULL, GST_CLOCK_TIME_NONE);
+  g_mutex_lock (demux->fetcher_lock);
+  fetcher->stopping = FALSE;
+  g_cond_broadcast (demux->fetcher_cond);
+
+  if (keep)
     return;
 
-  GST_DEBUG_OBJECT (demux, "Stopping fetcher.");
-  demux->stopping_fetcher = TRUE;
-  /* set the element state to NULL */
-  gst_element_set_state (demux->fetcher, GST_STATE_NULL);
-  gst_element_get_state (demux->fetcher, NULL, NULL, GST_CLOCK_TIME_NONE);
   /* unlink it from the internal pad */
-  pad = gst_pad_get_peer (demux->fetcherpad);
+  pad = gst_pad_get_peer (fetcher->pad);
   if (pad) {
-    gst_pad_unlink (pad, demux->fetcherpad);
+    gst_pad_unlink (pad, fetcher->pad);
     gst_object_unref (pad);
   }
   /* and finally unref it */
-  gst_object_unref (demux->fetcher);
-  demux->fetcher = NULL;
+  gst_object_unref (fetcher->element);
+  fetcher->element = NULL;
 
   /* if we stopped it to cancell a download, free the cached buffer */
-  if (cancelled && gst_adapter_available (demux->download)) {
-    gst_adapter_clear (demux->download);
+  if (cancelled && gst_adapter_available (fetcher->download)) {
+    gst_adapter_clear (fetcher->download);
   }
+}
+
+static void
+gst_hls_demux_stop_fetchers_locked (GstHLSDemux * demux, gboolean cancelled)
+{
+  gint i;
+
+  for (i = 0; i < GST_HLS_DEMUX_MAX_DOWNLOADS; i++)
+    gst_hls_demux_stop_fetcher_locked (demux, &demux->fetchers[i], cancelled);
+
   /* signal the fetcher thread that the download has finished/cancelled */
   if (cancelled)
     g_cond_broadcast (demux->fetcher_cond);
@@ -666,7 +750,7 @@ static void
 gst_hls_demux_stop (GstHLSDemux * demux)
 {
   g_mutex_lock (demux->fetcher_lock);
-  gst_hls_demux_stop_fetcher_locked (demux, TRUE);
+  gst_hls_demux_stop_fetchers_locked (demux, TRUE);
   g_mutex_unlock (demux->fetcher_lock);
   gst_task_stop (demux->task);
   gst_hls_demux_stop_update (demux);
@@ -809,12 +893,14 @@ static GstBusSyncReply
 gst_hls_demux_fetcher_bus_handler (GstBus * bus,
     GstMessage * message, gpointer data)
 {
-  GstHLSDemux *demux = GST_HLS_DEMUX (data);
+  GstHLSDemuxFetcher *fetcher = data;
+  GstHLSDemux *demux = fetcher->demux;
 
   if (GST_MESSAGE_TYPE (message) == GST_MESSAGE_ERROR) {
-    demux->fetcher_error = TRUE;
+    fetcher->error = TRUE;
     if (!demux->cancelled) {
       g_mutex_lock (demux->fetcher_lock);
+      fetcher->done = TRUE;
       g_cond_broadcast (demux->fetcher_cond);
       g_mutex_unlock (demux->fetcher_lock);
     }
@@ -825,26 +911,67 @@ gst_hls_demux_fetcher_bus_handler (GstBus * bus,
 }
 
 static gboolean
-gst_hls_demux_make_fetcher_locked (GstHLSDemux * demux, const gchar * uri)
+gst_hls_demux_fetcher_handles_uri (GstHLSDemuxFetcher * fetcher,
+    const gchar * uri)
+{
+  gchar **protocols;
+
+  protocols =
+      gst_uri_handler_get_protocols (GST_URI_HANDLER (fetcher->element));
+  for (; protocols && *protocols; protocols++) {
+    if (gst_uri_has_protocol (uri, *protocols))
+      return TRUE;
+  }
+  return FALSE;
+}
+
+static gboolean
+gst_hls_demux_make_fetcher_locked (GstHLSDemux * demux,
+    GstHLSDemuxFetcher * fetcher, const gchar * uri)
 {
   GstPad *pad;
 
   if (!gst_uri_is_valid (uri))
     return FALSE;
 
+  gst_hls_demux_wait_fetcher_locked (demux, fetcher);
+
+  fetcher->error = FALSE;
+  fetcher->done = FALSE;
+  fetcher->first_data_time = GST_CLOCK_TIME_NONE;
+  fetcher->end_time = GST_CLOCK_TIME_NONE;
+
+  /* Reuse the element of the previous download if possible */
+  if (fetcher->element) {
+    if (gst_hls_demux_fetcher_handles_uri (fetcher, uri) &&
+        gst_uri_handler_set_uri (GST_URI_HANDLER (fetcher->element), uri)) {
+      GST_DEBUG_OBJECT (demux, "Reusing fetcher for the URI:%s", uri);
+      fetcher->reused = TRUE;
+      fetcher->active = TRUE;
+      return TRUE;
+    }
+    gst_hls_demux_stop_fetcher_locked (demux, fetcher, TRUE);
+  }
+
   GST_DEBUG_OBJECT (demux, "Creating fetcher for the URI:%s", uri);
-  demux->fetcher = gst_element_make_from_uri (GST_URI_SRC, uri, NULL);
-  if (!demux->fetcher)
+  fetcher->element = gst_element_make_from_uri (GST_URI_SRC, uri, NULL);
+  if (!fetcher->element)
     return FALSE;
 
-  demux->fetcher_error = FALSE;
-  demux->stopping_fetcher = FALSE;
-  gst_element_set_bus (GST_ELEMENT (demux->fetcher), demux->fetcher_bus);
+  fetcher->reused = FALSE;
+  fetcher->active = TRUE;
+  fetcher->stopping = FALSE;
+  gst_element_set_bus (GST_ELEMENT (fetcher->element), fetcher->bus);
+
+  /* Let HTTP sources keep their connection open between requests */
+  if (g_object_class_find_property (G_OBJECT_GET_CLASS (fetcher->element),
+          "keep-alive"))
+    g_object_set (G_OBJECT (fetcher->element), "keep-alive", TRUE, NULL);
 
-  g_object_set (G_OBJECT (demux->fetcher), "location", uri, NULL);
-  pad = gst_element_get_static_pad (demux->fetcher, "src");
+  g_object_set (G_OBJECT (fetcher->element), "location", uri, NULL);
+  pad = gst_element_get_static_pad (fetcher->element, "src");
   if (pad) {
-    gst_pad_link (pad, demux->fetcherpad);
+    gst_pad_link (pad, fetcher->pad);
     gst_object_unref (pad);
   }
   return TRUE;
@@ -853,10 +980,13 @@ gst_hls_demux_make_fetcher_locked (GstHLSDemux * demux, const gchar * uri)
 static void
 gst_hls_demux_reset (GstHLSDemux * demux, gboolean dispose)
 {
+  gint i;
+
   demux->need_cache = TRUE;
   demux->thread_return = FALSE;
-  demux->accumulated_delay = 0;
+  demux->bandwidth = 0;
   demux->end_of_playlist = FALSE;
+  demux->live_edge = FALSE;
   demux->cancelled = FALSE;
   demux->do_typefind = TRUE;
 
@@ -870,7 +1000,8 @@ gst_hls_demux_reset (GstHLSDemux * demux, gboolean dispose)
     demux->playlist = NULL;
   }
 
-  gst_adapter_clear (demux->download);
+  for (i = 0; i < GST_HLS_DEMUX_MAX_DOWNLOADS; i++)
+    gst_adapter_clear (demux->fetchers[i].download);
 
   if (demux->client) {
     gst_m3u8_client_free (demux->client);
@@ -906,10 +1037,11 @@ static gboolean
 gst_hls_demux_update_thread (GstHLSDemux * demux)
 {
   /* Loop for the updates. It's started when the first fragments are cached and
-   * schedules the next update of the playlist (for lives sources) and the next
-   * update of fragments. When a new fragment is downloaded, it compares the
-   * download time with the next scheduled update to check if we can or should
-   * switch to a different bitrate */
+   * schedules the next update of the playlist (for lives sources). On every
+   * update it fetches as many fragments as fit in the queue, several of them
+   * at once, and switches to a different bitrate if the bandwidth estimate
+   * of the downloads asks for it. At the live edge of a live playlist there
+   * is nothing to fetch until its next update */
 
   g_mutex_lock (demux->thread_lock);
   GST_DEBUG_OBJECT (demux, "Started updates thread");
@@ -950,17 +1082,21 @@ gst_hls_demux_update_thread (GstHLSDemux * demux)
       continue;
     }
 
-    /* fetch the next fragment */
-    if (g_queue_is_empty (demux->queue)) {
-      if (!gst_hls_demux_get_next_fragment (demux)) {
-        if (!demux->end_of_playlist && !demux->cancelled) {
+    /* fetch the next fragments, as many as fit in the queue */
+    if (g_queue_get_length (demux->queue) < demux->fragments_cache) {
+      guint n_fragments;
+
+      n_fragments = MIN (demux->concurrent_downloads,
+          demux->fragments_cache - g_queue_get_length (demux->queue));
+      if (!gst_hls_demux_get_next_fragments (demux, n_fragments)) {
+        if (!demux->end_of_playlist && !demux->live_edge && !demux->cancelled) {
           demux->client->update_failed_count++;
           if (demux->client->update_failed_count < DEFAULT_FAILED_COUNT) {
-            GST_WARNING_OBJECT (demux, "Could not fetch the next fragment");
+            GST_WARNING_OBJECT (demux, "Could not fetch the next fragments");
             continue;
           } else {
             GST_ELEMENT_ERROR (demux, RESOURCE, NOT_FOUND,
-                ("Could not fetch the next fragment"), (NULL));
+                ("Could not fetch the next fragments"), (NULL));
             goto quit;
           }
         }
@@ -1013,7 +1149,7 @@ gst_hls_demux_start_update (GstHLSDemux * demux)
 static gboolean
 gst_hls_demux_cache_fragments (GstHLSDemux * demux)
 {
-  gint i;
+  guint i, n_fetched;
 
   /* If this playlist is a variant playlist, select the first one
    * and update it */
@@ -1035,7 +1171,7 @@ gst_hls_demux_cache_fragments (GstHLSDemux * demux)
    * and substract the 'fragmets_cache' to start from the last fragment*/
   if (gst_m3u8_client_is_live (demux->client)) {
     GST_M3U8_CLIENT_LOCK (demux->client);
-    demux->client->sequence += g_list_length (demux->client->current->files);
+    demux->client->sequence += demux->client->current->files->len;
     if (demux->client->sequence >= demux->fragments_cache)
       demux->client->sequence -= demux->fragments_cache;
     else
@@ -1053,8 +1189,8 @@ gst_hls_demux_cache_fragments (GstHLSDemux * demux)
               GST_FORMAT_TIME, duration));
   }
 
-  /* Cache the first fragments */
-  for (i = 0; i < demux->fragments_cache; i++) {
+  /* Cache the first fragments, downloading several of them at once */
+  for (i = 0; i < demux->fragments_cache; i += n_fetched) {
     gst_element_post_message (GST_ELEMENT (demux),
         gst_message_new_buffering (GST_OBJECT (demux),
             100 * i / demux->fragments_cache));
@@ -1062,7 +1198,12 @@ gst_hls_demux_cache_fragments (GstHLSDemux * demux)
     g_time_val_add (&demux->next_update,
         gst_m3u8_client_get_target_duration (demux->client)
         / GST_SECOND * G_USEC_PER_SEC);
-    if (!gst_hls_demux_get_next_fragment (demux)) {
+    n_fetched = gst_hls_demux_get_next_fragments (demux,
+        MIN (demux->concurrent_downloads, demux->fragments_cache - i));
+    if (n_fetched == 0) {
+      /* a short live playlist, start with what it has */
+      if (demux->live_edge && i > 0)
+        break;
       if (!demux->cancelled)
         GST_ERROR_OBJECT (demux, "Error caching the first fragments");
       return FALSE;
@@ -1081,66 +1222,97 @@ gst_hls_demux_cache_fragments (GstHLSDemux * demux)
   return TRUE;
 }
 
-static gboolean
-gst_hls_demux_fetch_location (GstHLSDemux * demux, const gchar * uri)
+/* Downloads @n_uris URIs at the same time, using one fetcher for each of them.
+ * Returns the number of URIs, counted from the first one, that were fetched
+ * successfully. Their data is left in the adapters of the first fetchers */
+static guint
+gst_hls_demux_fetch_locations (GstHLSDemux * demux, const gchar ** uris,
+    guint n_uris)
 {
+  GstHLSDemuxFetcher *fetcher;
   GstStateChangeReturn ret;
-  gboolean bret = FALSE;
+  guint i, n_started, n_fetched = 0;
+  gboolean done;
+
+  g_return_val_if_fail (n_uris <= GST_HLS_DEMUX_MAX_DOWNLOADS, 0);
 
   g_mutex_lock (demux->fetcher_lock);
 
-  while (demux->fetcher)
+  while (demux->fetching)
     g_cond_wait (demux->fetcher_cond, demux->fetcher_lock);
 
   if (demux->cancelled)
     goto quit;
 
-  if (!gst_hls_demux_make_fetcher_locked (demux, uri)) {
-    goto uri_error;
-  }
-
-  ret = gst_element_set_state (demux->fetcher, GST_STATE_PLAYING);
-  if (ret == GST_STATE_CHANGE_FAILURE)
-    goto state_change_error;
+  demux->fetching = TRUE;
 
-  /* wait until we have fetched the uri */
-  GST_DEBUG_OBJECT (demux, "Waiting to fetch the URI");
-  g_cond_wait (demux->fetcher_cond, demux->fetcher_lock);
+  for (n_started = 0; n_started < n_uris; n_started++) {
+    fetcher = &demux->fetchers[n_started];
+    fetcher->start_time = gst_util_get_timestamp ();
 
-  gst_hls_demux_stop_fetcher_locked (demux, FALSE);
+    if (!gst_hls_demux_make_fetcher_locked (demux, fetcher, uris[n_started])) {
+      GST_ELEMENT_ERROR (demux, RESOURCE, OPEN_READ,
+          ("Could not create an element to fetch the given URI."),
+          ("URI: \"%s\"", uris[n_started]));
+      break;
+    }
 
-  if (!demux->fetcher_error && gst_adapter_available (demux->download)) {
-    GST_INFO_OBJECT (demux, "URI fetched successfully");
-    bret = TRUE;
+    ret = gst_element_set_state (fetcher->element, GST_STATE_PLAYING);
+    if (ret == GST_STATE_CHANGE_FAILURE) {
+      GST_ELEMENT_ERROR (demux, CORE, STATE_CHANGE,
+          ("Error changing state of the fetcher element."), (NULL));
+      gst_hls_demux_stop_fetcher_locked (demux, fetcher, TRUE);
+      break;
+    }
   }
-  goto quit;
 
-uri_error:
-  {
-    GST_ELEMENT_ERROR (demux, RESOURCE, OPEN_READ,
-        ("Could not create an element to fetch the given URI."), ("URI: \"%s\"",
-            uri));
-    bret = FALSE;
-    goto quit;
+  /* wait until we have fetched the uris, a cancelled download has its
+   * fetcher deactivated */
+  GST_DEBUG_OBJECT (demux, "Waiting to fetch %u URIs", n_started);
+  do {
+    done = TRUE;
+    for (i = 0; i < n_started; i++) {
+      fetcher = &demux->fetchers[i];
+      if (fetcher->active && !fetcher->done)
+        done = FALSE;
+    }
+    if (!done)
+      g_cond_wait (demux->fetcher_cond, demux->fetcher_lock);
+  } while (!done);
+
+  for (i = 0; i < n_started; i++) {
+    fetcher = &demux->fetchers[i];
+
+    /* failed fetchers are recreated for the next download */
+    gst_hls_demux_stop_fetcher_locked (demux, fetcher, fetcher->error);
+
+    if (n_fetched == i && !fetcher->error
+        && gst_adapter_available (fetcher->download)) {
+      GST_INFO_OBJECT (demux, "URI fetched successfully");
+      n_fetched++;
+    } else {
+      /* only an uninterrupted run of fragments is useful */
+      gst_adapter_clear (fetcher->download);
+    }
   }
 
-state_change_error:
-  {
-    GST_ELEMENT_ERROR (demux, CORE, STATE_CHANGE,
-        ("Error changing state of the fetcher element."), (NULL));
-    bret = FALSE;
-    goto quit;
-  }
+  demux->fetching = FALSE;
 
 quit:
   {
     /* Unlock any other fetcher that might be waiting */
     g_cond_broadcast (demux->fetcher_cond);
     g_mutex_unlock (demux->fetcher_lock);
-    return bret;
+    return n_fetched;
   }
 }
 
+static gboolean
+gst_hls_demux_fetch_location (GstHLSDemux * demux, const gchar * uri)
+{
+  return gst_hls_demux_fetch_locations (demux, &uri, 1) == 1;
+}
+
 static gchar *
 gst_hls_src_buf_to_utf8_playlist (gchar * data, guint size)
 {
@@ -1167,10 +1339,10 @@ gst_hls_demux_update_playlist (GstHLSDemux * demux)
   if (!gst_hls_demux_fetch_location (demux, uri))
     return FALSE;
 
-  avail = gst_adapter_available (demux->download);
-  data = gst_adapter_peek (demux->download, avail);
+  avail = gst_adapter_available (demux->fetchers[0].download);
+  data = gst_adapter_peek (demux->fetchers[0].download, avail);
   playlist = gst_hls_src_buf_to_utf8_playlist ((gchar *) data, avail);
-  gst_adapter_clear (demux->download);
+  gst_adapter_clear (demux->fetchers[0].download);
   if (playlist == NULL) {
     GST_WARNING_OBJECT (demux, "Couldn't not validate playlist encoding");
     return FALSE;
@@ -1179,29 +1351,35 @@ gst_hls_demux_update_playlist (GstHLSDemux * demux)
   return TRUE;
 }
 
+/* Switch to the variant with the highest bitrate not above @max_bitrate, or
+ * to the lowest one if none is */
 static gboolean
-gst_hls_demux_change_playlist (GstHLSDemux * demux, gboolean is_fast)
+gst_hls_demux_change_playlist (GstHLSDemux * demux, guint64 max_bitrate)
 {
-  GList *list;
+  GList *previous_variant, *current_variant;
   GstStructure *s;
-  gint new_bandwidth;
+  gint old_bandwidth, new_bandwidth;
 
   GST_M3U8_CLIENT_LOCK (demux->client);
-  if (is_fast)
-    list = g_list_next (demux->client->main->current_variant);
-  else
-    list = g_list_previous (demux->client->main->current_variant);
+  previous_variant = demux->client->main->current_variant;
+  /* the variants are sorted by bitrate, lowest first */
+  current_variant = demux->client->main->lists;
+  while (current_variant->next &&
+      GST_M3U8 (current_variant->next->data)->bandwidth <= max_bitrate)
+    current_variant = current_variant->next;
 
   /* Don't do anything else if the playlist is the same */
-  if (!list || list->data == demux->client->current) {
+  if (current_variant == previous_variant ||
+      current_variant->data == demux->client->current) {
     GST_M3U8_CLIENT_UNLOCK (demux->client);
     return TRUE;
   }
 
-  demux->client->main->current_variant = list;
+  demux->client->main->current_variant = current_variant;
+  old_bandwidth = demux->client->current->bandwidth;
   GST_M3U8_CLIENT_UNLOCK (demux->client);
 
-  gst_m3u8_client_set_current (demux->client, list->data);
+  gst_m3u8_client_set_current (demux->client, current_variant->data);
 
   GST_M3U8_CLIENT_LOCK (demux->client);
   new_bandwidth = demux->client->current->bandwidth;
@@ -1209,7 +1387,7 @@ gst_hls_demux_change_playlist (GstHLSDemux * demux, gboolean is_fast)
 
   gst_hls_demux_update_playlist (demux);
   GST_INFO_OBJECT (demux, "Client is %s, switching to bitrate %d",
-      is_fast ? "fast" : "slow", new_bandwidth);
+      new_bandwidth > old_bandwidth ? "fast" : "slow", new_bandwidth);
 
   s = gst_structure_new ("playlist",
       "uri", G_TYPE_STRING, gst_m3u8_client_get_current_uri (demux->client),
@@ -1252,13 +1430,65 @@ gst_hls_demux_schedule (GstHLSDemux * demux)
   return TRUE;
 }
 
+static void
+gst_hls_demux_update_bandwidth (GstHLSDemux * demux, guint64 size,
+    GstClockTime elapsed)
+{
+  guint64 bitrate;
+
+  if (size == 0 || elapsed == 0)
+    return;
+
+  bitrate = gst_util_uint64_scale (size, 8 * GST_SECOND, elapsed);
+  if (demux->bandwidth == 0)
+    demux->bandwidth = bitrate;
+  else
+    demux->bandwidth = BANDWIDTH_EWMA_WEIGHT * bitrate +
+        (1 - BANDWIDTH_EWMA_WEIGHT) * demux->bandwidth;
+
+  GST_DEBUG_OBJECT (demux, "fetched %" G_GUINT64_FORMAT " bytes in %"
+      GST_TIME_FORMAT ", %" G_GUINT64_FORMAT " bits/s, estimate %"
+      G_GUINT64_FORMAT " bits/s", size, GST_TIME_ARGS (elapsed), bitrate,
+      demux->bandwidth);
+}
+
+/* Post how long the download of a fragment took to start, which includes
+ * creating the source element and connecting, and how long the data took to
+ * arrive once started */
+static void
+gst_hls_demux_post_fragment_stats (GstHLSDemux * demux,
+    GstHLSDemuxFetcher * fetcher, const gchar * uri, guint size)
+{
+  GstClockTime setup_time, transfer_time;
+  GstStructure *s;
+
+  if (!GST_CLOCK_TIME_IS_VALID (fetcher->first_data_time) ||
+      !GST_CLOCK_TIME_IS_VALID (fetcher->end_time))
+    return;
+
+  setup_time = fetcher->first_data_time - fetcher->start_time;
+  transfer_time = fetcher->end_time - fetcher->first_data_time;
+
+  GST_DEBUG_OBJECT (demux, "fragment %s: %u bytes, setup %" GST_TIME_FORMAT
+      ", transfer %" GST_TIME_FORMAT "%s", uri, size,
+      GST_TIME_ARGS (setup_time), GST_TIME_ARGS (transfer_time),
+      fetcher->reused ? " (reused fetcher)" : "");
+
+  s = gst_structure_new ("fragment",
+      "uri", G_TYPE_STRING, uri,
+      "size", G_TYPE_UINT, size,
+      "setup-time", G_TYPE_UINT64, setup_time,
+      "transfer-time", G_TYPE_UINT64, transfer_time,
+      "reused", G_TYPE_BOOLEAN, fetcher->reused, NULL);
+  gst_element_post_message (GST_ELEMENT_CAST (demux),
+      gst_message_new_element (GST_OBJECT_CAST (demux), s));
+}
+
 static gboolean
 gst_hls_demux_switch_playlist (GstHLSDemux * demux)
 {
-  GTimeVal now;
-  gint64 diff, limit;
+  guint64 max_bitrate;
 
-  g_get_current_time (&now);
   GST_M3U8_CLIENT_LOCK (demux->client);
   if (!demux->client->main->lists) {
     GST_M3U8_CLIENT_UNLOCK (demux->client);
@@ -1266,94 +1496,116 @@ gst_hls_demux_switch_playlist (GstHLSDemux * demux)
   }
   GST_M3U8_CLIENT_UNLOCK (demux->client);
 
-  /* compare the time when the fragment was downloaded with the time when it was
-   * scheduled */
-  diff = (GST_TIMEVAL_TO_TIME (demux->next_update) - GST_TIMEVAL_TO_TIME (now));
-  limit = gst_m3u8_client_get_target_duration (demux->client)
-      * demux->bitrate_switch_tol;
+  /* nothing measured yet */
+  if (demux->bandwidth == 0)
+    return TRUE;
 
-  GST_DEBUG ("diff:%s%" GST_TIME_FORMAT ", limit:%" GST_TIME_FORMAT,
-      diff < 0 ? "-" : " ", GST_TIME_ARGS (ABS (diff)), GST_TIME_ARGS (limit));
+  /* keep some headroom for bandwidth variations */
+  max_bitrate = demux->bandwidth * (1 - demux->bitrate_switch_tol);
 
-  /* if we are on time switch to a higher bitrate */
-  if (diff > limit) {
-    while (diff > limit) {
-      gst_hls_demux_change_playlist (demux, TRUE);
-      diff -= limit;
-    }
-    demux->accumulated_delay = 0;
-  } else if (diff < 0) {
-    /* if the client is too slow wait until it has accumulated a certain delay to
-     * switch to a lower bitrate */
-    demux->accumulated_delay -= diff;
-    if (demux->accumulated_delay >= limit) {
-      while (demux->accumulated_delay >= limit) {
-        gst_hls_demux_change_playlist (demux, FALSE);
-        demux->accumulated_delay -= limit;
-      }
-      demux->accumulated_delay = 0;
-    }
-  }
-  return TRUE;
+  GST_DEBUG_OBJECT (demux, "bandwidth estimate: %" G_GUINT64_FORMAT
+      " bits/s, max bitrate: %" G_GUINT64_FORMAT, demux->bandwidth,
+      max_bitrate);
+
+  return gst_hls_demux_change_playlist (demux, max_bitrate);
 }
 
-static gboolean
-gst_hls_demux_get_next_fragment (GstHLSDemux * demux)
+static guint
+gst_hls_demux_get_next_fragments (GstHLSDemux * demux, guint n_fragments)
 {
-  GstBuffer *buf;
-  guint avail;
+  gchar *uris[GST_HLS_DEMUX_MAX_DOWNLOADS];
+  GstClockTime durations[GST_HLS_DEMUX_MAX_DOWNLOADS];
+  GstClockTime timestamps[GST_HLS_DEMUX_MAX_DOWNLOADS];
+  gboolean disconts[GST_HLS_DEMUX_MAX_DOWNLOADS];
   const gchar *next_fragment_uri;
-  GstClockTime duration;
-  GstClockTime timestamp;
-  gboolean discont;
+  GstClockTime start, elapsed;
+  guint64 size = 0;
+  guint i, n, n_fetched;
 
-  if (!gst_m3u8_client_get_next_fragment (demux->client, &discont,
-          &next_fragment_uri, &duration, &timestamp)) {
+  n_fragments = MIN (n_fragments, GST_HLS_DEMUX_MAX_DOWNLOADS);
+
+  /* the uris belong to the playlist, which can be updated while we fetch */
+  for (n = 0; n < n_fragments; n++) {
+    if (!gst_m3u8_client_get_next_fragment (demux->client, &disconts[n],
+            &next_fragment_uri, &durations[n], &timestamps[n]))
+      break;
+    uris[n] = g_strdup (next_fragment_uri);
+  }
+
+  if (n == 0) {
+    if (gst_m3u8_client_is_live (demux->client)) {
+      /* not an error, the next update of the playlist brings more */
+      GST_DEBUG_OBJECT (demux, "No new fragments until the next update");
+      demux->live_edge = TRUE;
+      return 0;
+    }
     GST_INFO_OBJECT (demux, "This playlist doesn't contain more fragments");
     demux->end_of_playlist = TRUE;
     gst_task_start (demux->task);
-    return FALSE;
+    return 0;
   }
+  demux->live_edge = FALSE;
+
+  GST_INFO_OBJECT (demux, "Fetching %u fragments starting with %s", n,
+      uris[0]);
 
-  GST_INFO_OBJECT (demux, "Fetching next fragment %s", next_fragment_uri);
+  start = gst_util_get_timestamp ();
+  n_fetched = gst_hls_demux_fetch_locations (demux, (const gchar **) uris, n);
+  elapsed = gst_util_get_timestamp () - start;
 
-  if (!gst_hls_demux_fetch_location (demux, next_fragment_uri)) {
+  if (n_fetched < n) {
     /* FIXME: The gst_m3u8_get_next_fragment increments the sequence number
        but another thread might call get_next_fragment and this decrement
        will not redownload the failed fragment, but might duplicate the
        download of a succeeded fragment
      */
-    g_atomic_int_add (&demux->client->sequence, -1);
-    return FALSE;
+    g_atomic_int_add (&demux->client->sequence, -(gint) (n - n_fetched));
   }
 
-  avail = gst_adapter_available (demux->download);
-  buf = gst_adapter_take_buffer (demux->download, avail);
-  GST_BUFFER_DURATION (buf) = duration;
-  GST_BUFFER_TIMESTAMP (buf) = timestamp;
-
-  /* We actually need to do this every time we switch bitrate */
-  if (G_UNLIKELY (demux->do_typefind)) {
-    GstCaps *caps = gst_type_find_helper_for_buffer (NULL, buf, NULL);
-
-    if (!demux->input_caps || !gst_caps_is_equal (caps, demux->input_caps)) {
-      gst_caps_replace (&demux->input_caps, caps);
-      /* gst_pad_set_caps (demux->srcpad, demux->input_caps); */
-      GST_INFO_OBJECT (demux, "Input source caps: %" GST_PTR_FORMAT,
-          demux->input_caps);
-      demux->do_typefind = FALSE;
-    } else
-      gst_caps_unref (caps);
+  for (i = 0; i < n_fetched; i++) {
+    GstAdapter *download = demux->fetchers[i].download;
+    GstBuffer *buf;
+
+    buf = gst_adapter_take_buffer (download, gst_adapter_available (download));
+    GST_BUFFER_DURATION (buf) = durations[i];
+    GST_BUFFER_TIMESTAMP (buf) = timestamps[i];
+    size += GST_BUFFER_SIZE (buf);
+
+    /* We actually need to do this every time we switch bitrate */
+    if (G_UNLIKELY (demux->do_typefind)) {
+      GstCaps *caps = gst_type_find_helper_for_buffer (NULL, buf, NULL);
+
+      if (!demux->input_caps || !gst_caps_is_equal (caps, demux->input_caps)) {
+        gst_caps_replace (&demux->input_caps, caps);
+        /* gst_pad_set_caps (demux->srcpad, demux->input_caps); */
+        GST_INFO_OBJECT (demux, "Input source caps: %" GST_PTR_FORMAT,
+            demux->input_caps);
+        demux->do_typefind = FALSE;
+      } else
+        gst_caps_unref (caps);
+    }
+    gst_buffer_set_caps (buf, demux->input_caps);
+
+    if (disconts[i]) {
+      GST_DEBUG_OBJECT (demux, "Marking fragment as discontinuous");
+      GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DISCONT);
+    }
+
+    gst_hls_demux_post_fragment_stats (demux, &demux->fetchers[i], uris[i],
+        GST_BUFFER_SIZE (buf));
+
+    g_queue_push_tail (demux->queue, buf);
+    gst_adapter_clear (download);
   }
-  gst_buffer_set_caps (buf, demux->input_caps);
 
-  if (discont) {
-    GST_DEBUG_OBJECT (demux, "Marking fragment as discontinuous");
-    GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DISCONT);
+  /* the downloads shared the link, so measure them together */
+  if (n_fetched > 0) {
+    gst_hls_demux_update_bandwidth (demux, size, elapsed);
+    gst_task_start (demux->task);
   }
 
-  g_queue_push_tail (demux->queue, buf);
-  gst_task_start (demux->task);
-  gst_adapter_clear (demux->download);
-  return TRUE;
+  for (i = 0; i < n; i++)
+    g_free (uris[i]);
+
+  return n_fetched;
 }
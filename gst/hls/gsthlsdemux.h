@@ -41,6 +41,32 @@ G_BEGIN_DECLS
   (G_TYPE_CHECK_CLASS_TYPE((klass),GST_TYPE_HLS_DEMUX))
 typedef struct _GstHLSDemux GstHLSDemux;
 typedef struct _GstHLSDemuxClass GstHLSDemuxClass;
+typedef struct _GstHLSDemuxFetcher GstHLSDemuxFetcher;
+
+/* maximum number of fragments downloaded at the same time */
+#define GST_HLS_DEMUX_MAX_DOWNLOADS 8
+
+/* A download slot: a source element linked to an internal sink pad that
+ * collects the data of one URI. The element is kept in READY between
+ * downloads and reused for the next URI if it handles its protocol */
+struct _GstHLSDemuxFetcher
+{
+  GstHLSDemux *demux;
+  GstElement *element;
+  GstBus *bus;
+  GstPad *pad;
+  GstAdapter *download;
+  gboolean active;              /* Downloading */
+  gboolean reused;              /* The element was used for a previous URI */
+  gboolean error;
+  gboolean done;                /* Got EOS or an error */
+  gboolean stopping;            /* The element is changing state without the fetcher lock */
+
+  /* Timing of the last download */
+  GstClockTime start_time;
+  GstClockTime first_data_time;
+  GstClockTime end_time;
+};
 
 /**
  * GstHLSDemux:
@@ -61,11 +87,13 @@ struct _GstHLSDemux
   GQueue *queue;                /* Queue storing the fetched fragments */
   gboolean need_cache;          /* Wheter we need to cache some fragments before starting to push data */
   gboolean end_of_playlist;
+  gboolean live_edge;           /* All fragments of the live playlist were fetched, until its next update */
   gboolean do_typefind;		/* Whether we need to typefind the next buffer */
 
   /* Properties */
   guint fragments_cache;        /* number of fragments needed to be cached to start playing */
-  gfloat bitrate_switch_tol;    /* tolerance with respect to the fragment duration to switch the bitarate*/
+  gfloat bitrate_switch_tol;    /* part of the bandwidth estimate kept as headroom when choosing a bitrate */
+  guint concurrent_downloads;   /* number of fragments fetched in parallel */
 
   /* Updates thread */
   GThread *updates_thread;      /* Thread handling the playlist and fragments updates */
@@ -73,19 +101,14 @@ struct _GstHLSDemux
   GCond *thread_cond;           /* Signals the thread to quit */
   gboolean thread_return;       /* Instructs the thread to return after the thread_quit condition is meet */
   GTimeVal next_update;         /* Time of the next update */
-  gint64 accumulated_delay;     /* Delay accumulated fetching fragments, used to decide a playlist switch */
+  guint64 bandwidth;            /* Moving average of the download bandwidth in bits/s, 0 if unknown */
 
-  /* Fragments fetcher */
-  GstElement *fetcher;
-  GstBus *fetcher_bus;
-  GstPad *fetcherpad;
+  /* Fragments fetchers */
+  GstHLSDemuxFetcher fetchers[GST_HLS_DEMUX_MAX_DOWNLOADS];
   GMutex *fetcher_lock;
   GCond *fetcher_cond;
-  GTimeVal *timeout;
-  gboolean fetcher_error;
-  gboolean stopping_fetcher;
+  gboolean fetching;            /* A download is in progress */
   gboolean cancelled;
-  GstAdapter *download;
 
   /* Position in the stream */
   GstClockTime position;
@@ -20,6 +20,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include <glib.h>
 
@@ -42,6 +43,9 @@ gst_m3u8_new (void)
   GstM3U8 *m3u8;
 
   m3u8 = g_new0 (GstM3U8, 1);
+  m3u8->files =
+      g_ptr_array_new_with_free_func ((GDestroyNotify)
+      gst_m3u8_media_file_free);
 
   return m3u8;
 }
@@ -65,10 +69,10 @@ gst_m3u8_free (GstM3U8 * self)
   g_free (self->allowcache);
   g_free (self->codecs);
 
-  g_list_foreach (self->files, (GFunc) gst_m3u8_media_file_free, NULL);
-  g_list_free (self->files);
+  g_ptr_array_free (self->files, TRUE);
 
   g_free (self->last_data);
+  g_free (self->last_file_line);
   g_list_foreach (self->lists, (GFunc) gst_m3u8_free, NULL);
   g_list_free (self->lists);
 
@@ -164,6 +168,22 @@ parse_attributes (gchar ** ptr, gchar ** a, gchar ** v)
   return TRUE;
 }
 
+/* Finds the last line of @data that is @line, and returns the end of it */
+static gchar *
+find_last_line (gchar * data, const gchar * line)
+{
+  gchar *match;
+  gsize len = strlen (line);
+
+  match = g_strrstr (data, line);
+  if (!match || (match > data && match[-1] != '\n'))
+    return NULL;
+  if (match[len] != '\0' && match[len] != '\r' && match[len] != '\n')
+    return NULL;
+
+  return match + len;
+}
+
 static gint
 _m3u8_compare_uri (GstM3U8 * a, gchar * uri)
 {
@@ -189,6 +209,9 @@ gst_m3u8_update (GstM3U8 * self, gchar * data, gboolean * updated)
   gchar *title, *end;
 //  gboolean discontinuity;
   GstM3U8 *list;
+  GstM3U8MediaFile *file;
+  guint first_sequence = 0, last_sequence = 0;
+  gboolean incremental, have_first = FALSE;
 
   g_return_val_if_fail (self != NULL, FALSE);
   g_return_val_if_fail (data != NULL, FALSE);
@@ -214,11 +237,20 @@ gst_m3u8_update (GstM3U8 * self, gchar * data, gboolean * updated)
   g_free (self->last_data);
   self->last_data = data;
 
-  if (self->files) {
-    g_list_foreach (self->files, (GFunc) gst_m3u8_media_file_free, NULL);
-    g_list_free (self->files);
-    self->files = NULL;
+  /* Live and event playlists mostly repeat what we already have. If the
+   * new playlist carries on from the files we know, those are only skipped
+   * over and just the tail is parsed, otherwise everything is reparsed.
+   * That can only be decided once the media sequence of its first file is
+   * known, at the first EXTINF */
+  incremental = self->files->len > 0;
+  if (incremental) {
+    file = g_ptr_array_index (self->files, 0);
+    first_sequence = file->sequence;
+    file = g_ptr_array_index (self->files, self->files->len - 1);
+    last_sequence = file->sequence;
   }
+  /* default value if there is no EXT-X-MEDIA-SEQUENCE */
+  self->mediasequence = 0;
 
   list = NULL;
   duration = -1;
@@ -230,6 +262,7 @@ gst_m3u8_update (GstM3U8 * self, gchar * data, gboolean * updated)
       *end = '\0';
 
     if (data[0] != '#') {
+      gchar *line = data;
       gchar *r;
 
       if (duration < 0 && list == NULL) {
@@ -237,6 +270,13 @@ gst_m3u8_update (GstM3U8 * self, gchar * data, gboolean * updated)
         goto next_line;
       }
 
+      if (list == NULL && incremental && self->mediasequence <= last_sequence) {
+        /* we already have this one */
+        self->mediasequence++;
+        duration = -1;
+        goto next_line;
+      }
+
       if (!gst_uri_is_valid (data)) {
         gchar *slash;
         if (!self->uri) {
@@ -272,13 +312,21 @@ gst_m3u8_update (GstM3U8 * self, gchar * data, gboolean * updated)
         }
         list = NULL;
       } else {
-        GstM3U8MediaFile *file;
         file =
             gst_m3u8_media_file_new (data, title, duration,
             self->mediasequence++);
+        if (self->files->len > 0) {
+          GstM3U8MediaFile *prev;
+
+          prev = g_ptr_array_index (self->files, self->files->len - 1);
+          file->start = prev->start + prev->duration;
+        }
         duration = -1;
         title = NULL;
-        self->files = g_list_append (self->files, file);
+        g_ptr_array_add (self->files, file);
+
+        g_free (self->last_file_line);
+        self->last_file_line = g_strchomp (g_strdup (line));
       }
 
     } else if (g_str_has_prefix (data, "#EXT-X-ENDLIST")) {
@@ -333,6 +381,38 @@ gst_m3u8_update (GstM3U8 * self, gchar * data, gboolean * updated)
       g_free (self->allowcache);
       self->allowcache = g_strdup (data + 19);
     } else if (g_str_has_prefix (data, "#EXTINF:")) {
+      if (!have_first) {
+        have_first = TRUE;
+        if (incremental && (self->mediasequence < first_sequence ||
+                self->mediasequence > last_sequence + 1)) {
+          GST_DEBUG ("Playlist doesn't continue the previous one, reparsing");
+          g_ptr_array_remove_range (self->files, 0, self->files->len);
+          incremental = FALSE;
+        }
+        first_sequence = self->mediasequence;
+
+        /* Jump right behind the newest file we know, searching from the
+         * end of the playlist, and only parse what comes after it. The
+         * known files are stepped over one by one only if it can't be
+         * found */
+        if (incremental && self->mediasequence <= last_sequence && end &&
+            self->last_file_line) {
+          gchar *tail = find_last_line (end + 1, self->last_file_line);
+
+          if (tail) {
+            GST_DEBUG ("Skipping to the files after %u", last_sequence);
+            self->mediasequence = last_sequence + 1;
+            duration = -1;
+            end = strchr (tail, '\n');
+            goto next_line;
+          }
+        }
+      }
+      if (incremental && self->mediasequence <= last_sequence) {
+        /* known file, its uri line will be skipped */
+        duration = 0;
+        goto next_line;
+      }
       if (!int_from_string (data + 8, &data, &val)) {
         GST_WARNING ("Can't read EXTINF duration");
         goto next_line;
@@ -357,6 +437,20 @@ gst_m3u8_update (GstM3U8 * self, gchar * data, gboolean * updated)
     data = g_utf8_next_char (end);      /* skip \n */
   }
 
+  /* drop the files that went out of the playlist window */
+  if (incremental) {
+    guint n_old = 0;
+
+    while (n_old < self->files->len) {
+      file = g_ptr_array_index (self->files, n_old);
+      if (have_first && file->sequence >= first_sequence)
+        break;
+      n_old++;
+    }
+    if (n_old > 0)
+      g_ptr_array_remove_range (self->files, 0, n_old);
+  }
+
   /* redorder playlists by bitrate */
   if (self->lists) {
     gchar *top_variant_uri = NULL;
@@ -447,9 +541,9 @@ gst_m3u8_client_update (GstM3U8Client * self, gchar * data)
     }
   }
 
-  if (m3u8->files && self->sequence == -1) {
+  if (m3u8->files->len > 0 && self->sequence == -1) {
     self->sequence =
-        GST_M3U8_MEDIA_FILE (g_list_first (m3u8->files)->data)->sequence;
+        GST_M3U8_MEDIA_FILE (g_ptr_array_index (m3u8->files, 0))->sequence;
     GST_DEBUG ("Setting first sequence at %d", self->sequence);
   }
 
@@ -459,32 +553,50 @@ out:
   return ret;
 }
 
-static gboolean
-_find_next (GstM3U8MediaFile * file, GstM3U8Client * client)
+/* index of the first file with a sequence number not lower than the client
+ * sequence, files->len if there is none. The sequence numbers of the files
+ * are consecutive */
+static guint
+_find_next (GstM3U8Client * client)
 {
-  GST_DEBUG ("Found fragment %d", file->sequence);
-  if (file->sequence >= client->sequence)
-    return FALSE;
-  return TRUE;
+  GPtrArray *files = client->current->files;
+  GstM3U8MediaFile *first;
+
+  if (files->len == 0)
+    return 0;
+
+  first = g_ptr_array_index (files, 0);
+  if (client->sequence <= (gint) first->sequence)
+    return 0;
+
+  return MIN (files->len, client->sequence - first->sequence);
 }
 
-void
-gst_m3u8_client_get_current_position (GstM3U8Client * client,
-    GstClockTime * timestamp)
+/* duration of the files before @index, in seconds */
+static guint64
+_position_of (GstM3U8 * m3u8, guint index)
 {
-  GList *l;
-  GList *walk;
+  GstM3U8MediaFile *first, *file;
 
-  l = g_list_find_custom (client->current->files, client,
-      (GCompareFunc) _find_next);
+  if (index == 0)
+    return 0;
 
-  *timestamp = 0;
-  for (walk = client->current->files; walk; walk = walk->next) {
-    if (walk == l)
-      break;
-    *timestamp += GST_M3U8_MEDIA_FILE (walk->data)->duration;
+  first = g_ptr_array_index (m3u8->files, 0);
+  if (index < m3u8->files->len) {
+    file = g_ptr_array_index (m3u8->files, index);
+    return file->start - first->start;
   }
-  *timestamp *= GST_SECOND;
+
+  file = g_ptr_array_index (m3u8->files, m3u8->files->len - 1);
+  return file->start + file->duration - first->start;
+}
+
+void
+gst_m3u8_client_get_current_position (GstM3U8Client * client,
+    GstClockTime * timestamp)
+{
+  *timestamp = _position_of (client->current, _find_next (client)) *
+      GST_SECOND;
 }
 
 gboolean
@@ -492,8 +604,8 @@ gst_m3u8_client_get_next_fragment (GstM3U8Client * client,
     gboolean * discontinuity, const gchar ** uri, GstClockTime * duration,
     GstClockTime * timestamp)
 {
-  GList *l;
   GstM3U8MediaFile *file;
+  guint index;
 
   g_return_val_if_fail (client != NULL, FALSE);
   g_return_val_if_fail (client->current != NULL, FALSE);
@@ -501,16 +613,16 @@ gst_m3u8_client_get_next_fragment (GstM3U8Client * client,
 
   GST_M3U8_CLIENT_LOCK (client);
   GST_DEBUG ("Looking for fragment %d", client->sequence);
-  l = g_list_find_custom (client->current->files, client,
-      (GCompareFunc) _find_next);
-  if (l == NULL) {
+  index = _find_next (client);
+  if (index >= client->current->files->len) {
     GST_M3U8_CLIENT_UNLOCK (client);
     return FALSE;
   }
 
-  gst_m3u8_client_get_current_position (client, timestamp);
+  *timestamp = _position_of (client->current, index) * GST_SECOND;
 
-  file = GST_M3U8_MEDIA_FILE (l->data);
+  file = g_ptr_array_index (client->current->files, index);
+  GST_DEBUG ("Found fragment %d", file->sequence);
 
   *discontinuity = client->sequence != file->sequence;
   client->sequence = file->sequence + 1;
@@ -522,12 +634,6 @@ gst_m3u8_client_get_next_fragment (GstM3U8Client * client,
   return TRUE;
 }
 
-static void
-_sum_duration (GstM3U8MediaFile * self, GstClockTime * duration)
-{
-  *duration += self->duration;
-}
-
 GstClockTime
 gst_m3u8_client_get_duration (GstM3U8Client * client)
 {
@@ -542,7 +648,7 @@ gst_m3u8_client_get_duration (GstM3U8Client * client)
     return GST_CLOCK_TIME_NONE;
   }
 
-  g_list_foreach (client->current->files, (GFunc) _sum_duration, &duration);
+  duration = _position_of (client->current, client->current->files->len);
   GST_M3U8_CLIENT_UNLOCK (client);
   return duration * GST_SECOND;
 }
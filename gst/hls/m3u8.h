@@ -49,10 +49,11 @@ struct _GstM3U8
   gchar *codecs;
   gint width;
   gint height;
-  GList *files;
+  GPtrArray *files;             /* GstM3U8MediaFile, ordered by sequence number */
 
   /*< private > */
   gchar *last_data;
+  gchar *last_file_line;        /* uri line of the newest file, as in last_data */
   GList *lists;                 /* list of GstM3U8 from the main playlist */
   GList *current_variant;       /* Current variant playlist used */
   GstM3U8 *parent;              /* main playlist (if any) */
@@ -65,6 +66,7 @@ struct _GstM3U8MediaFile
   gint duration;
   gchar *uri;
   guint sequence;               /* the sequence nb of this file */
+  guint64 start;                /* sum of the durations of the files before */
 };
 
 struct _GstM3U8Client
@@ -77,9 +77,12 @@ static gboolean gst_inter_audio_sink_unlock_stop (GstBaseSink * sink);
 
 enum
 {
-  PROP_0
+  PROP_0,
+  PROP_CHANNEL
 };
 
+#define DEFAULT_CHANNEL "default"
+
 /* pad templates */
 
 static GstStaticPadTemplate gst_inter_audio_sink_sink_template =
@@ -150,22 +153,30 @@ gst_inter_audio_sink_class_init (GstInterAudioSinkClass * klass)
   base_sink_class->unlock_stop =
       GST_DEBUG_FUNCPTR (gst_inter_audio_sink_unlock_stop);
 
+  g_object_class_install_property (gobject_class, PROP_CHANNEL,
+      g_param_spec_string ("channel", "Channel",
+          "Channel name to match inter src and sink elements",
+          DEFAULT_CHANNEL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
 gst_inter_audio_sink_init (GstInterAudioSink * interaudiosink,
     GstInterAudioSinkClass * interaudiosink_class)
 {
-  interaudiosink->surface = gst_inter_surface_get ("default");
+  interaudiosink->channel = g_strdup (DEFAULT_CHANNEL);
 }
 
 void
 gst_inter_audio_sink_set_property (GObject * object, guint property_id,
     const GValue * value, GParamSpec * pspec)
 {
-  /* GstInterAudioSink *interaudiosink = GST_INTER_AUDIO_SINK (object); */
+  GstInterAudioSink *interaudiosink = GST_INTER_AUDIO_SINK (object);
 
   switch (property_id) {
+    case PROP_CHANNEL:
+      g_free (interaudiosink->channel);
+      interaudiosink->channel = g_value_dup_string (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -176,9 +187,12 @@ void
 gst_inter_audio_sink_get_property (GObject * object, guint property_id,
     GValue * value, GParamSpec * pspec)
 {
-  /* GstInterAudioSink *interaudiosink = GST_INTER_AUDIO_SINK (object); */
+  GstInterAudioSink *interaudiosink = GST_INTER_AUDIO_SINK (object);
 
   switch (property_id) {
+    case PROP_CHANNEL:
+      g_value_set_string (value, interaudiosink->channel);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -198,9 +212,10 @@ gst_inter_audio_sink_dispose (GObject * object)
 void
 gst_inter_audio_sink_finalize (GObject * object)
 {
-  /* GstInterAudioSink *interaudiosink = GST_INTER_AUDIO_SINK (object); */
+  GstInterAudioSink *interaudiosink = GST_INTER_AUDIO_SINK (object);
 
   /* clean up object here */
+  g_free (interaudiosink->channel);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -254,6 +269,9 @@ gst_inter_audio_sink_get_times (GstBaseSink * sink, GstBuffer * buffer,
 static gboolean
 gst_inter_audio_sink_start (GstBaseSink * sink)
 {
+  GstInterAudioSink *interaudiosink = GST_INTER_AUDIO_SINK (sink);
+
+  interaudiosink->surface = gst_inter_surface_get (interaudiosink->channel);
 
   return TRUE;
 }
@@ -269,6 +287,9 @@ gst_inter_audio_sink_stop (GstBaseSink * sink)
   gst_adapter_clear (interaudiosink->surface->audio_adapter);
   g_mutex_unlock (interaudiosink->surface->mutex);
 
+  gst_inter_surface_unref (interaudiosink->surface);
+  interaudiosink->surface = NULL;
+
   return TRUE;
 }
 
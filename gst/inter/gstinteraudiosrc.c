@@ -79,9 +79,12 @@ gst_inter_audio_src_prepare_seek_segment (GstBaseSrc * src, GstEvent * seek,
 
 enum
 {
-  PROP_0
+  PROP_0,
+  PROP_CHANNEL
 };
 
+#define DEFAULT_CHANNEL "default"
+
 /* pad templates */
 
 static GstStaticPadTemplate gst_inter_audio_src_src_template =
@@ -158,7 +161,10 @@ gst_inter_audio_src_class_init (GstInterAudioSrcClass * klass)
     base_src_class->prepare_seek_segment =
         GST_DEBUG_FUNCPTR (gst_inter_audio_src_prepare_seek_segment);
 
-
+  g_object_class_install_property (gobject_class, PROP_CHANNEL,
+      g_param_spec_string ("channel", "Channel",
+          "Channel name to match inter src and sink elements",
+          DEFAULT_CHANNEL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -169,16 +175,20 @@ gst_inter_audio_src_init (GstInterAudioSrc * interaudiosrc,
   gst_base_src_set_live (GST_BASE_SRC (interaudiosrc), TRUE);
   gst_base_src_set_blocksize (GST_BASE_SRC (interaudiosrc), -1);
 
-  interaudiosrc->surface = gst_inter_surface_get ("default");
+  interaudiosrc->channel = g_strdup (DEFAULT_CHANNEL);
 }
 
 void
 gst_inter_audio_src_set_property (GObject * object, guint property_id,
     const GValue * value, GParamSpec * pspec)
 {
-  /* GstInterAudioSrc *interaudiosrc = GST_INTER_AUDIO_SRC (object); */
+  GstInterAudioSrc *interaudiosrc = GST_INTER_AUDIO_SRC (object);
 
   switch (property_id) {
+    case PROP_CHANNEL:
+      g_free (interaudiosrc->channel);
+      interaudiosrc->channel = g_value_dup_string (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -189,9 +199,12 @@ void
 gst_inter_audio_src_get_property (GObject * object, guint property_id,
     GValue * value, GParamSpec * pspec)
 {
-  /* GstInterAudioSrc *interaudiosrc = GST_INTER_AUDIO_SRC (object); */
+  GstInterAudioSrc *interaudiosrc = GST_INTER_AUDIO_SRC (object);
 
   switch (property_id) {
+    case PROP_CHANNEL:
+      g_value_set_string (value, interaudiosrc->channel);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -211,9 +224,10 @@ gst_inter_audio_src_dispose (GObject * object)
 void
 gst_inter_audio_src_finalize (GObject * object)
 {
-  /* GstInterAudioSrc *interaudiosrc = GST_INTER_AUDIO_SRC (object); */
+  GstInterAudioSrc *interaudiosrc = GST_INTER_AUDIO_SRC (object);
 
   /* clean up object here */
+  g_free (interaudiosrc->channel);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -276,6 +290,8 @@ gst_inter_audio_src_start (GstBaseSrc * src)
 
   GST_DEBUG_OBJECT (interaudiosrc, "start");
 
+  interaudiosrc->surface = gst_inter_surface_get (interaudiosrc->channel);
+
   return TRUE;
 }
 
@@ -286,6 +302,9 @@ gst_inter_audio_src_stop (GstBaseSrc * src)
 
   GST_DEBUG_OBJECT (interaudiosrc, "stop");
 
+  gst_inter_surface_unref (interaudiosrc->surface);
+  interaudiosrc->surface = NULL;
+
   return TRUE;
 }
 
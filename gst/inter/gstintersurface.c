@@ -21,22 +21,172 @@
 #include "config.h"
 #endif
 
-#include "gstintersurface.h"
+#include <string.h>
 
-static GstInterSurface *surface;
+#include "gstintersurface.h"
 
+/* the surfaces in use, looked up by channel name */
+static GList *surfaces;
+static GStaticMutex surfaces_lock = G_STATIC_MUTEX_INIT;
 
 GstInterSurface *
 gst_inter_surface_get (const char *name)
 {
+  GstInterSurface *surface;
+  GList *walk;
+
+  g_static_mutex_lock (&surfaces_lock);
+  for (walk = surfaces; walk; walk = walk->next) {
+    surface = walk->data;
+    if (strcmp (surface->name, name) == 0) {
+      surface->ref_count++;
+      goto done;
+    }
+  }
+
+  surface = g_malloc0 (sizeof (GstInterSurface));
+  surface->name = g_strdup (name);
+  surface->ref_count = 1;
+  surface->mutex = g_mutex_new ();
+  surface->audio_adapter = gst_adapter_new ();
+  surfaces = g_list_prepend (surfaces, surface);
+
+done:
+  g_static_mutex_unlock (&surfaces_lock);
+
   return surface;
+}
+
+void
+gst_inter_surface_unref (GstInterSurface * surface)
+{
+  int i;
+
+  g_static_mutex_lock (&surfaces_lock);
+  if (--surface->ref_count > 0) {
+    g_static_mutex_unlock (&surfaces_lock);
+    return;
+  }
+  surfaces = g_list_remove (surfaces, surface);
+  g_static_mutex_unlock (&surfaces_lock);
+
+  for (i = 0; i < GST_INTER_SURFACE_VIDEO_SLOTS; i++) {
+    if (surface->video_slots[i].buffer)
+      gst_buffer_unref (surface->video_slots[i].buffer);
+  }
+  g_object_unref (surface->audio_adapter);
+  g_mutex_free (surface->mutex);
+  g_free (surface->name);
+  g_free (surface);
+}
+
+/* Replaces the buffer of a slot, called with the mutex held.  Sources only
+ * increment readers while taking their reference, so the wait is short.
+ * Returns the previous buffer, which no source is looking at anymore. */
+static GstBuffer *
+gst_inter_surface_replace_slot (GstInterVideoSlot * slot, GstBuffer * buffer,
+    gint seq)
+{
+  GstBuffer *old;
+
+  old = slot->buffer;
+  g_atomic_int_set (&slot->seq, 0);
+  g_atomic_pointer_set (&slot->buffer, buffer);
+  g_atomic_int_set (&slot->seq, seq);
+
+  while (g_atomic_int_get (&slot->readers) > 0)
+    g_thread_yield ();
 
+  return old;
 }
 
 void
-gst_inter_surface_init (void)
+gst_inter_surface_push_video (GstInterSurface * surface, GstBuffer * buffer)
 {
-  surface = g_malloc0 (sizeof (GstInterSurface));
-  surface->mutex = g_mutex_new ();
-  surface->audio_adapter = gst_adapter_new ();
+  GstInterVideoSlot *slot;
+  GstBuffer *old;
+  gint seq;
+
+  g_mutex_lock (surface->mutex);
+  seq = surface->video_seq + 1;
+  slot = &surface->video_slots[seq % GST_INTER_SURFACE_VIDEO_SLOTS];
+  old = gst_inter_surface_replace_slot (slot, gst_buffer_ref (buffer), seq);
+  g_atomic_int_set (&surface->video_seq, seq);
+  g_mutex_unlock (surface->mutex);
+
+  if (old)
+    gst_buffer_unref (old);
+}
+
+/* Drops all frames.  The sequence numbers are kept, so the sources see
+ * empty slots instead of having to resynchronize. */
+void
+gst_inter_surface_clear_video (GstInterSurface * surface)
+{
+  GstInterVideoSlot *slot;
+  GstBuffer *old[GST_INTER_SURFACE_VIDEO_SLOTS];
+  int i;
+
+  g_mutex_lock (surface->mutex);
+  for (i = 0; i < GST_INTER_SURFACE_VIDEO_SLOTS; i++) {
+    slot = &surface->video_slots[i];
+    old[i] = gst_inter_surface_replace_slot (slot, NULL, slot->seq);
+  }
+  g_mutex_unlock (surface->mutex);
+
+  for (i = 0; i < GST_INTER_SURFACE_VIDEO_SLOTS; i++) {
+    if (old[i])
+      gst_buffer_unref (old[i]);
+  }
+}
+
+/* Returns a reference to the frame following @last_seq, or to the one
+ * before the newest if the source fell further behind, or to the newest
+ * again if there is nothing new.  The sequence number of the frame is
+ * stored in @seq.  Returns NULL if there is no frame.  Never blocks on the
+ * sinks, and sources don't block each other. */
+GstBuffer *
+gst_inter_surface_get_video (GstInterSurface * surface, gint last_seq,
+    gint * seq)
+{
+  GstInterVideoSlot *slot;
+  GstBuffer *buffer;
+  gint latest, want;
+
+  for (;;) {
+    latest = g_atomic_int_get (&surface->video_seq);
+    if (latest == 0)
+      return NULL;
+
+    /* staying one frame behind the newest absorbs jitter between the sink
+     * and the source without building up latency */
+    want = CLAMP (last_seq + 1, MAX (latest - 1, 1), latest);
+    slot = &surface->video_slots[want % GST_INTER_SURFACE_VIDEO_SLOTS];
+
+    /* the buffer can't go away while readers is set, and it belongs to
+     * frame want if seq didn't change while we took the reference */
+    buffer = NULL;
+    g_atomic_int_inc (&slot->readers);
+    if (g_atomic_int_get (&slot->seq) == want) {
+      buffer = g_atomic_pointer_get (&slot->buffer);
+      if (buffer)
+        gst_buffer_ref (buffer);
+      if (g_atomic_int_get (&slot->seq) != want) {
+        if (buffer)
+          gst_buffer_unref (buffer);
+        buffer = NULL;
+        want = 0;
+      }
+    } else {
+      want = 0;
+    }
+    g_atomic_int_add (&slot->readers, -1);
+
+    /* the sink lapped us, try again with the newer frames */
+    if (want == 0)
+      continue;
+
+    *seq = want;
+    return buffer;
+  }
 }
@@ -26,11 +26,29 @@
 G_BEGIN_DECLS
 
 typedef struct _GstInterSurface GstInterSurface;
+typedef struct _GstInterVideoSlot GstInterVideoSlot;
+
+/* number of frames kept around for the video sources, which lets a source
+ * that is a bit late still pick up the frame it expects */
+#define GST_INTER_SURFACE_VIDEO_SLOTS 4
+
+struct _GstInterVideoSlot
+{
+  /* sequence number of the frame in buffer, 0 while it is being replaced */
+  volatile gint seq;
+  /* number of sources currently taking a reference on buffer */
+  volatile gint readers;
+  gpointer buffer;
+};
 
 struct _GstInterSurface
 {
+  /* only taken by the sinks, and by both sides for the audio adapter */
   GMutex *mutex;
 
+  char *name;
+  int ref_count;
+
   /* video */
   GstVideoFormat format;
   int fps_n;
@@ -38,19 +56,27 @@ struct _GstInterSurface
   int width;
   int height;
   int n_frames;
-  int video_buffer_count;
+
+  /* sequence number of the newest video frame, 0 if there never was one.
+   * Written with the mutex held, read by the sources without it */
+  volatile gint video_seq;
+  GstInterVideoSlot video_slots[GST_INTER_SURFACE_VIDEO_SLOTS];
 
   /* audio */
   int sample_rate;
   int n_channels;
 
-  GstBuffer *video_buffer;
   GstAdapter *audio_adapter;
 };
 
 
 GstInterSurface * gst_inter_surface_get (const char *name);
-void gst_inter_surface_init (void);
+void gst_inter_surface_unref (GstInterSurface *surface);
+
+void gst_inter_surface_push_video (GstInterSurface *surface, GstBuffer *buffer);
+void gst_inter_surface_clear_video (GstInterSurface *surface);
+GstBuffer * gst_inter_surface_get_video (GstInterSurface *surface,
+    gint last_seq, gint *seq);
 
 
 G_END_DECLS
@@ -80,9 +80,14 @@ gst_inter_video_src_prepare_seek_segment (GstBaseSrc * src, GstEvent * seek,
 
 enum
 {
-  PROP_0
+  PROP_0,
+  PROP_CHANNEL,
+  PROP_FRAMES_DROPPED,
+  PROP_FRAMES_REPEATED
 };
 
+#define DEFAULT_CHANNEL "default"
+
 /* pad templates */
 
 static GstStaticPadTemplate gst_inter_video_src_src_template =
@@ -156,7 +161,18 @@ gst_inter_video_src_class_init (GstInterVideoSrcClass * klass)
     base_src_class->prepare_seek_segment =
         GST_DEBUG_FUNCPTR (gst_inter_video_src_prepare_seek_segment);
 
-
+  g_object_class_install_property (gobject_class, PROP_CHANNEL,
+      g_param_spec_string ("channel", "Channel",
+          "Channel name to match inter src and sink elements",
+          DEFAULT_CHANNEL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_FRAMES_DROPPED,
+      g_param_spec_uint64 ("frames-dropped", "Frames dropped",
+          "Number of frames of the sink this source skipped",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_FRAMES_REPEATED,
+      g_param_spec_uint64 ("frames-repeated", "Frames repeated",
+          "Number of times this source output the same frame again",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -166,16 +182,20 @@ gst_inter_video_src_init (GstInterVideoSrc * intervideosrc,
   gst_base_src_set_format (GST_BASE_SRC (intervideosrc), GST_FORMAT_TIME);
   gst_base_src_set_live (GST_BASE_SRC (intervideosrc), TRUE);
 
-  intervideosrc->surface = gst_inter_surface_get ("default");
+  intervideosrc->channel = g_strdup (DEFAULT_CHANNEL);
 }
 
 void
 gst_inter_video_src_set_property (GObject * object, guint property_id,
     const GValue * value, GParamSpec * pspec)
 {
-  /* GstInterVideoSrc *intervideosrc = GST_INTER_VIDEO_SRC (object); */
+  GstInterVideoSrc *intervideosrc = GST_INTER_VIDEO_SRC (object);
 
   switch (property_id) {
+    case PROP_CHANNEL:
+      g_free (intervideosrc->channel);
+      intervideosrc->channel = g_value_dup_string (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -186,9 +206,22 @@ void
 gst_inter_video_src_get_property (GObject * object, guint property_id,
     GValue * value, GParamSpec * pspec)
 {
-  /* GstInterVideoSrc *intervideosrc = GST_INTER_VIDEO_SRC (object); */
+  GstInterVideoSrc *intervideosrc = GST_INTER_VIDEO_SRC (object);
 
   switch (property_id) {
+    case PROP_CHANNEL:
+      g_value_set_string (value, intervideosrc->channel);
+      break;
+    case PROP_FRAMES_DROPPED:
+      GST_OBJECT_LOCK (intervideosrc);
+      g_value_set_uint64 (value, intervideosrc->frames_dropped);
+      GST_OBJECT_UNLOCK (intervideosrc);
+      break;
+    case PROP_FRAMES_REPEATED:
+      GST_OBJECT_LOCK (intervideosrc);
+      g_value_set_uint64 (value, intervideosrc->frames_repeated);
+      GST_OBJECT_UNLOCK (intervideosrc);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -208,9 +241,10 @@ gst_inter_video_src_dispose (GObject * object)
 void
 gst_inter_video_src_finalize (GObject * object)
 {
-  /* GstInterVideoSrc *intervideosrc = GST_INTER_VIDEO_SRC (object); */
+  GstInterVideoSrc *intervideosrc = GST_INTER_VIDEO_SRC (object);
 
   /* clean up object here */
+  g_free (intervideosrc->channel);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -279,6 +313,15 @@ gst_inter_video_src_start (GstBaseSrc * src)
 
   GST_DEBUG_OBJECT (intervideosrc, "start");
 
+  intervideosrc->surface = gst_inter_surface_get (intervideosrc->channel);
+  intervideosrc->last_seq = 0;
+  intervideosrc->video_buffer_count = 0;
+
+  GST_OBJECT_LOCK (intervideosrc);
+  intervideosrc->frames_dropped = 0;
+  intervideosrc->frames_repeated = 0;
+  GST_OBJECT_UNLOCK (intervideosrc);
+
   return TRUE;
 }
 
@@ -289,6 +332,13 @@ gst_inter_video_src_stop (GstBaseSrc * src)
 
   GST_DEBUG_OBJECT (intervideosrc, "stop");
 
+  GST_DEBUG_OBJECT (intervideosrc, "dropped %" G_GUINT64_FORMAT
+      " frames, repeated %" G_GUINT64_FORMAT, intervideosrc->frames_dropped,
+      intervideosrc->frames_repeated);
+
+  gst_inter_surface_unref (intervideosrc->surface);
+  intervideosrc->surface = NULL;
+
   return TRUE;
 }
 
@@ -356,21 +406,32 @@ gst_inter_video_src_create (GstBaseSrc * src, guint64 offset, guint size,
   GstInterVideoSrc *intervideosrc = GST_INTER_VIDEO_SRC (src);
   GstBuffer *buffer;
   guint8 *data;
+  gint seq;
 
   GST_DEBUG_OBJECT (intervideosrc, "create");
 
-  buffer = NULL;
+  buffer = gst_inter_surface_get_video (intervideosrc->surface,
+      intervideosrc->last_seq, &seq);
+
+  if (buffer) {
+    GST_OBJECT_LOCK (intervideosrc);
+    if (seq == intervideosrc->last_seq) {
+      intervideosrc->frames_repeated++;
+      intervideosrc->video_buffer_count++;
+    } else {
+      if (intervideosrc->last_seq > 0 && seq > intervideosrc->last_seq + 1)
+        intervideosrc->frames_dropped += seq - intervideosrc->last_seq - 1;
+      intervideosrc->video_buffer_count = 1;
+    }
+    GST_OBJECT_UNLOCK (intervideosrc);
+    intervideosrc->last_seq = seq;
 
-  g_mutex_lock (intervideosrc->surface->mutex);
-  if (intervideosrc->surface->video_buffer) {
-    buffer = gst_buffer_ref (intervideosrc->surface->video_buffer);
-    intervideosrc->surface->video_buffer_count++;
-    if (intervideosrc->surface->video_buffer_count >= 30) {
-      gst_buffer_unref (intervideosrc->surface->video_buffer);
-      intervideosrc->surface->video_buffer = NULL;
+    /* the sink went away, stop showing its last frame after a while */
+    if (intervideosrc->video_buffer_count > 30) {
+      gst_buffer_unref (buffer);
+      buffer = NULL;
     }
   }
-  g_mutex_unlock (intervideosrc->surface->mutex);
 
   if (buffer == NULL) {
     buffer =
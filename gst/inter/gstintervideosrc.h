@@ -40,6 +40,14 @@ struct _GstInterVideoSrc
   GstBaseSrc base_intervideosrc;
 
   GstInterSurface *surface;
+  char *channel;
+
+  /* sequence number of the last frame taken from the surface */
+  gint last_seq;
+  /* number of times that frame was output */
+  int video_buffer_count;
+  guint64 frames_dropped;
+  guint64 frames_repeated;
 
   GstVideoFormat format;
   int fps_n;
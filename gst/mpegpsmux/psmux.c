@@ -52,7 +52,7 @@
 #include "psmuxcommon.h"
 #include "psmuxstream.h"
 #include "psmux.h"
-#include "crc.h"
+#include <gst/gst-mpeg-crc.h>
 
 static gboolean psmux_packet_out (PsMux * mux);
 static gboolean psmux_write_pack_header (PsMux * mux);
@@ -466,7 +466,7 @@ psmux_ensure_program_stream_map (PsMux * mux)
 
   /* CRC32 */
   {
-    guint32 crc = calc_crc32 (bw.p_data, psm_size - 4);
+    guint32 crc = gst_mpeg_crc32 (bw.p_data, psm_size - 4);
     guint8 *pos = bw.p_data + psm_size - 4;
     psmux_put32 (&pos, crc);
   }
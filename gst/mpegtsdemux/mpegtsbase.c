@@ -66,6 +66,9 @@ static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
 enum
 {
   ARG_0,
+  PROP_FILTERED_PACKETS,
+  PROP_SECTION_CACHE_HITS,
+  PROP_SECTION_CACHE_MISSES,
   /* FILL ME */
 };
 
@@ -94,65 +97,6 @@ GST_BOILERPLATE_FULL (MpegTSBase, mpegts_base, GstElement, GST_TYPE_ELEMENT,
     _extra_init);
 
 
-static const guint32 crc_tab[256] = {
-  0x00000000, 0x04c11db7, 0x09823b6e, 0x0d4326d9, 0x130476dc, 0x17c56b6b,
-  0x1a864db2, 0x1e475005, 0x2608edb8, 0x22c9f00f, 0x2f8ad6d6, 0x2b4bcb61,
-  0x350c9b64, 0x31cd86d3, 0x3c8ea00a, 0x384fbdbd, 0x4c11db70, 0x48d0c6c7,
-  0x4593e01e, 0x4152fda9, 0x5f15adac, 0x5bd4b01b, 0x569796c2, 0x52568b75,
-  0x6a1936c8, 0x6ed82b7f, 0x639b0da6, 0x675a1011, 0x791d4014, 0x7ddc5da3,
-  0x709f7b7a, 0x745e66cd, 0x9823b6e0, 0x9ce2ab57, 0x91a18d8e, 0x95609039,
-  0x8b27c03c, 0x8fe6dd8b, 0x82a5fb52, 0x8664e6e5, 0xbe2b5b58, 0xbaea46ef,
-  0xb7a96036, 0xb3687d81, 0xad2f2d84, 0xa9ee3033, 0xa4ad16ea, 0xa06c0b5d,
-  0xd4326d90, 0xd0f37027, 0xddb056fe, 0xd9714b49, 0xc7361b4c, 0xc3f706fb,
-  0xceb42022, 0xca753d95, 0xf23a8028, 0xf6fb9d9f, 0xfbb8bb46, 0xff79a6f1,
-  0xe13ef6f4, 0xe5ffeb43, 0xe8bccd9a, 0xec7dd02d, 0x34867077, 0x30476dc0,
-  0x3d044b19, 0x39c556ae, 0x278206ab, 0x23431b1c, 0x2e003dc5, 0x2ac12072,
-  0x128e9dcf, 0x164f8078, 0x1b0ca6a1, 0x1fcdbb16, 0x018aeb13, 0x054bf6a4,
-  0x0808d07d, 0x0cc9cdca, 0x7897ab07, 0x7c56b6b0, 0x71159069, 0x75d48dde,
-  0x6b93dddb, 0x6f52c06c, 0x6211e6b5, 0x66d0fb02, 0x5e9f46bf, 0x5a5e5b08,
-  0x571d7dd1, 0x53dc6066, 0x4d9b3063, 0x495a2dd4, 0x44190b0d, 0x40d816ba,
-  0xaca5c697, 0xa864db20, 0xa527fdf9, 0xa1e6e04e, 0xbfa1b04b, 0xbb60adfc,
-  0xb6238b25, 0xb2e29692, 0x8aad2b2f, 0x8e6c3698, 0x832f1041, 0x87ee0df6,
-  0x99a95df3, 0x9d684044, 0x902b669d, 0x94ea7b2a, 0xe0b41de7, 0xe4750050,
-  0xe9362689, 0xedf73b3e, 0xf3b06b3b, 0xf771768c, 0xfa325055, 0xfef34de2,
-  0xc6bcf05f, 0xc27dede8, 0xcf3ecb31, 0xcbffd686, 0xd5b88683, 0xd1799b34,
-  0xdc3abded, 0xd8fba05a, 0x690ce0ee, 0x6dcdfd59, 0x608edb80, 0x644fc637,
-  0x7a089632, 0x7ec98b85, 0x738aad5c, 0x774bb0eb, 0x4f040d56, 0x4bc510e1,
-  0x46863638, 0x42472b8f, 0x5c007b8a, 0x58c1663d, 0x558240e4, 0x51435d53,
-  0x251d3b9e, 0x21dc2629, 0x2c9f00f0, 0x285e1d47, 0x36194d42, 0x32d850f5,
-  0x3f9b762c, 0x3b5a6b9b, 0x0315d626, 0x07d4cb91, 0x0a97ed48, 0x0e56f0ff,
-  0x1011a0fa, 0x14d0bd4d, 0x19939b94, 0x1d528623, 0xf12f560e, 0xf5ee4bb9,
-  0xf8ad6d60, 0xfc6c70d7, 0xe22b20d2, 0xe6ea3d65, 0xeba91bbc, 0xef68060b,
-  0xd727bbb6, 0xd3e6a601, 0xdea580d8, 0xda649d6f, 0xc423cd6a, 0xc0e2d0dd,
-  0xcda1f604, 0xc960ebb3, 0xbd3e8d7e, 0xb9ff90c9, 0xb4bcb610, 0xb07daba7,
-  0xae3afba2, 0xaafbe615, 0xa7b8c0cc, 0xa379dd7b, 0x9b3660c6, 0x9ff77d71,
-  0x92b45ba8, 0x9675461f, 0x8832161a, 0x8cf30bad, 0x81b02d74, 0x857130c3,
-  0x5d8a9099, 0x594b8d2e, 0x5408abf7, 0x50c9b640, 0x4e8ee645, 0x4a4ffbf2,
-  0x470cdd2b, 0x43cdc09c, 0x7b827d21, 0x7f436096, 0x7200464f, 0x76c15bf8,
-  0x68860bfd, 0x6c47164a, 0x61043093, 0x65c52d24, 0x119b4be9, 0x155a565e,
-  0x18197087, 0x1cd86d30, 0x029f3d35, 0x065e2082, 0x0b1d065b, 0x0fdc1bec,
-  0x3793a651, 0x3352bbe6, 0x3e119d3f, 0x3ad08088, 0x2497d08d, 0x2056cd3a,
-  0x2d15ebe3, 0x29d4f654, 0xc5a92679, 0xc1683bce, 0xcc2b1d17, 0xc8ea00a0,
-  0xd6ad50a5, 0xd26c4d12, 0xdf2f6bcb, 0xdbee767c, 0xe3a1cbc1, 0xe760d676,
-  0xea23f0af, 0xeee2ed18, 0xf0a5bd1d, 0xf464a0aa, 0xf9278673, 0xfde69bc4,
-  0x89b8fd09, 0x8d79e0be, 0x803ac667, 0x84fbdbd0, 0x9abc8bd5, 0x9e7d9662,
-  0x933eb0bb, 0x97ffad0c, 0xafb010b1, 0xab710d06, 0xa6322bdf, 0xa2f33668,
-  0xbcb4666d, 0xb8757bda, 0xb5365d03, 0xb1f740b4
-};
-
-/* relicenced to LGPL from fluendo ts demuxer */
-static guint32
-mpegts_base_calc_crc32 (guint8 * data, guint datalen)
-{
-  gint i;
-  guint32 crc = 0xffffffff;
-
-  for (i = 0; i < datalen; i++) {
-    crc = (crc << 8) ^ crc_tab[((crc >> 24) ^ *data++) & 0xff];
-  }
-  return crc;
-}
-
 static void
 _extra_init (GType type)
 {
@@ -188,6 +132,20 @@ mpegts_base_class_init (MpegTSBaseClass * klass)
   gobject_class->dispose = mpegts_base_dispose;
   gobject_class->finalize = mpegts_base_finalize;
 
+  g_object_class_install_property (gobject_class, PROP_FILTERED_PACKETS,
+      g_param_spec_uint64 ("filtered-packets", "Filtered packets",
+          "Number of packets dropped by PID before being parsed", 0,
+          G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_SECTION_CACHE_HITS,
+      g_param_spec_uint64 ("section-cache-hits", "Section cache hits",
+          "Number of PSI sections dropped because they were unchanged", 0,
+          G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_SECTION_CACHE_MISSES,
+      g_param_spec_uint64 ("section-cache-misses", "Section cache misses",
+          "Number of new or changed PSI sections which had to be parsed", 0,
+          G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -202,6 +160,10 @@ mpegts_base_reset (MpegTSBase * base)
   /* PAT */
   MPEGTS_BIT_SET (base->known_psi, 0);
 
+  /* Let everything through until a PMT tells which streams are wanted, as
+   * mpegts_base_is_psi() may still find PSI on PIDs we don't know yet */
+  mpegts_packetizer_set_pid_filtering (base->packetizer, FALSE);
+
   /* FIXME : Commenting the Following lines is to be in sync with the following
    * commit
    *
@@ -299,9 +261,18 @@ static void
 mpegts_base_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec)
 {
-  /* MpegTSBase *base = GST_MPEGTS_BASE (object); */
+  MpegTSBase *base = GST_MPEGTS_BASE (object);
 
   switch (prop_id) {
+    case PROP_FILTERED_PACKETS:
+      g_value_set_uint64 (value, base->packetizer->n_filtered);
+      break;
+    case PROP_SECTION_CACHE_HITS:
+      g_value_set_uint64 (value, base->packetizer->n_section_cache_hits);
+      break;
+    case PROP_SECTION_CACHE_MISSES:
+      g_value_set_uint64 (value, base->packetizer->n_section_cache_misses);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -365,6 +336,50 @@ mpegts_pid_in_active_programs (MpegTSBase * base, guint16 pid)
   return lookup.res;
 }
 
+typedef struct
+{
+  MpegTSBase *base;
+  gboolean res;
+  guint16 pid;
+} WantedPIDLookup;
+
+static void
+foreach_pid_in_wanted_program (gpointer key, MpegTSBaseProgram * program,
+    WantedPIDLookup * lookup)
+{
+  MpegTSBaseClass *klass = GST_MPEGTS_BASE_GET_CLASS (lookup->base);
+
+  if (!program->active || lookup->res)
+    return;
+  if (klass->program_wanted && !klass->program_wanted (lookup->base, program))
+    return;
+  if (program->streams[lookup->pid])
+    lookup->res = TRUE;
+}
+
+/* Update whether packets of @pid should get past the packetizer. A PID is
+ * wanted if it is a known PSI PID, one of the reserved SI PIDs (DVB SI
+ * lives in 0x00-0x1F and ATSC PSIP on the base PID 0x1FFB) or a stream of a
+ * program the subclass is interested in. Known PSI PIDs carry the PAT and
+ * the PMTs, which may change the filter, so a batch ends after them */
+static void
+mpegts_base_update_pid_filter (MpegTSBase * base, guint16 pid)
+{
+  WantedPIDLookup lookup;
+  gboolean known_psi = MPEGTS_BIT_IS_SET (base->known_psi, pid);
+
+  lookup.base = base;
+  lookup.pid = pid;
+  lookup.res = pid < 0x20 || pid == 0x1FFB || known_psi;
+
+  if (!lookup.res)
+    g_hash_table_foreach (base->programs,
+        (GHFunc) foreach_pid_in_wanted_program, &lookup);
+
+  mpegts_packetizer_set_pid_wanted (base->packetizer, pid, lookup.res);
+  mpegts_packetizer_set_pid_ends_batch (base->packetizer, pid, known_psi);
+}
+
 /* returns NULL if no matching descriptor found *
  * otherwise returns a descriptor that needs to *
  * be freed */
@@ -429,6 +444,7 @@ mpegts_base_add_program (MpegTSBase * base,
 
   /* Mark the PMT PID as being a known PSI PID */
   MPEGTS_BIT_SET (base->known_psi, pmt_pid);
+  mpegts_base_update_pid_filter (base, pmt_pid);
 
   g_hash_table_insert (base->programs,
       GINT_TO_POINTER (program_number), program);
@@ -601,6 +617,7 @@ mpegts_base_deactivate_program (MpegTSBase * base, MpegTSBaseProgram * program)
        * program */
       if (!mpegts_pid_in_active_programs (base, pid))
         MPEGTS_BIT_UNSET (base->is_pes, pid);
+      mpegts_base_update_pid_filter (base, pid);
     }
 
     /* remove pcr stream */
@@ -608,6 +625,7 @@ mpegts_base_deactivate_program (MpegTSBase * base, MpegTSBaseProgram * program)
     mpegts_base_program_remove_stream (base, program, program->pcr_pid);
     if (!mpegts_pid_in_active_programs (base, program->pcr_pid))
       MPEGTS_BIT_UNSET (base->is_pes, program->pcr_pid);
+    mpegts_base_update_pid_filter (base, program->pcr_pid);
 
     GST_DEBUG ("program stream_list is now %p", program->stream_list);
   }
@@ -625,6 +643,7 @@ mpegts_base_activate_program (MpegTSBase * base, MpegTSBaseProgram * program,
   const GValue *new_streams;
   const GValue *value;
   MpegTSBaseClass *klass;
+  GList *tmp;
 
   if (G_UNLIKELY (program->active))
     return;
@@ -666,6 +685,19 @@ mpegts_base_activate_program (MpegTSBase * base, MpegTSBaseProgram * program,
   if (klass->program_started != NULL)
     klass->program_started (base, program);
 
+  /* Now that the subclass has seen the program, let the packets of its
+   * streams through if it wants them. With the first PMT we know enough to
+   * start filtering at all */
+  if (base->packetizer->pid_filter == NULL) {
+    mpegts_packetizer_set_pid_filtering (base->packetizer, TRUE);
+    for (i = 0; i < 0x2000; i++)
+      mpegts_base_update_pid_filter (base, i);
+  } else {
+    for (tmp = program->stream_list; tmp; tmp = tmp->next)
+      mpegts_base_update_pid_filter (base,
+          ((MpegTSBaseStream *) tmp->data)->pid);
+  }
+
   GST_DEBUG_OBJECT (base, "new pmt %" GST_PTR_FORMAT, pmt_info);
 }
 
@@ -776,10 +808,12 @@ mpegts_base_apply_pat (MpegTSBase * base, GstStructure * pat_info)
            * program, so setting to False may make it go through expensive
            * path in is_psi unnecessarily */
           MPEGTS_BIT_UNSET (base->known_psi, program->pmt_pid);
+          mpegts_base_update_pid_filter (base, program->pmt_pid);
         }
 
         program->pmt_pid = pid;
         MPEGTS_BIT_SET (base->known_psi, pid);
+        mpegts_base_update_pid_filter (base, pid);
       }
     } else {
       /* Create a new program */
@@ -954,14 +988,8 @@ mpegts_base_handle_psi (MpegTSBase * base, MpegTSPacketizerSection * section)
   gboolean res = TRUE;
   GstStructure *structure = NULL;
 
-  /* table ids 0x70 - 0x73 do not have a crc */
-  if (G_LIKELY (section->table_id < 0x70 || section->table_id > 0x73)) {
-    if (G_UNLIKELY (mpegts_base_calc_crc32 (GST_BUFFER_DATA (section->buffer),
-                GST_BUFFER_SIZE (section->buffer)) != 0)) {
-      GST_WARNING_OBJECT (base, "bad crc in psi pid 0x%x", section->pid);
-      return FALSE;
-    }
-  }
+  /* The CRC was already checked by the packetizer, which also dropped the
+   * sections it had already handed out */
 
   switch (section->table_id) {
     case 0x00:
@@ -1248,9 +1276,10 @@ mpegts_base_chain (GstPad * pad, GstBuffer * buf)
   GstFlowReturn res = GST_FLOW_OK;
   MpegTSBase *base;
   gboolean based;
-  MpegTSPacketizerPacketReturn pret;
   MpegTSPacketizer2 *packetizer;
-  MpegTSPacketizerPacket packet;
+  MpegTSPacketizerPacket packets[MPEGTS_PACKETIZER_BATCH_SIZE];
+  MpegTSPacketizerPacketReturn prets[MPEGTS_PACKETIZER_BATCH_SIZE];
+  guint i, n;
 
   base = GST_MPEGTS_BASE (gst_object_get_parent (GST_OBJECT (pad)));
   packetizer = base->packetizer;
@@ -1263,41 +1292,53 @@ mpegts_base_chain (GstPad * pad, GstBuffer * buf)
   }
 
   mpegts_packetizer_push (base->packetizer, buf);
-  while (((pret =
-              mpegts_packetizer_next_packet (base->packetizer,
-                  &packet)) != PACKET_NEED_MORE) && res == GST_FLOW_OK) {
-    if (G_UNLIKELY (pret == PACKET_BAD))
-      /* bad header, skip the packet */
-      goto next;
-
-    /* base PSI data */
-    if (packet.payload != NULL && mpegts_base_is_psi (base, &packet)) {
-      MpegTSPacketizerSection section;
-      based = mpegts_packetizer_push_section (packetizer, &packet, &section);
-      if (G_UNLIKELY (!based))
-        /* bad section data */
-        goto next;
+  while (res == GST_FLOW_OK && (n = mpegts_packetizer_next_packets (packetizer,
+              packets, prets, MPEGTS_PACKETIZER_BATCH_SIZE)) > 0) {
+    for (i = 0; i < n; i++) {
+      MpegTSPacketizerPacket *packet = &packets[i];
+
+      if (G_UNLIKELY (res != GST_FLOW_OK)) {
+        /* downstream stopped in the middle of the batch, keep the rest for
+         * the next call like the data still in the adapter.  A flush drops
+         * them */
+        mpegts_packetizer_return_packets (packetizer, packet, &prets[i],
+            n - i);
+        break;
+      }
 
-      if (G_LIKELY (section.complete)) {
-        /* section complete */
-        based = mpegts_base_handle_psi (base, &section);
-        gst_buffer_unref (section.buffer);
+      if (G_UNLIKELY (prets[i] == PACKET_BAD))
+        /* bad header, skip the packet */
+        goto next;
 
+      /* base PSI data */
+      if (packet->payload != NULL && mpegts_base_is_psi (base, packet)) {
+        MpegTSPacketizerSection section;
+        based = mpegts_packetizer_push_section (packetizer, packet, &section);
         if (G_UNLIKELY (!based))
-          /* bad PSI table */
+          /* bad section data */
           goto next;
-      }
-      /* we need to push section packet downstream */
-      res = mpegts_base_push (base, &packet, &section);
 
-    } else if (MPEGTS_BIT_IS_SET (base->is_pes, packet.pid)) {
-      /* push the packet downstream */
-      res = mpegts_base_push (base, &packet, NULL);
-    } else
-      gst_buffer_unref (packet.buffer);
+        if (G_LIKELY (section.complete)) {
+          /* section complete */
+          based = mpegts_base_handle_psi (base, &section);
+          gst_buffer_unref (section.buffer);
+
+          if (G_UNLIKELY (!based))
+            /* bad PSI table */
+            goto next;
+        }
+        /* we need to push section packet downstream */
+        res = mpegts_base_push (base, packet, &section);
+
+      } else if (MPEGTS_BIT_IS_SET (base->is_pes, packet->pid)) {
+        /* push the packet downstream */
+        res = mpegts_base_push (base, packet, NULL);
+      } else
+        gst_buffer_unref (packet->buffer);
 
-  next:
-    mpegts_packetizer_clear_packet (base->packetizer, &packet);
+    next:
+      mpegts_packetizer_clear_packet (packetizer, packet);
+    }
   }
 
   gst_object_unref (base);
@@ -154,6 +154,12 @@ struct _MpegTSBaseClass {
   /* program_stopped gets called when pat no longer has program's pmt */
   void (*program_stopped) (MpegTSBase *base, MpegTSBaseProgram *program);
 
+  /* program_wanted returns whether the subclass is interested in the
+   * streams of an active program. Packets of streams which no wanted
+   * program contains are dropped early by the packetizer. If not
+   * implemented, all active programs are wanted */
+  gboolean (*program_wanted) (MpegTSBase *base, MpegTSBaseProgram *program);
+
   /* stream_added is called whenever a new stream has been identified */
   void (*stream_added) (MpegTSBase *base, MpegTSBaseStream *stream, MpegTSBaseProgram *program);
   /* stream_removed is called whenever a stream is no longer referenced */
@@ -176,10 +182,6 @@ struct _MpegTSBaseClass {
   void (*eit_info) (GstStructure *eit);
 };
 
-#define MPEGTS_BIT_SET(field, offs)    ((field)[(offs) / 8] |=  (1 << ((offs) % 8)))
-#define MPEGTS_BIT_UNSET(field, offs)  ((field)[(offs) / 8] &= ~(1 << ((offs) % 8)))
-#define MPEGTS_BIT_IS_SET(field, offs) ((field)[(offs) / 8] &   (1 << ((offs) % 8)))
-
 GType mpegts_base_get_type(void);
 
 MpegTSBaseProgram *mpegts_base_get_program (MpegTSBase * base, gint program_number);
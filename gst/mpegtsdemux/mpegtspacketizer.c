@@ -24,6 +24,8 @@
 
 #include <string.h>
 
+#include <gst/gst-mpeg-crc.h>
+
 #include "mpegtspacketizer.h"
 #include "gstmpegdesc.h"
 
@@ -68,6 +70,7 @@ G_DEFINE_TYPE_EXTENDED (MpegTSPacketizer2, mpegts_packetizer, G_TYPE_OBJECT, 0,
 
 static void mpegts_packetizer_dispose (GObject * object);
 static void mpegts_packetizer_finalize (GObject * object);
+static void mpegts_packetizer_drop_pending (MpegTSPacketizer2 * packetizer);
 static gchar *convert_to_utf8 (const gchar * text, gint length, guint start,
     const gchar * encoding, gboolean is_multibyte, GError ** error);
 static gchar *get_encoding (const gchar * text, guint * start_text,
@@ -79,19 +82,8 @@ static gchar *get_encoding_and_convert (const gchar * text, guint length);
 #define VERSION_NUMBER_UNSET 255
 #define TABLE_ID_UNSET 0xFF
 
-static gint
-mpegts_packetizer_stream_subtable_compare (gconstpointer a, gconstpointer b)
-{
-  MpegTSPacketizerStreamSubtable *asub, *bsub;
-
-  asub = (MpegTSPacketizerStreamSubtable *) a;
-  bsub = (MpegTSPacketizerStreamSubtable *) b;
-
-  if (asub->table_id == bsub->table_id &&
-      asub->subtable_extension == bsub->subtable_extension)
-    return 0;
-  return -1;
-}
+#define SUBTABLE_KEY(table_id, subtable_extension) \
+  GUINT_TO_POINTER (((guint) (table_id) << 16) | (subtable_extension))
 
 static MpegTSPacketizerStreamSubtable *
 mpegts_packetizer_stream_subtable_new (guint8 table_id,
@@ -99,14 +91,21 @@ mpegts_packetizer_stream_subtable_new (guint8 table_id,
 {
   MpegTSPacketizerStreamSubtable *subtable;
 
-  subtable = g_new0 (MpegTSPacketizerStreamSubtable, 1);
+  subtable = g_slice_new0 (MpegTSPacketizerStreamSubtable);
   subtable->version_number = VERSION_NUMBER_UNSET;
   subtable->table_id = table_id;
   subtable->subtable_extension = subtable_extension;
-  subtable->crc = 0;
   return subtable;
 }
 
+static void
+mpegts_packetizer_stream_subtable_free (MpegTSPacketizerStreamSubtable *
+    subtable)
+{
+  g_free (subtable->section_crc);
+  g_slice_free (MpegTSPacketizerStreamSubtable, subtable);
+}
+
 static MpegTSPacketizerStream *
 mpegts_packetizer_stream_new (void)
 {
@@ -115,7 +114,8 @@ mpegts_packetizer_stream_new (void)
   stream = (MpegTSPacketizerStream *) g_new0 (MpegTSPacketizerStream, 1);
   stream->section_adapter = gst_adapter_new ();
   stream->continuity_counter = CONTINUITY_UNSET;
-  stream->subtables = NULL;
+  stream->subtables = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+      NULL, (GDestroyNotify) mpegts_packetizer_stream_subtable_free);
   stream->section_table_id = TABLE_ID_UNSET;
   return stream;
 }
@@ -125,8 +125,7 @@ mpegts_packetizer_stream_free (MpegTSPacketizerStream * stream)
 {
   gst_adapter_clear (stream->section_adapter);
   g_object_unref (stream->section_adapter);
-  g_slist_foreach (stream->subtables, (GFunc) g_free, NULL);
-  g_slist_free (stream->subtables);
+  g_hash_table_destroy (stream->subtables);
   g_free (stream);
 }
 
@@ -159,6 +158,15 @@ mpegts_packetizer_init (MpegTSPacketizer2 * packetizer)
   packetizer->empty = TRUE;
   packetizer->streams = g_new0 (MpegTSPacketizerStream *, 8192);
   packetizer->know_packet_size = FALSE;
+  packetizer->pid_filter = NULL;
+  packetizer->pid_batch_end = NULL;
+  packetizer->n_filtered = 0;
+  packetizer->pending = g_array_new (FALSE, FALSE,
+      sizeof (MpegTSPacketizerPacket));
+  packetizer->pending_rets = g_array_new (FALSE, FALSE,
+      sizeof (MpegTSPacketizerPacketReturn));
+  packetizer->n_section_cache_hits = 0;
+  packetizer->n_section_cache_misses = 0;
 }
 
 static void
@@ -181,6 +189,9 @@ mpegts_packetizer_dispose (GObject * object)
       g_free (packetizer->streams);
     }
 
+    mpegts_packetizer_set_pid_filtering (packetizer, FALSE);
+
+    mpegts_packetizer_drop_pending (packetizer);
     gst_adapter_clear (packetizer->adapter);
     g_object_unref (packetizer->adapter);
     packetizer->disposed = TRUE;
@@ -195,6 +206,11 @@ mpegts_packetizer_dispose (GObject * object)
 static void
 mpegts_packetizer_finalize (GObject * object)
 {
+  MpegTSPacketizer2 *packetizer = GST_MPEGTS_PACKETIZER (object);
+
+  g_array_free (packetizer->pending, TRUE);
+  g_array_free (packetizer->pending_rets, TRUE);
+
   if (G_OBJECT_CLASS (mpegts_packetizer_parent_class)->finalize)
     G_OBJECT_CLASS (mpegts_packetizer_parent_class)->finalize (object);
 }
@@ -305,8 +321,9 @@ mpegts_packetizer_parse_section_header (MpegTSPacketizer2 * packetizer,
 {
   guint8 tmp;
   guint8 *data, *crc_data;
+  guint8 section_number;
+  gboolean has_crc;
   MpegTSPacketizerStreamSubtable *subtable;
-  GSList *subtable_list = NULL;
 
   section->complete = TRUE;
   /* get the section buffer, pass the ownership to the caller */
@@ -322,16 +339,14 @@ mpegts_packetizer_parse_section_header (MpegTSPacketizer2 * packetizer,
   else
     section->subtable_extension = GST_READ_UINT16_BE (data + 2);
 
-  subtable = mpegts_packetizer_stream_subtable_new (section->table_id,
-      section->subtable_extension);
-
-  subtable_list = g_slist_find_custom (stream->subtables, subtable,
-      mpegts_packetizer_stream_subtable_compare);
-  if (subtable_list) {
-    g_free (subtable);
-    subtable = (MpegTSPacketizerStreamSubtable *) (subtable_list->data);
-  } else {
-    stream->subtables = g_slist_prepend (stream->subtables, subtable);
+  subtable = g_hash_table_lookup (stream->subtables,
+      SUBTABLE_KEY (section->table_id, section->subtable_extension));
+  if (subtable == NULL) {
+    subtable = mpegts_packetizer_stream_subtable_new (section->table_id,
+        section->subtable_extension);
+    g_hash_table_insert (stream->subtables,
+        SUBTABLE_KEY (section->table_id, section->subtable_extension),
+        subtable);
   }
 
   section->section_length = GST_READ_UINT16_BE (data) & 0x0FFF;
@@ -347,17 +362,49 @@ mpegts_packetizer_parse_section_header (MpegTSPacketizer2 * packetizer,
   if (!section->current_next_indicator)
     goto not_applicable;
 
+  /* only long sections (section_syntax_indicator set) have a section_number */
+  if (GST_BUFFER_DATA (section->buffer)[1] & 0x80)
+    section_number = *data;
+  else
+    section_number = 0;
+
   /* CRC is at the end of the section */
   crc_data =
       GST_BUFFER_DATA (section->buffer) + GST_BUFFER_SIZE (section->buffer) - 4;
   section->crc = GST_READ_UINT32_BE (crc_data);
 
-  if (section->version_number == subtable->version_number &&
-      section->crc == subtable->crc)
-    goto not_applicable;
+  /* table ids 0x70 - 0x73 do not have a crc */
+  has_crc = section->table_id < 0x70 || section->table_id > 0x73;
+
+  if (section->version_number == subtable->version_number) {
+    /* Identical version and CRC as a section we already validated and
+     * handed out, drop it before anybody parses it again */
+    if (subtable->section_crc &&
+        MPEGTS_BIT_IS_SET (subtable->seen_sections, section_number) &&
+        subtable->section_crc[section_number] == section->crc) {
+      packetizer->n_section_cache_hits++;
+      goto not_applicable;
+    }
+  } else {
+    /* New version, forget about all the sections of the previous one */
+    memset (subtable->seen_sections, 0, sizeof (subtable->seen_sections));
+    subtable->version_number = section->version_number;
+  }
 
-  subtable->version_number = section->version_number;
-  subtable->crc = section->crc;
+  packetizer->n_section_cache_misses++;
+
+  if (has_crc && G_UNLIKELY (gst_mpeg_crc32 (GST_BUFFER_DATA (section->buffer),
+              GST_BUFFER_SIZE (section->buffer)) != 0)) {
+    GST_WARNING ("bad crc in psi pid 0x%x", section->pid);
+    section->complete = FALSE;
+    gst_buffer_unref (section->buffer);
+    return FALSE;
+  }
+
+  if (subtable->section_crc == NULL)
+    subtable->section_crc = g_new (guint32, 256);
+  subtable->section_crc[section_number] = section->crc;
+  MPEGTS_BIT_SET (subtable->seen_sections, section_number);
   stream->section_table_id = section->table_id;
 
   return TRUE;
@@ -2058,6 +2105,21 @@ error:
   return NULL;
 }
 
+static void
+mpegts_packetizer_drop_pending (MpegTSPacketizer2 * packetizer)
+{
+  guint i;
+
+  for (i = 0; i < packetizer->pending->len; i++) {
+    MpegTSPacketizerPacket *packet =
+        &g_array_index (packetizer->pending, MpegTSPacketizerPacket, i);
+
+    gst_buffer_unref (packet->buffer);
+  }
+  g_array_set_size (packetizer->pending, 0);
+  g_array_set_size (packetizer->pending_rets, 0);
+}
+
 void
 mpegts_packetizer_clear (MpegTSPacketizer2 * packetizer)
 {
@@ -2079,6 +2141,7 @@ mpegts_packetizer_clear (MpegTSPacketizer2 * packetizer)
     memset (packetizer->streams, 0, 8192 * sizeof (MpegTSPacketizerStream *));
   }
 
+  mpegts_packetizer_drop_pending (packetizer);
   gst_adapter_clear (packetizer->adapter);
   packetizer->offset = 0;
   packetizer->empty = TRUE;
@@ -2096,6 +2159,7 @@ mpegts_packetizer_flush (MpegTSPacketizer2 * packetizer)
       }
     }
   }
+  mpegts_packetizer_drop_pending (packetizer);
   gst_adapter_flush (packetizer->adapter, packetizer->adapter->size);
 
   packetizer->offset = 0;
@@ -2153,33 +2217,38 @@ mpegts_try_discover_packet_size (MpegTSPacketizer2 * packetizer)
   dest = g_malloc (MPEGTS_MAX_PACKETSIZE * 4);
   /* wait for 3 sync bytes */
   while (packetizer->adapter->size >= MPEGTS_MAX_PACKETSIZE * 4) {
+    guint8 *sync;
 
     /* check for sync bytes */
     gst_adapter_copy (packetizer->adapter, dest, 0, MPEGTS_MAX_PACKETSIZE * 4);
-    /* find first sync byte */
+    /* try every sync byte candidate in the first MPEGTS_MAX_PACKETSIZE bytes,
+     * memchr() is vectorized in most libcs so this is much cheaper than
+     * looking at each byte ourselves */
     pos = -1;
-    for (i = 0; i < MPEGTS_MAX_PACKETSIZE; i++) {
-      if (dest[i] == 0x47) {
-        for (j = 0; j < 4; j++) {
-          guint packetsize = psizes[j];
-          /* check each of the packet size possibilities in turn */
-          if (dest[i] == 0x47 && dest[i + packetsize] == 0x47 &&
-              dest[i + packetsize * 2] == 0x47 &&
-              dest[i + packetsize * 3] == 0x47) {
-            packetizer->know_packet_size = TRUE;
-            packetizer->packet_size = packetsize;
-            packetizer->caps = gst_caps_new_simple ("video/mpegts",
-                "systemstream", G_TYPE_BOOLEAN, TRUE,
-                "packetsize", G_TYPE_INT, packetsize, NULL);
-            if (packetsize == MPEGTS_M2TS_PACKETSIZE)
-              pos = i - 4;
-            else
-              pos = i;
-            break;
-          }
+    sync = dest;
+    while ((sync = memchr (sync, 0x47,
+                MPEGTS_MAX_PACKETSIZE - (sync - dest))) != NULL) {
+      i = sync - dest;
+      for (j = 0; j < 4; j++) {
+        guint packetsize = psizes[j];
+        /* check each of the packet size possibilities in turn */
+        if (dest[i + packetsize] == 0x47 &&
+            dest[i + packetsize * 2] == 0x47 &&
+            dest[i + packetsize * 3] == 0x47) {
+          packetizer->know_packet_size = TRUE;
+          packetizer->packet_size = packetsize;
+          packetizer->caps = gst_caps_new_simple ("video/mpegts",
+              "systemstream", G_TYPE_BOOLEAN, TRUE,
+              "packetsize", G_TYPE_INT, packetsize, NULL);
+          if (packetsize == MPEGTS_M2TS_PACKETSIZE)
+            pos = i - 4;
+          else
+            pos = i;
+          break;
         }
-        break;
       }
+      if (packetizer->know_packet_size || ++sync >= dest + MPEGTS_MAX_PACKETSIZE)
+        break;
     }
 
     if (packetizer->know_packet_size)
@@ -2256,16 +2325,18 @@ mpegts_packetizer_next_packet (MpegTSPacketizer2 * packetizer,
       guint i;
       GstBuffer *tmpbuf;
 
+      guint8 *sync;
+
       GST_LOG ("Lost sync %d", packetizer->packet_size);
       /* Find the 0x47 in the buffer */
-      for (i = 0; i < packetizer->packet_size; i++)
-        if (GST_BUFFER_DATA (packet->buffer)[i] == 0x47)
-          break;
-      if (G_UNLIKELY (i == packetizer->packet_size)) {
+      sync = memchr (GST_BUFFER_DATA (packet->buffer), 0x47,
+          packetizer->packet_size);
+      if (G_UNLIKELY (sync == NULL)) {
         GST_ERROR ("REALLY lost the sync");
         gst_buffer_unref (packet->buffer);
         goto done;
       }
+      i = sync - GST_BUFFER_DATA (packet->buffer);
 
       if (packetizer->packet_size == MPEGTS_M2TS_PACKETSIZE) {
         if (i >= 4)
@@ -2294,6 +2365,207 @@ done:
   return PACKET_NEED_MORE;
 }
 
+/**
+ * mpegts_packetizer_next_packets:
+ * @packetizer: a #MpegTSPacketizer2
+ * @packets: array of at least @n_packets packets to fill
+ * @rets: array of at least @n_packets results
+ * @n_packets: maximum number of packets to return
+ *
+ * Batch variant of mpegts_packetizer_next_packet(). The longest run of
+ * consecutive, correctly synced packets (up to @n_packets) is validated in
+ * one pass over the adapter, taken out with a single
+ * gst_adapter_take_buffer() and split into sub-buffers. When the first
+ * packet is not synced, this falls back to mpegts_packetizer_next_packet()
+ * which takes care of resyncing.
+ *
+ * If PID filtering is enabled, packets whose PID is not in the filter are
+ * dropped here, before any sub-buffer is created for them or their
+ * adaptation field is parsed. A batch ends after a packet of a PID set
+ * with mpegts_packetizer_set_pid_ends_batch(), so that the packets after
+ * it are only filtered once the caller handled it.
+ *
+ * Packets given back with mpegts_packetizer_return_packets() are handed
+ * out first, as they are, before any new data is looked at.
+ *
+ * The parse result of packet i is stored in rets[i], which is never
+ * #PACKET_NEED_MORE. The caller owns the buffers of the returned packets.
+ *
+ * Returns: the number of packets stored in @packets, 0 if more data is needed.
+ */
+guint
+mpegts_packetizer_next_packets (MpegTSPacketizer2 * packetizer,
+    MpegTSPacketizerPacket * packets, MpegTSPacketizerPacketReturn * rets,
+    guint n_packets)
+{
+  const guint8 *data;
+  GstBuffer *buffer;
+  guint packet_size, sync_offset, avail, i, n, res = 0;
+
+  g_return_val_if_fail (n_packets > 0, 0);
+
+  if (G_UNLIKELY (packetizer->pending->len > 0)) {
+    n = MIN (packetizer->pending->len, n_packets);
+    memcpy (packets, packetizer->pending->data,
+        n * sizeof (MpegTSPacketizerPacket));
+    memcpy (rets, packetizer->pending_rets->data,
+        n * sizeof (MpegTSPacketizerPacketReturn));
+    g_array_remove_range (packetizer->pending, 0, n);
+    g_array_remove_range (packetizer->pending_rets, 0, n);
+    return n;
+  }
+
+  if (G_UNLIKELY (!packetizer->know_packet_size)) {
+    if (!mpegts_try_discover_packet_size (packetizer))
+      return 0;
+  }
+
+  packet_size = packetizer->packet_size;
+  /* M2TS packets don't start with the sync byte, all other variants do */
+  sync_offset = (packet_size == MPEGTS_M2TS_PACKETSIZE) ? 4 : 0;
+
+  /* loop until we have at least one packet, as everything we looked at may
+   * have been filtered out */
+  while (res == 0) {
+    avail = MIN (packetizer->adapter->size / packet_size, n_packets);
+    if (avail == 0)
+      break;
+
+    data = gst_adapter_peek (packetizer->adapter, avail * packet_size);
+    data += sync_offset;
+    for (n = 0; n < avail; n++, data += packet_size) {
+      if (G_UNLIKELY (*data != 0x47))
+        break;
+      if (packetizer->pid_batch_end &&
+          G_UNLIKELY (MPEGTS_BIT_IS_SET (packetizer->pid_batch_end,
+                  GST_READ_UINT16_BE (data + 1) & 0x1FFF))) {
+        n++;
+        break;
+      }
+    }
+
+    if (G_UNLIKELY (n == 0)) {
+      /* let the slow path resync for us */
+      rets[0] = mpegts_packetizer_next_packet (packetizer, &packets[0]);
+      return rets[0] == PACKET_NEED_MORE ? 0 : 1;
+    }
+
+    GST_LOG ("taking %u packets from offset %" G_GUINT64_FORMAT, n,
+        packetizer->offset);
+
+    buffer = gst_adapter_take_buffer (packetizer->adapter, n * packet_size);
+    data = GST_BUFFER_DATA (buffer) + sync_offset;
+    for (i = 0; i < n; i++, data += packet_size) {
+      MpegTSPacketizerPacket *packet = &packets[res];
+
+      if (packetizer->pid_filter) {
+        guint16 pid = GST_READ_UINT16_BE (data + 1) & 0x1FFF;
+
+        if (!MPEGTS_BIT_IS_SET (packetizer->pid_filter, pid)) {
+          packetizer->offset += packet_size;
+          packetizer->n_filtered++;
+          continue;
+        }
+      }
+
+      memset (packet, 0, sizeof (MpegTSPacketizerPacket));
+      packet->buffer = gst_buffer_create_sub (buffer, i * packet_size,
+          packet_size);
+      packet->data_start = GST_BUFFER_DATA (packet->buffer) + sync_offset;
+      /* ALL mpeg-ts variants contain 188 bytes of data */
+      packet->data_end = packet->data_start + 188;
+      GST_BUFFER_OFFSET (packet->buffer) = packet->offset =
+          packetizer->offset;
+      packetizer->offset += packet_size;
+
+      rets[res++] = mpegts_packetizer_parse_packet (packetizer, packet);
+    }
+    gst_buffer_unref (buffer);
+  }
+
+  return res;
+}
+
+/**
+ * mpegts_packetizer_return_packets:
+ * @packetizer: a #MpegTSPacketizer2
+ * @packets: packets from mpegts_packetizer_next_packets()
+ * @rets: their parse results
+ * @n_packets: number of packets in @packets
+ *
+ * Gives back the packets of a batch the caller could not process, like
+ * when downstream returned a flow error in the middle of it. They are
+ * handed out again by the next mpegts_packetizer_next_packets(), before
+ * any packet still pending, unless the packetizer is flushed or cleared
+ * first. The packetizer takes ownership of their buffers.
+ */
+void
+mpegts_packetizer_return_packets (MpegTSPacketizer2 * packetizer,
+    MpegTSPacketizerPacket * packets, MpegTSPacketizerPacketReturn * rets,
+    guint n_packets)
+{
+  g_array_prepend_vals (packetizer->pending, packets, n_packets);
+  g_array_prepend_vals (packetizer->pending_rets, rets, n_packets);
+}
+
+/**
+ * mpegts_packetizer_set_pid_filtering:
+ * @packetizer: a #MpegTSPacketizer2
+ * @enable: whether to filter packets by PID
+ *
+ * Enables or disables dropping of packets in mpegts_packetizer_next_packets()
+ * based on their PID. When enabled, the filter starts out empty and PIDs
+ * need to be added with mpegts_packetizer_set_pid_wanted(), and no PID
+ * ends a batch.
+ */
+void
+mpegts_packetizer_set_pid_filtering (MpegTSPacketizer2 * packetizer,
+    gboolean enable)
+{
+  if (enable) {
+    if (packetizer->pid_filter == NULL) {
+      packetizer->pid_filter = g_new0 (guint8, 8192 / 8);
+      packetizer->pid_batch_end = g_new0 (guint8, 8192 / 8);
+    } else {
+      memset (packetizer->pid_filter, 0, 8192 / 8);
+      memset (packetizer->pid_batch_end, 0, 8192 / 8);
+    }
+  } else {
+    g_free (packetizer->pid_filter);
+    packetizer->pid_filter = NULL;
+    g_free (packetizer->pid_batch_end);
+    packetizer->pid_batch_end = NULL;
+  }
+}
+
+void
+mpegts_packetizer_set_pid_wanted (MpegTSPacketizer2 * packetizer,
+    guint16 pid, gboolean wanted)
+{
+  if (G_UNLIKELY (packetizer->pid_filter == NULL))
+    return;
+
+  GST_LOG ("PID 0x%04x wanted: %d", pid, wanted);
+
+  if (wanted)
+    MPEGTS_BIT_SET (packetizer->pid_filter, pid);
+  else
+    MPEGTS_BIT_UNSET (packetizer->pid_filter, pid);
+}
+
+void
+mpegts_packetizer_set_pid_ends_batch (MpegTSPacketizer2 * packetizer,
+    guint16 pid, gboolean ends_batch)
+{
+  if (G_UNLIKELY (packetizer->pid_batch_end == NULL))
+    return;
+
+  if (ends_batch)
+    MPEGTS_BIT_SET (packetizer->pid_batch_end, pid);
+  else
+    MPEGTS_BIT_UNSET (packetizer->pid_batch_end, pid);
+}
+
 void
 mpegts_packetizer_clear_packet (MpegTSPacketizer2 * packetizer,
     MpegTSPacketizerPacket * packet)
@@ -36,6 +36,13 @@
 #define MPEGTS_MIN_PACKETSIZE MPEGTS_NORMAL_PACKETSIZE
 #define MPEGTS_MAX_PACKETSIZE MPEGTS_ATSC_PACKETSIZE
 
+/* number of packets mpegts_packetizer_next_packets() is asked for at once */
+#define MPEGTS_PACKETIZER_BATCH_SIZE 64
+
+#define MPEGTS_BIT_SET(field, offs)    ((field)[(offs) / 8] |=  (1 << ((offs) % 8)))
+#define MPEGTS_BIT_UNSET(field, offs)  ((field)[(offs) / 8] &= ~(1 << ((offs) % 8)))
+#define MPEGTS_BIT_IS_SET(field, offs) ((field)[(offs) / 8] &   (1 << ((offs) % 8)))
+
 #define MPEGTS_AFC_PCR_FLAG	0x10
 #define MPEGTS_AFC_OPCR_FLAG	0x08
 
@@ -61,7 +68,8 @@ typedef struct
   GstAdapter *section_adapter;
   guint8 section_table_id;
   guint section_length;
-  GSList *subtables;
+  /* MpegTSPacketizerStreamSubtable hashed by table_id/subtable_extension */
+  GHashTable *subtables;
   guint64 offset;
 } MpegTSPacketizerStream;
 
@@ -79,6 +87,25 @@ struct _MpegTSPacketizer2 {
   /* current offset of the tip of the adapter */
   guint64 offset;
   gboolean empty;
+
+  /* bitmap of the PIDs mpegts_packetizer_next_packets() lets through,
+   * NULL if PID filtering is disabled. Use MPEGTS_BIT_* on it */
+  guint8 *pid_filter;
+  /* bitmap of the PIDs after whose packets a batch ends, as handling them
+   * may change @pid_filter. Only allocated along with it */
+  guint8 *pid_batch_end;
+  /* number of packets dropped by the PID filter */
+  guint64 n_filtered;
+
+  /* packets of a batch given back with mpegts_packetizer_return_packets(),
+   * and their parse results, handed out again before any new packet */
+  GArray *pending;
+  GArray *pending_rets;
+
+  /* number of complete sections dropped because an identical section was
+   * already seen, and number of sections which had to be parsed */
+  guint64 n_section_cache_hits;
+  guint64 n_section_cache_misses;
 };
 
 struct _MpegTSPacketizer2Class {
@@ -125,7 +152,10 @@ typedef struct
    * section_syntax_indicator is 0, sub_table_extension will be set to 0 */
   guint16 subtable_extension;
   guint8 version_number;
-  guint32 crc;
+  /* sections of version_number seen so far, indexed by section_number,
+   * and the CRC_32 they had. Use MPEGTS_BIT_* on seen_sections */
+  guint8 seen_sections[256 / 8];
+  guint32 *section_crc;
 } MpegTSPacketizerStreamSubtable;
 
 typedef enum {
@@ -143,6 +173,18 @@ void mpegts_packetizer_push (MpegTSPacketizer2 *packetizer, GstBuffer *buffer);
 gboolean mpegts_packetizer_has_packets (MpegTSPacketizer2 *packetizer);
 MpegTSPacketizerPacketReturn mpegts_packetizer_next_packet (MpegTSPacketizer2 *packetizer,
   MpegTSPacketizerPacket *packet);
+guint mpegts_packetizer_next_packets (MpegTSPacketizer2 *packetizer,
+  MpegTSPacketizerPacket *packets, MpegTSPacketizerPacketReturn *rets,
+  guint n_packets);
+void mpegts_packetizer_return_packets (MpegTSPacketizer2 *packetizer,
+  MpegTSPacketizerPacket *packets, MpegTSPacketizerPacketReturn *rets,
+  guint n_packets);
+void mpegts_packetizer_set_pid_filtering (MpegTSPacketizer2 *packetizer,
+  gboolean enable);
+void mpegts_packetizer_set_pid_wanted (MpegTSPacketizer2 *packetizer,
+  guint16 pid, gboolean wanted);
+void mpegts_packetizer_set_pid_ends_batch (MpegTSPacketizer2 *packetizer,
+  guint16 pid, gboolean ends_batch);
 void mpegts_packetizer_clear_packet (MpegTSPacketizer2 *packetizer,
   MpegTSPacketizerPacket *packet);
 void mpegts_packetizer_remove_stream(MpegTSPacketizer2 *packetizer,
@@ -70,6 +70,18 @@
  */
 #define SEEK_TIMESTAMP_OFFSET (1000 * GST_MSECOND)
 
+/* minimal distance between two PCR entries added to the seek index while
+ * playing. Keeping it below SEEK_TIMESTAMP_OFFSET means a seek into an
+ * already played region needs no bisection at all */
+#define INDEX_MIN_DISTANCE (500 * GST_MSECOND)
+
+/* sidecar index file: "TSIX", version, number of entries followed by the
+ * entries as big endian gsttime, pcr and offset */
+#define INDEX_FILE_MAGIC GST_MAKE_FOURCC ('T', 'S', 'I', 'X')
+#define INDEX_FILE_VERSION 1
+#define INDEX_FILE_HEADER_SIZE 12
+#define INDEX_FILE_ENTRY_SIZE 24
+
 GST_DEBUG_CATEGORY_STATIC (ts_demux_debug);
 #define GST_CAT_DEFAULT ts_demux_debug
 
@@ -128,6 +140,10 @@ struct _TSDemuxStream
   /* Number of rollover seen for PTS/DTS (default:0) */
   guint nb_pts_rollover;
   guint nb_dts_rollover;
+
+  /* PES payload pushed as is vs. merged for downstream */
+  guint64 bytes_zero_copy;
+  guint64 bytes_merged;
 };
 
 #define VIDEO_CAPS \
@@ -194,6 +210,9 @@ enum
   ARG_0,
   PROP_PROGRAM_NUMBER,
   PROP_EMIT_STATS,
+  PROP_INDEX_LOCATION,
+  PROP_BYTES_ZERO_COPY,
+  PROP_BYTES_MERGED,
   /* FILL ME */
 };
 
@@ -205,6 +224,8 @@ static gboolean gst_ts_demux_srcpad_query (GstPad * pad, GstQuery * query);
 /* mpegtsbase methods */
 static void
 gst_ts_demux_program_started (MpegTSBase * base, MpegTSBaseProgram * program);
+static gboolean
+gst_ts_demux_program_wanted (MpegTSBase * base, MpegTSBaseProgram * program);
 static void gst_ts_demux_reset (MpegTSBase * base);
 static GstFlowReturn
 gst_ts_demux_push (MpegTSBase * base, MpegTSPacketizerPacket * packet,
@@ -233,6 +254,11 @@ static void gst_ts_demux_flush_streams (GstTSDemux * tsdemux);
 static GstFlowReturn
 gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream);
 
+static void gst_ts_demux_index_add (GstTSDemux * demux, TSPcrOffset * entry);
+static gboolean gst_ts_demux_index_load (GstTSDemux * demux,
+    TSPcrOffset * first, TSPcrOffset * last);
+static void gst_ts_demux_index_save (GstTSDemux * demux);
+
 static gboolean push_event (MpegTSBase * base, GstEvent * event);
 static void _extra_init (GType type);
 
@@ -294,12 +320,29 @@ gst_ts_demux_class_init (GstTSDemuxClass * klass)
           "Emit messages for every pcr/opcr/pts/dts", FALSE,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_INDEX_LOCATION,
+      g_param_spec_string ("index-location", "Index location",
+          "File to load the seek index from and save it to (pull mode only)",
+          NULL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_BYTES_ZERO_COPY,
+      g_param_spec_uint64 ("bytes-zero-copy", "Bytes zero-copy",
+          "Number of payload bytes pushed without copying them", 0,
+          G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_BYTES_MERGED,
+      g_param_spec_uint64 ("bytes-merged", "Bytes merged",
+          "Number of payload bytes copied into contiguous buffers because "
+          "downstream can't handle buffer lists", 0,
+          G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
 
   ts_class = GST_MPEGTS_BASE_CLASS (klass);
   ts_class->reset = GST_DEBUG_FUNCPTR (gst_ts_demux_reset);
   ts_class->push = GST_DEBUG_FUNCPTR (gst_ts_demux_push);
   ts_class->push_event = GST_DEBUG_FUNCPTR (push_event);
   ts_class->program_started = GST_DEBUG_FUNCPTR (gst_ts_demux_program_started);
+  ts_class->program_wanted = GST_DEBUG_FUNCPTR (gst_ts_demux_program_wanted);
   ts_class->stream_added = gst_ts_demux_stream_added;
   ts_class->stream_removed = gst_ts_demux_stream_removed;
   ts_class->find_timestamps = GST_DEBUG_FUNCPTR (find_timestamps);
@@ -328,11 +371,17 @@ gst_ts_demux_reset (MpegTSBase * base)
 {
   GstTSDemux *demux = (GstTSDemux *) base;
 
+  if (demux->index && demux->index_dirty)
+    gst_ts_demux_index_save (demux);
+
   if (demux->index) {
     g_array_free (demux->index, TRUE);
     demux->index = NULL;
   }
   demux->index_size = 0;
+  demux->index_dirty = FALSE;
+  demux->bytes_zero_copy = 0;
+  demux->bytes_merged = 0;
   demux->need_newsegment = TRUE;
   demux->program_number = -1;
   demux->duration = GST_CLOCK_TIME_NONE;
@@ -348,6 +397,10 @@ gst_ts_demux_reset (MpegTSBase * base)
 static void
 gst_ts_demux_finalize (GObject * object)
 {
+  GstTSDemux *demux = GST_TS_DEMUX (object);
+
+  g_free (demux->index_location);
+
   if (G_OBJECT_CLASS (parent_class)->finalize)
     G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -369,6 +422,12 @@ gst_ts_demux_set_property (GObject * object, guint prop_id,
     case PROP_EMIT_STATS:
       demux->emit_statistics = g_value_get_boolean (value);
       break;
+    case PROP_INDEX_LOCATION:
+      GST_OBJECT_LOCK (demux);
+      g_free (demux->index_location);
+      demux->index_location = g_value_dup_string (value);
+      GST_OBJECT_UNLOCK (demux);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -387,6 +446,17 @@ gst_ts_demux_get_property (GObject * object, guint prop_id,
     case PROP_EMIT_STATS:
       g_value_set_boolean (value, demux->emit_statistics);
       break;
+    case PROP_INDEX_LOCATION:
+      GST_OBJECT_LOCK (demux);
+      g_value_set_string (value, demux->index_location);
+      GST_OBJECT_UNLOCK (demux);
+      break;
+    case PROP_BYTES_ZERO_COPY:
+      g_value_set_uint64 (value, demux->bytes_zero_copy);
+      break;
+    case PROP_BYTES_MERGED:
+      g_value_set_uint64 (value, demux->bytes_merged);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -618,6 +688,199 @@ TSPcrOffset_find (gconstpointer a, gconstpointer b, gpointer user_data)
     return 0;
 }
 
+static gint
+TSPcrOffset_find_offset (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+  if (((TSPcrOffset *) a)->offset < ((TSPcrOffset *) b)->offset)
+    return -1;
+  else if (((TSPcrOffset *) a)->offset > ((TSPcrOffset *) b)->offset)
+    return 1;
+  else
+    return 0;
+}
+
+/* Insert a PCR seen at entry->offset into the seek index, which is kept
+ * sorted by offset (and thereby by time). The gsttime of the entry is
+ * derived from the preceding index entry so PCR wraps are handled. Entries
+ * closer than INDEX_MIN_DISTANCE to a neighbour are ignored, so are entries
+ * that do not fit between their neighbours (discontinuities) */
+static void
+gst_ts_demux_index_add (GstTSDemux * demux, TSPcrOffset * entry)
+{
+  TSPcrOffset *prev, *next;
+  TSPcrOffset new;
+  gint idx;
+
+  if (G_UNLIKELY (!demux->index || demux->index_size < 2))
+    return;
+
+  prev = gst_util_array_binary_search (demux->index->data, demux->index_size,
+      sizeof (*prev), TSPcrOffset_find_offset, GST_SEARCH_MODE_BEFORE, entry,
+      NULL);
+  if (G_UNLIKELY (!prev))
+    return;
+
+  idx = prev - (TSPcrOffset *) demux->index->data;
+  /* past the last entry, the index only covers [first_pcr, last_pcr] */
+  if (G_UNLIKELY (idx + 1 >= demux->index_size))
+    return;
+  next = prev + 1;
+
+  if (entry->offset <= prev->offset || entry->offset >= next->offset)
+    return;
+
+  new = *entry;
+  new.gsttime = calculate_gsttime (prev, new.pcr);
+
+  if (new.gsttime < prev->gsttime + INDEX_MIN_DISTANCE ||
+      new.gsttime + INDEX_MIN_DISTANCE > next->gsttime)
+    return;
+
+  GST_LOG ("index entry %d time: %" GST_TIME_FORMAT " offset: %"
+      G_GUINT64_FORMAT, idx + 1, GST_TIME_ARGS (new.gsttime), new.offset);
+
+  g_array_insert_val (demux->index, idx + 1, new);
+  demux->index_size++;
+  demux->index_dirty = TRUE;
+}
+
+/* Load the index stored in index-location instead of scanning the file for
+ * it. The file is only accepted if its first and last entries match the
+ * PCRs found at the start and the end of the stream, i.e. if it was created
+ * for this very file */
+static gboolean
+gst_ts_demux_index_load (GstTSDemux * demux, TSPcrOffset * first,
+    TSPcrOffset * last)
+{
+  GArray *index = NULL;
+  TSPcrOffset entry, *prev;
+  gchar *location, *contents = NULL;
+  GError *err = NULL;
+  gsize size, n_entries, i;
+  gboolean ret = FALSE;
+  guint8 *data;
+
+  GST_OBJECT_LOCK (demux);
+  location = g_strdup (demux->index_location);
+  GST_OBJECT_UNLOCK (demux);
+
+  if (location == NULL)
+    return FALSE;
+
+  if (!g_file_get_contents (location, &contents, &size, &err)) {
+    GST_DEBUG_OBJECT (demux, "could not read index: %s", err->message);
+    g_error_free (err);
+    goto done;
+  }
+
+  data = (guint8 *) contents;
+  if (size < INDEX_FILE_HEADER_SIZE ||
+      GST_READ_UINT32_LE (data) != INDEX_FILE_MAGIC ||
+      GST_READ_UINT32_BE (data + 4) != INDEX_FILE_VERSION)
+    goto invalid;
+
+  n_entries = GST_READ_UINT32_BE (data + 8);
+  if (n_entries < 2 ||
+      (size - INDEX_FILE_HEADER_SIZE) / INDEX_FILE_ENTRY_SIZE < n_entries)
+    goto invalid;
+
+  index = g_array_sized_new (TRUE, TRUE, sizeof (entry), n_entries);
+  data += INDEX_FILE_HEADER_SIZE;
+  for (i = 0; i < n_entries; i++) {
+    entry.gsttime = GST_READ_UINT64_BE (data);
+    entry.pcr = GST_READ_UINT64_BE (data + 8);
+    entry.offset = GST_READ_UINT64_BE (data + 16);
+    data += INDEX_FILE_ENTRY_SIZE;
+
+    if (i > 0) {
+      prev = &g_array_index (index, TSPcrOffset, i - 1);
+      if (entry.offset <= prev->offset || entry.gsttime < prev->gsttime)
+        goto invalid;
+    }
+    g_array_append_val (index, entry);
+  }
+
+  prev = &g_array_index (index, TSPcrOffset, 0);
+  if (prev->offset != first->offset || prev->pcr != first->pcr) {
+    GST_INFO_OBJECT (demux, "index %s does not match stream start", location);
+    goto done;
+  }
+  prev = &g_array_index (index, TSPcrOffset, n_entries - 1);
+  if (prev->offset != last->offset || prev->pcr != last->pcr) {
+    GST_INFO_OBJECT (demux, "index %s does not match stream end", location);
+    goto done;
+  }
+
+  GST_INFO_OBJECT (demux, "loaded %" G_GSIZE_FORMAT " index entries from %s",
+      n_entries, location);
+
+  demux->index = index;
+  demux->index_size = n_entries;
+  demux->index_dirty = FALSE;
+  demux->first_pcr = g_array_index (index, TSPcrOffset, 0);
+  demux->index_pcr = demux->first_pcr;
+  demux->last_pcr = g_array_index (index, TSPcrOffset, n_entries - 1);
+  index = NULL;
+  ret = TRUE;
+
+done:
+  if (index)
+    g_array_free (index, TRUE);
+  g_free (contents);
+  g_free (location);
+  return ret;
+
+invalid:
+  GST_WARNING_OBJECT (demux, "invalid index file %s", location);
+  goto done;
+}
+
+static void
+gst_ts_demux_index_save (GstTSDemux * demux)
+{
+  gchar *location;
+  guint8 *contents, *data;
+  GError *err = NULL;
+  gsize size;
+  gint i;
+
+  GST_OBJECT_LOCK (demux);
+  location = g_strdup (demux->index_location);
+  GST_OBJECT_UNLOCK (demux);
+
+  if (location == NULL)
+    return;
+
+  size = INDEX_FILE_HEADER_SIZE + demux->index_size * INDEX_FILE_ENTRY_SIZE;
+  data = contents = g_malloc (size);
+
+  GST_WRITE_UINT32_LE (data, INDEX_FILE_MAGIC);
+  GST_WRITE_UINT32_BE (data + 4, INDEX_FILE_VERSION);
+  GST_WRITE_UINT32_BE (data + 8, demux->index_size);
+  data += INDEX_FILE_HEADER_SIZE;
+  for (i = 0; i < demux->index_size; i++) {
+    TSPcrOffset *entry = &g_array_index (demux->index, TSPcrOffset, i);
+
+    GST_WRITE_UINT64_BE (data, entry->gsttime);
+    GST_WRITE_UINT64_BE (data + 8, entry->pcr);
+    GST_WRITE_UINT64_BE (data + 16, entry->offset);
+    data += INDEX_FILE_ENTRY_SIZE;
+  }
+
+  if (!g_file_set_contents (location, (gchar *) contents, size, &err)) {
+    GST_WARNING_OBJECT (demux, "could not write index %s: %s", location,
+        err->message);
+    g_error_free (err);
+  } else {
+    GST_INFO_OBJECT (demux, "saved %d index entries to %s", demux->index_size,
+        location);
+    demux->index_dirty = FALSE;
+  }
+
+  g_free (contents);
+  g_free (location);
+}
+
 static GstFlowReturn
 gst_ts_demux_perform_seek (MpegTSBase * base, GstSegment * segment, guint16 pid)
 {
@@ -736,6 +999,9 @@ gst_ts_demux_perform_seek (MpegTSBase * base, GstSegment * segment, guint16 pid)
       goto done;
     }
 
+    /* remember it, the next seek close to here won't need to bisect */
+    gst_ts_demux_index_add (demux, &seekpcroffset);
+
     if (seekpcroffset.gsttime > seektime) {
       pcr_stop = seekpcroffset;
     } else {
@@ -1251,6 +1517,8 @@ gst_ts_demux_stream_added (MpegTSBase * base, MpegTSBaseStream * bstream,
     stream->raw_dts = 0;
     stream->nb_pts_rollover = 0;
     stream->nb_dts_rollover = 0;
+    stream->bytes_zero_copy = 0;
+    stream->bytes_merged = 0;
   }
   stream->flow_return = GST_FLOW_OK;
 }
@@ -1276,6 +1544,10 @@ gst_ts_demux_stream_removed (MpegTSBase * base, MpegTSBaseStream * bstream)
 
       demux->need_newsegment = need_newsegment;
 
+      GST_INFO_OBJECT (stream->pad, "pushed %" G_GUINT64_FORMAT
+          " bytes zero-copy, merged %" G_GUINT64_FORMAT " bytes",
+          stream->bytes_zero_copy, stream->bytes_merged);
+
       GST_DEBUG_OBJECT (stream->pad, "Pushing out EOS");
       gst_pad_push_event (stream->pad, gst_event_new_eos ());
       GST_DEBUG_OBJECT (stream->pad, "Deactivating and removing pad");
@@ -1566,6 +1838,7 @@ verify_timestamps (MpegTSBase * base, TSPcrOffset * first, TSPcrOffset * last)
 
   demux->index = g_array_append_val (demux->index, *last);
   demux->index_size++;
+  demux->index_dirty = TRUE;
 
   demux->last_pcr = *last;
   return TRUE;
@@ -1664,7 +1937,9 @@ find_timestamps (MpegTSBase * base, guint64 initoff, guint64 * offset)
     goto beach;
   }
 
-  verify_timestamps (base, &initial, &final);
+  /* a stored index saves the pulls needed to build it */
+  if (!gst_ts_demux_index_load (demux, &initial, &final))
+    verify_timestamps (base, &initial, &final);
 
   gst_segment_set_duration (&demux->segment, GST_FORMAT_TIME,
       demux->last_pcr.gsttime - demux->first_pcr.gsttime);
@@ -1844,6 +2119,9 @@ gst_ts_demux_record_pcr (GstTSDemux * demux, TSDemuxStream * stream,
       demux->first_pcr.offset = offset;
       demux->first_pcr.pcr = pcr;
     }
+    /* pull mode, extend the seek index with what we play */
+    if (((MpegTSBase *) demux)->mode != BASE_MODE_PUSHING)
+      gst_ts_demux_index_add (demux, &demux->cur_pcr);
   }
 
   if (G_UNLIKELY (demux->emit_statistics)) {
@@ -1984,19 +2262,6 @@ calc_gsttime_from_pts (TSPcrOffset * start, guint64 pts)
   return time;
 }
 
-#if 0
-static gint
-TSPcrOffset_find_offset (gconstpointer a, gconstpointer b, gpointer user_data)
-{
-  if (((TSPcrOffset *) a)->offset < ((TSPcrOffset *) b)->offset)
-    return -1;
-  else if (((TSPcrOffset *) a)->offset > ((TSPcrOffset *) b)->offset)
-    return 1;
-  else
-    return 0;
-}
-#endif
-
 static GstFlowReturn
 gst_ts_demux_parse_pes_header (GstTSDemux * demux, TSDemuxStream * stream)
 {
@@ -2253,11 +2518,61 @@ calculate_and_push_newsegment (GstTSDemux * demux, TSDemuxStream * stream)
   demux->need_newsegment = FALSE;
 }
 
+/* Buffer lists are only handled natively by pads with a chain list
+ * function, for all others the core merges every group into a new buffer.
+ * Ghost pads always have one and pass the lists on to their target, so
+ * look at the pad the lists end up on */
+static gboolean
+gst_ts_demux_peer_accepts_lists (GstPad * pad)
+{
+  GstPad *peer, *target;
+  gboolean res = TRUE;
+
+  peer = gst_pad_get_peer (pad);
+  while (peer && GST_IS_GHOST_PAD (peer)) {
+    target = gst_ghost_pad_get_target (GST_GHOST_PAD (peer));
+    gst_object_unref (peer);
+    peer = target;
+  }
+  if (peer) {
+    res = GST_PAD_CHAINLISTFUNC (peer) != NULL;
+    gst_object_unref (peer);
+  }
+
+  return res;
+}
+
+/* Copy the buffers of @list into one buffer of @size bytes, consuming them */
+static GstBuffer *
+gst_ts_demux_merge_buffers (GList * list, guint size)
+{
+  GstBuffer *buf;
+  guint8 *data;
+
+  buf = gst_buffer_new_and_alloc (size);
+  gst_buffer_copy_metadata (buf, GST_BUFFER_CAST (list->data),
+      GST_BUFFER_COPY_ALL);
+
+  data = GST_BUFFER_DATA (buf);
+  for (; list; list = list->next) {
+    GstBuffer *sub = GST_BUFFER_CAST (list->data);
+
+    memcpy (data, GST_BUFFER_DATA (sub), GST_BUFFER_SIZE (sub));
+    data += GST_BUFFER_SIZE (sub);
+    gst_buffer_unref (sub);
+  }
+
+  return buf;
+}
+
 static GstFlowReturn
 gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream)
 {
   GstFlowReturn res = GST_FLOW_OK;
   MpegTSBaseStream *bs = (MpegTSBaseStream *) stream;
+  GstBuffer *buffer = NULL;
+  GList *tmp;
+  guint size = 0;
 
   GST_DEBUG ("stream:%p, pid:0x%04x stream_type:%d state:%d pad:%s:%s",
       stream, bs->pid, bs->stream_type, stream->state,
@@ -2288,17 +2603,52 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream)
     calculate_and_push_newsegment (demux, stream);
 
   /* We have a confirmed buffer, let's push it out */
-  GST_LOG ("Putting pending data into GstBufferList");
   stream->currentlist = g_list_reverse (stream->currentlist);
-  gst_buffer_list_iterator_add_list (stream->currentit, stream->currentlist);
-  gst_buffer_list_iterator_free (stream->currentit);
+  for (tmp = stream->currentlist; tmp; tmp = tmp->next)
+    size += GST_BUFFER_SIZE (tmp->data);
 
-  GST_DEBUG_OBJECT (stream->pad,
-      "Pushing buffer list with timestamp: %" GST_TIME_FORMAT,
-      GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (gst_buffer_list_get
-              (stream->current, 0, 0))));
+  if (G_UNLIKELY (size == 0)) {
+    GST_LOG ("Empty PES packet, dropping");
+    g_list_foreach (stream->currentlist, (GFunc) gst_buffer_unref, NULL);
+  } else if (stream->currentlist->next == NULL) {
+    /* The whole payload is in one packet, push that sub-buffer as is */
+    buffer = GST_BUFFER_CAST (stream->currentlist->data);
+    stream->bytes_zero_copy += size;
+    demux->bytes_zero_copy += size;
+  } else if (!gst_ts_demux_peer_accepts_lists (stream->pad)) {
+    /* Downstream needs contiguous memory, the copy can't be avoided */
+    GST_LOG ("Merging pending data into one buffer");
+    buffer = gst_ts_demux_merge_buffers (stream->currentlist, size);
+    stream->bytes_merged += size;
+    demux->bytes_merged += size;
+  }
+
+  if (buffer || size == 0) {
+    g_list_free (stream->currentlist);
+    gst_buffer_list_iterator_free (stream->currentit);
+    gst_buffer_list_unref (stream->current);
+    if (buffer == NULL)
+      goto beach;
+
+    GST_DEBUG_OBJECT (stream->pad,
+        "Pushing buffer with timestamp: %" GST_TIME_FORMAT,
+        GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (buffer)));
+
+    res = gst_pad_push (stream->pad, buffer);
+  } else {
+    GST_LOG ("Putting pending data into GstBufferList");
+    gst_buffer_list_iterator_add_list (stream->currentit, stream->currentlist);
+    gst_buffer_list_iterator_free (stream->currentit);
+    stream->bytes_zero_copy += size;
+    demux->bytes_zero_copy += size;
 
-  res = gst_pad_push_list (stream->pad, stream->current);
+    GST_DEBUG_OBJECT (stream->pad,
+        "Pushing buffer list with timestamp: %" GST_TIME_FORMAT,
+        GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (gst_buffer_list_get
+                (stream->current, 0, 0))));
+
+    res = gst_pad_push_list (stream->pad, stream->current);
+  }
   GST_DEBUG_OBJECT (stream->pad, "Returned %s", gst_flow_get_name (res));
   res = tsdemux_combine_flows (demux, stream, res);
   GST_DEBUG_OBJECT (stream->pad, "combined %s", gst_flow_get_name (res));
@@ -2314,6 +2664,13 @@ beach:
   return res;
 }
 
+static gboolean
+gst_ts_demux_program_wanted (MpegTSBase * base, MpegTSBaseProgram * program)
+{
+  /* We only ever output the streams of the selected program */
+  return GST_TS_DEMUX_CAST (base)->program == program;
+}
+
 static GstFlowReturn
 gst_ts_demux_handle_packet (GstTSDemux * demux, TSDemuxStream * stream,
     MpegTSPacketizerPacket * packet, MpegTSPacketizerSection * section)
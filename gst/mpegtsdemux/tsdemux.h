@@ -65,6 +65,7 @@ struct _GstTSDemux
    * accessed from the application thread and the streaming thread */
   guint program_number;		/* Required program number (ignore:-1) */
   gboolean emit_statistics;
+  gchar *index_location;	/* sidecar file for the seek index */
 
   /*< private >*/
   MpegTSBaseProgram *program;	/* Current program */
@@ -77,10 +78,15 @@ struct _GstTSDemux
   /* pcr wrap and seeking */
   GArray *index;
   gint index_size;
+  gboolean index_dirty;		/* index changed since loaded/saved */
   TSPcrOffset first_pcr;
   TSPcrOffset last_pcr;
   TSPcrOffset cur_pcr;
   TSPcrOffset index_pcr;
+
+  /* PES payload pushed as is vs. merged for downstream */
+  guint64 bytes_zero_copy;
+  guint64 bytes_merged;
 };
 
 struct _GstTSDemuxClass
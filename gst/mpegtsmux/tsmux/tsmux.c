@@ -85,7 +85,7 @@
 
 #include "tsmux.h"
 #include "tsmuxstream.h"
-#include "crc.h"
+#include <gst/gst-mpeg-crc.h>
 
 #define GST_CAT_DEFAULT mpegtsmux_debug
 
@@ -932,7 +932,7 @@ tsmux_write_pat (TsMux * mux)
         mux->transport_id, mux->pat_version, 0, 0);
 
     /* Calc and output CRC for data bytes, not including itself */
-    crc = calc_crc32 (pat->data, pat->pi.stream_avail - 4);
+    crc = gst_mpeg_crc32 (pat->data, pat->pi.stream_avail - 4);
     tsmux_put32 (&pos, crc);
 
     TS_DEBUG ("PAT has %d programs, is %u bytes",
@@ -1037,7 +1037,7 @@ tsmux_write_pmt (TsMux * mux, TsMuxProgram * program)
 
     /* Calc and output CRC for data bytes, 
      * but not counting the CRC bytes this time */
-    crc = calc_crc32 (pmt->data, pmt->pi.stream_avail - 4);
+    crc = gst_mpeg_crc32 (pmt->data, pmt->pi.stream_avail - 4);
     tsmux_put32 (&pos, crc);
 
     TS_DEBUG ("PMT for program %d has %d streams, is %u bytes",
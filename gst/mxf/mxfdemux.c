@@ -31,7 +31,6 @@
  */
 
 /* TODO:
- *   - Seeking support: Use IndexTableSegments
  *   - Handle timecode tracks correctly (where is this documented?)
  *   - Handle drop-frame field of timecode tracks
  *   - Handle Generic container system items
@@ -74,6 +73,11 @@ GST_STATIC_PAD_TEMPLATE ("track_%u",
 GST_DEBUG_CATEGORY_STATIC (mxfdemux_debug);
 #define GST_CAT_DEFAULT mxfdemux_debug
 
+/* Index table segments say at which edit unit they start, and the offsets
+ * are kept in one array per table. Limit it to about a week of edit units
+ * at 25 fps so a broken file can't make us allocate gigabytes */
+#define MXF_INDEX_MAX_EDIT_UNITS (1 << 24)
+
 GType gst_mxf_demux_pad_get_type (void);
 G_DEFINE_TYPE (GstMXFDemuxPad, gst_mxf_demux_pad, GST_TYPE_PAD);
 
@@ -110,7 +114,9 @@ enum
   PROP_0,
   PROP_PACKAGE,
   PROP_MAX_DRIFT,
-  PROP_STRUCTURE
+  PROP_STRUCTURE,
+  PROP_FOLLOW,
+  PROP_FOLLOW_INTERVAL
 };
 
 static gboolean gst_mxf_demux_sink_event (GstPad * pad, GstEvent * event);
@@ -224,6 +230,8 @@ gst_mxf_demux_reset_metadata (GstMXFDemux * demux)
 static void
 gst_mxf_demux_reset (GstMXFDemux * demux)
 {
+  guint i;
+
   GST_DEBUG_OBJECT (demux, "cleaning up MXF demuxer");
 
   demux->flushing = FALSE;
@@ -235,6 +243,9 @@ gst_mxf_demux_reset (GstMXFDemux * demux)
 
   demux->run_in = -1;
 
+  demux->finalized = FALSE;
+  demux->follow_offset = -1;
+
   memset (&demux->current_package_uid, 0, sizeof (MXFUMID));
 
   gst_segment_init (&demux->segment, GST_FORMAT_TIME);
@@ -253,17 +264,13 @@ gst_mxf_demux_reset (GstMXFDemux * demux)
     demux->random_index_pack = NULL;
   }
 
-  if (demux->pending_index_table_segments) {
-    GList *l;
+  for (i = 0; i < demux->index_tables->len; i++) {
+    GstMXFDemuxIndexTable *t =
+        &g_array_index (demux->index_tables, GstMXFDemuxIndexTable, i);
 
-    for (l = demux->pending_index_table_segments; l; l = l->next) {
-      MXFIndexTableSegment *s = l->data;
-      mxf_index_table_segment_reset (s);
-      g_free (s);
-    }
-    g_list_free (demux->pending_index_table_segments);
-    demux->pending_index_table_segments = NULL;
+    g_array_free (t->offsets, TRUE);
   }
+  g_array_set_size (demux->index_tables, 0);
 
   gst_mxf_demux_reset_mxf_state (demux);
   gst_mxf_demux_reset_metadata (demux);
@@ -372,6 +379,14 @@ gst_mxf_demux_get_earliest_pad (GstMXFDemux * demux)
   return pad;
 }
 
+/* In pull mode a file without footer partition might still be written, its
+ * end is not the end of the stream then */
+static gboolean
+gst_mxf_demux_is_following (GstMXFDemux * demux)
+{
+  return demux->follow && demux->random_access && !demux->finalized;
+}
+
 static gint
 gst_mxf_demux_partition_compare (GstMXFDemuxPartition * a,
     GstMXFDemuxPartition * b)
@@ -409,14 +424,19 @@ gst_mxf_demux_handle_partition_pack (GstMXFDemux * demux, const MXFUL * key,
     return GST_FLOW_ERROR;
   }
 
-  if (partition.this_partition != demux->offset + demux->run_in) {
+  if (partition.this_partition != demux->offset - demux->run_in) {
     GST_WARNING_OBJECT (demux, "Partition with incorrect offset");
-    partition.this_partition = demux->offset + demux->run_in;
+    partition.this_partition = demux->offset - demux->run_in;
   }
 
   if (partition.type == MXF_PARTITION_PACK_HEADER)
     demux->footer_partition_pack_offset = partition.footer_partition;
 
+  /* A file with a footer partition doesn't grow anymore */
+  if (partition.type == MXF_PARTITION_PACK_FOOTER ||
+      demux->footer_partition_pack_offset != 0)
+    demux->finalized = TRUE;
+
   for (l = demux->partitions; l; l = l->next) {
     GstMXFDemuxPartition *tmp = l->data;
 
@@ -730,6 +750,7 @@ gst_mxf_demux_update_essence_tracks (GstMXFDemux * demux)
           tmp.position = 0;
         else
           tmp.position = -1;
+        tmp.follow_position = -1;
 
         g_array_append_val (demux->essence_tracks, tmp);
         etrack =
@@ -1379,6 +1400,291 @@ gst_mxf_demux_handle_descriptive_metadata (GstMXFDemux * demux,
   return ret;
 }
 
+static GstMXFDemuxIndexTable *
+gst_mxf_demux_get_index_table (GstMXFDemux * demux, guint32 body_sid)
+{
+  guint i;
+
+  for (i = 0; i < demux->index_tables->len; i++) {
+    GstMXFDemuxIndexTable *t =
+        &g_array_index (demux->index_tables, GstMXFDemuxIndexTable, i);
+
+    if (t->body_sid == body_sid)
+      return t;
+  }
+
+  return NULL;
+}
+
+static void
+gst_mxf_demux_index_table_add_segment (GstMXFDemuxIndexTable * table,
+    const MXFIndexTableSegment * segment)
+{
+  guint i, len;
+
+  /* SMPTE 377M 10.2.2: no index entries if all edit units have the same
+   * size */
+  if (segment->n_index_entries == 0) {
+    if (segment->edit_unit_byte_count != 0)
+      table->edit_unit_byte_count = segment->edit_unit_byte_count;
+    return;
+  }
+
+  /* Every edit unit takes at least one byte of the essence container, so
+   * the first entry can't start before its edit unit */
+  if (segment->index_start_position < 0 ||
+      segment->n_index_entries > MXF_INDEX_MAX_EDIT_UNITS ||
+      segment->index_start_position >
+      MXF_INDEX_MAX_EDIT_UNITS - segment->n_index_entries ||
+      (guint64) segment->index_start_position >
+      segment->index_entries[0].stream_offset) {
+    GST_WARNING ("Ignoring index table segment for edit units %"
+        G_GINT64_FORMAT " to %" G_GINT64_FORMAT,
+        segment->index_start_position,
+        segment->index_start_position + segment->n_index_entries);
+    return;
+  }
+
+  len = table->offsets->len;
+  if (len < segment->index_start_position + segment->n_index_entries) {
+    g_array_set_size (table->offsets,
+        segment->index_start_position + segment->n_index_entries);
+    for (i = len; i < table->offsets->len; i++)
+      g_array_index (table->offsets, GstMXFDemuxIndex, i).offset = G_MAXUINT64;
+  }
+
+  for (i = 0; i < segment->n_index_entries; i++) {
+    GstMXFDemuxIndex *idx = &g_array_index (table->offsets, GstMXFDemuxIndex,
+        segment->index_start_position + i);
+
+    idx->offset = segment->index_entries[i].stream_offset;
+    /* SMPTE 377M 10.2.3: random access flag */
+    idx->keyframe = (segment->index_entries[i].flags & 0x80) != 0;
+  }
+}
+
+/* Index tables count in bytes of the essence container, which is split
+ * over the partitions with the same body SID. These convert between such
+ * stream offsets and file offsets without the run-in, like the ones in
+ * etrack->offsets */
+static guint64
+gst_mxf_demux_stream_offset_to_offset (GstMXFDemux * demux, guint32 body_sid,
+    guint64 stream_offset)
+{
+  GstMXFDemuxPartition *p = NULL;
+  GList *l;
+
+  for (l = demux->partitions; l; l = l->next) {
+    GstMXFDemuxPartition *tmp = l->data;
+
+    if (tmp->partition.body_sid != body_sid
+        || tmp->essence_container_offset == 0)
+      continue;
+    if (tmp->partition.body_offset > stream_offset)
+      break;
+    p = tmp;
+  }
+
+  if (!p)
+    return -1;
+
+  return p->partition.this_partition + p->essence_container_offset +
+      stream_offset - p->partition.body_offset;
+}
+
+static guint64
+gst_mxf_demux_offset_to_stream_offset (GstMXFDemux * demux, guint32 body_sid,
+    guint64 offset)
+{
+  GstMXFDemuxPartition *p = NULL;
+  GList *l;
+
+  for (l = demux->partitions; l; l = l->next) {
+    GstMXFDemuxPartition *tmp = l->data;
+
+    if (tmp->partition.this_partition > offset)
+      break;
+    p = tmp;
+  }
+
+  if (!p || p->partition.body_sid != body_sid
+      || p->essence_container_offset == 0
+      || offset < p->partition.this_partition + p->essence_container_offset)
+    return -1;
+
+  return offset - p->partition.this_partition - p->essence_container_offset +
+      p->partition.body_offset;
+}
+
+static guint64
+gst_mxf_demux_index_table_get_stream_offset (GstMXFDemuxIndexTable * table,
+    gint64 position)
+{
+  if (table->edit_unit_byte_count != 0)
+    return position * table->edit_unit_byte_count;
+  else if (position < table->offsets->len)
+    return g_array_index (table->offsets, GstMXFDemuxIndex, position).offset;
+  else
+    return G_MAXUINT64;
+}
+
+/* Edit units inside of a clip wrapped KLV packet can't be handled on their
+ * own, so only use tables whose second edit unit starts a new KLV packet */
+static GstMXFDemuxIndexTable *
+gst_mxf_demux_get_usable_index_table (GstMXFDemux * demux, guint32 body_sid)
+{
+  GstMXFDemuxIndexTable *table;
+  GstBuffer *buffer;
+  guint64 offset;
+
+  if (!demux->random_access)
+    return NULL;
+
+  table = gst_mxf_demux_get_index_table (demux, body_sid);
+  if (!table || table->checked)
+    return (table && table->usable) ? table : NULL;
+
+  offset = gst_mxf_demux_index_table_get_stream_offset (table, 1);
+  if (offset == G_MAXUINT64) {
+    /* Not more than one edit unit, nothing can go wrong */
+    if (table->edit_unit_byte_count != 0 || table->offsets->len > 0) {
+      table->checked = table->usable = TRUE;
+      return table;
+    }
+    return NULL;
+  }
+
+  offset = gst_mxf_demux_stream_offset_to_offset (demux, body_sid, offset);
+  if (offset == -1) {
+    /* Check again once the partition of it is known */
+    return NULL;
+  }
+
+  table->checked = TRUE;
+  if (gst_mxf_demux_pull_range (demux, demux->run_in + offset, 16,
+          &buffer) == GST_FLOW_OK) {
+    table->usable = mxf_is_mxf_packet ((const MXFUL *)
+        GST_BUFFER_DATA (buffer));
+    gst_buffer_unref (buffer);
+  }
+
+  if (!table->usable)
+    GST_WARNING_OBJECT (demux, "Can't use index table for body SID %u",
+        body_sid);
+
+  return table->usable ? table : NULL;
+}
+
+/* Returns the file offset of the edit unit at @position, or the last
+ * keyframe before it */
+static guint64
+gst_mxf_demux_find_edit_unit (GstMXFDemux * demux,
+    GstMXFDemuxEssenceTrack * etrack, gint64 * position, gboolean keyframe)
+{
+  GstMXFDemuxIndexTable *table;
+  gint64 edit_unit = *position;
+  guint64 stream_offset, offset;
+
+  table = gst_mxf_demux_get_usable_index_table (demux, etrack->body_sid);
+  if (!table)
+    return -1;
+
+  if (table->edit_unit_byte_count == 0) {
+    if (edit_unit >= table->offsets->len)
+      return -1;
+
+    while (keyframe && edit_unit >= 0 &&
+        !g_array_index (table->offsets, GstMXFDemuxIndex, edit_unit).keyframe)
+      edit_unit--;
+    /* No random access flags in the index */
+    if (edit_unit < 0)
+      edit_unit = *position;
+  }
+
+  stream_offset = gst_mxf_demux_index_table_get_stream_offset (table,
+      edit_unit);
+  if (stream_offset == G_MAXUINT64)
+    return -1;
+
+  offset = gst_mxf_demux_stream_offset_to_offset (demux, etrack->body_sid,
+      stream_offset);
+  if (offset == -1)
+    return -1;
+
+  *position = edit_unit;
+  return offset;
+}
+
+/* Returns the position of the edit unit that contains the file offset */
+static gint64
+gst_mxf_demux_find_edit_unit_position (GstMXFDemux * demux,
+    GstMXFDemuxEssenceTrack * etrack, guint64 offset)
+{
+  GstMXFDemuxIndexTable *table;
+  guint64 stream_offset, last;
+  guint lo, hi, mid, next;
+  GList *l;
+
+  table = gst_mxf_demux_get_usable_index_table (demux, etrack->body_sid);
+  if (!table)
+    return -1;
+
+  stream_offset = gst_mxf_demux_offset_to_stream_offset (demux,
+      etrack->body_sid, offset);
+  if (stream_offset == -1)
+    return -1;
+
+  if (table->edit_unit_byte_count != 0)
+    return stream_offset / table->edit_unit_byte_count;
+
+  /* First edit unit starting after the offset.  Edit units of missing
+   * segments have no offset, they are skipped and the next known edit unit
+   * decides which half to continue with */
+  lo = 0;
+  hi = table->offsets->len;
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    for (next = mid; next < hi; next++) {
+      if (g_array_index (table->offsets, GstMXFDemuxIndex, next).offset !=
+          G_MAXUINT64)
+        break;
+    }
+
+    if (next < hi && g_array_index (table->offsets, GstMXFDemuxIndex,
+            next).offset <= stream_offset)
+      lo = next + 1;
+    else
+      hi = mid;
+  }
+
+  if (lo == 0)
+    return -1;
+
+  /* Unknown where the edit unit before the offset ends */
+  if (lo < table->offsets->len &&
+      g_array_index (table->offsets, GstMXFDemuxIndex, lo).offset ==
+      G_MAXUINT64)
+    return -1;
+
+  /* The last indexed edit unit goes on until the end of its partition */
+  if (lo == table->offsets->len) {
+    last = gst_mxf_demux_stream_offset_to_offset (demux, etrack->body_sid,
+        g_array_index (table->offsets, GstMXFDemuxIndex, lo - 1).offset);
+    if (last == -1)
+      return -1;
+
+    for (l = demux->partitions; l; l = l->next) {
+      GstMXFDemuxPartition *p = l->data;
+
+      if (p->partition.this_partition > last &&
+          p->partition.this_partition <= offset)
+        return -1;
+    }
+  }
+
+  return lo - 1;
+}
+
 static GstFlowReturn
 gst_mxf_demux_handle_generic_container_system_item (GstMXFDemux * demux,
     const MXFUL * key, GstBuffer * buffer)
@@ -1594,7 +1900,10 @@ gst_mxf_demux_handle_generic_container_essence_element (GstMXFDemux * demux,
   if (etrack->position == -1) {
     GST_DEBUG_OBJECT (demux,
         "Unknown essence track position, looking into index");
-    if (etrack->offsets) {
+    etrack->position = gst_mxf_demux_find_edit_unit_position (demux, etrack,
+        demux->offset - demux->run_in);
+
+    if (etrack->position == -1 && etrack->offsets) {
       for (i = 0; i < etrack->offsets->len; i++) {
         GstMXFDemuxIndex *idx =
             &g_array_index (etrack->offsets, GstMXFDemuxIndex, i);
@@ -1646,24 +1955,23 @@ gst_mxf_demux_handle_generic_container_essence_element (GstMXFDemux * demux,
 
   if (outbuf)
     keyframe = !GST_BUFFER_FLAG_IS_SET (outbuf, GST_BUFFER_FLAG_DELTA_UNIT);
+  if (!keyframe)
+    etrack->delta_units = TRUE;
 
   if (!etrack->offsets)
     etrack->offsets = g_array_new (FALSE, TRUE, sizeof (GstMXFDemuxIndex));
 
   {
-    if (etrack->offsets->len > etrack->position) {
-      GstMXFDemuxIndex *index =
-          &g_array_index (etrack->offsets, GstMXFDemuxIndex, etrack->position);
+    GstMXFDemuxIndex *index;
 
-      index->offset = demux->offset - demux->run_in;
-      index->keyframe = keyframe;
-    } else {
-      GstMXFDemuxIndex index;
+    /* After seeking with the index tables there can be a gap */
+    if (etrack->offsets->len <= etrack->position)
+      g_array_set_size (etrack->offsets, etrack->position + 1);
 
-      index.offset = demux->offset - demux->run_in;
-      index.keyframe = keyframe;
-      g_array_insert_val (etrack->offsets, etrack->position, index);
-    }
+    index =
+        &g_array_index (etrack->offsets, GstMXFDemuxIndex, etrack->position);
+    index->offset = demux->offset - demux->run_in;
+    index->keyframe = keyframe;
   }
 
   if (peek)
@@ -1790,13 +2098,13 @@ gst_mxf_demux_handle_generic_container_essence_element (GstMXFDemux * demux,
         if (ret != GST_FLOW_OK && ret != GST_FLOW_UNEXPECTED) {
           GST_ERROR_OBJECT (demux, "Switching component failed");
         }
-      } else if (etrack->duration > 0
+      } else if (etrack->duration > 0 && !gst_mxf_demux_is_following (demux)
           && pad->current_essence_track_position >= etrack->duration) {
         GST_DEBUG_OBJECT (demux,
             "Current component position after end of essence track");
         ret = GST_FLOW_UNEXPECTED;
       }
-    } else if (etrack->duration > 0
+    } else if (etrack->duration > 0 && !gst_mxf_demux_is_following (demux)
         && pad->current_essence_track_position == etrack->duration) {
       GST_DEBUG_OBJECT (demux, "At the end of the essence track");
       ret = GST_FLOW_UNEXPECTED;
@@ -1851,6 +2159,9 @@ gst_mxf_demux_handle_random_index_pack (GstMXFDemux * demux, const MXFUL * key,
     return GST_FLOW_ERROR;
   }
 
+  /* Only written at the very end */
+  demux->finalized = TRUE;
+
   for (i = 0; i < demux->random_index_pack->len; i++) {
     GstMXFDemuxPartition *p = NULL;
     MXFRandomIndexPackEntry *e =
@@ -1899,19 +2210,14 @@ static GstFlowReturn
 gst_mxf_demux_handle_index_table_segment (GstMXFDemux * demux,
     const MXFUL * key, GstBuffer * buffer)
 {
-  MXFIndexTableSegment *segment;
+  MXFIndexTableSegment segment;
+  GstMXFDemuxIndexTable *table;
 
   GST_DEBUG_OBJECT (demux,
       "Handling index table segment of size %u at offset %"
       G_GUINT64_FORMAT, GST_BUFFER_SIZE (buffer), demux->offset);
 
-  if (!demux->current_partition->primer.mappings) {
-    GST_WARNING_OBJECT (demux, "Invalid primer pack");
-  }
-
-  segment = g_new0 (MXFIndexTableSegment, 1);
-
-  if (!mxf_index_table_segment_parse (key, segment,
+  if (!mxf_index_table_segment_parse (key, &segment,
           &demux->current_partition->primer, GST_BUFFER_DATA (buffer),
           GST_BUFFER_SIZE (buffer))) {
 
@@ -1919,21 +2225,31 @@ gst_mxf_demux_handle_index_table_segment (GstMXFDemux * demux,
     return GST_FLOW_ERROR;
   }
 
-  demux->pending_index_table_segments =
-      g_list_prepend (demux->pending_index_table_segments, segment);
+  table = gst_mxf_demux_get_index_table (demux, segment.body_sid);
+  if (!table) {
+    GstMXFDemuxIndexTable t = { 0, };
+
+    t.body_sid = segment.body_sid;
+    t.index_sid = segment.index_sid;
+    t.offsets = g_array_new (FALSE, FALSE, sizeof (GstMXFDemuxIndex));
+    g_array_append_val (demux->index_tables, t);
+    table = gst_mxf_demux_get_index_table (demux, segment.body_sid);
+  }
 
+  gst_mxf_demux_index_table_add_segment (table, &segment);
+  mxf_index_table_segment_reset (&segment);
 
   return GST_FLOW_OK;
 }
 
+/* Pulls the key and the length of the KLV packet at @offset, @data_offset
+ * is the size of both */
 static GstFlowReturn
-gst_mxf_demux_pull_klv_packet (GstMXFDemux * demux, guint64 offset, MXFUL * key,
-    GstBuffer ** outbuf, guint * read)
+gst_mxf_demux_pull_klv_header (GstMXFDemux * demux, guint64 offset,
+    MXFUL * key, guint * data_offset, guint64 * length)
 {
   GstBuffer *buffer = NULL;
   const guint8 *data;
-  guint64 data_offset = 0;
-  guint64 length;
   GstFlowReturn ret = GST_FLOW_OK;
 
   memset (key, 0, sizeof (MXFUL));
@@ -1949,12 +2265,12 @@ gst_mxf_demux_pull_klv_packet (GstMXFDemux * demux, guint64 offset, MXFUL * key,
 
   /* Decode BER encoded packet length */
   if ((data[16] & 0x80) == 0) {
-    length = data[16];
-    data_offset = 17;
+    *length = data[16];
+    *data_offset = 17;
   } else {
     guint slen = data[16] & 0x7f;
 
-    data_offset = 16 + 1 + slen;
+    *data_offset = 16 + 1 + slen;
 
     gst_buffer_unref (buffer);
     buffer = NULL;
@@ -1972,16 +2288,33 @@ gst_mxf_demux_pull_klv_packet (GstMXFDemux * demux, guint64 offset, MXFUL * key,
       goto beach;
     data = GST_BUFFER_DATA (buffer);
 
-    length = 0;
+    *length = 0;
     while (slen) {
-      length = (length << 8) | *data;
+      *length = (*length << 8) | *data;
       data++;
       slen--;
     }
   }
 
-  gst_buffer_unref (buffer);
-  buffer = NULL;
+beach:
+  if (buffer)
+    gst_buffer_unref (buffer);
+
+  return ret;
+}
+
+static GstFlowReturn
+gst_mxf_demux_pull_klv_packet (GstMXFDemux * demux, guint64 offset, MXFUL * key,
+    GstBuffer ** outbuf, guint * read)
+{
+  GstBuffer *buffer = NULL;
+  guint data_offset = 0;
+  guint64 length = 0;
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  if ((ret = gst_mxf_demux_pull_klv_header (demux, offset, key, &data_offset,
+              &length)) != GST_FLOW_OK)
+    goto beach;
 
   /* GStreamer's buffer sizes are stored in a guint so we
    * limit ourself to G_MAXUINT large buffers */
@@ -2009,6 +2342,23 @@ beach:
   return ret;
 }
 
+/* Skips fill packets, returns the offset and key of the next packet */
+static guint64
+gst_mxf_demux_skip_fill (GstMXFDemux * demux, guint64 offset, MXFUL * key)
+{
+  guint data_offset;
+  guint64 length;
+
+  while (gst_mxf_demux_pull_klv_header (demux, offset, key, &data_offset,
+          &length) == GST_FLOW_OK) {
+    if (!mxf_is_fill (key))
+      return offset;
+    offset += data_offset + length;
+  }
+
+  return -1;
+}
+
 static void
 gst_mxf_demux_pull_random_index_pack (GstMXFDemux * demux)
 {
@@ -2075,6 +2425,79 @@ gst_mxf_demux_pull_random_index_pack (GstMXFDemux * demux)
   demux->offset = old_offset;
 }
 
+/* Reads the partition packs and index table segments of all partitions
+ * from the random index pack and where their essence starts, so that the
+ * index tables can be used for seeking right away */
+static void
+gst_mxf_demux_pull_index_tables (GstMXFDemux * demux)
+{
+  guint64 old_offset = demux->offset;
+  GstMXFDemuxPartition *old_partition = demux->current_partition;
+  GList *l;
+
+  for (l = demux->partitions; l; l = l->next) {
+    GstMXFDemuxPartition *p = l->data;
+    guint64 offset, end;
+    GstBuffer *buffer = NULL;
+    MXFUL key;
+    guint read = 0;
+
+    offset = demux->run_in + p->partition.this_partition;
+    demux->offset = offset;
+    if (gst_mxf_demux_pull_klv_packet (demux, offset, &key, &buffer,
+            &read) != GST_FLOW_OK)
+      break;
+
+    if (!mxf_is_partition_pack (&key) ||
+        gst_mxf_demux_handle_partition_pack (demux, &key,
+            buffer) != GST_FLOW_OK) {
+      GST_WARNING_OBJECT (demux, "No valid partition pack at offset %"
+          G_GUINT64_FORMAT, offset);
+      gst_buffer_unref (buffer);
+      continue;
+    }
+    gst_buffer_unref (buffer);
+    p = demux->current_partition;
+
+    /* SMPTE 377M 7.1: the byte counts start after the fill following the
+     * partition pack */
+    offset = gst_mxf_demux_skip_fill (demux, offset + read, &key);
+    if (offset == -1)
+      continue;
+
+    offset += p->partition.header_byte_count;
+    end = offset + p->partition.index_byte_count;
+    while (offset < end) {
+      if (gst_mxf_demux_pull_klv_packet (demux, offset, &key, &buffer,
+              &read) != GST_FLOW_OK)
+        break;
+
+      if (mxf_is_index_table_segment (&key)) {
+        demux->offset = offset;
+        gst_mxf_demux_handle_index_table_segment (demux, &key, buffer);
+      }
+      gst_buffer_unref (buffer);
+      offset += read;
+    }
+
+    if (p->partition.body_sid == 0 || p->essence_container_offset != 0)
+      continue;
+
+    offset = gst_mxf_demux_skip_fill (demux, end, &key);
+    if (offset != -1 && (mxf_is_generic_container_system_item (&key) ||
+            mxf_is_generic_container_essence_element (&key) ||
+            mxf_is_avid_essence_container_essence_element (&key)))
+      p->essence_container_offset =
+          offset - demux->run_in - p->partition.this_partition;
+  }
+
+  GST_DEBUG_OBJECT (demux, "Found index tables for %u essence containers",
+      demux->index_tables->len);
+
+  demux->offset = old_offset;
+  demux->current_partition = old_partition;
+}
+
 static void
 gst_mxf_demux_parse_footer_metadata (GstMXFDemux * demux)
 {
@@ -2427,6 +2850,21 @@ from_index:
     }
   }
 
+  /* Then in the index tables of the file */
+  {
+    gint64 edit_unit = *position;
+    guint64 offset;
+
+    offset =
+        gst_mxf_demux_find_edit_unit (demux, etrack, &edit_unit, keyframe);
+    if (offset != -1) {
+      GST_DEBUG_OBJECT (demux, "Found edit unit %" G_GINT64_FORMAT
+          " in index table at offset %" G_GUINT64_FORMAT, edit_unit, offset);
+      *position = edit_unit;
+      return offset;
+    }
+  }
+
   GST_DEBUG_OBJECT (demux, "Not found in index");
   if (!demux->random_access) {
     guint64 new_offset = -1;
@@ -2483,7 +2921,7 @@ from_index:
           gst_mxf_demux_pull_klv_packet (demux, demux->offset, &key, &buffer,
           &read);
 
-      if (ret == GST_FLOW_UNEXPECTED) {
+      if (ret == GST_FLOW_UNEXPECTED && !gst_mxf_demux_is_following (demux)) {
         for (i = 0; i < demux->essence_tracks->len; i++) {
           GstMXFDemuxEssenceTrack *t =
               &g_array_index (demux->essence_tracks, GstMXFDemuxEssenceTrack,
@@ -2543,6 +2981,209 @@ from_index:
   return -1;
 }
 
+/* Walks the KLV packets that were appended to a growing file since the last
+ * time. Partition packs, primer packs and index table segments are parsed,
+ * of the essence elements only the keys are pulled to extend the offsets
+ * of the essence tracks. The header metadata is not parsed again, only the
+ * durations of the essence tracks grow */
+static void
+gst_mxf_demux_follow_refresh (GstMXFDemux * demux)
+{
+  guint64 old_offset = demux->offset;
+  GstMXFDemuxPartition *old_partition = demux->current_partition;
+  gboolean updated = FALSE;
+  guint i;
+
+  if (demux->follow_offset == -1)
+    return;
+
+  gst_mxf_demux_set_partition_for_offset (demux, demux->follow_offset);
+
+  while (!demux->finalized) {
+    GstBuffer *buffer = NULL;
+    MXFUL key;
+    guint data_offset, read;
+    guint64 length;
+
+    if (gst_mxf_demux_pull_klv_header (demux, demux->follow_offset, &key,
+            &data_offset, &length) != GST_FLOW_OK)
+      break;
+
+    /* Only look at packets that are completely written */
+    if (length > 0) {
+      if (gst_mxf_demux_pull_range (demux,
+              demux->follow_offset + data_offset + length - 1, 1,
+              &buffer) != GST_FLOW_OK)
+        break;
+      gst_buffer_unref (buffer);
+      buffer = NULL;
+    }
+
+    demux->offset = demux->follow_offset;
+
+    if (mxf_is_partition_pack (&key) || mxf_is_primer_pack (&key) ||
+        mxf_is_index_table_segment (&key)) {
+      if (gst_mxf_demux_pull_klv_packet (demux, demux->follow_offset, &key,
+              &buffer, &read) != GST_FLOW_OK)
+        break;
+
+      if (mxf_is_partition_pack (&key)) {
+        if (gst_mxf_demux_handle_partition_pack (demux, &key,
+                buffer) == GST_FLOW_OK
+            && demux->current_partition->partition.body_sid != 0) {
+          MXFPartitionPack *pack = &demux->current_partition->partition;
+
+          for (i = 0; i < demux->essence_tracks->len; i++) {
+            GstMXFDemuxEssenceTrack *t =
+                &g_array_index (demux->essence_tracks, GstMXFDemuxEssenceTrack,
+                i);
+
+            if (t->body_sid != pack->body_sid)
+              continue;
+            if (pack->body_offset == 0)
+              t->follow_position = 0;
+            t->follow_partition_start = TRUE;
+          }
+        }
+      } else if (mxf_is_primer_pack (&key)) {
+        gst_mxf_demux_handle_primer_pack (demux, &key, buffer);
+      } else {
+        gst_mxf_demux_handle_index_table_segment (demux, &key, buffer);
+      }
+      gst_buffer_unref (buffer);
+    } else if (demux->current_partition &&
+        (mxf_is_generic_container_system_item (&key) ||
+            mxf_is_generic_container_essence_element (&key) ||
+            mxf_is_avid_essence_container_essence_element (&key))) {
+      GstMXFDemuxPartition *p = demux->current_partition;
+      GstMXFDemuxEssenceTrack *etrack = NULL;
+      guint32 track_number = GST_READ_UINT32_BE (&key.u[12]);
+
+      if (p->essence_container_offset == 0)
+        p->essence_container_offset =
+            demux->offset - demux->run_in - p->partition.this_partition;
+
+      for (i = 0; i < demux->essence_tracks->len &&
+          !mxf_is_generic_container_system_item (&key); i++) {
+        GstMXFDemuxEssenceTrack *tmp =
+            &g_array_index (demux->essence_tracks, GstMXFDemuxEssenceTrack, i);
+
+        if (tmp->body_sid == p->partition.body_sid &&
+            (tmp->track_number == track_number || tmp->track_number == 0)) {
+          etrack = tmp;
+          break;
+        }
+      }
+
+      if (etrack && etrack->follow_position != -1) {
+        /* Tracks with index tables are seeked with them */
+        if (!gst_mxf_demux_get_index_table (demux, etrack->body_sid)) {
+          GstMXFDemuxIndex *idx;
+
+          if (!etrack->offsets)
+            etrack->offsets =
+                g_array_new (FALSE, TRUE, sizeof (GstMXFDemuxIndex));
+          if (etrack->offsets->len <= etrack->follow_position)
+            g_array_set_size (etrack->offsets, etrack->follow_position + 1);
+
+          idx = &g_array_index (etrack->offsets, GstMXFDemuxIndex,
+              etrack->follow_position);
+          if (idx->offset == 0) {
+            idx->offset = demux->offset - demux->run_in;
+            /* Set properly once the essence element is handled. Until then
+             * the first edit unit of a body partition is taken as a
+             * keyframe, writers start partitions at a GOP */
+            idx->keyframe = !etrack->delta_units ||
+                etrack->follow_partition_start;
+          }
+        }
+        etrack->follow_position++;
+        etrack->follow_partition_start = FALSE;
+      }
+    }
+
+    demux->follow_offset += data_offset + length;
+  }
+
+  for (i = 0; i < demux->essence_tracks->len; i++) {
+    GstMXFDemuxEssenceTrack *t =
+        &g_array_index (demux->essence_tracks, GstMXFDemuxEssenceTrack, i);
+    GstMXFDemuxIndexTable *table;
+    gint64 duration = t->follow_position;
+
+    table = gst_mxf_demux_get_index_table (demux, t->body_sid);
+    if (table && table->offsets->len > duration)
+      duration = table->offsets->len;
+
+    if (duration > t->duration) {
+      t->duration = duration;
+      updated = TRUE;
+    }
+  }
+
+  demux->offset = old_offset;
+  demux->current_partition = old_partition;
+
+  if (updated) {
+    GST_DEBUG_OBJECT (demux, "File has grown to offset %" G_GUINT64_FORMAT,
+        demux->follow_offset);
+    gst_element_post_message (GST_ELEMENT_CAST (demux),
+        gst_message_new_duration (GST_OBJECT_CAST (demux), GST_FORMAT_TIME,
+            -1));
+  }
+}
+
+/* Waits for a growing file to be appended to, returns
+ * GST_FLOW_WRONG_STATE if interrupted by a seek or deactivation */
+static GstFlowReturn
+gst_mxf_demux_follow_wait (GstMXFDemux * demux)
+{
+  GTimeVal timeval;
+  gboolean interrupted;
+  guint i;
+
+  /* Everything up to here was handled already */
+  if (demux->follow_offset == -1) {
+    demux->follow_offset = demux->offset;
+    for (i = 0; i < demux->essence_tracks->len; i++) {
+      GstMXFDemuxEssenceTrack *t =
+          &g_array_index (demux->essence_tracks, GstMXFDemuxEssenceTrack, i);
+
+      t->follow_position = t->position;
+    }
+  }
+
+  GST_LOG_OBJECT (demux, "Waiting for the file to grow");
+
+  /* The interval is at most 10 minutes, which fits into the microseconds
+   * g_time_val_add() takes on 32 bit too */
+  g_get_current_time (&timeval);
+  g_time_val_add (&timeval, (glong) (demux->follow_interval / GST_USECOND));
+
+  g_mutex_lock (demux->follow_lock);
+  if (!demux->follow_interrupted)
+    g_cond_timed_wait (demux->follow_cond, demux->follow_lock, &timeval);
+  interrupted = demux->follow_interrupted;
+  g_mutex_unlock (demux->follow_lock);
+
+  if (interrupted)
+    return GST_FLOW_WRONG_STATE;
+
+  gst_mxf_demux_follow_refresh (demux);
+
+  return GST_FLOW_OK;
+}
+
+static void
+gst_mxf_demux_set_follow_interrupted (GstMXFDemux * demux,
+    gboolean interrupted)
+{
+  g_mutex_lock (demux->follow_lock);
+  demux->follow_interrupted = interrupted;
+  g_cond_signal (demux->follow_cond);
+  g_mutex_unlock (demux->follow_lock);
+}
+
 static GstFlowReturn
 gst_mxf_demux_pull_and_handle_klv_packet (GstMXFDemux * demux)
 {
@@ -2563,6 +3204,12 @@ gst_mxf_demux_pull_and_handle_klv_packet (GstMXFDemux * demux)
       gst_mxf_demux_pull_klv_packet (demux, demux->offset, &key, &buffer,
       &read);
 
+  if (ret == GST_FLOW_UNEXPECTED && gst_mxf_demux_is_following (demux)) {
+    /* Try again here once the file has grown */
+    ret = gst_mxf_demux_follow_wait (demux);
+    goto beach;
+  }
+
   if (ret == GST_FLOW_UNEXPECTED && demux->src->len > 0) {
     guint i;
     GstMXFDemuxPad *p = NULL;
@@ -2720,6 +3367,10 @@ gst_mxf_demux_loop (GstPad * pad)
 
     /* First of all pull&parse the random index pack at EOF */
     gst_mxf_demux_pull_random_index_pack (demux);
+
+    /* and the index tables of the partitions listed in it */
+    if (demux->random_index_pack)
+      gst_mxf_demux_pull_index_tables (demux);
   }
 
   /* Now actually do something */
@@ -3213,6 +3864,9 @@ gst_mxf_demux_seek_pull (GstMXFDemux * demux, GstEvent * event)
   flush = ! !(flags & GST_SEEK_FLAG_FLUSH);
   keyframe = ! !(flags & GST_SEEK_FLAG_KEY_UNIT);
 
+  /* Stop waiting for a growing file */
+  gst_mxf_demux_set_follow_interrupted (demux, TRUE);
+
   if (flush) {
     GstEvent *e;
 
@@ -3230,6 +3884,8 @@ gst_mxf_demux_seek_pull (GstMXFDemux * demux, GstEvent * event)
   /* Take the stream lock */
   GST_PAD_STREAM_LOCK (demux->sinkpad);
 
+  gst_mxf_demux_set_follow_interrupted (demux, FALSE);
+
   if (flush) {
     GstEvent *e;
 
@@ -3239,6 +3895,10 @@ gst_mxf_demux_seek_pull (GstMXFDemux * demux, GstEvent * event)
     gst_pad_push_event (demux->sinkpad, e);
   }
 
+  /* Make the part of a growing file that was written since known */
+  if (gst_mxf_demux_is_following (demux))
+    gst_mxf_demux_follow_refresh (demux);
+
   /* Work on a copy until we are sure the seek succeeded. */
   memcpy (&seeksegment, &demux->segment, sizeof (GstSegment));
 
@@ -3420,6 +4080,35 @@ gst_mxf_demux_src_query_type (GstPad * pad)
   return types;
 }
 
+/* Returns the duration of the material track in edit units or -1, must be
+ * called with the metadata lock */
+static gint64
+gst_mxf_demux_pad_get_duration (GstMXFDemux * demux, GstMXFDemuxPad * pad)
+{
+  GstMXFDemuxEssenceTrack *etrack = pad->current_essence_track;
+  gint64 duration;
+
+  duration = pad->material_track->parent.sequence->duration;
+  if (duration <= -1)
+    duration = -1;
+
+  /* The essence of a growing file is longer than the metadata says */
+  if (gst_mxf_demux_is_following (demux) && etrack && etrack->source_track
+      && etrack->duration > 0 && etrack->source_track->edit_rate.n > 0
+      && etrack->source_track->edit_rate.d > 0
+      && pad->material_track->edit_rate.n > 0
+      && pad->material_track->edit_rate.d > 0) {
+    gint64 essence_duration =
+        gst_util_uint64_scale (etrack->duration,
+        pad->material_track->edit_rate.n * etrack->source_track->edit_rate.d,
+        pad->material_track->edit_rate.d * etrack->source_track->edit_rate.n);
+
+    duration = MAX (duration, essence_duration);
+  }
+
+  return duration;
+}
+
 static gboolean
 gst_mxf_demux_src_query (GstPad * pad, GstQuery * query)
 {
@@ -3480,9 +4169,7 @@ gst_mxf_demux_src_query (GstPad * pad, GstQuery * query)
         goto error;
       }
 
-      duration = mxfpad->material_track->parent.sequence->duration;
-      if (duration <= -1)
-        duration = -1;
+      duration = gst_mxf_demux_pad_get_duration (demux, mxfpad);
 
       if (duration != -1 && format == GST_FORMAT_TIME) {
         if (mxfpad->material_track->edit_rate.n == 0 ||
@@ -3584,10 +4271,12 @@ gst_mxf_demux_sink_activate_pull (GstPad * sinkpad, gboolean active)
 
   if (active) {
     demux->random_access = TRUE;
+    gst_mxf_demux_set_follow_interrupted (demux, FALSE);
     gst_object_unref (demux);
     return gst_pad_start_task (sinkpad, (GstTaskFunction) gst_mxf_demux_loop,
         sinkpad);
   } else {
+    gst_mxf_demux_set_follow_interrupted (demux, TRUE);
     demux->random_access = FALSE;
     gst_object_unref (demux);
     return gst_pad_stop_task (sinkpad);
@@ -3768,7 +4457,7 @@ gst_mxf_demux_query (GstElement * element, GstQuery * query)
         if (!pad->material_track || !pad->material_track->parent.sequence)
           continue;
 
-        pdur = pad->material_track->parent.sequence->duration;
+        pdur = gst_mxf_demux_pad_get_duration (demux, pad);
         if (pad->material_track->edit_rate.n == 0 ||
             pad->material_track->edit_rate.d == 0 || pdur <= -1)
           continue;
@@ -3881,6 +4570,12 @@ gst_mxf_demux_set_property (GObject * object, guint prop_id,
     case PROP_MAX_DRIFT:
       demux->max_drift = g_value_get_uint64 (value);
       break;
+    case PROP_FOLLOW:
+      demux->follow = g_value_get_boolean (value);
+      break;
+    case PROP_FOLLOW_INTERVAL:
+      demux->follow_interval = g_value_get_uint64 (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -3900,6 +4595,12 @@ gst_mxf_demux_get_property (GObject * object, guint prop_id,
     case PROP_MAX_DRIFT:
       g_value_set_uint64 (value, demux->max_drift);
       break;
+    case PROP_FOLLOW:
+      g_value_set_boolean (value, demux->follow);
+      break;
+    case PROP_FOLLOW_INTERVAL:
+      g_value_set_uint64 (value, demux->follow_interval);
+      break;
     case PROP_STRUCTURE:{
       GstStructure *s;
 
@@ -3949,11 +4650,16 @@ gst_mxf_demux_finalize (GObject * object)
   demux->src = NULL;
   g_array_free (demux->essence_tracks, TRUE);
   demux->essence_tracks = NULL;
+  g_array_free (demux->index_tables, TRUE);
+  demux->index_tables = NULL;
 
   g_hash_table_destroy (demux->metadata);
 
   g_static_rw_lock_free (&demux->metadata_lock);
 
+  g_mutex_free (demux->follow_lock);
+  g_cond_free (demux->follow_cond);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -3999,6 +4705,18 @@ gst_mxf_demux_class_init (GstMXFDemuxClass * klass)
           "Structural metadata of the MXF file",
           GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_FOLLOW,
+      g_param_spec_boolean ("follow", "Follow",
+          "Wait for growing files to be written to at their end instead of "
+          "finishing, until they get a footer partition (pull mode only)",
+          FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_FOLLOW_INTERVAL,
+      g_param_spec_uint64 ("follow-interval", "Follow interval",
+          "Number of nanoseconds between checks if a growing file was "
+          "written to", GST_MSECOND, 600 * GST_SECOND, 500 * GST_MSECOND,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state =
       GST_DEBUG_FUNCPTR (gst_mxf_demux_change_state);
   gstelement_class->query = GST_DEBUG_FUNCPTR (gst_mxf_demux_query);
@@ -4026,6 +4744,10 @@ gst_mxf_demux_init (GstMXFDemux * demux, GstMXFDemuxClass * g_class)
   gst_element_add_pad (GST_ELEMENT (demux), demux->sinkpad);
 
   demux->max_drift = 500 * GST_MSECOND;
+  demux->follow_interval = 500 * GST_MSECOND;
+
+  demux->follow_lock = g_mutex_new ();
+  demux->follow_cond = g_cond_new ();
 
   demux->adapter = gst_adapter_new ();
   g_static_rw_lock_init (&demux->metadata_lock);
@@ -4033,6 +4755,8 @@ gst_mxf_demux_init (GstMXFDemux * demux, GstMXFDemuxClass * g_class)
   demux->src = g_ptr_array_new ();
   demux->essence_tracks =
       g_array_new (FALSE, FALSE, sizeof (GstMXFDemuxEssenceTrack));
+  demux->index_tables =
+      g_array_new (FALSE, FALSE, sizeof (GstMXFDemuxIndexTable));
 
   gst_segment_init (&demux->segment, GST_FORMAT_TIME);
 
@@ -61,6 +61,21 @@ typedef struct
   gboolean keyframe;
 } GstMXFDemuxIndex;
 
+typedef struct
+{
+  guint32 body_sid;
+  guint32 index_sid;
+
+  /* Size of every edit unit if constant, offsets is empty then */
+  guint32 edit_unit_byte_count;
+
+  /* Stream offsets of the edit units, G_MAXUINT64 if not indexed */
+  GArray *offsets;
+
+  /* Edit units start at KLV packets, i.e. the essence is frame wrapped */
+  gboolean checked, usable;
+} GstMXFDemuxIndexTable;
+
 typedef struct
 {
   guint32 body_sid;
@@ -73,6 +88,14 @@ typedef struct
   gint64 duration;
 
   GArray *offsets;
+  /* Not all edit units are keyframes */
+  gboolean delta_units;
+
+  /* Position of the next essence element after the part of a growing
+   * file that was looked at */
+  gint64 follow_position;
+  /* The next essence element found there starts a body partition */
+  gboolean follow_partition_start;
 
   MXFMetadataSourcePackage *source_package;
   MXFMetadataTimelineTrack *source_track;
@@ -149,7 +172,7 @@ struct _GstMXFDemux
   GstMXFDemuxPartition *current_partition;
 
   GArray *essence_tracks;
-  GList *pending_index_table_segments;
+  GArray *index_tables;
 
   GArray *random_index_pack;
 
@@ -166,9 +189,18 @@ struct _GstMXFDemux
   MXFMetadataGenericPackage *current_package;
   gchar *current_package_string;
 
+  /* Growing files */
+  GMutex *follow_lock;
+  GCond *follow_cond;
+  gboolean follow_interrupted;
+  gboolean finalized;
+  guint64 follow_offset;
+
   /* Properties */
   gchar *requested_package_string;
   GstClockTime max_drift;
+  gboolean follow;
+  GstClockTime follow_interval;
 };
 
 struct _GstMXFDemuxClass
@@ -402,79 +402,74 @@ mxf_metadata_init (MXFMetadata * self)
 {
 }
 
-static GArray *_mxf_metadata_registry = NULL;
-
-#define _add_metadata_type(type) G_STMT_START { \
-  GType t = type; \
-  \
-  g_array_append_val (_mxf_metadata_registry, t); \
-} G_STMT_END
+/* Metadata type, as found in the last bytes of the set keys, to GType.
+ * Header metadata can contain tens of thousands of sets, so don't look
+ * through all registered types for every one of them */
+static GHashTable *_mxf_metadata_registry = NULL;
 
 void
-mxf_metadata_init_types (void)
+mxf_metadata_register (GType type)
 {
-  g_return_if_fail (_mxf_metadata_registry == NULL);
+  MXFMetadataClass *klass;
 
-  _mxf_metadata_registry = g_array_new (FALSE, TRUE, sizeof (GType));
-
-  _add_metadata_type (MXF_TYPE_METADATA_PREFACE);
-  _add_metadata_type (MXF_TYPE_METADATA_IDENTIFICATION);
-  _add_metadata_type (MXF_TYPE_METADATA_CONTENT_STORAGE);
-  _add_metadata_type (MXF_TYPE_METADATA_ESSENCE_CONTAINER_DATA);
-  _add_metadata_type (MXF_TYPE_METADATA_MATERIAL_PACKAGE);
-  _add_metadata_type (MXF_TYPE_METADATA_SOURCE_PACKAGE);
-  _add_metadata_type (MXF_TYPE_METADATA_TIMELINE_TRACK);
-  _add_metadata_type (MXF_TYPE_METADATA_EVENT_TRACK);
-  _add_metadata_type (MXF_TYPE_METADATA_STATIC_TRACK);
-  _add_metadata_type (MXF_TYPE_METADATA_SEQUENCE);
-  _add_metadata_type (MXF_TYPE_METADATA_SOURCE_CLIP);
-  _add_metadata_type (MXF_TYPE_METADATA_TIMECODE_COMPONENT);
-  _add_metadata_type (MXF_TYPE_METADATA_DM_SEGMENT);
-  _add_metadata_type (MXF_TYPE_METADATA_DM_SOURCE_CLIP);
-  _add_metadata_type (MXF_TYPE_METADATA_FILE_DESCRIPTOR);
-  _add_metadata_type (MXF_TYPE_METADATA_GENERIC_PICTURE_ESSENCE_DESCRIPTOR);
-  _add_metadata_type (MXF_TYPE_METADATA_CDCI_PICTURE_ESSENCE_DESCRIPTOR);
-  _add_metadata_type (MXF_TYPE_METADATA_RGBA_PICTURE_ESSENCE_DESCRIPTOR);
-  _add_metadata_type (MXF_TYPE_METADATA_GENERIC_SOUND_ESSENCE_DESCRIPTOR);
-  _add_metadata_type (MXF_TYPE_METADATA_GENERIC_DATA_ESSENCE_DESCRIPTOR);
-  _add_metadata_type (MXF_TYPE_METADATA_MULTIPLE_DESCRIPTOR);
-  _add_metadata_type (MXF_TYPE_METADATA_NETWORK_LOCATOR);
-  _add_metadata_type (MXF_TYPE_METADATA_TEXT_LOCATOR);
-}
-
-#undef _add_metadata_type
+  g_return_if_fail (g_type_is_a (type, MXF_TYPE_METADATA));
+  g_return_if_fail (_mxf_metadata_registry != NULL);
+
+  /* The class is kept around for the type to be known */
+  klass = MXF_METADATA_CLASS (g_type_class_ref (type));
+  g_return_if_fail (klass->type != 0);
+
+  if (!g_hash_table_lookup (_mxf_metadata_registry,
+          GUINT_TO_POINTER ((guint) klass->type)))
+    g_hash_table_insert (_mxf_metadata_registry,
+        GUINT_TO_POINTER ((guint) klass->type), GSIZE_TO_POINTER (type));
+}
 
 void
-mxf_metadata_register (GType type)
+mxf_metadata_init_types (void)
 {
-  g_return_if_fail (g_type_is_a (type, MXF_TYPE_METADATA));
+  g_return_if_fail (_mxf_metadata_registry == NULL);
 
-  g_array_append_val (_mxf_metadata_registry, type);
+  _mxf_metadata_registry = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  mxf_metadata_register (MXF_TYPE_METADATA_PREFACE);
+  mxf_metadata_register (MXF_TYPE_METADATA_IDENTIFICATION);
+  mxf_metadata_register (MXF_TYPE_METADATA_CONTENT_STORAGE);
+  mxf_metadata_register (MXF_TYPE_METADATA_ESSENCE_CONTAINER_DATA);
+  mxf_metadata_register (MXF_TYPE_METADATA_MATERIAL_PACKAGE);
+  mxf_metadata_register (MXF_TYPE_METADATA_SOURCE_PACKAGE);
+  mxf_metadata_register (MXF_TYPE_METADATA_TIMELINE_TRACK);
+  mxf_metadata_register (MXF_TYPE_METADATA_EVENT_TRACK);
+  mxf_metadata_register (MXF_TYPE_METADATA_STATIC_TRACK);
+  mxf_metadata_register (MXF_TYPE_METADATA_SEQUENCE);
+  mxf_metadata_register (MXF_TYPE_METADATA_SOURCE_CLIP);
+  mxf_metadata_register (MXF_TYPE_METADATA_TIMECODE_COMPONENT);
+  mxf_metadata_register (MXF_TYPE_METADATA_DM_SEGMENT);
+  mxf_metadata_register (MXF_TYPE_METADATA_DM_SOURCE_CLIP);
+  mxf_metadata_register (MXF_TYPE_METADATA_FILE_DESCRIPTOR);
+  mxf_metadata_register (MXF_TYPE_METADATA_GENERIC_PICTURE_ESSENCE_DESCRIPTOR);
+  mxf_metadata_register (MXF_TYPE_METADATA_CDCI_PICTURE_ESSENCE_DESCRIPTOR);
+  mxf_metadata_register (MXF_TYPE_METADATA_RGBA_PICTURE_ESSENCE_DESCRIPTOR);
+  mxf_metadata_register (MXF_TYPE_METADATA_GENERIC_SOUND_ESSENCE_DESCRIPTOR);
+  mxf_metadata_register (MXF_TYPE_METADATA_GENERIC_DATA_ESSENCE_DESCRIPTOR);
+  mxf_metadata_register (MXF_TYPE_METADATA_MULTIPLE_DESCRIPTOR);
+  mxf_metadata_register (MXF_TYPE_METADATA_NETWORK_LOCATOR);
+  mxf_metadata_register (MXF_TYPE_METADATA_TEXT_LOCATOR);
 }
 
 MXFMetadata *
 mxf_metadata_new (guint16 type, MXFPrimerPack * primer, guint64 offset,
     const guint8 * data, guint size)
 {
-  guint i;
-  GType t = G_TYPE_INVALID;
+  GType t;
   MXFMetadata *ret = NULL;
 
   g_return_val_if_fail (type != 0, NULL);
   g_return_val_if_fail (primer != NULL, NULL);
   g_return_val_if_fail (_mxf_metadata_registry != NULL, NULL);
 
-  for (i = 0; i < _mxf_metadata_registry->len; i++) {
-    GType tmp = g_array_index (_mxf_metadata_registry, GType, i);
-    MXFMetadataClass *klass = MXF_METADATA_CLASS (g_type_class_ref (tmp));
-
-    if (klass->type == type) {
-      g_type_class_unref (klass);
-      t = tmp;
-      break;
-    }
-    g_type_class_unref (klass);
-  }
+  t = (GType) GPOINTER_TO_SIZE (g_hash_table_lookup (_mxf_metadata_registry,
+          GUINT_TO_POINTER ((guint) type)));
 
   if (t == G_TYPE_INVALID) {
     GST_WARNING
@@ -6347,36 +6342,33 @@ mxf_descriptive_metadata_class_init (MXFDescriptiveMetadataClass * klass)
 {
 }
 
-typedef struct
-{
-  guint8 scheme;
-  GType *types;
-} _MXFDescriptiveMetadataScheme;
-
-static GArray *_dm_schemes = NULL;
+/* (scheme << 24) | type to GType, like _mxf_metadata_registry */
+static GHashTable *_dm_types = NULL;
 
 void
 mxf_descriptive_metadata_register (guint8 scheme, GType * types)
 {
-  _MXFDescriptiveMetadataScheme s;
+  GType *p;
 
-  if (!_dm_schemes)
-    _dm_schemes =
-        g_array_new (FALSE, TRUE, sizeof (_MXFDescriptiveMetadataScheme));
+  if (!_dm_types)
+    _dm_types = g_hash_table_new (g_direct_hash, g_direct_equal);
 
-  s.scheme = scheme;
-  s.types = types;
+  for (p = types; *p; p++) {
+    MXFDescriptiveMetadataClass *klass =
+        MXF_DESCRIPTIVE_METADATA_CLASS (g_type_class_ref (*p));
+    guint key = (((guint) scheme) << 24) | (klass->type & 0xffffff);
 
-  g_array_append_val (_dm_schemes, s);
+    if (!g_hash_table_lookup (_dm_types, GUINT_TO_POINTER (key)))
+      g_hash_table_insert (_dm_types, GUINT_TO_POINTER (key),
+          GSIZE_TO_POINTER (*p));
+  }
 }
 
 MXFDescriptiveMetadata *
 mxf_descriptive_metadata_new (guint8 scheme, guint32 type,
     MXFPrimerPack * primer, guint64 offset, const guint8 * data, guint size)
 {
-  guint i;
-  GType t = G_TYPE_INVALID, *p;
-  _MXFDescriptiveMetadataScheme *s = NULL;
+  GType t = G_TYPE_INVALID;
   MXFDescriptiveMetadata *ret = NULL;
 
   g_return_val_if_fail (primer != NULL, NULL);
@@ -6386,35 +6378,9 @@ mxf_descriptive_metadata_new (guint8 scheme, guint32 type,
     return NULL;
   }
 
-  for (i = 0; i < _dm_schemes->len; i++) {
-    _MXFDescriptiveMetadataScheme *data =
-        &g_array_index (_dm_schemes, _MXFDescriptiveMetadataScheme, i);
-
-    if (data->scheme == scheme) {
-      s = data;
-      break;
-    }
-  }
-
-  if (s == NULL) {
-    GST_WARNING ("Descriptive metadata scheme 0x%02x not supported", scheme);
-    return NULL;
-  }
-
-  p = s->types;
-  while (*p) {
-    GType tmp = *p;
-    MXFDescriptiveMetadataClass *klass =
-        MXF_DESCRIPTIVE_METADATA_CLASS (g_type_class_ref (tmp));
-
-    if (klass->type == type) {
-      g_type_class_unref (klass);
-      t = tmp;
-      break;
-    }
-    g_type_class_unref (klass);
-    p++;
-  }
+  if (_dm_types)
+    t = (GType) GPOINTER_TO_SIZE (g_hash_table_lookup (_dm_types,
+            GUINT_TO_POINTER ((((guint) scheme) << 24) | (type & 0xffffff))));
 
   if (t == G_TYPE_INVALID) {
     GST_WARNING
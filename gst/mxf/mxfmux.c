@@ -52,9 +52,12 @@ static GstStaticPadTemplate src_templ = GST_STATIC_PAD_TEMPLATE ("src",
     GST_STATIC_CAPS ("application/mxf")
     );
 
+#define DEFAULT_PARTITION_INTERVAL (10 * GST_SECOND)
+
 enum
 {
-  PROP_0
+  PROP_0,
+  PROP_PARTITION_INTERVAL
 };
 
 GST_BOILERPLATE (GstMXFMux, gst_mxf_mux, GstElement, GST_TYPE_ELEMENT);
@@ -84,6 +87,7 @@ gst_mxf_mux_push (GstMXFMux * mux, GstBuffer * buf)
   guint size = GST_BUFFER_SIZE (buf);
   GstFlowReturn ret;
 
+  buf = gst_buffer_make_metadata_writable (buf);
   gst_buffer_set_caps (buf, GST_PAD_CAPS (mux->srcpad));
   ret = gst_pad_push (mux->srcpad, buf);
   mux->offset += size;
@@ -127,6 +131,13 @@ gst_mxf_mux_class_init (GstMXFMuxClass * klass)
   gobject_class->set_property = gst_mxf_mux_set_property;
   gobject_class->get_property = gst_mxf_mux_get_property;
 
+  g_object_class_install_property (gobject_class, PROP_PARTITION_INTERVAL,
+      g_param_spec_uint64 ("partition-interval", "Partition interval",
+          "Start a new body partition with the index table of the previous "
+          "one after this much time (0 = a single body partition)",
+          0, G_MAXUINT64, DEFAULT_PARTITION_INTERVAL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state = GST_DEBUG_FUNCPTR (gst_mxf_mux_change_state);
   gstelement_class->request_new_pad =
       GST_DEBUG_FUNCPTR (gst_mxf_mux_request_new_pad);
@@ -149,6 +160,10 @@ gst_mxf_mux_init (GstMXFMux * mux, GstMXFMuxClass * g_class)
   gst_collect_pads_set_function (mux->collect,
       (GstCollectPadsFunction) GST_DEBUG_FUNCPTR (gst_mxf_mux_collected), mux);
 
+  mux->rip = g_array_new (FALSE, FALSE, sizeof (MXFRandomIndexPackEntry));
+  mux->index_entries = g_array_new (FALSE, FALSE, sizeof (MXFIndexEntry));
+  mux->partition_interval = DEFAULT_PARTITION_INTERVAL;
+
   gst_mxf_mux_reset (mux);
 }
 
@@ -166,6 +181,9 @@ gst_mxf_mux_finalize (GObject * object)
     mux->metadata_list = NULL;
   }
 
+  g_array_free (mux->rip, TRUE);
+  g_array_free (mux->index_entries, TRUE);
+
   gst_object_unref (mux->collect);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
@@ -175,9 +193,12 @@ static void
 gst_mxf_mux_set_property (GObject * object,
     guint prop_id, const GValue * value, GParamSpec * pspec)
 {
-  //GstMXFMux *mux = GST_MXF_MUX (object);
+  GstMXFMux *mux = GST_MXF_MUX (object);
 
   switch (prop_id) {
+    case PROP_PARTITION_INTERVAL:
+      mux->partition_interval = g_value_get_uint64 (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -188,9 +209,12 @@ static void
 gst_mxf_mux_get_property (GObject * object,
     guint prop_id, GValue * value, GParamSpec * pspec)
 {
-  //GstMXFMux *mux = GST_MXF_MUX (object);
+  GstMXFMux *mux = GST_MXF_MUX (object);
 
   switch (prop_id) {
+    case PROP_PARTITION_INTERVAL:
+      g_value_set_uint64 (value, mux->partition_interval);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -221,6 +245,7 @@ gst_mxf_mux_reset (GstMXFMux * mux)
     mux->metadata_list = NULL;
   }
   mux->metadata = mxf_metadata_hash_table_new ();
+  gst_buffer_replace (&mux->header_metadata, NULL);
 
   mxf_partition_pack_reset (&mux->partition);
   mxf_primer_pack_reset (&mux->primer);
@@ -228,6 +253,12 @@ gst_mxf_mux_reset (GstMXFMux * mux)
   mux->last_gc_timestamp = 0;
   mux->last_gc_position = 0;
   mux->offset = 0;
+
+  g_array_set_size (mux->rip, 0);
+  g_array_set_size (mux->index_entries, 0);
+  mux->body_offset = 0;
+  mux->index_start_position = 0;
+  mux->partition_timestamp = 0;
 }
 
 static gboolean
@@ -939,7 +970,7 @@ gst_mxf_mux_create_metadata (GstMXFMux * mux)
 
     cstorage->essence_container_data[0]->linked_package =
         MXF_METADATA_SOURCE_PACKAGE (cstorage->packages[1]);
-    cstorage->essence_container_data[0]->index_sid = 0;
+    cstorage->essence_container_data[0]->index_sid = 2;
     cstorage->essence_container_data[0]->body_sid = 1;
   }
 
@@ -1036,55 +1067,212 @@ gst_mxf_mux_init_partition_pack (GstMXFMux * mux)
   return GST_FLOW_OK;
 }
 
-static GstFlowReturn
-gst_mxf_mux_write_header_metadata (GstMXFMux * mux)
+/* Serializes the primer pack and the header metadata into one buffer that
+ * is written as is into all partitions with header metadata */
+static void
+gst_mxf_mux_serialize_header_metadata (GstMXFMux * mux)
 {
-  GstFlowReturn ret = GST_FLOW_OK;
-  GstBuffer *buf;
   GList *buffers = NULL;
   GList *l;
-  MXFMetadataBase *m;
-  guint64 header_byte_count = 0;
+  GstBuffer *buf;
+  guint size = 0;
+  guint8 *data;
 
   for (l = mux->metadata_list; l; l = l->next) {
-    m = l->data;
-    buf = mxf_metadata_base_to_buffer (m, &mux->primer);
-    header_byte_count += GST_BUFFER_SIZE (buf);
+    buf = mxf_metadata_base_to_buffer (l->data, &mux->primer);
+    size += GST_BUFFER_SIZE (buf);
     buffers = g_list_prepend (buffers, buf);
   }
 
-  buffers = g_list_reverse (buffers);
+  /* Only complete after all metadata was serialized */
   buf = mxf_primer_pack_to_buffer (&mux->primer);
-  header_byte_count += GST_BUFFER_SIZE (buf);
-  buffers = g_list_prepend (buffers, buf);
+  size += GST_BUFFER_SIZE (buf);
+  buffers = g_list_prepend (g_list_reverse (buffers), buf);
+
+  gst_buffer_replace (&mux->header_metadata, NULL);
+  mux->header_metadata = gst_buffer_new_and_alloc (size);
+  data = GST_BUFFER_DATA (mux->header_metadata);
+  for (l = buffers; l; l = l->next) {
+    buf = l->data;
+    memcpy (data, GST_BUFFER_DATA (buf), GST_BUFFER_SIZE (buf));
+    data += GST_BUFFER_SIZE (buf);
+    gst_buffer_unref (buf);
+  }
+  g_list_free (buffers);
+}
+
+/* The local tag of the index entries has a 16 bit size */
+#define MAX_INDEX_ENTRIES ((G_MAXUINT16 - 8) / 11)
+
+/* Creates the index table segments of the pending index entries */
+static GList *
+gst_mxf_mux_create_index_segments (GstMXFMux * mux, guint64 * size)
+{
+  MXFMetadataEssenceContainerData *ecd =
+      mux->preface->content_storage->essence_container_data[0];
+  MXFIndexTableSegment segment;
+  GList *ret = NULL;
+  GstBuffer *buf;
+  guint i, n;
+
+  *size = 0;
+
+  memset (&segment, 0, sizeof (MXFIndexTableSegment));
+  memcpy (&segment.index_edit_rate, &mux->min_edit_rate,
+      sizeof (MXFFraction));
+  segment.index_sid = ecd->index_sid;
+  segment.body_sid = ecd->body_sid;
+
+  for (i = 0; i < mux->index_entries->len; i += n) {
+    n = MIN (mux->index_entries->len - i, MAX_INDEX_ENTRIES);
+
+    mxf_uuid_init (&segment.instance_id, NULL);
+    segment.index_start_position = mux->index_start_position + i;
+    segment.index_duration = n;
+    segment.n_index_entries = n;
+    segment.index_entries =
+        &g_array_index (mux->index_entries, MXFIndexEntry, i);
+
+    buf = mxf_index_table_segment_to_buffer (&segment);
+    *size += GST_BUFFER_SIZE (buf);
+    ret = g_list_prepend (ret, buf);
+  }
+
+  mux->index_start_position += mux->index_entries->len;
+  g_array_set_size (mux->index_entries, 0);
+
+  return g_list_reverse (ret);
+}
+
+/* Writes the partition pack of mux->partition, followed by the header
+ * metadata if @metadata and by the index table segments of the content
+ * packages since the last partition if @index */
+static GstFlowReturn
+gst_mxf_mux_write_partition (GstMXFMux * mux, gboolean metadata,
+    gboolean index)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstBuffer *buf;
+  GList *segments = NULL;
+  GList *l;
+  guint64 index_byte_count = 0;
+
+  if (metadata && !mux->header_metadata)
+    gst_mxf_mux_serialize_header_metadata (mux);
+
+  if (index)
+    segments = gst_mxf_mux_create_index_segments (mux, &index_byte_count);
+
+  mux->partition.header_byte_count =
+      metadata ? GST_BUFFER_SIZE (mux->header_metadata) : 0;
+  mux->partition.index_byte_count = index_byte_count;
+  mux->partition.index_sid = (segments) ?
+      mux->preface->content_storage->essence_container_data[0]->index_sid : 0;
 
-  mux->partition.header_byte_count = header_byte_count;
   buf = mxf_partition_pack_to_buffer (&mux->partition);
   if ((ret = gst_mxf_mux_push (mux, buf)) != GST_FLOW_OK) {
     GST_ERROR_OBJECT (mux, "Failed pushing partition: %s",
         gst_flow_get_name (ret));
-    g_list_foreach (buffers, (GFunc) gst_mini_object_unref, NULL);
-    g_list_free (buffers);
-    return ret;
+    goto done;
   }
 
-  for (l = buffers; l; l = l->next) {
+  if (metadata) {
+    buf = gst_buffer_ref (mux->header_metadata);
+    if ((ret = gst_mxf_mux_push (mux, buf)) != GST_FLOW_OK) {
+      GST_ERROR_OBJECT (mux, "Failed pushing header metadata: %s",
+          gst_flow_get_name (ret));
+      goto done;
+    }
+  }
+
+  for (l = segments; l; l = l->next) {
     buf = l->data;
     l->data = NULL;
     if ((ret = gst_mxf_mux_push (mux, buf)) != GST_FLOW_OK) {
-      GST_ERROR_OBJECT (mux, "Failed pushing buffer: %s",
+      GST_ERROR_OBJECT (mux, "Failed pushing index table segment: %s",
           gst_flow_get_name (ret));
-      g_list_foreach (l, (GFunc) gst_mini_object_unref, NULL);
-      g_list_free (buffers);
-      return ret;
+      goto done;
     }
   }
 
-  g_list_free (buffers);
+done:
+  for (l = segments; l; l = l->next) {
+    if (l->data)
+      gst_buffer_unref (l->data);
+  }
+  g_list_free (segments);
 
   return ret;
 }
 
+static void
+gst_mxf_mux_add_rip_entry (GstMXFMux * mux)
+{
+  MXFRandomIndexPackEntry entry;
+
+  entry.offset = mux->partition.this_partition;
+  entry.body_sid = mux->partition.body_sid;
+  g_array_append_val (mux->rip, entry);
+}
+
+static GstFlowReturn
+gst_mxf_mux_write_body_partition (GstMXFMux * mux)
+{
+  mux->partition.type = MXF_PARTITION_PACK_BODY;
+  mux->partition.prev_partition = mux->partition.this_partition;
+  mux->partition.this_partition = mux->offset;
+  mux->partition.footer_partition = 0;
+  mux->partition.body_offset = mux->body_offset;
+  mux->partition.body_sid =
+      mux->preface->content_storage->essence_container_data[0]->body_sid;
+
+  gst_mxf_mux_add_rip_entry (mux);
+  mux->partition_timestamp = mux->last_gc_timestamp;
+
+  /* With the index table of the previous partition, so that readers of a
+   * growing file can seek in everything before it */
+  return gst_mxf_mux_write_partition (mux, FALSE, TRUE);
+}
+
+/* Called before writing an element of the content package at
+ * mux->last_gc_position. Starts a new body partition at the first element
+ * of a content package once the partition interval is over, and adds the
+ * index entries of the content packages */
+static GstFlowReturn
+gst_mxf_mux_start_element (GstMXFMux * mux, gboolean delta_unit)
+{
+  GstFlowReturn ret;
+  MXFIndexEntry *entry;
+
+  if (mux->index_start_position + mux->index_entries->len <=
+      mux->last_gc_position) {
+    if (mux->partition_interval > 0 && mux->last_gc_timestamp >=
+        mux->partition_timestamp + mux->partition_interval) {
+      if ((ret = gst_mxf_mux_write_body_partition (mux)) != GST_FLOW_OK)
+        return ret;
+    }
+
+    /* Content packages without any elements start where the next one
+     * starts */
+    while (mux->index_start_position + mux->index_entries->len <=
+        mux->last_gc_position) {
+      MXFIndexEntry tmp = { 0, };
+
+      /* SMPTE 377M 10.2.3: random access */
+      tmp.flags = 0x80;
+      tmp.stream_offset = mux->body_offset;
+      g_array_append_val (mux->index_entries, tmp);
+    }
+  }
+
+  entry = &g_array_index (mux->index_entries, MXFIndexEntry,
+      mux->index_entries->len - 1);
+  if (delta_unit)
+    entry->flags &= ~0x80;
+
+  return GST_FLOW_OK;
+}
+
 static const guint8 _gc_essence_element_ul[] = {
   0x06, 0x0e, 0x2b, 0x34, 0x01, 0x02, 0x01, 0x00,
   0x0d, 0x01, 0x03, 0x01, 0x00, 0x00, 0x00, 0x00
@@ -1098,6 +1286,7 @@ gst_mxf_mux_handle_buffer (GstMXFMux * mux, GstMXFMuxPad * cpad)
   GstBuffer *packet;
   GstFlowReturn ret = GST_FLOW_OK;
   guint8 slen, ber[9];
+  gboolean delta_unit;
   gboolean flush =
       (cpad->collect.abidata.ABI.eos && !cpad->have_complete_edit_unit
       && cpad->collect.buffer == NULL);
@@ -1122,6 +1311,8 @@ gst_mxf_mux_handle_buffer (GstMXFMux * mux, GstMXFMuxPad * cpad)
         cpad->source_track->parent.track_id, cpad->pos);
   }
 
+  delta_unit = buf && GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT);
+
   ret = cpad->write_func (buf, GST_PAD_CAPS (cpad->collect.pad),
       cpad->mapping_data, cpad->adapter, &outbuf, flush);
   if (ret != GST_FLOW_OK && ret != GST_FLOW_CUSTOM_SUCCESS) {
@@ -1142,21 +1333,36 @@ gst_mxf_mux_handle_buffer (GstMXFMux * mux, GstMXFMuxPad * cpad)
   if (buf == NULL)
     return ret;
 
+  if ((ret = gst_mxf_mux_start_element (mux, delta_unit)) != GST_FLOW_OK) {
+    gst_buffer_unref (buf);
+    return ret;
+  }
+
+  /* The essence is pushed as is after the key and length */
   slen = mxf_ber_encode_size (GST_BUFFER_SIZE (buf), ber);
-  packet = gst_buffer_new_and_alloc (16 + slen + GST_BUFFER_SIZE (buf));
+  packet = gst_buffer_new_and_alloc (16 + slen);
   memcpy (GST_BUFFER_DATA (packet), _gc_essence_element_ul, 16);
   GST_BUFFER_DATA (packet)[7] = cpad->descriptor->essence_container.u[7];
   GST_WRITE_UINT32_BE (&GST_BUFFER_DATA (packet)[12],
       cpad->source_track->parent.track_number);
   memcpy (&GST_BUFFER_DATA (packet)[16], ber, slen);
-  memcpy (&GST_BUFFER_DATA (packet)[16 + slen], GST_BUFFER_DATA (buf),
-      GST_BUFFER_SIZE (buf));
-  gst_buffer_unref (buf);
+  mux->body_offset += 16 + slen + GST_BUFFER_SIZE (buf);
+
+  buf = gst_buffer_make_metadata_writable (buf);
+  GST_BUFFER_TIMESTAMP (buf) = GST_CLOCK_TIME_NONE;
+  GST_BUFFER_DURATION (buf) = GST_CLOCK_TIME_NONE;
+  GST_BUFFER_OFFSET (buf) = GST_BUFFER_OFFSET_NONE;
+  GST_BUFFER_OFFSET_END (buf) = GST_BUFFER_OFFSET_NONE;
 
   GST_DEBUG_OBJECT (cpad->collect.pad, "Pushing buffer of size %u for track %u",
-      GST_BUFFER_SIZE (packet), cpad->source_track->parent.track_id);
+      16 + slen + GST_BUFFER_SIZE (buf), cpad->source_track->parent.track_id);
 
-  if ((ret = gst_mxf_mux_push (mux, packet)) != GST_FLOW_OK) {
+  if ((ret = gst_mxf_mux_push (mux, packet)) != GST_FLOW_OK)
+    gst_buffer_unref (buf);
+  else
+    ret = gst_mxf_mux_push (mux, buf);
+
+  if (ret != GST_FLOW_OK) {
     GST_ERROR_OBJECT (cpad->collect.pad,
         "Failed pushing buffer for track %u, reason %s",
         cpad->source_track->parent.track_id, gst_flow_get_name (ret));
@@ -1171,26 +1377,6 @@ gst_mxf_mux_handle_buffer (GstMXFMux * mux, GstMXFMuxPad * cpad)
   return ret;
 }
 
-static GstFlowReturn
-gst_mxf_mux_write_body_partition (GstMXFMux * mux)
-{
-  GstBuffer *buf;
-
-  mux->partition.type = MXF_PARTITION_PACK_BODY;
-  mux->partition.this_partition = mux->offset;
-  mux->partition.prev_partition = 0;
-  mux->partition.footer_partition = 0;
-  mux->partition.header_byte_count = 0;
-  mux->partition.index_byte_count = 0;
-  mux->partition.index_sid = 0;
-  mux->partition.body_offset = 0;
-  mux->partition.body_sid =
-      mux->preface->content_storage->essence_container_data[0]->body_sid;
-
-  buf = mxf_partition_pack_to_buffer (&mux->partition);
-  return gst_mxf_mux_push (mux, buf);
-}
-
 static GstFlowReturn
 gst_mxf_mux_handle_eos (GstMXFMux * mux)
 {
@@ -1283,43 +1469,29 @@ gst_mxf_mux_handle_eos (GstMXFMux * mux)
   }
 
   {
-    guint64 body_partition = mux->partition.this_partition;
-    guint32 body_sid = mux->partition.body_sid;
     guint64 footer_partition = mux->offset;
-    GArray *rip;
     GstFlowReturn ret;
-    MXFRandomIndexPackEntry entry;
 
     mux->partition.type = MXF_PARTITION_PACK_FOOTER;
     mux->partition.closed = TRUE;
     mux->partition.complete = TRUE;
+    mux->partition.prev_partition = mux->partition.this_partition;
     mux->partition.this_partition = mux->offset;
-    mux->partition.prev_partition = body_partition;
     mux->partition.footer_partition = mux->offset;
-    mux->partition.header_byte_count = 0;
-    mux->partition.index_byte_count = 0;
-    mux->partition.index_sid = 0;
     mux->partition.body_offset = 0;
     mux->partition.body_sid = 0;
+    gst_mxf_mux_add_rip_entry (mux);
 
-    gst_mxf_mux_write_header_metadata (mux);
+    /* With the final durations, for the footer and the header partition */
+    gst_mxf_mux_serialize_header_metadata (mux);
 
-    rip = g_array_sized_new (FALSE, FALSE, sizeof (MXFRandomIndexPackEntry), 3);
-    entry.offset = 0;
-    entry.body_sid = 0;
-    g_array_append_val (rip, entry);
-    entry.offset = body_partition;
-    entry.body_sid = body_sid;
-    g_array_append_val (rip, entry);
-    entry.offset = footer_partition;
-    entry.body_sid = 0;
-    g_array_append_val (rip, entry);
+    /* The index table of the last body partition */
+    gst_mxf_mux_write_partition (mux, TRUE, TRUE);
 
-    packet = mxf_random_index_pack_to_buffer (rip);
+    packet = mxf_random_index_pack_to_buffer (mux->rip);
     if ((ret = gst_mxf_mux_push (mux, packet)) != GST_FLOW_OK) {
       GST_ERROR_OBJECT (mux, "Failed pushing random index pack");
     }
-    g_array_free (rip, TRUE);
 
     /* Rewrite header partition with updated values */
     if (gst_pad_push_event (mux->srcpad,
@@ -1332,13 +1504,10 @@ gst_mxf_mux_handle_eos (GstMXFMux * mux)
       mux->partition.this_partition = 0;
       mux->partition.prev_partition = footer_partition;
       mux->partition.footer_partition = footer_partition;
-      mux->partition.header_byte_count = 0;
-      mux->partition.index_byte_count = 0;
-      mux->partition.index_sid = 0;
       mux->partition.body_offset = 0;
       mux->partition.body_sid = 0;
 
-      ret = gst_mxf_mux_write_header_metadata (mux);
+      ret = gst_mxf_mux_write_partition (mux, TRUE, FALSE);
       if (ret != GST_FLOW_OK) {
         GST_ERROR_OBJECT (mux, "Rewriting header partition failed");
         return ret;
@@ -1401,7 +1570,8 @@ gst_mxf_mux_collected (GstCollectPads * pads, gpointer user_data)
       if ((ret = gst_mxf_mux_init_partition_pack (mux)) != GST_FLOW_OK)
         goto error;
 
-      ret = gst_mxf_mux_write_header_metadata (mux);
+      gst_mxf_mux_add_rip_entry (mux);
+      ret = gst_mxf_mux_write_partition (mux, TRUE, FALSE);
     } else {
       ret = GST_FLOW_ERROR;
     }
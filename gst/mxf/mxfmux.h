@@ -87,12 +87,27 @@ typedef struct _GstMXFMux {
   GHashTable *metadata;
   GList *metadata_list;
   MXFMetadataPreface *preface;
+  /* primer pack and header metadata, serialized */
+  GstBuffer *header_metadata;
 
   MXFFraction min_edit_rate;
   guint64 last_gc_position;
   GstClockTime last_gc_timestamp;
 
+  /* MXFRandomIndexPackEntry of all partitions written so far */
+  GArray *rip;
+  /* bytes of the essence container written so far */
+  guint64 body_offset;
+  /* MXFIndexEntry of the content packages that are not indexed yet, the
+   * first of them at index_start_position */
+  GArray *index_entries;
+  guint64 index_start_position;
+  GstClockTime partition_timestamp;
+
   gchar *application;
+
+  /* properties */
+  GstClockTime partition_interval;
 } GstMXFMux;
 
 typedef struct _GstMXFMuxClass {
@@ -454,21 +454,11 @@ const MXFUL _mxf_ul_table[] = {
 gboolean
 mxf_ul_is_equal (const MXFUL * a, const MXFUL * b)
 {
-  guint i;
-
   g_return_val_if_fail (a != NULL, FALSE);
   g_return_val_if_fail (b != NULL, FALSE);
 
-  for (i = 0; i < 16; i++) {
-    /* registry version */
-    if (i == 7)
-      continue;
-
-    if (a->u[i] != b->u[i])
-      return FALSE;
-  }
-
-  return TRUE;
+  /* everything but the registry version */
+  return (memcmp (&a->u[8], &b->u[8], 8) == 0 && memcmp (a, b, 7) == 0);
 }
 
 gboolean
@@ -528,15 +518,20 @@ mxf_ul_is_valid (const MXFUL * ul)
 guint
 mxf_ul_hash (const MXFUL * ul)
 {
-  guint32 ret = 0;
+  guint32 ret = 2166136261U;
   guint i;
 
   g_return_val_if_fail (ul != NULL, 0);
 
-  for (i = 0; i < 4; i++)
-    ret ^= (ul->u[i * 4 + 0] << 24) |
-        (ul->u[i * 4 + 1] << 16) |
-        (ul->u[i * 4 + 2] << 8) | (ul->u[i * 4 + 3] << 0);
+  /* FNV-1a, a plain XOR of the words puts ULs that only differ in the
+   * same bits of different words into the same bucket */
+  for (i = 0; i < 16; i++) {
+    /* registry version, ignored by mxf_ul_is_equal() too */
+    if (i == 7)
+      continue;
+
+    ret = (ret ^ ul->u[i]) * 16777619U;
+  }
 
   return ret;
 }
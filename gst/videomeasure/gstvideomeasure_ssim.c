@@ -62,6 +62,8 @@
 #define GST_CAT_DEFAULT gst_ssim_debug
 GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
 
+#define DEFAULT_N_THREADS 1
+
 /* elementfactory information */
 
 #define SINK_CAPS \
@@ -197,12 +199,15 @@ gst_ssim_sink_getcaps (GstPad * pad)
   return result;
 }
 
+/* The Gaussian weighted functions below only work on the lines @y_start to
+ * @y_end, so that they can be run on bands of the frame concurrently */
 static void
-calculate_mu (GstSSim * ssim, gfloat * outmu, guint8 * buf)
+calculate_mu (GstSSim * ssim, gfloat * outmu, guint8 * buf, gint y_start,
+    gint y_end)
 {
   gint oy, ox, iy, ix;
 
-  for (oy = 0; oy < ssim->height; oy++) {
+  for (oy = y_start; oy < y_end; oy++) {
     for (ox = 0; ox < ssim->width; ox++) {
       gfloat mu = 0;
       gfloat elsumm;
@@ -228,32 +233,19 @@ calculate_mu (GstSSim * ssim, gfloat * outmu, guint8 * buf)
       winend_y = ssim->windows[source_offset].y_window_end;
       elsumm = ssim->windows[source_offset].element_summ;
 
-      switch (ssim->windowtype) {
-        case 0:
-          for (iy = winstart_y; iy <= winend_y; iy++) {
-            pixel_offset = iy * ssim->width;
-            for (ix = winstart_x; ix <= winend_x; ix++)
-              mu += buf[pixel_offset + ix];
-          }
-          mu = mu / elsumm;
-          break;
-        case 1:
-
-          weight_y_base = wghstart_y - winstart_y;
-          weight_x_base = wghstart_x - winstart_x;
-
-          for (iy = winstart_y; iy <= winend_y; iy++) {
-            pixel_offset = iy * ssim->width;
-            weight_offset = (weight_y_base + iy) * ssim->windowsize +
-                weight_x_base;
-            for (ix = winstart_x; ix <= winend_x; ix++) {
-              weight = ssim->weights[weight_offset + ix];
-              mu += weight * buf[pixel_offset + ix];
-            }
-          }
-          mu = mu / elsumm;
-          break;
+      weight_y_base = wghstart_y - winstart_y;
+      weight_x_base = wghstart_x - winstart_x;
+
+      for (iy = winstart_y; iy <= winend_y; iy++) {
+        pixel_offset = iy * ssim->width;
+        weight_offset = (weight_y_base + iy) * ssim->windowsize +
+            weight_x_base;
+        for (ix = winstart_x; ix <= winend_x; ix++) {
+          weight = ssim->weights[weight_offset + ix];
+          mu += weight * buf[pixel_offset + ix];
+        }
       }
+      mu = mu / elsumm;
       outmu[oy * ssim->width + ox] = mu;
     }
   }
@@ -262,14 +254,12 @@ calculate_mu (GstSSim * ssim, gfloat * outmu, guint8 * buf)
 
 static void
 calcssim_without_mu (GstSSim * ssim, guint8 * org, gfloat * orgmu, guint8 * mod,
-    guint8 * out, gfloat * mean, gfloat * lowest, gfloat * highest)
+    guint8 * out, gint y_start, gint y_end, gdouble * summ, gfloat * lowest,
+    gfloat * highest)
 {
   gint oy, ox, iy, ix;
-  gfloat cumulative_ssim = 0;
-  *lowest = G_MAXFLOAT;
-  *highest = -G_MAXFLOAT;
 
-  for (oy = 0; oy < ssim->height; oy++) {
+  for (oy = y_start; oy < y_end; oy++) {
     for (ox = 0; ox < ssim->width; ox++) {
       gfloat mu_o = 128, mu_m = 128;
       gdouble sigma_o = 0, sigma_m = 0, sigma_om = 0;
@@ -299,49 +289,27 @@ calcssim_without_mu (GstSSim * ssim, guint8 * org, gfloat * orgmu, guint8 * mod,
 
       weight_y_base = wghstart_y - winstart_y;
       weight_x_base = wghstart_x - winstart_x;
-      switch (ssim->windowtype) {
-        case 0:
-          for (iy = winstart_y; iy <= winend_y; iy++) {
-            guint8 *org_with_offset, *mod_with_offset;
-            pixel_offset = iy * ssim->width;
-            org_with_offset = &org[pixel_offset];
-            mod_with_offset = &mod[pixel_offset];
-            for (ix = winstart_x; ix <= winend_x; ix++) {
-              tmp1 = org_with_offset[ix] - mu_o;
-              sigma_o += tmp1 * tmp1;
-              tmp2 = mod_with_offset[ix] - mu_m;
-              sigma_m += tmp2 * tmp2;
-              sigma_om += tmp1 * tmp2;
-            }
-          }
-          break;
-        case 1:
-
-          weight_y_base = wghstart_y - winstart_y;
-          weight_x_base = wghstart_x - winstart_x;
-
-          for (iy = winstart_y; iy <= winend_y; iy++) {
-            guint8 *org_with_offset, *mod_with_offset;
-            gfloat *weights_with_offset;
-            gfloat wt1, wt2;
-            pixel_offset = iy * ssim->width;
-            weight_offset = (weight_y_base + iy) * ssim->windowsize +
-                weight_x_base;
-            org_with_offset = &org[pixel_offset];
-            mod_with_offset = &mod[pixel_offset];
-            weights_with_offset = &ssim->weights[weight_offset];
-            for (ix = winstart_x; ix <= winend_x; ix++) {
-              weight = weights_with_offset[ix];
-              tmp1 = org_with_offset[ix] - mu_o;
-              tmp2 = mod_with_offset[ix] - mu_m;
-              wt1 = weight * tmp1;
-              wt2 = weight * tmp2;
-              sigma_o += wt1 * tmp1;
-              sigma_m += wt2 * tmp2;
-              sigma_om += wt1 * tmp2;
-            }
-          }
-          break;
+
+      for (iy = winstart_y; iy <= winend_y; iy++) {
+        guint8 *org_with_offset, *mod_with_offset;
+        gfloat *weights_with_offset;
+        gfloat wt1, wt2;
+        pixel_offset = iy * ssim->width;
+        weight_offset = (weight_y_base + iy) * ssim->windowsize +
+            weight_x_base;
+        org_with_offset = &org[pixel_offset];
+        mod_with_offset = &mod[pixel_offset];
+        weights_with_offset = &ssim->weights[weight_offset];
+        for (ix = winstart_x; ix <= winend_x; ix++) {
+          weight = weights_with_offset[ix];
+          tmp1 = org_with_offset[ix] - mu_o;
+          tmp2 = mod_with_offset[ix] - mu_m;
+          wt1 = weight * tmp1;
+          wt2 = weight * tmp2;
+          sigma_o += wt1 * tmp1;
+          sigma_m += wt2 * tmp2;
+          sigma_om += wt1 * tmp2;
+        }
       }
       sigma_o = sqrt (sigma_o / elsumm);
       sigma_m = sqrt (sigma_m / elsumm);
@@ -355,22 +323,19 @@ calcssim_without_mu (GstSSim * ssim, guint8 * org, gfloat * orgmu, guint8 * mod,
       out[oy * ssim->width + ox] = 127 + tmp1 * 128;
       *lowest = MIN (*lowest, tmp1);
       *highest = MAX (*highest, tmp1);
-      cumulative_ssim += tmp1;
+      *summ += tmp1;
     }
   }
-  *mean = cumulative_ssim / (ssim->width * ssim->height);
 }
 
 static void
 calcssim_canonical (GstSSim * ssim, guint8 * org, gfloat * orgmu, guint8 * mod,
-    guint8 * out, gfloat * mean, gfloat * lowest, gfloat * highest)
+    guint8 * out, gint y_start, gint y_end, gdouble * summ, gfloat * lowest,
+    gfloat * highest)
 {
   gint oy, ox, iy, ix;
-  gfloat cumulative_ssim = 0;
-  *lowest = G_MAXFLOAT;
-  *highest = -G_MAXFLOAT;
 
-  for (oy = 0; oy < ssim->height; oy++) {
+  for (oy = y_start; oy < y_end; oy++) {
     for (ox = 0; ox < ssim->width; ox++) {
       gfloat mu_o = 0, mu_m = 0;
       gdouble sigma_o = 0, sigma_m = 0, sigma_om = 0;
@@ -398,66 +363,41 @@ calcssim_canonical (GstSSim * ssim, guint8 * org, gfloat * orgmu, guint8 * mod,
       winend_y = ssim->windows[source_offset].y_window_end;
       elsumm = ssim->windows[source_offset].element_summ;
 
-      switch (ssim->windowtype) {
-        case 0:
-          for (iy = winstart_y; iy <= winend_y; iy++) {
-            pixel_offset = iy * ssim->width;
-            for (ix = winstart_x; ix <= winend_x; ix++) {
-              mu_m += mod[pixel_offset + ix];
-            }
-          }
-          mu_m = mu_m / elsumm;
-          mu_o = orgmu[oy * ssim->width + ox];
-          for (iy = winstart_y; iy <= winend_y; iy++) {
-            pixel_offset = iy * ssim->width;
-            for (ix = winstart_x; ix <= winend_x; ix++) {
-              tmp1 = org[pixel_offset + ix] - mu_o;
-              tmp2 = mod[pixel_offset + ix] - mu_m;
-              sigma_o += tmp1 * tmp1;
-              sigma_m += tmp2 * tmp2;
-              sigma_om += tmp1 * tmp2;
-            }
-          }
-          break;
-        case 1:
-
-          weight_y_base = wghstart_y - winstart_y;
-          weight_x_base = wghstart_x - winstart_x;
-
-          for (iy = winstart_y; iy <= winend_y; iy++) {
-            pixel_offset = iy * ssim->width;
-            weight_offset = (weight_y_base + iy) * ssim->windowsize +
-                weight_x_base;
-            for (ix = winstart_x; ix <= winend_x; ix++) {
-              weight = ssim->weights[weight_offset + ix];
-              mu_o += weight * org[pixel_offset + ix];
-              mu_m += weight * mod[pixel_offset + ix];
-            }
-          }
-          mu_m = mu_m / elsumm;
-          mu_o = orgmu[oy * ssim->width + ox];
-          for (iy = winstart_y; iy <= winend_y; iy++) {
-            gfloat *weights_with_offset;
-            guint8 *org_with_offset, *mod_with_offset;
-            gfloat wt1, wt2;
-            pixel_offset = iy * ssim->width;
-            weight_offset = (weight_y_base + iy) * ssim->windowsize +
-                weight_x_base;
-            weights_with_offset = &ssim->weights[weight_offset];
-            org_with_offset = &org[pixel_offset];
-            mod_with_offset = &mod[pixel_offset];
-            for (ix = winstart_x; ix <= winend_x; ix++) {
-              weight = weights_with_offset[ix];
-              tmp1 = org_with_offset[ix] - mu_o;
-              tmp2 = mod_with_offset[ix] - mu_m;
-              wt1 = weight * tmp1;
-              wt2 = weight * tmp2;
-              sigma_o += wt1 * tmp1;
-              sigma_m += wt2 * tmp2;
-              sigma_om += wt1 * tmp2;
-            }
-          }
-          break;
+      weight_y_base = wghstart_y - winstart_y;
+      weight_x_base = wghstart_x - winstart_x;
+
+      /* mu of the original is calculated once for all modified streams */
+      for (iy = winstart_y; iy <= winend_y; iy++) {
+        pixel_offset = iy * ssim->width;
+        weight_offset = (weight_y_base + iy) * ssim->windowsize +
+            weight_x_base;
+        for (ix = winstart_x; ix <= winend_x; ix++) {
+          weight = ssim->weights[weight_offset + ix];
+          mu_m += weight * mod[pixel_offset + ix];
+        }
+      }
+      mu_m = mu_m / elsumm;
+      mu_o = orgmu[oy * ssim->width + ox];
+      for (iy = winstart_y; iy <= winend_y; iy++) {
+        gfloat *weights_with_offset;
+        guint8 *org_with_offset, *mod_with_offset;
+        gfloat wt1, wt2;
+        pixel_offset = iy * ssim->width;
+        weight_offset = (weight_y_base + iy) * ssim->windowsize +
+            weight_x_base;
+        weights_with_offset = &ssim->weights[weight_offset];
+        org_with_offset = &org[pixel_offset];
+        mod_with_offset = &mod[pixel_offset];
+        for (ix = winstart_x; ix <= winend_x; ix++) {
+          weight = weights_with_offset[ix];
+          tmp1 = org_with_offset[ix] - mu_o;
+          tmp2 = mod_with_offset[ix] - mu_m;
+          wt1 = weight * tmp1;
+          wt2 = weight * tmp2;
+          sigma_o += wt1 * tmp1;
+          sigma_m += wt2 * tmp2;
+          sigma_om += wt1 * tmp2;
+        }
       }
       sigma_o = sqrt (sigma_o / elsumm);
       sigma_m = sqrt (sigma_m / elsumm);
@@ -471,10 +411,329 @@ calcssim_canonical (GstSSim * ssim, guint8 * org, gfloat * orgmu, guint8 * mod,
       out[oy * ssim->width + ox] = 127 + tmp1 * 128;
       *lowest = MIN (*lowest, tmp1);
       *highest = MAX (*highest, tmp1);
-      cumulative_ssim += tmp1;
+      *summ += tmp1;
     }
   }
-  *mean = cumulative_ssim / (ssim->width * ssim->height);
+}
+
+/* Without weighting, the sums over a window don't need to be recalculated
+ * for every pixel: per column sums over the lines of the window are updated
+ * once per line, and the window sums are updated from those once per pixel
+ * while sliding the window along the line.  The sums are exact integers,
+ * they fit in 32 bits for the largest window of 22x22 */
+static void
+calcssim_box_add_line (guint32 * cols, gint width, const guint8 * org,
+    const guint8 * mod)
+{
+  guint32 *col_o = cols, *col_m = cols + width, *col_oo = cols + 2 * width;
+  guint32 *col_mm = cols + 3 * width, *col_om = cols + 4 * width;
+  gint i;
+
+  for (i = 0; i < width; i++) {
+    col_o[i] += org[i];
+    col_m[i] += mod[i];
+    col_oo[i] += org[i] * org[i];
+    col_mm[i] += mod[i] * mod[i];
+    col_om[i] += org[i] * mod[i];
+  }
+}
+
+static void
+calcssim_box_remove_line (guint32 * cols, gint width, const guint8 * org,
+    const guint8 * mod)
+{
+  guint32 *col_o = cols, *col_m = cols + width, *col_oo = cols + 2 * width;
+  guint32 *col_mm = cols + 3 * width, *col_om = cols + 4 * width;
+  gint i;
+
+  for (i = 0; i < width; i++) {
+    col_o[i] -= org[i];
+    col_m[i] -= mod[i];
+    col_oo[i] -= org[i] * org[i];
+    col_mm[i] -= mod[i] * mod[i];
+    col_om[i] -= org[i] * mod[i];
+  }
+}
+
+static inline void
+calcssim_box (GstSSim * ssim, guint8 * org, guint8 * mod, guint8 * out,
+    gint y_start, gint y_end, gboolean canonical, gdouble * summ,
+    gfloat * lowest, gfloat * highest)
+{
+  gint width = ssim->width, height = ssim->height;
+  /* the window spans the pixels from x - before to x + after */
+  gint before = ssim->windowsize / 2 - (ssim->windowsize % 2 == 0);
+  gint after = ssim->windowsize / 2;
+  guint32 *cols, *col_o, *col_m, *col_oo, *col_mm, *col_om;
+  gint ox, oy, x0, x1, y0, y1;
+
+  cols = g_new0 (guint32, 5 * width);
+  col_o = cols;
+  col_m = cols + width;
+  col_oo = cols + 2 * width;
+  col_mm = cols + 3 * width;
+  col_om = cols + 4 * width;
+
+  y0 = MAX (y_start - before, 0);
+  y1 = MIN (y_start + after, height - 1);
+  for (oy = y0; oy <= y1; oy++)
+    calcssim_box_add_line (cols, width, &org[oy * width], &mod[oy * width]);
+
+  for (oy = y_start; oy < y_end; oy++) {
+    guint32 s_o = 0, s_m = 0, s_oo = 0, s_mm = 0, s_om = 0;
+
+    if (oy > y_start) {
+      if (oy - before > y0) {
+        calcssim_box_remove_line (cols, width, &org[y0 * width],
+            &mod[y0 * width]);
+        y0++;
+      }
+      if (oy + after < height) {
+        y1++;
+        calcssim_box_add_line (cols, width, &org[y1 * width],
+            &mod[y1 * width]);
+      }
+    }
+
+    x0 = 0;
+    x1 = MIN (after, width - 1);
+    for (ox = x0; ox <= x1; ox++) {
+      s_o += col_o[ox];
+      s_m += col_m[ox];
+      s_oo += col_oo[ox];
+      s_mm += col_mm[ox];
+      s_om += col_om[ox];
+    }
+
+    for (ox = 0; ox < width; ox++) {
+      gdouble n, mu_o, mu_m, sigma_o, sigma_m, sigma_om;
+      gfloat index;
+
+      if (ox > 0) {
+        if (ox - before > x0) {
+          s_o -= col_o[x0];
+          s_m -= col_m[x0];
+          s_oo -= col_oo[x0];
+          s_mm -= col_mm[x0];
+          s_om -= col_om[x0];
+          x0++;
+        }
+        if (ox + after < width) {
+          x1++;
+          s_o += col_o[x1];
+          s_m += col_m[x1];
+          s_oo += col_oo[x1];
+          s_mm += col_mm[x1];
+          s_om += col_om[x1];
+        }
+      }
+
+      /* variances and covariance around mu, as sum (x - mu)^2 / n would */
+      n = (x1 - x0 + 1) * (y1 - y0 + 1);
+      if (canonical) {
+        mu_o = s_o / n;
+        mu_m = s_m / n;
+      } else {
+        mu_o = mu_m = 128;
+      }
+      sigma_o = s_oo / n - 2 * mu_o * s_o / n + mu_o * mu_o;
+      sigma_m = s_mm / n - 2 * mu_m * s_m / n + mu_m * mu_m;
+      sigma_om = s_om / n - mu_o * s_m / n - mu_m * s_o / n + mu_o * mu_m;
+
+      index = (2 * mu_o * mu_m + ssim->const1) * (2 * sigma_om + ssim->const2) /
+          ((mu_o * mu_o + mu_m * mu_m + ssim->const1) *
+          (sigma_o + sigma_m + ssim->const2));
+
+      out[oy * width + ox] = 127 + index * 128;
+      *lowest = MIN (*lowest, index);
+      *highest = MAX (*highest, index);
+      *summ += index;
+    }
+  }
+
+  g_free (cols);
+}
+
+static void
+calcssim_box_without_mu (GstSSim * ssim, guint8 * org, gfloat * orgmu,
+    guint8 * mod, guint8 * out, gint y_start, gint y_end, gdouble * summ,
+    gfloat * lowest, gfloat * highest)
+{
+  calcssim_box (ssim, org, mod, out, y_start, y_end, FALSE, summ, lowest,
+      highest);
+}
+
+static void
+calcssim_box_canonical (GstSSim * ssim, guint8 * org, gfloat * orgmu,
+    guint8 * mod, guint8 * out, gint y_start, gint y_end, gdouble * summ,
+    gfloat * lowest, gfloat * highest)
+{
+  calcssim_box (ssim, org, mod, out, y_start, y_end, TRUE, summ, lowest,
+      highest);
+}
+
+/* Bands of output lines are measured concurrently, each keeping its own
+ * sum and extremes until all are done */
+
+typedef struct
+{
+  GstSSimThreads *threads;
+
+  gint y_start;
+  gint y_end;
+
+  gdouble summ;
+  gfloat lowest;
+  gfloat highest;
+} GstSSimBand;
+
+struct _GstSSimThreads
+{
+  gint n_threads;
+  GstSSimBand *bands;
+
+  GThreadPool *pool;
+  GMutex *lock;
+  GCond *cond;
+  gint n_pending;
+
+  /* the frames the bands work on, without @mod only mu of @org is
+   * calculated */
+  GstSSim *ssim;
+  guint8 *org;
+  gfloat *orgmu;
+  guint8 *mod;
+  guint8 *out;
+};
+
+static void
+gst_ssim_band_measure (GstSSim * ssim, GstSSimBand * band, guint8 * org,
+    gfloat * orgmu, guint8 * mod, guint8 * out)
+{
+  band->summ = 0;
+  band->lowest = G_MAXFLOAT;
+  band->highest = -G_MAXFLOAT;
+
+  if (mod == NULL)
+    calculate_mu (ssim, orgmu, org, band->y_start, band->y_end);
+  else
+    ssim->func (ssim, org, orgmu, mod, out, band->y_start, band->y_end,
+        &band->summ, &band->lowest, &band->highest);
+}
+
+static void
+gst_ssim_band_func (gpointer data, gpointer user_data)
+{
+  GstSSimBand *band = data;
+  GstSSimThreads *threads = band->threads;
+
+  gst_ssim_band_measure (threads->ssim, band, threads->org, threads->orgmu,
+      threads->mod, threads->out);
+
+  if (band != &threads->bands[0]) {
+    g_mutex_lock (threads->lock);
+    if (--threads->n_pending == 0)
+      g_cond_signal (threads->cond);
+    g_mutex_unlock (threads->lock);
+  }
+}
+
+static void
+gst_ssim_threads_free (GstSSimThreads * threads)
+{
+  if (threads->pool)
+    g_thread_pool_free (threads->pool, FALSE, TRUE);
+  if (threads->lock)
+    g_mutex_free (threads->lock);
+  if (threads->cond)
+    g_cond_free (threads->cond);
+
+  g_free (threads->bands);
+  g_free (threads);
+}
+
+static GstSSimThreads *
+gst_ssim_threads_new (gint n_threads)
+{
+  GstSSimThreads *threads;
+  gint i;
+
+  threads = g_new0 (GstSSimThreads, 1);
+  threads->n_threads = n_threads;
+  threads->bands = g_new0 (GstSSimBand, n_threads);
+  for (i = 0; i < n_threads; i++)
+    threads->bands[i].threads = threads;
+
+  threads->pool = g_thread_pool_new (gst_ssim_band_func, NULL,
+      n_threads - 1, TRUE, NULL);
+  if (threads->pool == NULL) {
+    gst_ssim_threads_free (threads);
+    return NULL;
+  }
+  threads->lock = g_mutex_new ();
+  threads->cond = g_cond_new ();
+
+  return threads;
+}
+
+/* calculates mu of @org into @orgmu if @mod is NULL, the SSIM of @mod
+ * against @org otherwise */
+static void
+gst_ssim_measure (GstSSim * ssim, guint8 * org, gfloat * orgmu, guint8 * mod,
+    guint8 * out, gfloat * mean, gfloat * lowest, gfloat * highest)
+{
+  GstSSimThreads *threads = ssim->threads;
+  GstSSimBand single, *bands;
+  gint band_height, n_bands, y, i;
+  gdouble summ = 0;
+
+  if (threads == NULL) {
+    single.y_start = 0;
+    single.y_end = ssim->height;
+    gst_ssim_band_measure (ssim, &single, org, orgmu, mod, out);
+    bands = &single;
+    n_bands = 1;
+  } else {
+    threads->ssim = ssim;
+    threads->org = org;
+    threads->orgmu = orgmu;
+    threads->mod = mod;
+    threads->out = out;
+
+    band_height = (ssim->height + threads->n_threads - 1) /
+        threads->n_threads;
+    n_bands = 0;
+    for (y = 0; y < ssim->height; y += band_height) {
+      threads->bands[n_bands].y_start = y;
+      threads->bands[n_bands].y_end = MIN (y + band_height, ssim->height);
+      n_bands++;
+    }
+
+    threads->n_pending = n_bands - 1;
+    for (i = 1; i < n_bands; i++)
+      g_thread_pool_push (threads->pool, &threads->bands[i], NULL);
+
+    gst_ssim_band_func (&threads->bands[0], NULL);
+
+    g_mutex_lock (threads->lock);
+    while (threads->n_pending > 0)
+      g_cond_wait (threads->cond, threads->lock);
+    g_mutex_unlock (threads->lock);
+
+    bands = threads->bands;
+  }
+
+  if (mod == NULL)
+    return;
+
+  *lowest = G_MAXFLOAT;
+  *highest = -G_MAXFLOAT;
+  for (i = 0; i < n_bands; i++) {
+    summ += bands[i].summ;
+    *lowest = MIN (*lowest, bands[i].lowest);
+    *highest = MAX (*highest, bands[i].highest);
+  }
+  *mean = summ / (ssim->width * ssim->height);
 }
 
 
@@ -1001,6 +1260,16 @@ gst_ssim_sink_event (GstPad * pad, GstEvent * event)
   return ret;
 }
 
+static void
+gst_ssim_clear_windows (GstSSim * ssim)
+{
+  g_free (ssim->windows);
+  ssim->windows = NULL;
+
+  g_free (ssim->weights);
+  ssim->weights = NULL;
+}
+
 static void
 gst_ssim_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
@@ -1015,18 +1284,18 @@ gst_ssim_set_property (GObject * object, guint prop_id,
       break;
     case PROP_WINDOW_TYPE:
       ssim->windowtype = g_value_get_int (value);
-      g_free (ssim->windows);
-      ssim->windows = NULL;
+      gst_ssim_clear_windows (ssim);
       break;
     case PROP_WINDOW_SIZE:
       ssim->windowsize = g_value_get_int (value);
-      g_free (ssim->windows);
-      ssim->windows = NULL;
+      gst_ssim_clear_windows (ssim);
       break;
     case PROP_GAUSS_SIGMA:
       ssim->sigma = g_value_get_float (value);
-      g_free (ssim->windows);
-      ssim->windows = NULL;
+      gst_ssim_clear_windows (ssim);
+      break;
+    case PROP_N_THREADS:
+      ssim->n_threads = g_value_get_uint (value);
       break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -1055,6 +1324,9 @@ gst_ssim_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_GAUSS_SIGMA:
       g_value_set_float (value, ssim->sigma);
       break;
+    case PROP_N_THREADS:
+      g_value_set_uint (value, ssim->n_threads);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1095,6 +1367,12 @@ gst_ssim_class_init (GstSSimClass * klass)
           "(only when using Gaussian window).",
           G_MINFLOAT, 10, 1.5, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (G_OBJECT_CLASS (klass), PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Threads",
+          "Number of bands of the frames measured concurrently",
+          1, 64, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_static_pad_template (gstelement_class,
       &gst_ssim_src_template);
   gst_element_class_add_static_pad_template (gstelement_class,
@@ -1261,6 +1539,8 @@ gst_ssim_init (GstSSim * ssim)
   ssim->windows = NULL;
   ssim->sigma = 1.5;
   ssim->ssimtype = 0;
+  ssim->n_threads = DEFAULT_N_THREADS;
+  ssim->threads = NULL;
   ssim->src = g_ptr_array_new ();
   ssim->padcount = 0;
   ssim->collect_event = NULL;
@@ -1280,11 +1560,11 @@ gst_ssim_finalize (GObject * object)
   gst_object_unref (ssim->collect);
   ssim->collect = NULL;
 
-  g_free (ssim->windows);
-  ssim->windows = NULL;
+  gst_ssim_clear_windows (ssim);
 
-  g_free (ssim->weights);
-  ssim->weights = NULL;
+  if (ssim->threads)
+    gst_ssim_threads_free (ssim->threads);
+  ssim->threads = NULL;
 
   if (ssim->sinkcaps)
     gst_caps_unref (ssim->sinkcaps);
@@ -1328,8 +1608,7 @@ gst_ssim_regenerate_windows (GstSSim * ssim)
   windowiseven = ((gint) ssim->windowsize / 2) * 2 == ssim->windowsize ? 1 : 0;
 
   g_free (ssim->windows);
-
-  ssim->windows = g_new (GstSSimWindowCache, ssim->height * ssim->width);
+  ssim->windows = NULL;
 
   switch (ssim->windowtype) {
     case 0:
@@ -1355,6 +1634,18 @@ gst_ssim_regenerate_windows (GstSSim * ssim)
     }
   }
 
+  /* FIXME: while 0.01 and 0.03 are pretty much static, the 255 implies that
+   * we're working with 8-bit-per-color-component format, which may not be true
+   */
+  ssim->const1 = 0.01 * 255 * 0.01 * 255;
+  ssim->const2 = 0.03 * 255 * 0.03 * 255;
+
+  /* without weighting the windows are slid over the frame */
+  if (ssim->windowtype == 0)
+    return TRUE;
+
+  ssim->windows = g_new (GstSSimWindowCache, ssim->height * ssim->width);
+
   for (y = 0; y < ssim->height; y++) {
     for (x = 0; x < ssim->width; x++) {
       GstSSimWindowCache win;
@@ -1388,8 +1679,10 @@ gst_ssim_regenerate_windows (GstSSim * ssim)
       if (element_count == normal_count)
         win.element_summ = normal_summ;
       else {
-        for (y2 = win.y_weight_start; y2 < ssim->windowsize; y2++) {
-          for (x2 = win.x_weight_start; x2 < ssim->windowsize; x2++) {
+        for (y2 = win.y_weight_start; y2 <= win.y_weight_start +
+            win.y_window_end - win.y_window_start; y2++) {
+          for (x2 = win.x_weight_start; x2 <= win.x_weight_start +
+              win.x_window_end - win.x_window_start; x2++) {
             win.element_summ += ssim->weights[y2 * ssim->windowsize + x2];
           }
         }
@@ -1398,11 +1691,6 @@ gst_ssim_regenerate_windows (GstSSim * ssim)
     }
   }
 
-  /* FIXME: while 0.01 and 0.03 are pretty much static, the 255 implies that
-   * we're working with 8-bit-per-color-component format, which may not be true
-   */
-  ssim->const1 = 0.01 * 255 * 0.01 * 255;
-  ssim->const2 = 0.03 * 255 * 0.03 * 255;
   return TRUE;
 }
 
@@ -1423,22 +1711,38 @@ gst_ssim_collected (GstCollectPads * pads, gpointer user_data)
 
   ssim = GST_SSIM (user_data);
 
-  if (G_UNLIKELY (ssim->windows == NULL)) {
+  if (G_UNLIKELY (ssim->weights == NULL)) {
     GST_DEBUG_OBJECT (ssim, "Regenerating windows");
     gst_ssim_regenerate_windows (ssim);
   }
 
   switch (ssim->ssimtype) {
     case 0:
-      ssim->func = (GstSSimFunction) calcssim_canonical;
+      if (ssim->windowtype == 0)
+        ssim->func = (GstSSimFunction) calcssim_box_canonical;
+      else
+        ssim->func = (GstSSimFunction) calcssim_canonical;
       break;
     case 1:
-      ssim->func = (GstSSimFunction) calcssim_without_mu;
+      if (ssim->windowtype == 0)
+        ssim->func = (GstSSimFunction) calcssim_box_without_mu;
+      else
+        ssim->func = (GstSSimFunction) calcssim_without_mu;
       break;
     default:
       return GST_FLOW_ERROR;
   }
 
+  if (G_UNLIKELY (ssim->threads == NULL ? ssim->n_threads > 1 :
+          ssim->threads->n_threads != ssim->n_threads)) {
+    GST_DEBUG_OBJECT (ssim, "measuring in %u bands", ssim->n_threads);
+    if (ssim->threads)
+      gst_ssim_threads_free (ssim->threads);
+    ssim->threads = NULL;
+    if (ssim->n_threads > 1)
+      ssim->threads = gst_ssim_threads_new (ssim->n_threads);
+  }
+
   for (collected = pads->data; collected; collected = g_slist_next (collected)) {
     GstCollectData *collect_data;
     GstBuffer *inbuf;
@@ -1463,31 +1767,31 @@ gst_ssim_collected (GstCollectPads * pads, gpointer user_data)
   if (G_UNLIKELY (!ready))
     goto eos;
 
-  /* Mu is just a blur, we can calculate it once */
-  if (ssim->ssimtype == 0) {
-    orgmu = g_new (gfloat, ssim->width * ssim->height);
-
-    for (collected = pads->data; collected;
-        collected = g_slist_next (collected)) {
-      GstCollectData *collect_data;
-
-      collect_data = (GstCollectData *) collected->data;
+  for (collected = pads->data; collected; collected = g_slist_next (collected)) {
+    GstCollectData *collect_data;
 
-      if (collect_data->pad == ssim->orig) {
-        orgbuf = gst_collect_pads_pop (pads, collect_data);;
+    collect_data = (GstCollectData *) collected->data;
 
-        GST_DEBUG_OBJECT (ssim, "Original stream - flags(0x%x), timestamp(%"
-            GST_TIME_FORMAT "), duration(%" GST_TIME_FORMAT ")",
-            GST_BUFFER_FLAGS (orgbuf),
-            GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (orgbuf)),
-            GST_TIME_ARGS (GST_BUFFER_DURATION (orgbuf)));
-        calculate_mu (ssim, orgmu, GST_BUFFER_DATA (orgbuf));
+    if (collect_data->pad == ssim->orig) {
+      orgbuf = gst_collect_pads_pop (pads, collect_data);
 
-        break;
-      }
+      GST_DEBUG_OBJECT (ssim, "Original stream - flags(0x%x), timestamp(%"
+          GST_TIME_FORMAT "), duration(%" GST_TIME_FORMAT ")",
+          GST_BUFFER_FLAGS (orgbuf),
+          GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (orgbuf)),
+          GST_TIME_ARGS (GST_BUFFER_DURATION (orgbuf)));
+      break;
     }
   }
 
+  /* Mu is just a blur, we can calculate it once.  Without weighting it comes
+   * for free with the sums over the window */
+  if (ssim->ssimtype == 0 && ssim->windowtype != 0) {
+    orgmu = g_new (gfloat, ssim->width * ssim->height);
+    gst_ssim_measure (ssim, GST_BUFFER_DATA (orgbuf), orgmu, NULL, NULL, NULL,
+        NULL, NULL);
+  }
+
   GST_LOG_OBJECT (ssim, "starting to cycle through streams");
 
   for (collected = pads->data; collected; collected = g_slist_next (collected)) {
@@ -1552,8 +1856,8 @@ gst_ssim_collected (GstCollectPads * pads, gpointer user_data)
 
         GST_LOG_OBJECT (ssim, "channel %p: calculating SSIM", collect_data);
 
-        ssim->func (ssim, GST_BUFFER_DATA (orgbuf), orgmu, indata, outdata,
-            &mssim, &lowest, &highest);
+        gst_ssim_measure (ssim, GST_BUFFER_DATA (orgbuf), orgmu, indata,
+            outdata, &mssim, &lowest, &highest);
 
         GST_DEBUG_OBJECT (GST_OBJECT (ssim), "MSSIM is %f, l-h is %f - %f",
             mssim, lowest, highest);
@@ -1612,8 +1916,7 @@ gst_ssim_collected (GstCollectPads * pads, gpointer user_data)
   }
   gst_buffer_unref (orgbuf);
 
-  if (ssim->ssimtype == 0)
-    g_free (orgmu);
+  g_free (orgmu);
 
   ssim->segment_position = 0;
 
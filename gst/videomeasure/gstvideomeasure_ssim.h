@@ -33,6 +33,7 @@ enum
   PROP_WINDOW_TYPE,
   PROP_WINDOW_SIZE,
   PROP_GAUSS_SIGMA,
+  PROP_N_THREADS,
 };
 
 
@@ -61,8 +62,11 @@ typedef struct _GstSSimWindowCache {
   gfloat element_summ;
 } GstSSimWindowCache;
 
+typedef struct _GstSSimThreads     GstSSimThreads;
+
 typedef void (*GstSSimFunction) (GstSSim *ssim, guint8 *org, gfloat *orgmu,
-    guint8 *mod, guint8 *out, gfloat *mean, gfloat *lowest, gfloat *highest);
+    guint8 *mod, guint8 *out, gint y_start, gint y_end, gdouble *summ,
+    gfloat *lowest, gfloat *highest);
 
 typedef struct _GstSSimOutputContext GstSSimOutputContext;
 
@@ -104,7 +108,8 @@ struct _GstSSim {
   /* Type of a weight-generator. 0 - no weighting. 1 - Gaussian weighting */
   gint            windowtype;
 
-  /* Array of width*height GstSSimWindowCaches */
+  /* Array of width*height GstSSimWindowCaches, only for Gaussian
+   * weighting */
   GstSSimWindowCache *windows;
 
   /* Array of windowsize*windowsize gfloats */
@@ -115,6 +120,10 @@ struct _GstSSim {
   
   GstSSimFunction func;
 
+  /* Number of bands of the frame measured concurrently */
+  guint           n_threads;
+  GstSSimThreads *threads;
+
   gfloat         const1;
   gfloat         const2;
 
@@ -258,6 +258,7 @@ gst_h264_parse_stop (GstBaseParse * parse)
     gst_buffer_replace (&h264parse->sps_nals[i], NULL);
   for (i = 0; i < GST_H264_MAX_PPS_COUNT; i++)
     gst_buffer_replace (&h264parse->pps_nals[i], NULL);
+  h264parse->sps_changes = 0;
 
   gst_h264_nal_parser_free (h264parse->nalparser);
 
@@ -433,6 +434,47 @@ gst_h264_parser_store_nal (GstH264Parse * h264parse, guint id,
     gst_buffer_unref (store[id]);
 
   store[id] = buf;
+
+  if (naltype == GST_H264_NAL_PPS)
+    h264parse->pps_sps_changes[id] = h264parse->sps_changes;
+}
+
+/* TRUE if @nalu is byte for byte the SPS or PPS already stored for its id,
+ * in which case parsing it again would not change anything.  Parameter sets
+ * are typically repeated with every keyframe, so this spares re-parsing
+ * (and renegotiating) them for most of the stream */
+static gboolean
+gst_h264_parser_nal_is_stored (GstH264Parse * h264parse,
+    GstH264NalUnitType naltype, GstH264NalUnit * nalu)
+{
+  GstH264NalParser *nalparser = h264parse->nalparser;
+  GstBuffer **store;
+  guint i, store_size;
+
+  if (naltype == GST_H264_NAL_SPS) {
+    store_size = GST_H264_MAX_SPS_COUNT;
+    store = h264parse->sps_nals;
+  } else {
+    store_size = GST_H264_MAX_PPS_COUNT;
+    store = h264parse->pps_nals;
+  }
+
+  for (i = 0; i < store_size; i++) {
+    if (store[i] == NULL || GST_BUFFER_SIZE (store[i]) != nalu->size ||
+        memcmp (GST_BUFFER_DATA (store[i]), nalu->data + nalu->offset,
+            nalu->size) != 0)
+      continue;
+
+    if (naltype == GST_H264_NAL_SPS)
+      return gst_h264_parser_set_last_sps (nalparser, i);
+
+    /* a PPS is parsed against its SPS, which may have changed since */
+    if (h264parse->pps_sps_changes[i] != h264parse->sps_changes)
+      return FALSE;
+    return gst_h264_parser_set_last_pps (nalparser, i);
+  }
+
+  return FALSE;
 }
 
 /* SPS/PPS/IDR considered key, all others DELTA;
@@ -464,47 +506,62 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
 
   switch (nal_type) {
     case GST_H264_NAL_SPS:
+      /* found in stream, no need to forcibly push at start */
+      h264parse->push_codec = FALSE;
+      if (gst_h264_parser_nal_is_stored (h264parse, nal_type, nalu)) {
+        GST_LOG_OBJECT (h264parse, "sps unchanged");
+        break;
+      }
+
       gst_h264_parser_parse_sps (nalparser, nalu, &sps, TRUE);
+      h264parse->sps_changes++;
 
       GST_DEBUG_OBJECT (h264parse, "triggering src caps check");
       h264parse->update_caps = TRUE;
-      /* found in stream, no need to forcibly push at start */
-      h264parse->push_codec = FALSE;
 
       gst_h264_parser_store_nal (h264parse, sps.id, nal_type, nalu);
       break;
     case GST_H264_NAL_PPS:
+      h264parse->push_codec = FALSE;
+      if (gst_h264_parser_nal_is_stored (h264parse, nal_type, nalu)) {
+        GST_LOG_OBJECT (h264parse, "pps unchanged");
+        break;
+      }
+
       gst_h264_parser_parse_pps (nalparser, nalu, &pps);
       /* parameters might have changed, force caps check */
       GST_DEBUG_OBJECT (h264parse, "triggering src caps check");
       h264parse->update_caps = TRUE;
-      /* found in stream, no need to forcibly push at start */
-      h264parse->push_codec = FALSE;
 
       gst_h264_parser_store_nal (h264parse, pps.id, nal_type, nalu);
       break;
     case GST_H264_NAL_SEI:
-      gst_h264_parser_parse_sei (nalparser, nalu, &sei);
-      switch (sei.payloadType) {
-        case GST_H264_SEI_PIC_TIMING:
-          h264parse->sei_pic_struct_pres_flag =
-              sei.pic_timing.pic_struct_present_flag;
-          h264parse->sei_cpb_removal_delay = sei.pic_timing.cpb_removal_delay;
-          if (h264parse->sei_pic_struct_pres_flag)
-            h264parse->sei_pic_struct = sei.pic_timing.pic_struct;
-          break;
-        case GST_H264_SEI_BUF_PERIOD:
-          if (h264parse->ts_trn_nb == GST_CLOCK_TIME_NONE ||
-              h264parse->dts == GST_CLOCK_TIME_NONE)
-            h264parse->ts_trn_nb = 0;
-          else
-            h264parse->ts_trn_nb = h264parse->dts;
-
-          GST_LOG_OBJECT (h264parse,
-              "new buffering period; ts_trn_nb updated: %" GST_TIME_FORMAT,
-              GST_TIME_ARGS (h264parse->ts_trn_nb));
-          break;
+      /* the timing info is only used to interpolate timestamps */
+      if (h264parse->do_ts) {
+        gst_h264_parser_parse_sei (nalparser, nalu, &sei);
+        switch (sei.payloadType) {
+          case GST_H264_SEI_PIC_TIMING:
+            h264parse->sei_pic_struct_pres_flag =
+                sei.pic_timing.pic_struct_present_flag;
+            h264parse->sei_cpb_removal_delay =
+                sei.pic_timing.cpb_removal_delay;
+            if (h264parse->sei_pic_struct_pres_flag)
+              h264parse->sei_pic_struct = sei.pic_timing.pic_struct;
+            break;
+          case GST_H264_SEI_BUF_PERIOD:
+            if (h264parse->ts_trn_nb == GST_CLOCK_TIME_NONE ||
+                h264parse->dts == GST_CLOCK_TIME_NONE)
+              h264parse->ts_trn_nb = 0;
+            else
+              h264parse->ts_trn_nb = h264parse->dts;
+
+            GST_LOG_OBJECT (h264parse,
+                "new buffering period; ts_trn_nb updated: %" GST_TIME_FORMAT,
+                GST_TIME_ARGS (h264parse->ts_trn_nb));
+            break;
+        }
       }
+
       /* mark SEI pos */
       if (h264parse->sei_pos == -1) {
         if (h264parse->format == GST_H264_PARSE_FORMAT_AVC)
@@ -530,7 +587,10 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
       }
       GST_DEBUG_OBJECT (h264parse, "frame start: %i", h264parse->frame_start);
 #ifndef GST_DISABLE_GST_DEBUG
-      {
+      /* the full slice header (ref pic list modification, weight tables,
+       * ref pic marking) is only of interest for debugging */
+      if (gst_debug_category_get_threshold (GST_CAT_DEFAULT) >=
+          GST_LEVEL_DEBUG) {
         GstH264SliceHdr slice;
         GstH264ParserResult pres;
 
@@ -46,7 +46,10 @@ enum
   PROP_PERMS,
   PROP_SHM_SIZE,
   PROP_WAIT_FOR_CONNECTION,
-  PROP_BUFFER_TIME
+  PROP_BUFFER_TIME,
+  PROP_BUFFERS_ZERO_COPY,
+  PROP_BUFFERS_COPIED,
+  PROP_RING_SIZE
 };
 
 struct GstShmClient
@@ -57,6 +60,7 @@ struct GstShmClient
 
 #define DEFAULT_SIZE ( 256 * 1024 )
 #define DEFAULT_WAIT_FOR_CONNECTION (TRUE)
+#define DEFAULT_RING_SIZE (0)
 /* Default is user read/write, group read */
 #define DEFAULT_PERMS ( S_IRUSR | S_IWUSR | S_IRGRP )
 
@@ -112,6 +116,7 @@ gst_shm_sink_init (GstShmSink * self, GstShmSinkClass * g_class)
   self->size = DEFAULT_SIZE;
   self->wait_for_connection = DEFAULT_WAIT_FOR_CONNECTION;
   self->perms = DEFAULT_PERMS;
+  self->ring_size = DEFAULT_RING_SIZE;
 }
 
 static void
@@ -169,6 +174,28 @@ gst_shm_sink_class_init (GstShmSinkClass * klass)
           0, G_MAXUINT64, GST_CLOCK_TIME_NONE,
           G_PARAM_CONSTRUCT | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_BUFFERS_ZERO_COPY,
+      g_param_spec_uint64 ("buffers-zero-copy",
+          "Buffers sent without copy",
+          "Number of buffers that were allocated from the shared memory area "
+          "and sent without copying them", 0, G_MAXUINT64, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_BUFFERS_COPIED,
+      g_param_spec_uint64 ("buffers-copied",
+          "Buffers copied",
+          "Number of buffers that had to be copied into the shared memory area",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_RING_SIZE,
+      g_param_spec_uint ("ring-size",
+          "Size of the buffer rings",
+          "Number of buffers that can be queued in shared memory for each "
+          "client instead of going through the control socket, rounded up "
+          "to a power of two (0 = disabled, needs sources that support it)",
+          0, 65536, DEFAULT_RING_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   signals[SIGNAL_CLIENT_CONNECTED] = g_signal_new ("client-connected",
       GST_TYPE_SHM_SINK, G_SIGNAL_RUN_LAST, 0, NULL, NULL,
       g_cclosure_marshal_VOID__INT, G_TYPE_NONE, 1, G_TYPE_INT);
@@ -242,6 +269,13 @@ gst_shm_sink_set_property (GObject * object, guint prop_id,
       GST_OBJECT_UNLOCK (object);
       g_cond_broadcast (self->cond);
       break;
+    case PROP_RING_SIZE:
+      GST_OBJECT_LOCK (object);
+      self->ring_size = g_value_get_uint (value);
+      if (self->pipe)
+        sp_writer_set_ring_size (self->pipe, self->ring_size);
+      GST_OBJECT_UNLOCK (object);
+      break;
     default:
       break;
   }
@@ -279,6 +313,15 @@ gst_shm_sink_get_property (GObject * object, guint prop_id,
     case PROP_BUFFER_TIME:
       g_value_set_uint64 (value, self->buffer_time);
       break;
+    case PROP_BUFFERS_ZERO_COPY:
+      g_value_set_uint64 (value, self->buffers_zero_copy);
+      break;
+    case PROP_BUFFERS_COPIED:
+      g_value_set_uint64 (value, self->buffers_copied);
+      break;
+    case PROP_RING_SIZE:
+      g_value_set_uint (value, self->ring_size);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -295,6 +338,8 @@ gst_shm_sink_start (GstBaseSink * bsink)
   GstShmSink *self = GST_SHM_SINK (bsink);
 
   self->stop = FALSE;
+  self->buffers_zero_copy = 0;
+  self->buffers_copied = 0;
 
   if (!self->socket_path) {
     GST_ELEMENT_ERROR (self, RESOURCE, OPEN_READ_WRITE,
@@ -314,6 +359,7 @@ gst_shm_sink_start (GstBaseSink * bsink)
   }
 
   sp_set_data (self->pipe, self);
+  sp_writer_set_ring_size (self->pipe, self->ring_size);
   g_free (self->socket_path);
   self->socket_path = g_strdup (sp_writer_get_path (self->pipe));
 
@@ -368,8 +414,14 @@ gst_shm_sink_stop (GstBaseSink * bsink)
   gst_poll_free (self->poll);
   self->poll = NULL;
 
+  GST_DEBUG_OBJECT (self, "Sent %" G_GUINT64_FORMAT " buffers without copy, "
+      "copied %" G_GUINT64_FORMAT, self->buffers_zero_copy,
+      self->buffers_copied);
+
+  GST_OBJECT_LOCK (self);
   sp_close (self->pipe);
   self->pipe = NULL;
+  GST_OBJECT_UNLOCK (self);
 
   return TRUE;
 }
@@ -396,58 +448,85 @@ static GstFlowReturn
 gst_shm_sink_render (GstBaseSink * bsink, GstBuffer * buf)
 {
   GstShmSink *self = GST_SHM_SINK (bsink);
+  ShmBlock *block = NULL;
+  gchar *shmbuf = NULL;
   int rv;
 
   GST_OBJECT_LOCK (self);
   while (self->wait_for_connection && !self->clients) {
     g_cond_wait (self->cond, GST_OBJECT_GET_LOCK (self));
-    if (self->unlock) {
-      GST_OBJECT_UNLOCK (self);
-      return GST_FLOW_WRONG_STATE;
-    }
+    if (self->unlock)
+      goto flushing;
   }
 
   while (!gst_shm_sink_can_render (self, GST_BUFFER_TIMESTAMP (buf))) {
     g_cond_wait (self->cond, GST_OBJECT_GET_LOCK (self));
-    if (self->unlock) {
-      GST_OBJECT_UNLOCK (self);
-      return GST_FLOW_WRONG_STATE;
-    }
+    if (self->unlock)
+      goto flushing;
   }
 
   rv = sp_writer_send_buf (self->pipe, (char *) GST_BUFFER_DATA (buf),
       GST_BUFFER_SIZE (buf), GST_BUFFER_TIMESTAMP (buf));
 
-  if (rv == -1) {
-    ShmBlock *block = NULL;
-    gchar *shmbuf = NULL;
-    while ((block = sp_writer_alloc_block (self->pipe,
-                GST_BUFFER_SIZE (buf))) == NULL) {
-      g_cond_wait (self->cond, GST_OBJECT_GET_LOCK (self));
-      if (self->unlock) {
-        GST_OBJECT_UNLOCK (self);
-        return GST_FLOW_WRONG_STATE;
-      }
-    }
-    while (self->wait_for_connection && !self->clients) {
-      g_cond_wait (self->cond, GST_OBJECT_GET_LOCK (self));
-      if (self->unlock) {
-        sp_writer_free_block (block);
-        GST_OBJECT_UNLOCK (self);
-        return GST_FLOW_WRONG_STATE;
-      }
-    }
+  if (rv != -1) {
+    /* Sent from the shared memory, even if no client was there to take it */
+    self->buffers_zero_copy++;
+    GST_OBJECT_UNLOCK (self);
+    return GST_FLOW_OK;
+  }
 
-    shmbuf = sp_writer_block_get_buf (block);
-    memcpy (shmbuf, GST_BUFFER_DATA (buf), GST_BUFFER_SIZE (buf));
-    sp_writer_send_buf (self->pipe, shmbuf, GST_BUFFER_SIZE (buf),
-        GST_BUFFER_TIMESTAMP (buf));
-    sp_writer_free_block (block);
+  /* The buffer is not in our shared memory, copy it to a block of its own */
+  if (GST_BUFFER_SIZE (buf) > sp_writer_get_max_buf_size (self->pipe))
+    goto too_big;
+
+  while ((block = sp_writer_alloc_block (self->pipe,
+              GST_BUFFER_SIZE (buf))) == NULL) {
+    g_cond_wait (self->cond, GST_OBJECT_GET_LOCK (self));
+    if (self->unlock)
+      goto flushing;
   }
+  shmbuf = sp_writer_block_get_buf (block);
+
+  /* Nobody else touches the block until it is sent, so don't hold up the
+   * poll thread while copying */
+  GST_OBJECT_UNLOCK (self);
+  memcpy (shmbuf, GST_BUFFER_DATA (buf), GST_BUFFER_SIZE (buf));
+  GST_OBJECT_LOCK (self);
+
+  while (self->wait_for_connection && !self->clients) {
+    g_cond_wait (self->cond, GST_OBJECT_GET_LOCK (self));
+    if (self->unlock)
+      goto flushing;
+  }
+  if (self->unlock)
+    goto flushing;
+
+  sp_writer_send_buf (self->pipe, shmbuf, GST_BUFFER_SIZE (buf),
+      GST_BUFFER_TIMESTAMP (buf));
+  sp_writer_free_block (block);
+  self->buffers_copied++;
 
   GST_OBJECT_UNLOCK (self);
 
   return GST_FLOW_OK;
+
+  /* ERRORS */
+flushing:
+  {
+    if (block)
+      sp_writer_free_block (block);
+    GST_OBJECT_UNLOCK (self);
+    return GST_FLOW_WRONG_STATE;
+  }
+too_big:
+  {
+    GST_OBJECT_UNLOCK (self);
+    GST_ELEMENT_ERROR (self, RESOURCE, NO_SPACE_LEFT,
+        ("Shared memory area is too small"),
+        ("Requested %u bytes, shared memory area is of %u bytes",
+            GST_BUFFER_SIZE (buf), self->size));
+    return GST_FLOW_ERROR;
+  }
 }
 
 static void
@@ -475,8 +554,12 @@ gst_shm_sink_buffer_alloc (GstBaseSink * sink, guint64 offset, guint size,
   ShmBlock *block = NULL;
   gpointer buf = NULL;
 
+  /* Never wait for space here, upstream may be holding on to the buffers
+   * that fill the area, render() will copy the buffer instead. Before
+   * start() there is no area to allocate from yet */
   GST_OBJECT_LOCK (self);
-  block = sp_writer_alloc_block (self->pipe, size);
+  if (self->pipe && size <= sp_writer_get_max_buf_size (self->pipe))
+    block = sp_writer_alloc_block (self->pipe, size);
   if (block) {
     buf = sp_writer_block_get_buf (block);
     g_object_ref (self);
@@ -51,6 +51,7 @@ struct _GstShmSink
 
   guint perms;
   guint size;
+  guint ring_size;
 
   GList *clients;
 
@@ -63,6 +64,9 @@ struct _GstShmSink
   gboolean unlock;
   GstClockTime buffer_time;
 
+  guint64 buffers_zero_copy;
+  guint64 buffers_copied;
+
   GCond *cond;
 };
 
@@ -33,14 +33,30 @@
 #include <string.h>
 #include <assert.h>
 
+/* Number of size classes of the free lists, the class of a free block is
+ * floor (log2 (number of granules)) */
+#define SHM_ALLOC_CLASSES (sizeof (unsigned long) * 8)
+
 /* This is the allocated space to hold multiple blocks */
 struct _ShmAllocSpace
 {
   /* The total size of this space */
   size_t size;
 
-  /* chained list of the blocks contained in this space */
-  ShmAllocBlock *blocks;
+  /* The number of granules in this space, the last one can be partial */
+  unsigned long n_granules;
+
+  /* The blocks, free or used, tile the whole space. The entries for all
+   * granules of a used block point to it, which finds the block of any
+   * offset inside of it. The entries for the first and the last granule of
+   * a free block point to it and all others are NULL, which finds the
+   * neighbours of a block being freed without walking any list */
+  ShmAllocBlock **tags;
+
+  /* The free blocks, segregated by size class */
+  ShmAllocBlock *free_lists[SHM_ALLOC_CLASSES];
+  /* Bit n is set if free_lists[n] is not empty */
+  unsigned long free_classes;
 };
 
 /* A single block of data */
@@ -48,18 +64,117 @@ struct _ShmAllocBlock
 {
   int use_count;
 
+  /* Non zero if this block is in a free list */
+  int free;
+
   /* Pointer back to the AllocSpace where this block is */
   ShmAllocSpace *space;
 
   /* The offset of this block in the alloc space */
   unsigned long offset;
-  /* The size of the block */
-  unsigned long size;
+  /* The size of the block in granules */
+  unsigned long granules;
 
-  /* Pointer to the next block in the chain */
+  /* Links in the free list, only used for free blocks */
+  ShmAllocBlock *prev;
   ShmAllocBlock *next;
 };
 
+static unsigned int
+shm_alloc_class (unsigned long granules)
+{
+  unsigned int class = 0;
+
+  while (granules >>= 1)
+    class++;
+
+  return class;
+}
+
+static void
+shm_alloc_space_set_tags (ShmAllocSpace * self, ShmAllocBlock * block)
+{
+  unsigned long first = block->offset >> SHM_ALLOC_GRANULE_SHIFT;
+
+  self->tags[first] = block;
+  self->tags[first + block->granules - 1] = block;
+}
+
+/* Tags or untags all granules of @block but its first and last */
+static void
+shm_alloc_space_set_inner_tags (ShmAllocSpace * self, ShmAllocBlock * block,
+    ShmAllocBlock * tag)
+{
+  unsigned long first = block->offset >> SHM_ALLOC_GRANULE_SHIFT;
+  unsigned long i;
+
+  for (i = first + 1; i + 1 < first + block->granules; i++)
+    self->tags[i] = tag;
+}
+
+/* The number of bytes @block can hold, less than its granules if it ends
+ * with the partial last granule of the space */
+static unsigned long
+shm_alloc_space_block_capacity (ShmAllocSpace * self, ShmAllocBlock * block)
+{
+  unsigned long capacity = block->granules << SHM_ALLOC_GRANULE_SHIFT;
+
+  if (block->offset + capacity > self->size)
+    capacity = self->size - block->offset;
+
+  return capacity;
+}
+
+static void
+shm_alloc_space_insert_free (ShmAllocSpace * self, ShmAllocBlock * block)
+{
+  unsigned int class = shm_alloc_class (block->granules);
+
+  block->free = 1;
+  block->use_count = 0;
+  block->prev = NULL;
+  block->next = self->free_lists[class];
+  if (block->next)
+    block->next->prev = block;
+  self->free_lists[class] = block;
+  self->free_classes |= 1UL << class;
+
+  shm_alloc_space_set_tags (self, block);
+}
+
+static void
+shm_alloc_space_remove_free (ShmAllocSpace * self, ShmAllocBlock * block)
+{
+  unsigned int class = shm_alloc_class (block->granules);
+
+  if (block->prev)
+    block->prev->next = block->next;
+  else
+    self->free_lists[class] = block->next;
+  if (block->next)
+    block->next->prev = block->prev;
+
+  if (!self->free_lists[class])
+    self->free_classes &= ~(1UL << class);
+
+  block->free = 0;
+  block->prev = NULL;
+  block->next = NULL;
+}
+
+static ShmAllocBlock *
+shm_alloc_block_new (ShmAllocSpace * space, unsigned long offset,
+    unsigned long granules)
+{
+  ShmAllocBlock *block = spalloc_new (ShmAllocBlock);
+
+  memset (block, 0, sizeof (ShmAllocBlock));
+  block->space = space;
+  block->offset = offset;
+  block->granules = granules;
+
+  return block;
+}
 
 ShmAllocSpace *
 shm_alloc_space_new (size_t size)
@@ -69,6 +184,14 @@ shm_alloc_space_new (size_t size)
   memset (self, 0, sizeof (ShmAllocSpace));
 
   self->size = size;
+  self->n_granules = (size + SHM_ALLOC_GRANULE - 1) >> SHM_ALLOC_GRANULE_SHIFT;
+
+  if (self->n_granules > 0) {
+    self->tags = spalloc_alloc (sizeof (ShmAllocBlock *) * self->n_granules);
+    memset (self->tags, 0, sizeof (ShmAllocBlock *) * self->n_granules);
+    shm_alloc_space_insert_free (self,
+        shm_alloc_block_new (self, 0, self->n_granules));
+  }
 
   return self;
 }
@@ -76,53 +199,84 @@ shm_alloc_space_new (size_t size)
 void
 shm_alloc_space_free (ShmAllocSpace * self)
 {
-  assert (self && self->blocks == NULL);
+  if (self->n_granules > 0) {
+    ShmAllocBlock *block = self->tags[0];
+
+    /* everything must have been freed and merged back */
+    assert (block->free && block->granules == self->n_granules);
+    spalloc_free (ShmAllocBlock, block);
+    spalloc_free1 (sizeof (ShmAllocBlock *) * self->n_granules, self->tags);
+  }
+
   spalloc_free (ShmAllocSpace, self);
 }
 
+/* The biggest block that fits in an empty space */
+unsigned long
+shm_alloc_space_get_max_block_size (ShmAllocSpace * self)
+{
+  return self->size;
+}
 
 ShmAllocBlock *
 shm_alloc_space_alloc_block (ShmAllocSpace * self, unsigned long size)
 {
-  ShmAllocBlock *block;
-  ShmAllocBlock *item = NULL;
-  ShmAllocBlock *prev_item = NULL;
-  unsigned long prev_end_offset = 0;
-
+  ShmAllocBlock *block = NULL;
+  unsigned long granules;
+  unsigned long classes;
+  unsigned int class;
+  unsigned int i;
+
+  granules = (size + SHM_ALLOC_GRANULE - 1) >> SHM_ALLOC_GRANULE_SHIFT;
+  if (granules == 0)
+    granules = 1;
+
+  if (size > self->size || granules > self->n_granules)
+    return NULL;
+
+  /* Any block of a higher class is big enough, take one from the lowest
+   * such class that isn't empty.  Only a block ending with the partial last
+   * granule can hold less than its granules, skip it if it's too small */
+  class = shm_alloc_class (granules);
+  i = (granules == (1UL << class)) ? class : class + 1;
+  if (i < SHM_ALLOC_CLASSES) {
+    for (classes = self->free_classes >> i; classes && !block;
+        classes >>= 1, i++) {
+      if (classes & 1) {
+        for (block = self->free_lists[i]; block; block = block->next)
+          if (shm_alloc_space_block_capacity (self, block) >= size)
+            break;
+      }
+    }
+  }
 
-  for (item = self->blocks; item; item = item->next) {
-    unsigned long max_size = 0;
+  /* Otherwise, some block of the same class as the request may still be big
+   * enough */
+  if (!block) {
+    for (block = self->free_lists[class]; block; block = block->next)
+      if (block->granules >= granules &&
+          shm_alloc_space_block_capacity (self, block) >= size)
+        break;
+  }
 
-    max_size = item->offset - prev_end_offset;
+  if (!block)
+    return NULL;
 
-    if (max_size >= size)
-      break;
+  shm_alloc_space_remove_free (self, block);
 
-    prev_end_offset = item->offset + item->size;
-    prev_item = item;
-  }
+  /* Give back what we don't need */
+  if (block->granules > granules) {
+    ShmAllocBlock *rest = shm_alloc_block_new (self,
+        block->offset + (granules << SHM_ALLOC_GRANULE_SHIFT),
+        block->granules - granules);
 
-  /* Did not find space before an existing block */
-  if (self->blocks && !item) {
-    /* Return NULL if there is no big enough space, otherwise, there is space
-     * at the end */
-    if (self->size - prev_end_offset < size)
-      return NULL;
+    block->granules = granules;
+    shm_alloc_space_insert_free (self, rest);
   }
 
-  block = spalloc_new (ShmAllocBlock);
-  memset (block, 0, sizeof (ShmAllocBlock));
-  block->offset = prev_end_offset;
-  block->size = size;
   block->use_count = 1;
-  block->space = self;
-
-  if (prev_item)
-    prev_item->next = block;
-  else
-    self->blocks = block;
-
-  block->next = item;
+  shm_alloc_space_set_tags (self, block);
+  shm_alloc_space_set_inner_tags (self, block, block);
 
   return block;
 }
@@ -136,35 +290,55 @@ shm_alloc_space_alloc_block_get_offset (ShmAllocBlock * block)
 static void
 shm_alloc_space_free_block (ShmAllocBlock * block)
 {
-  ShmAllocBlock *item = NULL;
-  ShmAllocBlock *prev_item = NULL;
   ShmAllocSpace *self = block->space;
+  ShmAllocBlock *neighbour;
+  unsigned long first = block->offset >> SHM_ALLOC_GRANULE_SHIFT;
+  unsigned long last = first + block->granules - 1;
+
+  /* Merge with the free blocks on either side, the tags that end up inside
+   * the merged block are cleared */
+  shm_alloc_space_set_inner_tags (self, block, NULL);
+  if (last + 1 < self->n_granules) {
+    neighbour = self->tags[last + 1];
+    if (neighbour->free) {
+      shm_alloc_space_remove_free (self, neighbour);
+      self->tags[last] = NULL;
+      self->tags[last + 1] = NULL;
+      block->granules += neighbour->granules;
+      spalloc_free (ShmAllocBlock, neighbour);
+    }
+  }
 
-  for (item = self->blocks; item; item = item->next) {
-    if (item == block) {
-      if (prev_item)
-        prev_item->next = item->next;
-      else
-        self->blocks = item->next;
-      break;
+  if (first > 0) {
+    neighbour = self->tags[first - 1];
+    if (neighbour->free) {
+      shm_alloc_space_remove_free (self, neighbour);
+      self->tags[first - 1] = NULL;
+      self->tags[first] = NULL;
+      neighbour->granules += block->granules;
+      spalloc_free (ShmAllocBlock, block);
+      block = neighbour;
     }
-    prev_item = item;
   }
 
-  spalloc_free (ShmAllocBlock, block);
+  shm_alloc_space_insert_free (self, block);
 }
 
 ShmAllocBlock *
 shm_alloc_space_block_get (ShmAllocSpace * self, unsigned long offset)
 {
   ShmAllocBlock *block = NULL;
+  unsigned long granule = offset >> SHM_ALLOC_GRANULE_SHIFT;
 
-  for (block = self->blocks; block; block = block->next) {
-    if (block->offset <= offset && (block->offset + block->size) > offset)
-      return block;
-  }
+  if (offset >= self->size)
+    return NULL;
 
-  return NULL;
+  /* All granules of used blocks are tagged */
+  block = self->tags[granule];
+  if (!block || block->free)
+    return NULL;
+
+  return block;
 }
 
 
@@ -50,11 +50,17 @@
 extern "C" {
 #endif
 
+/* Blocks are allocated in multiples of this many bytes, which also makes
+ * every block start at an aligned offset */
+#define SHM_ALLOC_GRANULE_SHIFT 8
+#define SHM_ALLOC_GRANULE (1UL << SHM_ALLOC_GRANULE_SHIFT)
+
 typedef struct _ShmAllocSpace ShmAllocSpace;
 typedef struct _ShmAllocBlock ShmAllocBlock;
 
 ShmAllocSpace *shm_alloc_space_new (size_t size);
 void shm_alloc_space_free (ShmAllocSpace * self);
+unsigned long shm_alloc_space_get_max_block_size (ShmAllocSpace * self);
 
 
 ShmAllocBlock *shm_alloc_space_alloc_block (ShmAllocSpace * self,
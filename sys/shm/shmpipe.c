@@ -61,9 +61,40 @@
  * type 4: ack buffer
  * offset
  *
- * Type 4 goes from the client to the server
+ * type 5: new ring
+ * Number of slots
+ * Size of path (followed by path)
+ *
+ * type 6: ring ready
+ * No payload
+ *
+ * type 7: start ring
+ * No payload
+ *
+ * type 8: wake up
+ * No payload
+ *
+ * Types 4 and 6 go from the client to the server
+ * Type 8 goes both ways
  * The rest are from the server to the client
  * The client should never write in the SHM
+ *
+ * If the server has a ring size set, it creates a second shm area for each
+ * client it accepts, holding a ring of buffers going to the client and a
+ * ring of acks coming back, and announces it with type 5. A client that
+ * could map it replies with type 6, then the server sends type 7 and from
+ * there on sends the buffers through the ring, the client starts reading the
+ * ring when it gets type 7 so it sees them in order. Clients that don't
+ * know about rings never get type 5 as it is only sent if enabled.
+ * Types 1 and 2 always go over the socket, a buffer in the ring from an
+ * area the client doesn't know yet stays there until it read type 1.
+ *
+ * Whoever reads from a ring sets its waiting flag before going back to
+ * poll the socket, whoever writes to it only sends a type 8 message if that
+ * flag was set. So as long as the other side keeps up, nothing goes over
+ * the socket anymore. A full buffer ring means the client is that far
+ * behind, it then misses buffers. Acks go over the socket if their ring
+ * is full.
  */
 
 
@@ -74,7 +105,73 @@ enum
   COMMAND_NEW_SHM_AREA = 1,
   COMMAND_CLOSE_SHM_AREA = 2,
   COMMAND_NEW_BUFFER = 3,
-  COMMAND_ACK_BUFFER = 4
+  COMMAND_ACK_BUFFER = 4,
+  COMMAND_NEW_RING = 5,
+  COMMAND_RING_READY = 6,
+  COMMAND_RING_START = 7,
+  COMMAND_WAKE_UP = 8
+};
+
+/* The rings are shared between processes that may not have the same word
+ * size, so only use fixed size types in them */
+
+#define RING_MAX_SLOTS (64 * 1024)
+
+#define sp_memory_barrier() __sync_synchronize ()
+
+typedef struct _ShmRingHeader ShmRingHeader;
+typedef struct _ShmRingBuffer ShmRingBuffer;
+typedef struct _ShmRingAck ShmRingAck;
+typedef struct _ShmRing ShmRing;
+
+/* The counters only ever increase, the slot of counter n is n % slots. Each
+ * one is written by one side only and lives in its own cache line */
+struct _ShmRingHeader
+{
+  uint32_t slots;
+  uint32_t padding0[15];
+
+  /* written by the server */
+  volatile uint32_t buffers_written;
+  volatile uint32_t server_waiting;
+  volatile uint32_t acks_read;
+  uint32_t padding1[13];
+
+  /* written by the client */
+  volatile uint32_t buffers_read;
+  volatile uint32_t client_waiting;
+  volatile uint32_t acks_written;
+  uint32_t padding2[13];
+};
+
+struct _ShmRingBuffer
+{
+  int32_t area_id;
+  uint32_t padding;
+  uint64_t offset;
+  uint64_t size;
+};
+
+struct _ShmRingAck
+{
+  int32_t area_id;
+  uint32_t padding;
+  uint64_t offset;
+};
+
+struct _ShmRing
+{
+  int shm_fd;
+  char *shm_name;
+
+  unsigned int slots;
+  size_t len;
+  ShmRingHeader *header;
+  ShmRingBuffer *buffers;
+  ShmRingAck *acks;
+
+  /* set once the other side knows about it */
+  int active;
 };
 
 typedef struct _ShmArea ShmArea;
@@ -133,12 +230,20 @@ struct _ShmPipe
   ShmClient *clients;
 
   mode_t perms;
+
+  unsigned int ring_slots;
+
+  /* reader side of the ring */
+  ShmRing *ring;
 };
 
 struct _ShmClient
 {
   int fd;
 
+  /* writer side of the ring of this client */
+  ShmRing *ring;
+
   ShmClient *next;
 };
 
@@ -171,6 +276,12 @@ struct CommandBuffer
     {
       unsigned long offset;
     } ack_buffer;
+    struct
+    {
+      unsigned int slots;
+      unsigned int path_size;
+      /* Followed by path */
+    } new_ring;
   } payload;
 };
 
@@ -179,6 +290,10 @@ static void sp_close_shm (ShmArea * area);
 static int sp_shmbuf_dec (ShmPipe * self, ShmBuffer * buf,
     ShmBuffer * prev_buf);
 static void sp_shm_area_dec (ShmPipe * self, ShmArea * area);
+static ShmRing *sp_open_ring (char *path, unsigned int slots, mode_t perms);
+static void sp_close_ring (ShmRing * ring);
+static int send_command (int fd, struct CommandBuffer *cb,
+    unsigned short int type, int area_id);
 
 
 
@@ -344,6 +459,123 @@ sp_close_shm (ShmArea * area)
   spalloc_free (ShmArea, area);
 }
 
+#define RETURN_ERROR(format, ...)  do {                   \
+  fprintf (stderr, format, __VA_ARGS__);                  \
+  sp_close_ring (ring);                                   \
+  return NULL;                                            \
+  } while (0)
+
+/**
+ * sp_open_ring:
+ * @path: Path of the ring for a reader,
+ *  NULL if this is a writer (then it will allocate its own path)
+ *
+ * Opens a ShmRing, both sides map it read-write
+ */
+
+static ShmRing *
+sp_open_ring (char *path, unsigned int slots, mode_t perms)
+{
+  ShmRing *ring = spalloc_new (ShmRing);
+  char tmppath[32];
+  int flags;
+  int i = 0;
+
+  memset (ring, 0, sizeof (ShmRing));
+
+  ring->slots = slots;
+  ring->len = sizeof (ShmRingHeader) + slots * (sizeof (ShmRingBuffer) +
+      sizeof (ShmRingAck));
+  ring->header = MAP_FAILED;
+
+  if (path)
+    flags = O_RDWR;
+  else
+    flags = O_RDWR | O_CREAT | O_TRUNC | O_EXCL;
+
+  ring->shm_fd = -1;
+
+  if (path) {
+    ring->shm_fd = shm_open (path, flags, perms);
+  } else {
+    do {
+      snprintf (tmppath, sizeof (tmppath), "/shmring.%5d.%5d", getpid (),
+          i++);
+      ring->shm_fd = shm_open (tmppath, flags, perms);
+    } while (ring->shm_fd < 0 && errno == EEXIST);
+  }
+
+  if (ring->shm_fd < 0)
+    RETURN_ERROR ("shm_open failed on %s (%d): %s\n",
+        path ? path : tmppath, errno, strerror (errno));
+
+  if (!path) {
+    ring->shm_name = strdup (tmppath);
+
+    if (ftruncate (ring->shm_fd, ring->len))
+      RETURN_ERROR ("Could not resize ring, ftruncate failed (%d): %s\n",
+          errno, strerror (errno));
+  }
+
+  ring->header = mmap (NULL, ring->len, PROT_READ | PROT_WRITE, MAP_SHARED,
+      ring->shm_fd, 0);
+
+  if (ring->header == MAP_FAILED)
+    RETURN_ERROR ("mmap failed (%d): %s\n", errno, strerror (errno));
+
+  if (path) {
+    if (ring->header->slots != slots)
+      RETURN_ERROR ("Ring has %u slots instead of %u\n", ring->header->slots,
+          slots);
+  } else {
+    /* The reader looks at the ring as soon as it gets the start command,
+     * the writer is idle until it gets the first ack */
+    memset (ring->header, 0, ring->len);
+    ring->header->slots = slots;
+    ring->header->server_waiting = 1;
+  }
+
+  ring->buffers = (ShmRingBuffer *) (ring->header + 1);
+  ring->acks = (ShmRingAck *) (ring->buffers + slots);
+
+  return ring;
+}
+
+#undef RETURN_ERROR
+
+/* The creator of the ring unlinks it once the other side has mapped it */
+static void
+sp_ring_unlink (ShmRing * ring)
+{
+  if (ring->shm_name) {
+    shm_unlink (ring->shm_name);
+    free (ring->shm_name);
+    ring->shm_name = NULL;
+  }
+}
+
+static void
+sp_close_ring (ShmRing * ring)
+{
+  if (ring->header != MAP_FAILED)
+    munmap (ring->header, ring->len);
+
+  if (ring->shm_fd >= 0)
+    close (ring->shm_fd);
+
+  sp_ring_unlink (ring);
+
+  spalloc_free (ShmRing, ring);
+}
+
+/* Returns 1 and clears the flag if the other side was waiting for it */
+static int
+sp_ring_wake_up (volatile uint32_t * waiting)
+{
+  sp_memory_barrier ();
+  return __sync_bool_compare_and_swap (waiting, 1, 0);
+}
+
 static void
 sp_shm_area_inc (ShmArea * area)
 {
@@ -405,6 +637,9 @@ sp_dec (ShmPipe * self)
   while (self->shm_area)
     sp_shm_area_dec (self, self->shm_area);
 
+  if (self->ring)
+    sp_close_ring (self->ring);
+
   spalloc_free (ShmPipe, self);
 }
 
@@ -438,6 +673,23 @@ sp_writer_setperms_shm (ShmPipe * self, mode_t perms)
   return ret;
 }
 
+void
+sp_writer_set_ring_size (ShmPipe * self, unsigned int slots)
+{
+  unsigned int n = 1;
+
+  if (slots == 0) {
+    self->ring_slots = 0;
+    return;
+  }
+
+  /* the counters wrap around, so the number of slots must divide 2^32 */
+  while (n < slots && n < RING_MAX_SLOTS)
+    n <<= 1;
+
+  self->ring_slots = n;
+}
+
 static int
 send_command (int fd, struct CommandBuffer *cb, unsigned short int type,
     int area_id)
@@ -518,6 +770,13 @@ sp_writer_alloc_block (ShmPipe * self, size_t size)
   return block;
 }
 
+/* The biggest block sp_writer_alloc_block() can ever return */
+size_t
+sp_writer_get_max_buf_size (ShmPipe * self)
+{
+  return shm_alloc_space_get_max_block_size (self->shm_area->allocspace);
+}
+
 char *
 sp_writer_block_get_buf (ShmBlock * block)
 {
@@ -540,6 +799,35 @@ sp_writer_free_block (ShmBlock * block)
   spalloc_free (ShmBlock, block);
 }
 
+/* Returns 0 if the ring is full */
+static int
+sp_writer_ring_send (ShmClient * client, int area_id, unsigned long offset,
+    unsigned long size)
+{
+  ShmRing *ring = client->ring;
+  ShmRingHeader *header = ring->header;
+  uint32_t written = header->buffers_written;
+  ShmRingBuffer *slot;
+
+  if (written - header->buffers_read >= ring->slots)
+    return 0;
+
+  slot = &ring->buffers[written % ring->slots];
+  slot->area_id = area_id;
+  slot->offset = offset;
+  slot->size = size;
+  sp_memory_barrier ();
+  header->buffers_written = written + 1;
+
+  if (sp_ring_wake_up (&header->client_waiting)) {
+    struct CommandBuffer cb = { 0 };
+
+    send_command (client->fd, &cb, COMMAND_WAKE_UP, area_id);
+  }
+
+  return 1;
+}
+
 /* Returns the number of client this has successfully been sent to */
 
 int
@@ -582,10 +870,16 @@ sp_writer_send_buf (ShmPipe * self, char *buf, size_t size, uint64_t tag)
 
   for (client = self->clients; client; client = client->next) {
     struct CommandBuffer cb = { 0 };
-    cb.payload.buffer.offset = offset;
-    cb.payload.buffer.size = bsize;
-    if (!send_command (client->fd, &cb, COMMAND_NEW_BUFFER, self->shm_area->id))
-      continue;
+
+    if (client->ring && client->ring->active) {
+      if (!sp_writer_ring_send (client, area->id, offset, bsize))
+        continue;
+    } else {
+      cb.payload.buffer.offset = offset;
+      cb.payload.buffer.size = bsize;
+      if (!send_command (client->fd, &cb, COMMAND_NEW_BUFFER, area->id))
+        continue;
+    }
     sb->clients[i++] = client->fd;
     c++;
   }
@@ -674,6 +968,50 @@ sp_client_recv (ShmPipe * self, char **buf)
       }
       return -23;
 
+    case COMMAND_NEW_RING:
+      assert (cb.payload.new_ring.path_size > 0);
+
+      area_name = malloc (cb.payload.new_ring.path_size);
+      retval = recv (self->main_socket, area_name,
+          cb.payload.new_ring.path_size, 0);
+      if (retval < 0 ||
+          (unsigned int) retval != cb.payload.new_ring.path_size) {
+        free (area_name);
+        return -3;
+      }
+
+      /* If we can't use it, just don't tell the server and keep going
+       * without */
+      if (cb.payload.new_ring.slots > 0 &&
+          cb.payload.new_ring.slots <= RING_MAX_SLOTS &&
+          (cb.payload.new_ring.slots & (cb.payload.new_ring.slots - 1)) == 0) {
+        ShmRing *ring;
+
+        ring = sp_open_ring (area_name, cb.payload.new_ring.slots, 0);
+        if (ring) {
+          struct CommandBuffer ready = { 0 };
+
+          if (self->ring)
+            sp_close_ring (self->ring);
+          self->ring = ring;
+          if (!send_command (self->main_socket, &ready, COMMAND_RING_READY,
+                  cb.area_id)) {
+            free (area_name);
+            return -5;
+          }
+        }
+      }
+      free (area_name);
+      break;
+
+    case COMMAND_RING_START:
+      if (self->ring)
+        self->ring->active = 1;
+      break;
+
+    case COMMAND_WAKE_UP:
+      break;
+
     default:
       return -99;
   }
@@ -681,10 +1019,55 @@ sp_client_recv (ShmPipe * self, char **buf)
   return 0;
 }
 
+static int
+sp_writer_ack_buffer (ShmPipe * self, int area_id, unsigned long offset)
+{
+  ShmBuffer *buf = NULL, *prev_buf = NULL;
+
+  for (buf = self->buffers; buf; buf = buf->next) {
+    if (buf->shm_area->id == area_id && buf->offset == offset) {
+      sp_shmbuf_dec (self, buf, prev_buf);
+      return 0;
+    }
+    prev_buf = buf;
+  }
+
+  return -2;
+}
+
+static int
+sp_writer_ring_recv_acks (ShmPipe * self, ShmClient * client)
+{
+  ShmRing *ring = client->ring;
+  ShmRingHeader *header = ring->header;
+  ShmRingAck *ack;
+  uint32_t read;
+  int ret = 0;
+
+again:
+  for (read = header->acks_read; read != header->acks_written; read++) {
+    sp_memory_barrier ();
+    ack = &ring->acks[read % ring->slots];
+    if (sp_writer_ack_buffer (self, ack->area_id, ack->offset) < 0)
+      ret = -2;
+    sp_memory_barrier ();
+    header->acks_read = read + 1;
+  }
+
+  /* Ask to be woken up, then check again in case an ack came in meanwhile */
+  header->server_waiting = 1;
+  sp_memory_barrier ();
+  if (header->acks_read != header->acks_written) {
+    header->server_waiting = 0;
+    goto again;
+  }
+
+  return ret;
+}
+
 int
 sp_writer_recv (ShmPipe * self, ShmClient * client)
 {
-  ShmBuffer *buf = NULL, *prev_buf = NULL;
   struct CommandBuffer cb;
 
   if (!recv_command (client->fd, &cb))
@@ -692,20 +1075,26 @@ sp_writer_recv (ShmPipe * self, ShmClient * client)
 
   switch (cb.type) {
     case COMMAND_ACK_BUFFER:
+      return sp_writer_ack_buffer (self, cb.area_id,
+          cb.payload.ack_buffer.offset);
 
-      for (buf = self->buffers; buf; buf = buf->next) {
-        if (buf->shm_area->id == cb.area_id &&
-            buf->offset == cb.payload.ack_buffer.offset) {
-          sp_shmbuf_dec (self, buf, prev_buf);
-          break;
-        }
-        prev_buf = buf;
-      }
-
-      if (!buf)
+    case COMMAND_RING_READY:
+      if (!client->ring || client->ring->active)
         return -2;
 
+      /* The client has mapped it, nobody else needs to find it. Everything
+       * sent from now on goes through the ring */
+      sp_ring_unlink (client->ring);
+      client->ring->active = 1;
+      if (!send_command (client->fd, &cb, COMMAND_RING_START, cb.area_id))
+        return -1;
       break;
+
+    case COMMAND_WAKE_UP:
+      if (!client->ring || !client->ring->active)
+        return -2;
+      return sp_writer_ring_recv_acks (self, client);
+
     default:
       return -99;
   }
@@ -713,11 +1102,70 @@ sp_writer_recv (ShmPipe * self, ShmClient * client)
   return 0;
 }
 
+long int
+sp_client_recv_ring (ShmPipe * self, char **buf)
+{
+  ShmRing *ring = self->ring;
+  ShmRingHeader *header;
+  ShmRingBuffer *slot;
+  ShmArea *area;
+  uint32_t read;
+  int area_id;
+  unsigned long offset, size;
+
+  *buf = NULL;
+
+  if (!ring || !ring->active)
+    return 0;
+
+  header = ring->header;
+  read = header->buffers_read;
+
+  if (read == header->buffers_written) {
+    /* Ask to be woken up, then check again in case a buffer came in
+     * meanwhile */
+    header->client_waiting = 1;
+    sp_memory_barrier ();
+    if (read == header->buffers_written)
+      return 0;
+    header->client_waiting = 0;
+  }
+
+  sp_memory_barrier ();
+  slot = &ring->buffers[read % ring->slots];
+  area_id = slot->area_id;
+  offset = slot->offset;
+  size = slot->size;
+
+  for (area = self->shm_area; area; area = area->next) {
+    if (area->id == area_id)
+      break;
+  }
+
+  if (!area) {
+    struct CommandBuffer cb;
+
+    /* The writer announces a new area on the socket before it puts buffers
+     * from it in the ring, leave the slot there until that was read */
+    if (recv (self->main_socket, &cb, sizeof (cb), MSG_PEEK | MSG_DONTWAIT) > 0)
+      return 0;
+    return -23;
+  }
+
+  sp_memory_barrier ();
+  header->buffers_read = read + 1;
+
+  *buf = area->shm_area_buf + offset;
+  sp_shm_area_inc (area);
+  return size;
+}
+
 int
 sp_client_recv_finish (ShmPipe * self, char *buf)
 {
   ShmArea *shm_area = NULL;
   unsigned long offset;
+  int area_id;
   struct CommandBuffer cb = { 0 };
 
   for (shm_area = self->shm_area; shm_area; shm_area = shm_area->next) {
@@ -729,12 +1177,31 @@ sp_client_recv_finish (ShmPipe * self, char *buf)
   assert (shm_area);
 
   offset = buf - shm_area->shm_area_buf;
+  area_id = shm_area->id;
 
   sp_shm_area_dec (self, shm_area);
 
+  if (self->ring && self->ring->active) {
+    ShmRing *ring = self->ring;
+    ShmRingHeader *header = ring->header;
+    uint32_t written = header->acks_written;
+
+    if (written - header->acks_read < ring->slots) {
+      ShmRingAck *ack = &ring->acks[written % ring->slots];
+
+      ack->area_id = area_id;
+      ack->offset = offset;
+      sp_memory_barrier ();
+      header->acks_written = written + 1;
+
+      if (!sp_ring_wake_up (&header->server_waiting))
+        return 1;
+      return send_command (self->main_socket, &cb, COMMAND_WAKE_UP, area_id);
+    }
+  }
+
   cb.payload.ack_buffer.offset = offset;
-  return send_command (self->main_socket, &cb, COMMAND_ACK_BUFFER,
-      self->shm_area->id);
+  return send_command (self->main_socket, &cb, COMMAND_ACK_BUFFER, area_id);
 }
 
 ShmPipe *
@@ -797,6 +1264,24 @@ sp_writer_accept_client (ShmPipe * self)
 
   client = spalloc_new (ShmClient);
   client->fd = fd;
+  client->ring = NULL;
+
+  /* The client keeps using the socket until it has mapped the ring */
+  if (self->ring_slots > 0) {
+    ShmRing *ring = sp_open_ring (NULL, self->ring_slots, self->perms);
+
+    if (ring) {
+      memset (&cb, 0, sizeof (cb));
+      pathlen = strlen (ring->shm_name) + 1;
+      cb.payload.new_ring.slots = self->ring_slots;
+      cb.payload.new_ring.path_size = pathlen;
+      if (send_command (fd, &cb, COMMAND_NEW_RING, self->shm_area->id) &&
+          send (fd, ring->shm_name, pathlen, MSG_NOSIGNAL) == pathlen)
+        client->ring = ring;
+      else
+        sp_close_ring (ring);
+    }
+  }
 
   /* Prepend ot linked list */
   client->next = self->clients;
@@ -868,6 +1353,9 @@ again:
 
   self->num_clients--;
 
+  if (client->ring)
+    sp_close_ring (client->ring);
+
   spalloc_free (ShmClient, client);
 }
 
@@ -56,6 +56,13 @@
  * buffers are no longer valid. If was valid buffer was received, the
  * client must release it with sp_client_recv_finish() when it is done
  * reading from it.
+ *
+ * If the writer enabled rings with sp_writer_set_ring_size(), buffers
+ * can also arrive without anything to read on the socket. The reader
+ * must then call sp_client_recv_ring() before each select(), it
+ * returns the buffers queued in the ring the same way as
+ * sp_client_recv(), or 0 with a NULL buffer when there are none or when
+ * the next one is in a new area that is still to be read from the socket.
  */
 
 
@@ -86,11 +93,13 @@ void sp_set_data (ShmPipe * self, void *data);
 
 int sp_writer_setperms_shm (ShmPipe * self, mode_t perms);
 int sp_writer_resize (ShmPipe * self, size_t size);
+void sp_writer_set_ring_size (ShmPipe * self, unsigned int slots);
 
 int sp_get_fd (ShmPipe * self);
 int sp_writer_get_client_fd (ShmClient * client);
 
 ShmBlock *sp_writer_alloc_block (ShmPipe * self, size_t size);
+size_t sp_writer_get_max_buf_size (ShmPipe * self);
 void sp_writer_free_block (ShmBlock *block);
 int sp_writer_send_buf (ShmPipe * self, char *buf, size_t size, uint64_t tag);
 char *sp_writer_block_get_buf (ShmBlock *block);
@@ -104,6 +113,7 @@ int sp_writer_pending_writes (ShmPipe * self);
 
 ShmPipe *sp_client_open (const char *path);
 long int sp_client_recv (ShmPipe * self, char **buf);
+long int sp_client_recv_ring (ShmPipe * self, char **buf);
 int sp_client_recv_finish (ShmPipe * self, char *buf);
 
 ShmBuffer *sp_writer_get_pending_buffers (ShmPipe * self);
@@ -0,0 +1,209 @@
+/* GStreamer
+ *
+ * unit tests for multithreaded conversion in colorspace
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/video/video.h>
+
+#include <string.h>
+
+static GstPad *mysrcpad, *mysinkpad;
+static GstCaps *sink_caps;
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+/* 4k frames, an odd number of lines to have a partial last band */
+#define WIDTH 3840
+#define HEIGHT 2157
+#define N_FRAMES 5
+
+static GstCaps *
+sink_getcaps (GstPad * pad)
+{
+  return gst_caps_ref (sink_caps);
+}
+
+static GstElement *
+setup_colorspace (GstVideoFormat out_format, guint n_threads, gint dither)
+{
+  GstElement *csp;
+
+  csp = gst_check_setup_element ("colorspace");
+  g_object_set (csp, "n-threads", n_threads, "dither", dither, NULL);
+
+  sink_caps = gst_video_format_new_caps (out_format, WIDTH, HEIGHT, 25, 1, 1,
+      1);
+  mysrcpad = gst_check_setup_src_pad (csp, &srctemplate, NULL);
+  mysinkpad = gst_check_setup_sink_pad (csp, &sinktemplate, NULL);
+  gst_pad_set_getcaps_function (mysinkpad, sink_getcaps);
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  fail_unless (gst_element_set_state (csp, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_SUCCESS);
+
+  return csp;
+}
+
+static void
+cleanup_colorspace (GstElement * csp)
+{
+  gst_element_set_state (csp, GST_STATE_NULL);
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_src_pad (csp);
+  gst_check_teardown_sink_pad (csp);
+  gst_check_teardown_element (csp);
+  gst_caps_unref (sink_caps);
+  sink_caps = NULL;
+}
+
+/* converts @inbuf N_FRAMES times, returns the last output and stores the
+ * time per frame in @elapsed */
+static GstBuffer *
+convert (GstBuffer * inbuf, GstVideoFormat out_format, guint n_threads,
+    gint dither, gdouble * elapsed)
+{
+  GstElement *csp;
+  GstBuffer *outbuf = NULL;
+  GTimer *timer;
+  guint i;
+
+  csp = setup_colorspace (out_format, n_threads, dither);
+
+  timer = g_timer_new ();
+  for (i = 0; i < N_FRAMES; i++) {
+    fail_unless_equals_int (gst_pad_push (mysrcpad, gst_buffer_ref (inbuf)),
+        GST_FLOW_OK);
+    fail_unless_equals_int (g_list_length (buffers), 1);
+    if (outbuf)
+      gst_buffer_unref (outbuf);
+    outbuf = buffers->data;
+    buffers = g_list_delete_link (buffers, buffers);
+  }
+  *elapsed = g_timer_elapsed (timer, NULL) / N_FRAMES;
+  g_timer_destroy (timer);
+
+  cleanup_colorspace (csp);
+
+  return outbuf;
+}
+
+static void
+check_threads (GstVideoFormat in_format, GstVideoFormat out_format,
+    gint dither)
+{
+  static const guint n_threads[] = { 2, 3, 4, 8, 16 };
+  GstBuffer *inbuf, *ref, *outbuf;
+  GstCaps *caps;
+  gdouble ref_elapsed, elapsed;
+  guint8 *data;
+  guint i, size;
+
+  size = gst_video_format_get_size (in_format, WIDTH, HEIGHT);
+  inbuf = gst_buffer_new_and_alloc (size);
+  data = GST_BUFFER_DATA (inbuf);
+  g_random_set_seed (1);
+  for (i = 0; i < size; i++)
+    data[i] = g_random_int () & 0xff;
+  caps = gst_video_format_new_caps (in_format, WIDTH, HEIGHT, 25, 1, 1, 1);
+  gst_buffer_set_caps (inbuf, caps);
+  gst_caps_unref (caps);
+
+  ref = convert (inbuf, out_format, 1, dither, &ref_elapsed);
+  GST_INFO ("%" GST_FOURCC_FORMAT " -> %" GST_FOURCC_FORMAT
+      ", 1 thread: %f s per frame",
+      GST_FOURCC_ARGS (gst_video_format_to_fourcc (in_format)),
+      GST_FOURCC_ARGS (gst_video_format_to_fourcc (out_format)), ref_elapsed);
+
+  for (i = 0; i < G_N_ELEMENTS (n_threads); i++) {
+    outbuf = convert (inbuf, out_format, n_threads[i], dither, &elapsed);
+    GST_INFO ("%" GST_FOURCC_FORMAT " -> %" GST_FOURCC_FORMAT
+        ", %u threads: %f s per frame, speedup %.2f",
+        GST_FOURCC_ARGS (gst_video_format_to_fourcc (in_format)),
+        GST_FOURCC_ARGS (gst_video_format_to_fourcc (out_format)),
+        n_threads[i], elapsed, ref_elapsed / elapsed);
+
+    /* the bands produce exactly what a single thread does */
+    fail_unless_equals_int (GST_BUFFER_SIZE (outbuf), GST_BUFFER_SIZE (ref));
+    fail_unless (memcmp (GST_BUFFER_DATA (outbuf), GST_BUFFER_DATA (ref),
+            GST_BUFFER_SIZE (ref)) == 0);
+    gst_buffer_unref (outbuf);
+  }
+
+  gst_buffer_unref (ref);
+  gst_buffer_unref (inbuf);
+}
+
+/* fast path */
+GST_START_TEST (test_threads_UYVY)
+{
+  check_threads (GST_VIDEO_FORMAT_UYVY, GST_VIDEO_FORMAT_I420, 0);
+}
+
+GST_END_TEST;
+
+/* generic 8 bit path, with 4:2:0 chroma */
+GST_START_TEST (test_threads_I420)
+{
+  check_threads (GST_VIDEO_FORMAT_I420, GST_VIDEO_FORMAT_Y41B, 0);
+}
+
+GST_END_TEST;
+
+/* generic 16 bit path, plain and with halftone dithering */
+GST_START_TEST (test_threads_v210)
+{
+  check_threads (GST_VIDEO_FORMAT_v210, GST_VIDEO_FORMAT_UYVY, 0);
+  check_threads (GST_VIDEO_FORMAT_v210, GST_VIDEO_FORMAT_UYVY, 2);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_threads_AYUV64)
+{
+  check_threads (GST_VIDEO_FORMAT_AYUV64, GST_VIDEO_FORMAT_v210, 0);
+}
+
+GST_END_TEST;
+
+static Suite *
+colorspace_suite (void)
+{
+  Suite *s = suite_create ("colorspace");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_set_timeout (tc_chain, 180);
+  tcase_add_test (tc_chain, test_threads_UYVY);
+  tcase_add_test (tc_chain, test_threads_I420);
+  tcase_add_test (tc_chain, test_threads_v210);
+  tcase_add_test (tc_chain, test_threads_AYUV64);
+
+  return s;
+}
+
+GST_CHECK_MAIN (colorspace);
@@ -0,0 +1,200 @@
+/* GStreamer
+ *
+ * unit tests for the 10 bit fast paths of colorspace
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+
+#include <string.h>
+
+#include "colorspace.h"
+
+#define N_FRAMES 10
+
+/* fills a frame of @format with random data, padding included */
+static guint8 *
+make_frame (GstVideoFormat format, gint width, gint height)
+{
+  guint8 *data;
+  gint i, size;
+
+  size = gst_video_format_get_size (format, width, height);
+  data = g_malloc (size);
+  for (i = 0; i < size; i++)
+    data[i] = g_random_int () & 0xff;
+
+  return data;
+}
+
+/* Compares two v210 frames in the samples the generic path defines. It
+ * packs whole groups of 6 pixels from a line that is only @defined pixels
+ * long, the samples past it and the chroma averaged with them are left
+ * undefined */
+static void
+check_v210 (const guint8 * fast, const guint8 * generic, gint defined,
+    gint width, gint height)
+{
+  gint stride = gst_video_format_get_row_stride (GST_VIDEO_FORMAT_v210, 0,
+      width);
+  gint i, j, k;
+
+  for (j = 0; j < height; j++) {
+    for (i = 0; i < (width + 5) / 6 * 4; i++) {
+      guint32 a = GST_READ_UINT32_LE (fast + j * stride + i * 4);
+      guint32 b = GST_READ_UINT32_LE (generic + j * stride + i * 4);
+
+      for (k = 0; k < 3; k++) {
+        /* the position of the sample in the line, in 4:2:2 order of
+         * Cb Y Cr Y */
+        gint pos = (i * 3 + k) % 4;
+        gint pixel = (i * 3 + k) / 4 * 2;
+        gboolean is_defined;
+
+        if (pos == 1 || pos == 3)
+          is_defined = pixel + pos / 2 < defined;
+        else
+          is_defined = pixel + 1 < defined;
+
+        if (is_defined)
+          fail_unless_equals_int ((a >> (10 * k)) & 0x3ff,
+              (b >> (10 * k)) & 0x3ff);
+      }
+    }
+  }
+}
+
+static void
+check_frame (GstVideoFormat from, GstVideoFormat to, const guint8 * fast,
+    const guint8 * generic, gint width, gint height)
+{
+  /* the generic path reads UYVY only in whole macropixels */
+  if (to == GST_VIDEO_FORMAT_v210)
+    check_v210 (fast, generic,
+        from == GST_VIDEO_FORMAT_UYVY ? width & ~1 : width, width, height);
+  else
+    fail_unless (memcmp (fast, generic, gst_video_format_get_size (to, width,
+                height)) == 0);
+}
+
+/* converts with the fast path and with the generic path and checks that
+ * both give the same frame, also when split into bands */
+static void
+check_fast_path (GstVideoFormat from, GstVideoFormat to,
+    ColorSpaceColorSpec spec, gint width, gint height)
+{
+  ColorspaceConvert *convert;
+  guint8 *src, *fast, *generic;
+  gint i, size;
+  GTimer *timer;
+  gdouble fast_elapsed, generic_elapsed;
+
+  size = gst_video_format_get_size (to, width, height);
+  src = make_frame (from, width, height);
+  fast = g_malloc0 (size);
+  generic = g_malloc0 (size);
+
+  convert = colorspace_convert_new (to, spec, from, spec, width, height);
+  fail_unless (convert != NULL);
+  fail_if (convert->convert == colorspace_convert_generic);
+
+  timer = g_timer_new ();
+  for (i = 0; i < N_FRAMES; i++)
+    colorspace_convert_convert (convert, fast, src);
+  fast_elapsed = g_timer_elapsed (timer, NULL) / N_FRAMES;
+
+  g_timer_start (timer);
+  for (i = 0; i < N_FRAMES; i++)
+    colorspace_convert_generic (convert, generic, src);
+  generic_elapsed = g_timer_elapsed (timer, NULL) / N_FRAMES;
+  g_timer_destroy (timer);
+
+  GST_INFO ("%" GST_FOURCC_FORMAT " -> %" GST_FOURCC_FORMAT " %dx%d: "
+      "fast %f s, generic %f s per frame",
+      GST_FOURCC_ARGS (gst_video_format_to_fourcc (from)),
+      GST_FOURCC_ARGS (gst_video_format_to_fourcc (to)), width, height,
+      fast_elapsed, generic_elapsed);
+
+  check_frame (from, to, fast, generic, width, height);
+
+  memset (fast, 0, size);
+  colorspace_convert_set_n_threads (convert, 5);
+  colorspace_convert_convert (convert, fast, src);
+  check_frame (from, to, fast, generic, width, height);
+
+  colorspace_convert_free (convert);
+  g_free (src);
+  g_free (fast);
+  g_free (generic);
+}
+
+/* odd heights for a lone last chroma line, and widths that end in a
+ * partial v210 group or with a single pixel of a chroma pair */
+static const gint sizes[][2] = {
+  {1920, 1081}, {720, 576}, {12, 7}, {18, 3}, {1, 5}, {5, 4}, {7, 3}
+};
+
+GST_START_TEST (test_v210)
+{
+  gint i;
+
+  for (i = 0; i < G_N_ELEMENTS (sizes); i++) {
+    check_fast_path (GST_VIDEO_FORMAT_v210, GST_VIDEO_FORMAT_I420,
+        COLOR_SPEC_YUV_BT709, sizes[i][0], sizes[i][1]);
+    check_fast_path (GST_VIDEO_FORMAT_v210, GST_VIDEO_FORMAT_UYVY,
+        COLOR_SPEC_YUV_BT709, sizes[i][0], sizes[i][1]);
+    check_fast_path (GST_VIDEO_FORMAT_I420, GST_VIDEO_FORMAT_v210,
+        COLOR_SPEC_YUV_BT709, sizes[i][0], sizes[i][1]);
+    check_fast_path (GST_VIDEO_FORMAT_UYVY, GST_VIDEO_FORMAT_v210,
+        COLOR_SPEC_YUV_BT709, sizes[i][0], sizes[i][1]);
+    check_fast_path (GST_VIDEO_FORMAT_v210, GST_VIDEO_FORMAT_AYUV64,
+        COLOR_SPEC_YUV_BT709, sizes[i][0], sizes[i][1]);
+    check_fast_path (GST_VIDEO_FORMAT_AYUV64, GST_VIDEO_FORMAT_v210,
+        COLOR_SPEC_YUV_BT709, sizes[i][0], sizes[i][1]);
+  }
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_r210)
+{
+  gint i;
+
+  for (i = 0; i < G_N_ELEMENTS (sizes); i++) {
+    check_fast_path (GST_VIDEO_FORMAT_r210, GST_VIDEO_FORMAT_ARGB64,
+        COLOR_SPEC_RGB, sizes[i][0], sizes[i][1]);
+    check_fast_path (GST_VIDEO_FORMAT_ARGB64, GST_VIDEO_FORMAT_r210,
+        COLOR_SPEC_RGB, sizes[i][0], sizes[i][1]);
+  }
+}
+
+GST_END_TEST;
+
+static Suite *
+colorspace_fastpath_suite (void)
+{
+  Suite *s = suite_create ("colorspace_fastpath");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_v210);
+  tcase_add_test (tc_chain, test_r210);
+
+  return s;
+}
+
+GST_CHECK_MAIN (colorspace_fastpath);
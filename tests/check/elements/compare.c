@@ -0,0 +1,314 @@
+/* GStreamer
+ *
+ * unit tests for the quality report of compare
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+
+static GstPad *mysrcpad, *mycheckpad, *mysinkpad;
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+#define WIDTH 176
+#define HEIGHT 144
+#define N_FRAMES 20
+/* difference of the modified pixel of the odd frames */
+#define MAX_DIFF 7
+
+static GstElement *
+setup_compare (const gchar * location, gint report_format, guint n_threads)
+{
+  GstElement *compare;
+  GstPad *pad;
+
+  compare = gst_check_setup_element ("compare");
+  g_object_set (compare, "location", location, "report-format",
+      report_format, "n-threads", n_threads, NULL);
+
+  mysrcpad = gst_pad_new_from_static_template (&srctemplate, "src");
+  pad = gst_element_get_static_pad (compare, "sink");
+  fail_unless_equals_int (gst_pad_link (mysrcpad, pad), GST_PAD_LINK_OK);
+  gst_object_unref (pad);
+
+  mycheckpad = gst_pad_new_from_static_template (&srctemplate, "checksrc");
+  pad = gst_element_get_static_pad (compare, "check");
+  fail_unless_equals_int (gst_pad_link (mycheckpad, pad), GST_PAD_LINK_OK);
+  gst_object_unref (pad);
+
+  mysinkpad = gst_pad_new_from_static_template (&sinktemplate, "sink");
+  gst_pad_set_chain_function (mysinkpad, gst_check_chain_func);
+  pad = gst_element_get_static_pad (compare, "src");
+  fail_unless_equals_int (gst_pad_link (pad, mysinkpad), GST_PAD_LINK_OK);
+  gst_object_unref (pad);
+
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mycheckpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+  fail_unless_equals_int (gst_element_set_state (compare, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+
+  return compare;
+}
+
+static void
+cleanup_compare (GstElement * compare)
+{
+  /* writes the pending records */
+  gst_element_set_state (compare, GST_STATE_NULL);
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mycheckpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_object_unref (mysrcpad);
+  gst_object_unref (mycheckpad);
+  gst_object_unref (mysinkpad);
+  gst_check_drop_buffers ();
+  gst_check_teardown_element (compare);
+}
+
+/* an I420 frame with a random Y plane, or @org with a pixel of the Y plane
+ * changed by MAX_DIFF */
+static GstBuffer *
+make_frame (gint width, gint height, gint n, GstBuffer * org)
+{
+  GstBuffer *buf;
+  GstCaps *caps;
+  guint8 *data;
+  gint i;
+
+  buf = gst_buffer_new_and_alloc (width * height * 3 / 2);
+  data = GST_BUFFER_DATA (buf);
+  if (org == NULL) {
+    for (i = 0; i < width * height; i++)
+      data[i] = g_random_int_range (0, 256);
+    memset (data + width * height, 128, width * height / 2);
+  } else {
+    memcpy (data, GST_BUFFER_DATA (org), GST_BUFFER_SIZE (org));
+    i = g_random_int_range (0, width * height);
+    data[i] += (data[i] < 128) ? MAX_DIFF : -MAX_DIFF;
+  }
+
+  caps = gst_caps_new_simple ("video/x-raw-yuv",
+      "format", GST_TYPE_FOURCC, GST_MAKE_FOURCC ('I', '4', '2', '0'),
+      "width", G_TYPE_INT, width, "height", G_TYPE_INT, height,
+      "framerate", GST_TYPE_FRACTION, 25, 1, NULL);
+  gst_buffer_set_caps (buf, caps);
+  gst_caps_unref (caps);
+  GST_BUFFER_TIMESTAMP (buf) = n * GST_SECOND / 25;
+  GST_BUFFER_DURATION (buf) = GST_SECOND / 25;
+
+  return buf;
+}
+
+static gpointer
+push_check (gpointer data)
+{
+  return GINT_TO_POINTER (gst_pad_push (mycheckpad, data));
+}
+
+/* collectpads blocks a pad until the buffers of all pads are there, so the
+ * checked buffer is pushed from another thread.  The odd frames differ.
+ * Returns the time spent pushing */
+static gdouble
+push_frames (gint width, gint height, gint n_frames)
+{
+  GTimer *timer;
+  gdouble elapsed = 0;
+  gint i;
+
+  timer = g_timer_new ();
+  for (i = 0; i < n_frames; i++) {
+    GstBuffer *buf, *check;
+    GThread *thread;
+
+    buf = make_frame (width, height, i, NULL);
+    if (i % 2)
+      check = make_frame (width, height, i, buf);
+    else
+      check = gst_buffer_ref (buf);
+
+    g_timer_start (timer);
+    thread = g_thread_create (push_check, check, TRUE, NULL);
+    fail_unless_equals_int (gst_pad_push (mysrcpad, buf), GST_FLOW_OK);
+    fail_unless_equals_int (GPOINTER_TO_INT (g_thread_join (thread)),
+        GST_FLOW_OK);
+    elapsed += g_timer_elapsed (timer, NULL);
+  }
+  g_timer_destroy (timer);
+
+  /* everything was pushed on, whether measured or not */
+  fail_unless_equals_int (g_list_length (buffers), n_frames);
+  gst_check_drop_buffers ();
+
+  return elapsed;
+}
+
+static gchar *
+make_location (void)
+{
+  gchar *location;
+  gint fd;
+
+  fd = g_file_open_tmp ("compare-XXXXXX", &location, NULL);
+  fail_unless (fd >= 0);
+  close (fd);
+
+  return location;
+}
+
+GST_START_TEST (test_report_csv)
+{
+  GstElement *compare;
+  gchar *location, *contents, **lines;
+  gint i;
+
+  location = make_location ();
+  compare = setup_compare (location, 0, 3);
+  push_frames (WIDTH, HEIGHT, N_FRAMES);
+  cleanup_compare (compare);
+
+  fail_unless (g_file_get_contents (location, &contents, NULL, NULL));
+  lines = g_strsplit (contents, "\n", -1);
+  fail_unless_equals_string (lines[0],
+      "frame,timestamp,plane,psnr,ssim,max-diff");
+
+  /* a line per plane, in frame order */
+  fail_unless_equals_int (g_strv_length (lines), 1 + N_FRAMES * 3 + 1);
+  fail_unless_equals_string (lines[N_FRAMES * 3 + 1], "");
+  for (i = 0; i < N_FRAMES * 3; i++) {
+    gchar **fields = g_strsplit (lines[i + 1], ",", -1);
+    gint frame = i / 3, plane = i % 3;
+    gboolean differs = (frame % 2) && plane == 0;
+    gdouble psnr, ssim;
+
+    fail_unless_equals_int (g_strv_length (fields), 6);
+    fail_unless_equals_int (atoi (fields[0]), frame);
+    fail_unless (g_ascii_strtoull (fields[1], NULL, 10) ==
+        frame * GST_SECOND / 25);
+    fail_unless_equals_int (atoi (fields[2]), plane);
+    psnr = g_ascii_strtod (fields[3], NULL);
+    ssim = g_ascii_strtod (fields[4], NULL);
+    if (differs) {
+      fail_unless (fabs (psnr - 10 * log10 (255.0 * 255.0 * WIDTH * HEIGHT /
+                  (MAX_DIFF * MAX_DIFF))) < 0.001);
+      fail_unless (ssim > 0.99 && ssim <= 1.0);
+      fail_unless_equals_int (atoi (fields[5]), MAX_DIFF);
+    } else {
+      fail_unless (isinf (psnr));
+      fail_unless (ssim == 1.0);
+      fail_unless_equals_int (atoi (fields[5]), 0);
+    }
+    g_strfreev (fields);
+  }
+
+  g_strfreev (lines);
+  g_free (contents);
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_report_binary)
+{
+  GstElement *compare;
+  gchar *location, *contents;
+  gsize size;
+  gint i;
+
+  location = make_location ();
+  compare = setup_compare (location, 1, 2);
+  push_frames (WIDTH, HEIGHT, N_FRAMES);
+  cleanup_compare (compare);
+
+  fail_unless (g_file_get_contents (location, &contents, &size, NULL));
+  fail_unless_equals_int (size, N_FRAMES * (17 + 3 * 9));
+  for (i = 0; i < N_FRAMES; i++) {
+    guint8 *record = (guint8 *) contents + i * (17 + 3 * 9);
+
+    fail_unless (GST_READ_UINT64_LE (record) == i);
+    fail_unless (GST_READ_UINT64_LE (record + 8) == i * GST_SECOND / 25);
+    fail_unless_equals_int (GST_READ_UINT8 (record + 16), 3);
+    fail_unless_equals_int (GST_READ_UINT8 (record + 17 + 8),
+        (i % 2) ? MAX_DIFF : 0);
+    fail_unless (GST_READ_FLOAT_LE (record + 17 + 9 + 4) == 1.0);
+  }
+
+  g_free (contents);
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+/* measuring happens in the workers, the streaming thread only queues */
+GST_START_TEST (test_report_throughput)
+{
+  static const guint n_threads[] = { 1, 4 };
+  GstElement *compare;
+  gchar *location;
+  GTimer *timer;
+  gdouble pushed, elapsed;
+  gint i;
+
+  location = make_location ();
+  for (i = 0; i < G_N_ELEMENTS (n_threads); i++) {
+    timer = g_timer_new ();
+    compare = setup_compare (location, 0, n_threads[i]);
+    pushed = push_frames (1920, 1080, 25);
+    cleanup_compare (compare);
+    elapsed = g_timer_elapsed (timer, NULL);
+    g_timer_destroy (timer);
+
+    GST_INFO ("%u threads: pushed in %f s, measured in %f s, %.1f frames/s",
+        n_threads[i], pushed, elapsed, 25 / elapsed);
+  }
+
+  g_unlink (location);
+  g_free (location);
+}
+
+GST_END_TEST;
+
+static Suite *
+compare_suite (void)
+{
+  Suite *s = suite_create ("compare");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_set_timeout (tc_chain, 120);
+  tcase_add_test (tc_chain, test_report_csv);
+  tcase_add_test (tc_chain, test_report_binary);
+  tcase_add_test (tc_chain, test_report_throughput);
+
+  return s;
+}
+
+GST_CHECK_MAIN (compare);
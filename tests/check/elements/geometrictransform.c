@@ -0,0 +1,254 @@
+/* GStreamer
+ *
+ * unit tests and benchmark for the remapping of the geometric transforms
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/video/video.h>
+
+#include <string.h>
+
+static GstPad *mysrcpad, *mysinkpad;
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+#define N_FRAMES 10
+
+/* the effects with a precalculated map, diffuse maps every frame anew */
+static const gchar *effects[] = { "bulge", "circle", "fisheye",
+  "kaleidoscope", "marble", "mirror", "pinch", "rotate", "sphere", "square",
+  "stretch", "tunnel", "twirl", "waterripple"
+};
+
+static GstElement *
+setup_effect (const gchar * name, gint off_edge_pixels)
+{
+  GstElement *effect;
+
+  effect = gst_check_setup_element (name);
+  g_object_set (effect, "off-edge-pixels", off_edge_pixels, NULL);
+  mysrcpad = gst_check_setup_src_pad (effect, &srctemplate, NULL);
+  mysinkpad = gst_check_setup_sink_pad (effect, &sinktemplate, NULL);
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  fail_unless (gst_element_set_state (effect, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_SUCCESS);
+
+  return effect;
+}
+
+static void
+cleanup_effect (GstElement * effect)
+{
+  gst_element_set_state (effect, GST_STATE_NULL);
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_src_pad (effect);
+  gst_check_teardown_sink_pad (effect);
+  gst_check_teardown_element (effect);
+}
+
+/* a frame of random pixels, padding included */
+static GstBuffer *
+make_frame (GstVideoFormat format, gint width, gint height)
+{
+  GstBuffer *buf;
+  GstCaps *caps;
+  guint8 *data;
+  guint i, size;
+
+  size = gst_video_format_get_size (format, width, height);
+  buf = gst_buffer_new_and_alloc (size);
+  data = GST_BUFFER_DATA (buf);
+  for (i = 0; i < size; i++)
+    data[i] = g_random_int () & 0xff;
+  caps = gst_video_format_new_caps (format, width, height, 25, 1, 1, 1);
+  gst_buffer_set_caps (buf, caps);
+  gst_caps_unref (caps);
+
+  return buf;
+}
+
+/* transforms @inbuf N_FRAMES times with @n_threads, returns the last output
+ * and stores the time per frame in @elapsed */
+static GstBuffer *
+transform (GstElement * effect, GstBuffer * inbuf, guint n_threads,
+    gdouble * elapsed)
+{
+  GstBuffer *outbuf = NULL;
+  GTimer *timer;
+  guint i;
+
+  g_object_set (effect, "n-threads", n_threads, NULL);
+
+  timer = g_timer_new ();
+  for (i = 0; i < N_FRAMES; i++) {
+    fail_unless_equals_int (gst_pad_push (mysrcpad, gst_buffer_ref (inbuf)),
+        GST_FLOW_OK);
+    fail_unless_equals_int (g_list_length (buffers), 1);
+    if (outbuf)
+      gst_buffer_unref (outbuf);
+    outbuf = buffers->data;
+    buffers = g_list_delete_link (buffers, buffers);
+  }
+  *elapsed = g_timer_elapsed (timer, NULL) / N_FRAMES;
+  g_timer_destroy (timer);
+
+  return outbuf;
+}
+
+/* the same element with the same map remaps with 1 and with @n_threads,
+ * the bands must produce exactly what a single thread does */
+static void
+check_threads (const gchar * name, GstVideoFormat format, gint width,
+    gint height, gint off_edge_pixels, guint n_threads)
+{
+  GstElement *effect;
+  GstBuffer *inbuf, *ref, *outbuf;
+  gdouble ref_elapsed, elapsed;
+
+  inbuf = make_frame (format, width, height);
+  effect = setup_effect (name, off_edge_pixels);
+
+  ref = transform (effect, inbuf, 1, &ref_elapsed);
+  outbuf = transform (effect, inbuf, n_threads, &elapsed);
+  GST_INFO ("%s %dx%d, off-edge-pixels %d: %.1f fps, %u threads: %.1f fps",
+      name, width, height, off_edge_pixels, 1 / ref_elapsed, n_threads,
+      1 / elapsed);
+
+  fail_unless_equals_int (GST_BUFFER_SIZE (outbuf), GST_BUFFER_SIZE (ref));
+  fail_unless (memcmp (GST_BUFFER_DATA (outbuf), GST_BUFFER_DATA (ref),
+          GST_BUFFER_SIZE (ref)) == 0);
+
+  gst_buffer_unref (outbuf);
+  gst_buffer_unref (ref);
+  cleanup_effect (effect);
+  gst_buffer_unref (inbuf);
+}
+
+/* mirror reflects the left half exactly, which checks the copies of all
+ * pixel sizes and the black padding of odd widths */
+static void
+check_mirror (GstVideoFormat format, guint n_threads)
+{
+  const gint width = 175, height = 143;
+  GstElement *effect;
+  GstBuffer *inbuf, *outbuf;
+  gint x, y, pixel_stride, row_stride;
+  gdouble elapsed;
+  guint8 *in, *out;
+
+  inbuf = make_frame (format, width, height);
+  effect = setup_effect ("mirror", 0);
+  outbuf = transform (effect, inbuf, n_threads, &elapsed);
+
+  pixel_stride = gst_video_format_get_pixel_stride (format, 0);
+  row_stride = gst_video_format_get_row_stride (format, 0, width);
+  for (y = 0; y < height; y++) {
+    in = GST_BUFFER_DATA (inbuf) + y * row_stride;
+    out = GST_BUFFER_DATA (outbuf) + y * row_stride;
+    for (x = 0; x < width; x++) {
+      gint in_x = (x > width / 2.0 - 1.0) ? width - 1 - x : x;
+
+      fail_unless (memcmp (out + x * pixel_stride, in + in_x * pixel_stride,
+              pixel_stride) == 0);
+    }
+    for (x = width * pixel_stride; x < row_stride; x++)
+      fail_unless_equals_int (out[x], 0);
+  }
+
+  gst_buffer_unref (outbuf);
+  cleanup_effect (effect);
+  gst_buffer_unref (inbuf);
+}
+
+GST_START_TEST (test_mirror)
+{
+  static const GstVideoFormat formats[] = { GST_VIDEO_FORMAT_GRAY8,
+    GST_VIDEO_FORMAT_GRAY16_LE, GST_VIDEO_FORMAT_RGB, GST_VIDEO_FORMAT_xRGB
+  };
+  gint i;
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++) {
+    check_mirror (formats[i], 1);
+    check_mirror (formats[i], 3);
+  }
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_off_edge_pixels)
+{
+  gint i, off_edge_pixels;
+
+  for (i = 0; i < G_N_ELEMENTS (effects); i++) {
+    for (off_edge_pixels = 0; off_edge_pixels < 3; off_edge_pixels++)
+      check_threads (effects[i], GST_VIDEO_FORMAT_RGB, 319, 241,
+          off_edge_pixels, 3);
+  }
+}
+
+GST_END_TEST;
+
+/* fps of every effect at 1080p */
+GST_START_TEST (test_benchmark)
+{
+  GstElement *effect;
+  GstBuffer *inbuf, *outbuf;
+  gdouble elapsed;
+  gint i;
+
+  for (i = 0; i < G_N_ELEMENTS (effects); i++)
+    check_threads (effects[i], GST_VIDEO_FORMAT_xRGB, 1920, 1080, 1, 4);
+
+  /* not threaded */
+  inbuf = make_frame (GST_VIDEO_FORMAT_xRGB, 1920, 1080);
+  effect = setup_effect ("diffuse", 1);
+  outbuf = transform (effect, inbuf, 1, &elapsed);
+  GST_INFO ("diffuse 1920x1080: %.1f fps", 1 / elapsed);
+  gst_buffer_unref (outbuf);
+  cleanup_effect (effect);
+  gst_buffer_unref (inbuf);
+}
+
+GST_END_TEST;
+
+static Suite *
+geometrictransform_suite (void)
+{
+  Suite *s = suite_create ("geometrictransform");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_set_timeout (tc_chain, 180);
+  tcase_add_test (tc_chain, test_mirror);
+  tcase_add_test (tc_chain, test_off_edge_pixels);
+  tcase_add_test (tc_chain, test_benchmark);
+
+  return s;
+}
+
+GST_CHECK_MAIN (geometrictransform);
@@ -43,6 +43,13 @@ GstStaticPadTemplate sinktemplate_avc_au = GST_STATIC_PAD_TEMPLATE ("sink",
         ", stream-format = (string) avc, alignment = (string) au")
     );
 
+GstStaticPadTemplate sinktemplate_bs_au = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (SINK_CAPS_TMPL
+        ", stream-format = (string) byte-stream, alignment = (string) au")
+    );
+
 GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
     GST_PAD_ALWAYS,
@@ -319,6 +326,118 @@ h264parse_packetized_suite (void)
 }
 
 
+/* 4k sized access units, each made of many slices, with the parameter sets
+ * repeated with every keyframe as broadcast streams do */
+#define MS_FRAMES 60
+#define MS_SLICES 16
+#define MS_SLICE_SIZE (32 * 1024)
+#define MS_GOP 10
+
+static guint8 *
+make_multislice_stream (guint * size)
+{
+  guint8 *data, *p;
+  guint i, j;
+
+  data = g_malloc (MS_FRAMES * (sizeof (h264_sps) + sizeof (h264_pps) +
+          MS_SLICES * MS_SLICE_SIZE));
+  p = data;
+  for (i = 0; i < MS_FRAMES; i++) {
+    gboolean key = (i % MS_GOP == 0);
+
+    if (key) {
+      memcpy (p, h264_sps, sizeof (h264_sps));
+      p += sizeof (h264_sps);
+      memcpy (p, h264_pps, sizeof (h264_pps));
+      p += sizeof (h264_pps);
+    }
+    for (j = 0; j < MS_SLICES; j++) {
+      GST_WRITE_UINT32_BE (p, 1);
+      p[4] = key ? 0x65 : 0x41;
+      /* first_mb_in_slice is 0 for the first slice only */
+      p[5] = (j == 0) ? 0x88 : 0x40;
+      memset (p + 6, 0xff, MS_SLICE_SIZE - 6);
+      p += MS_SLICE_SIZE;
+    }
+  }
+  *size = p - data;
+
+  return data;
+}
+
+GST_START_TEST (test_parse_multislice)
+{
+  GstElement *h264parse;
+  GstPad *srcpad, *sinkpad;
+  GstBuffer *buffer;
+  GstCaps *caps;
+  GTimer *timer;
+  GList *l;
+  guint8 *data;
+  guint size, n_keyframes = 0;
+
+  h264parse = gst_check_setup_element ("h264parse");
+  srcpad = gst_check_setup_src_pad (h264parse, &srctemplate, NULL);
+  sinkpad = gst_check_setup_sink_pad (h264parse, &sinktemplate_bs_au, NULL);
+  gst_pad_set_active (srcpad, TRUE);
+  gst_pad_set_active (sinkpad, TRUE);
+  fail_unless_equals_int (gst_element_set_state (h264parse, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+
+  data = make_multislice_stream (&size);
+  buffer = gst_buffer_new ();
+  GST_BUFFER_DATA (buffer) = GST_BUFFER_MALLOCDATA (buffer) = data;
+  GST_BUFFER_SIZE (buffer) = size;
+  caps = gst_caps_from_string (SRC_CAPS_TMPL
+      ", stream-format = (string) byte-stream");
+  gst_buffer_set_caps (buffer, caps);
+  gst_caps_unref (caps);
+
+  timer = g_timer_new ();
+  fail_unless_equals_int (gst_pad_push (srcpad, buffer), GST_FLOW_OK);
+  fail_unless (gst_pad_push_event (srcpad, gst_event_new_eos ()));
+  GST_INFO ("%u slices per frame: %f ms per frame", MS_SLICES,
+      g_timer_elapsed (timer, NULL) * 1000 / MS_FRAMES);
+  g_timer_destroy (timer);
+
+  /* one buffer per access unit, parameter sets included */
+  fail_unless_equals_int (g_list_length (buffers), MS_FRAMES);
+  for (l = buffers; l; l = l->next) {
+    buffer = l->data;
+    if (!GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT))
+      n_keyframes++;
+  }
+  fail_unless_equals_int (n_keyframes, MS_FRAMES / MS_GOP);
+  fail_unless_equals_int (GST_BUFFER_SIZE (buffers->data),
+      sizeof (h264_sps) + sizeof (h264_pps) + MS_SLICES * MS_SLICE_SIZE);
+  fail_unless_equals_int (GST_BUFFER_SIZE (buffers->next->data),
+      MS_SLICES * MS_SLICE_SIZE);
+
+  gst_check_drop_buffers ();
+  gst_element_set_state (h264parse, GST_STATE_NULL);
+  gst_pad_set_active (srcpad, FALSE);
+  gst_pad_set_active (sinkpad, FALSE);
+  gst_check_teardown_src_pad (h264parse);
+  gst_check_teardown_sink_pad (h264parse);
+  gst_check_teardown_element (h264parse);
+}
+
+GST_END_TEST;
+
+static Suite *
+h264parse_multislice_suite (void)
+{
+  Suite *s = suite_create ("h264parse_multislice");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_set_timeout (tc_chain, 60);
+  tcase_add_test (tc_chain, test_parse_multislice);
+
+  return s;
+}
+
+
 /*
  * TODO:
  *   - Both push- and pull-modes need to be tested
@@ -389,5 +508,11 @@ main (int argc, char **argv)
   nf += srunner_ntests_failed (sr);
   srunner_free (sr);
 
+  s = h264parse_multislice_suite ();
+  sr = srunner_create (s);
+  srunner_run_all (sr, CK_NORMAL);
+  nf += srunner_ntests_failed (sr);
+  srunner_free (sr);
+
   return nf;
 }
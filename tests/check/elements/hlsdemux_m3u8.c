@@ -0,0 +1,204 @@
+/* GStreamer
+ *
+ * unit tests for the m3u8 playlist parser of hlsdemux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+
+#include "m3u8.h"
+
+GST_DEBUG_CATEGORY (fragmented_debug);
+
+#define TARGET_DURATION 10
+
+/* a playlist with the files @first .. @last, without ENDLIST unless @ended */
+static gchar *
+make_playlist (guint first, guint last, gboolean ended)
+{
+  GString *playlist;
+  guint i;
+
+  playlist = g_string_new ("#EXTM3U\n");
+  g_string_append_printf (playlist, "#EXT-X-TARGETDURATION:%d\n",
+      TARGET_DURATION);
+  g_string_append_printf (playlist, "#EXT-X-MEDIA-SEQUENCE:%u\n", first);
+  for (i = first; i <= last; i++) {
+    g_string_append_printf (playlist, "#EXTINF:%d,\n", TARGET_DURATION);
+    g_string_append_printf (playlist, "http://localhost/%u.ts\n", i);
+  }
+  if (ended)
+    g_string_append (playlist, "#EXT-X-ENDLIST\n");
+
+  return g_string_free (playlist, FALSE);
+}
+
+static void
+check_files (GstM3U8 * m3u8, guint first, guint last)
+{
+  GstM3U8MediaFile *file;
+  gchar *uri;
+  guint i;
+
+  fail_unless_equals_int (m3u8->files->len, last - first + 1);
+  for (i = 0; i < m3u8->files->len; i++) {
+    file = g_ptr_array_index (m3u8->files, i);
+    uri = g_strdup_printf ("http://localhost/%u.ts", first + i);
+    fail_unless_equals_int (file->sequence, first + i);
+    fail_unless_equals_string (file->uri, uri);
+    fail_unless_equals_int (file->duration, TARGET_DURATION);
+    g_free (uri);
+  }
+}
+
+GST_START_TEST (test_parse)
+{
+  GstM3U8Client *client;
+  const gchar *uri;
+  GstClockTime duration, timestamp;
+  gboolean discont;
+
+  client = gst_m3u8_client_new ("http://localhost/playlist.m3u8");
+  fail_unless (gst_m3u8_client_update (client, make_playlist (0, 9, TRUE)));
+  check_files (client->current, 0, 9);
+
+  fail_unless_equals_uint64 (gst_m3u8_client_get_duration (client),
+      10 * TARGET_DURATION * GST_SECOND);
+
+  client->sequence = 4;
+  fail_unless (gst_m3u8_client_get_next_fragment (client, &discont, &uri,
+          &duration, &timestamp));
+  fail_unless_equals_string (uri, "http://localhost/4.ts");
+  fail_unless_equals_uint64 (duration, TARGET_DURATION * GST_SECOND);
+  fail_unless_equals_uint64 (timestamp, 4 * TARGET_DURATION * GST_SECOND);
+  fail_if (discont);
+
+  client->sequence = 10;
+  fail_if (gst_m3u8_client_get_next_fragment (client, &discont, &uri,
+          &duration, &timestamp));
+
+  gst_m3u8_client_free (client);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_sliding_window)
+{
+  GstM3U8Client *client;
+  GstM3U8MediaFile *kept;
+  const gchar *uri;
+  GstClockTime duration, timestamp;
+  gboolean discont;
+
+  client = gst_m3u8_client_new ("http://localhost/playlist.m3u8");
+  fail_unless (gst_m3u8_client_update (client,
+          make_playlist (100, 104, FALSE)));
+  check_files (client->current, 100, 104);
+  kept = g_ptr_array_index (client->current->files, 2);
+
+  /* the window moved by two files */
+  fail_unless (gst_m3u8_client_update (client,
+          make_playlist (102, 106, FALSE)));
+  check_files (client->current, 102, 106);
+  /* known files are not parsed again */
+  fail_unless (g_ptr_array_index (client->current->files, 0) == kept);
+
+  /* positions are relative to the first file of the window */
+  client->sequence = 104;
+  fail_unless (gst_m3u8_client_get_next_fragment (client, &discont, &uri,
+          &duration, &timestamp));
+  fail_unless_equals_string (uri, "http://localhost/104.ts");
+  fail_unless_equals_uint64 (timestamp, 2 * TARGET_DURATION * GST_SECOND);
+
+  /* a sequence before the window resumes at its start */
+  client->sequence = 50;
+  fail_unless (gst_m3u8_client_get_next_fragment (client, &discont, &uri,
+          &duration, &timestamp));
+  fail_unless_equals_string (uri, "http://localhost/102.ts");
+  fail_unless (discont);
+
+  /* a gap in the sequence numbers causes a full reparse */
+  fail_unless (gst_m3u8_client_update (client,
+          make_playlist (200, 203, FALSE)));
+  check_files (client->current, 200, 203);
+
+  gst_m3u8_client_free (client);
+}
+
+GST_END_TEST;
+
+#define N_FILES 10000
+#define N_UPDATES 100
+
+/* an event playlist growing by one file per update */
+GST_START_TEST (test_long_event_playlist)
+{
+  GstM3U8Client *client;
+  GstM3U8MediaFile *first;
+  GTimer *timer;
+  guint i;
+
+  client = gst_m3u8_client_new ("http://localhost/playlist.m3u8");
+
+  timer = g_timer_new ();
+  fail_unless (gst_m3u8_client_update (client,
+          make_playlist (0, N_FILES - 1, FALSE)));
+  GST_INFO ("initial parse of %d files: %f s", N_FILES,
+      g_timer_elapsed (timer, NULL));
+  check_files (client->current, 0, N_FILES - 1);
+  first = g_ptr_array_index (client->current->files, 0);
+
+  g_timer_start (timer);
+  for (i = 0; i < N_UPDATES; i++) {
+    fail_unless (gst_m3u8_client_update (client,
+            make_playlist (0, N_FILES + i, FALSE)));
+  }
+  GST_INFO ("%d updates: %f s per update", N_UPDATES,
+      g_timer_elapsed (timer, NULL) / N_UPDATES);
+  g_timer_destroy (timer);
+
+  check_files (client->current, 0, N_FILES + N_UPDATES - 1);
+  fail_unless (g_ptr_array_index (client->current->files, 0) == first);
+
+  fail_unless (gst_m3u8_client_update (client,
+          make_playlist (0, N_FILES + N_UPDATES - 1, TRUE)));
+  fail_unless_equals_uint64 (gst_m3u8_client_get_duration (client),
+      (guint64) (N_FILES + N_UPDATES) * TARGET_DURATION * GST_SECOND);
+
+  gst_m3u8_client_free (client);
+}
+
+GST_END_TEST;
+
+static Suite *
+hlsdemux_m3u8_suite (void)
+{
+  Suite *s = suite_create ("hlsdemux_m3u8");
+  TCase *tc_chain = tcase_create ("general");
+
+  GST_DEBUG_CATEGORY_INIT (fragmented_debug, "fragmented", 0,
+      "fragmented unit tests");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_parse);
+  tcase_add_test (tc_chain, test_sliding_window);
+  tcase_add_test (tc_chain, test_long_event_playlist);
+
+  return s;
+}
+
+GST_CHECK_MAIN (hlsdemux_m3u8);
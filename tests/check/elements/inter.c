@@ -0,0 +1,365 @@
+/* GStreamer
+ *
+ * unit tests for the video channels of the inter elements
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <string.h>
+
+#include "gstintersurface.h"
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+#define WIDTH 64
+#define HEIGHT 48
+#define FRAME_SIZE (WIDTH * HEIGHT * 3 / 2)
+
+/* the pushed frames are filled with FIRST_VALUE + n, the black frames of
+ * the sources are 16 and 128 */
+#define N_FRAMES 50
+#define FIRST_VALUE 32
+
+/* what a source output, its chain function runs in the streaming thread */
+typedef struct
+{
+  GMutex *lock;
+  GCond *cond;
+  gint last_value;
+  guint n_black;
+  guint n_frames;
+} Received;
+
+static Received received[2];
+
+static GstCaps *
+make_caps (void)
+{
+  return gst_caps_new_simple ("video/x-raw-yuv",
+      "format", GST_TYPE_FOURCC, GST_MAKE_FOURCC ('I', '4', '2', '0'),
+      "width", G_TYPE_INT, WIDTH, "height", G_TYPE_INT, HEIGHT,
+      "framerate", GST_TYPE_FRACTION, 25, 1, NULL);
+}
+
+/* a frame is either completely black or completely one of the pushed frames,
+ * and the pushed frames never come out of order */
+static void
+check_frame (Received * r, GstBuffer * buf)
+{
+  guint8 *data = GST_BUFFER_DATA (buf);
+  gint i, value;
+
+  fail_unless_equals_int (GST_BUFFER_SIZE (buf), FRAME_SIZE);
+
+  g_mutex_lock (r->lock);
+  if (data[0] == 16) {
+    for (i = 0; i < WIDTH * HEIGHT; i++)
+      fail_unless_equals_int (data[i], 16);
+    for (; i < FRAME_SIZE; i++)
+      fail_unless_equals_int (data[i], 128);
+    r->n_black++;
+  } else {
+    value = data[0];
+    fail_unless (value >= FIRST_VALUE && value < FIRST_VALUE + N_FRAMES);
+    for (i = 0; i < FRAME_SIZE; i++)
+      fail_unless_equals_int (data[i], value);
+    fail_unless (value >= r->last_value);
+    r->last_value = value;
+    r->n_frames++;
+  }
+  g_cond_signal (r->cond);
+  g_mutex_unlock (r->lock);
+}
+
+static GstFlowReturn
+chain_0 (GstPad * pad, GstBuffer * buf)
+{
+  check_frame (&received[0], buf);
+  gst_buffer_unref (buf);
+
+  return GST_FLOW_OK;
+}
+
+static GstFlowReturn
+chain_1 (GstPad * pad, GstBuffer * buf)
+{
+  check_frame (&received[1], buf);
+  gst_buffer_unref (buf);
+
+  return GST_FLOW_OK;
+}
+
+static GstElement *
+setup_src (const gchar * channel, GstPadChainFunction chain)
+{
+  GstElement *src;
+  GstPad *sinkpad, *srcpad;
+  GstCaps *caps;
+
+  src = gst_check_setup_element ("intervideosrc");
+  g_object_set (src, "channel", channel, NULL);
+  sinkpad = gst_check_setup_sink_pad (src, &sinktemplate, NULL);
+  gst_pad_set_chain_function (sinkpad, chain);
+  gst_pad_set_active (sinkpad, TRUE);
+
+  /* the source doesn't negotiate by itself */
+  srcpad = gst_element_get_static_pad (src, "src");
+  caps = make_caps ();
+  fail_unless (gst_pad_set_caps (srcpad, caps));
+  gst_caps_unref (caps);
+  gst_object_unref (srcpad);
+
+  fail_if (gst_element_set_state (src, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE);
+
+  return src;
+}
+
+static void
+cleanup_src (GstElement * src)
+{
+  GstPad *srcpad, *sinkpad;
+
+  gst_element_set_state (src, GST_STATE_NULL);
+  srcpad = gst_element_get_static_pad (src, "src");
+  sinkpad = gst_pad_get_peer (srcpad);
+  gst_pad_set_active (sinkpad, FALSE);
+  gst_object_unref (sinkpad);
+  gst_object_unref (srcpad);
+  gst_check_teardown_sink_pad (src);
+  gst_check_teardown_element (src);
+}
+
+/* a sink and a source on one channel pass the frames on, a source on another
+ * channel only outputs black */
+GST_START_TEST (test_channel)
+{
+  GstElement *sink, *src, *other;
+  GstPad *mysrcpad;
+  GstCaps *caps;
+  gint i;
+
+  for (i = 0; i < G_N_ELEMENTS (received); i++) {
+    received[i].lock = g_mutex_new ();
+    received[i].cond = g_cond_new ();
+    received[i].last_value = 0;
+    received[i].n_black = 0;
+    received[i].n_frames = 0;
+  }
+
+  sink = gst_check_setup_element ("intervideosink");
+  g_object_set (sink, "channel", "check-channel", "sync", FALSE, NULL);
+  mysrcpad = gst_check_setup_src_pad (sink, &srctemplate, NULL);
+  gst_pad_set_active (mysrcpad, TRUE);
+  fail_if (gst_element_set_state (sink, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE);
+
+  src = setup_src ("check-channel", chain_0);
+  other = setup_src ("other-channel", chain_1);
+
+  caps = make_caps ();
+  for (i = 0; i < N_FRAMES; i++) {
+    GstBuffer *buf;
+
+    buf = gst_buffer_new_and_alloc (FRAME_SIZE);
+    memset (GST_BUFFER_DATA (buf), FIRST_VALUE + i, FRAME_SIZE);
+    gst_buffer_set_caps (buf, caps);
+    GST_BUFFER_TIMESTAMP (buf) = i * GST_SECOND / 25;
+    GST_BUFFER_DURATION (buf) = GST_SECOND / 25;
+    fail_unless_equals_int (gst_pad_push (mysrcpad, buf), GST_FLOW_OK);
+    g_usleep (G_USEC_PER_SEC / 100);
+  }
+  gst_caps_unref (caps);
+
+  /* the source catches up with the last frame */
+  g_mutex_lock (received[0].lock);
+  while (received[0].last_value != FIRST_VALUE + N_FRAMES - 1)
+    g_cond_wait (received[0].cond, received[0].lock);
+  g_mutex_unlock (received[0].lock);
+
+  cleanup_src (other);
+  cleanup_src (src);
+  gst_element_set_state (sink, GST_STATE_NULL);
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_check_teardown_src_pad (sink);
+  gst_check_teardown_element (sink);
+
+  GST_INFO ("check-channel: %u frames, %u black, other-channel: %u black",
+      received[0].n_frames, received[0].n_black, received[1].n_black);
+  fail_unless (received[0].n_frames > 0);
+  fail_unless_equals_int (received[1].n_frames, 0);
+  fail_unless (received[1].n_black > 0);
+
+  for (i = 0; i < G_N_ELEMENTS (received); i++) {
+    g_mutex_free (received[i].lock);
+    g_cond_free (received[i].cond);
+  }
+}
+
+GST_END_TEST;
+
+#define N_READERS 4
+#define N_PUSHES 20000
+#define STRESS_SIZE 1024
+
+static volatile gint n_freed;
+static volatile gint writer_done;
+
+/* poisons the data and keeps it around, so a reader that got a freed buffer
+ * sees it instead of reading whatever took its place */
+static GSList *freed_data;
+static GStaticMutex freed_lock = G_STATIC_MUTEX_INIT;
+
+static void
+poison_free (gpointer data)
+{
+  memset (data, 0xff, STRESS_SIZE);
+  g_static_mutex_lock (&freed_lock);
+  freed_data = g_slist_prepend (freed_data, data);
+  g_static_mutex_unlock (&freed_lock);
+  g_atomic_int_inc (&n_freed);
+}
+
+/* a buffer of frame @seq, every word of the data is @seq */
+static GstBuffer *
+make_stress_buffer (gint seq)
+{
+  GstBuffer *buf;
+  guint32 *data;
+  gint i;
+
+  data = g_malloc (STRESS_SIZE);
+  for (i = 0; i < STRESS_SIZE / 4; i++)
+    data[i] = seq;
+
+  buf = gst_buffer_new ();
+  GST_BUFFER_DATA (buf) = GST_BUFFER_MALLOCDATA (buf) = (guint8 *) data;
+  GST_BUFFER_SIZE (buf) = STRESS_SIZE;
+  GST_BUFFER_FREE_FUNC (buf) = poison_free;
+  GST_BUFFER_OFFSET (buf) = seq;
+
+  return buf;
+}
+
+static gpointer
+stress_writer (gpointer data)
+{
+  GstInterSurface *surface = data;
+  GstBuffer *buf;
+  gint seq;
+
+  for (seq = 1; seq <= N_PUSHES; seq++) {
+    buf = make_stress_buffer (seq);
+    gst_inter_surface_push_video (surface, buf);
+    gst_buffer_unref (buf);
+
+    /* like a sink that stops and starts again */
+    if (seq % 1000 == 0)
+      gst_inter_surface_clear_video (surface);
+  }
+  g_atomic_int_set (&writer_done, 1);
+
+  return NULL;
+}
+
+static gpointer
+stress_reader (gpointer data)
+{
+  GstInterSurface *surface = data;
+  GstBuffer *buf;
+  guint32 *words;
+  gint last_seq = 0, seq, i;
+  guint n_read = 0;
+
+  while (!g_atomic_int_get (&writer_done)) {
+    buf = gst_inter_surface_get_video (surface, last_seq, &seq);
+    if (buf == NULL)
+      continue;
+
+    fail_unless (seq >= last_seq);
+    fail_unless (seq <= g_atomic_int_get (&surface->video_seq));
+    fail_unless (GST_MINI_OBJECT_REFCOUNT_VALUE (buf) > 0);
+    fail_unless_equals_int (GST_BUFFER_OFFSET (buf), seq);
+    fail_unless_equals_int (GST_BUFFER_SIZE (buf), STRESS_SIZE);
+    words = (guint32 *) GST_BUFFER_DATA (buf);
+    for (i = 0; i < STRESS_SIZE / 4; i++)
+      fail_unless_equals_int (words[i], seq);
+
+    gst_buffer_unref (buf);
+    last_seq = seq;
+    n_read++;
+  }
+
+  return GUINT_TO_POINTER (n_read);
+}
+
+/* a sink replaces the frames while the sources read them, no source may get a
+ * buffer of another frame or one that was freed, and every frame is freed
+ * exactly once */
+GST_START_TEST (test_surface_stress)
+{
+  GstInterSurface *surface;
+  GThread *writer, *readers[N_READERS];
+  guint n_read;
+  gint i;
+
+  n_freed = 0;
+  writer_done = 0;
+  surface = gst_inter_surface_get ("stress-channel");
+
+  for (i = 0; i < N_READERS; i++)
+    readers[i] = g_thread_create (stress_reader, surface, TRUE, NULL);
+  writer = g_thread_create (stress_writer, surface, TRUE, NULL);
+
+  g_thread_join (writer);
+  for (i = 0; i < N_READERS; i++) {
+    n_read = GPOINTER_TO_UINT (g_thread_join (readers[i]));
+    GST_INFO ("reader %d: %u frames", i, n_read);
+  }
+
+  gst_inter_surface_unref (surface);
+  fail_unless_equals_int (g_atomic_int_get (&n_freed), N_PUSHES);
+
+  g_slist_foreach (freed_data, (GFunc) g_free, NULL);
+  g_slist_free (freed_data);
+  freed_data = NULL;
+}
+
+GST_END_TEST;
+
+static Suite *
+inter_suite (void)
+{
+  Suite *s = suite_create ("inter");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_set_timeout (tc_chain, 60);
+  tcase_add_test (tc_chain, test_channel);
+  tcase_add_test (tc_chain, test_surface_stress);
+
+  return s;
+}
+
+GST_CHECK_MAIN (inter);
@@ -256,6 +256,511 @@ GST_START_TEST (test_push)
 
 GST_END_TEST;
 
+/* The sample file with frame wrapped essence of N_EDIT_UNITS edit units,
+ * indexed in the footer partition */
+#define N_EDIT_UNITS 10
+#define SEEK_EDIT_UNIT 7
+
+#define HEADER_SIZE 19995
+#define METADATA_OFFSET 1104
+#define ESSENCE_KEY (mxf_file + 19995)
+#define FOOTER_PACK (mxf_file + 20031)
+#define FOOTER_PACK_SIZE 140
+#define INDEX_TABLE_SEGMENT_KEY (mxf_file + 20171)
+#define RANDOM_INDEX_PACK_KEY (mxf_file + 20271)
+
+static GByteArray *index_file;
+static guint index_file_size, index_header_size;
+static guint64 edit_unit_offsets[N_EDIT_UNITS + 1];
+static GMutex *index_lock;
+static GCond *index_cond;
+static GArray *received;
+static gboolean blocking, seeked;
+static guint early_reads;
+
+static void
+append_klv_header (GByteArray * file, const guint8 * key, guint length)
+{
+  guint8 ber[4] = { 0x83, length >> 16, length >> 8, length };
+
+  g_byte_array_append (file, key, 16);
+  g_byte_array_append (file, ber, 4);
+}
+
+static void
+append_tag (GByteArray * data, guint16 tag, guint16 length, guint64 value)
+{
+  guint8 buf[12];
+
+  GST_WRITE_UINT16_BE (buf, tag);
+  GST_WRITE_UINT16_BE (buf + 2, length);
+  if (length == 1)
+    GST_WRITE_UINT8 (buf + 4, value);
+  else if (length == 4)
+    GST_WRITE_UINT32_BE (buf + 4, value);
+  else
+    GST_WRITE_UINT64_BE (buf + 4, value);
+  g_byte_array_append (data, buf, 4 + length);
+}
+
+/* sets the durations of the components and the descriptor */
+static void
+patch_durations (guint8 * data, guint64 duration)
+{
+  guint offset = 140;
+
+  while (offset < index_header_size) {
+    guint length = GST_READ_UINT32_BE (data + offset + 16) & 0xffffff;
+    guint8 *set = data + offset + 20;
+
+    if (set[-16] == 0x02 && set[-15] == 0x53) {
+      guint i = 0;
+
+      while (i + 4 <= length) {
+        guint16 tag = GST_READ_UINT16_BE (set + i);
+        guint16 tag_size = GST_READ_UINT16_BE (set + i + 2);
+
+        if ((tag == 0x0202 || tag == 0x3002) && tag_size == 8)
+          GST_WRITE_UINT64_BE (set + i + 4, duration);
+        i += 4 + tag_size;
+      }
+    }
+    offset += 20 + length;
+  }
+}
+
+static guint
+edit_unit_size (gboolean cbr, guint i)
+{
+  return cbr ? 2205 : 1000 + 100 * i;
+}
+
+/* appends @n_sets unreferenced timecode components and sequences */
+static void
+append_metadata_sets (GByteArray * file, guint n_sets)
+{
+  static const guint8 set_key[] = {
+    0x06, 0x0e, 0x2b, 0x34, 0x02, 0x53, 0x01, 0x01,
+    0x0d, 0x01, 0x01, 0x01, 0x01, 0x01, 0x00, 0x00
+  };
+  GByteArray *set = g_byte_array_new ();
+  guint8 buf[20];
+  guint i;
+
+  for (i = 0; i < n_sets; i++) {
+    g_byte_array_set_size (set, 0);
+
+    GST_WRITE_UINT16_BE (buf, 0x3c0a);
+    GST_WRITE_UINT16_BE (buf + 2, 16);
+    memset (buf + 4, 0x55, 12);
+    GST_WRITE_UINT32_BE (buf + 16, i);
+    g_byte_array_append (set, buf, 20);
+    append_tag (set, 0x0202, 8, N_EDIT_UNITS);
+    if (i % 2 == 0) {
+      append_tag (set, 0x1501, 8, 0);
+      append_tag (set, 0x1503, 1, 0);
+    }
+
+    memcpy (buf, set_key, 16);
+    buf[14] = (i % 2 == 0) ? 0x14 : 0x0f;
+    append_klv_header (file, buf, set->len);
+    g_byte_array_append (file, set->data, set->len);
+  }
+
+  g_byte_array_free (set, TRUE);
+}
+
+/* @n_sets additional metadata sets make the header metadata larger */
+static void
+create_index_file (gboolean cbr, guint n_sets)
+{
+  GByteArray *segment;
+  guint64 footer;
+  guint8 buf[12];
+  guint i;
+
+  index_file = g_byte_array_new ();
+  g_byte_array_append (index_file, mxf_file, METADATA_OFFSET);
+  append_metadata_sets (index_file, n_sets);
+  g_byte_array_append (index_file, mxf_file + METADATA_OFFSET,
+      HEADER_SIZE - METADATA_OFFSET);
+  index_header_size = index_file->len;
+  GST_WRITE_UINT64_BE (index_file->data + 52, index_header_size - 140);
+  patch_durations (index_file->data, N_EDIT_UNITS);
+
+  for (i = 0; i < N_EDIT_UNITS; i++) {
+    guint size = edit_unit_size (cbr, i);
+
+    edit_unit_offsets[i] = index_file->len;
+    append_klv_header (index_file, ESSENCE_KEY, size);
+    g_byte_array_set_size (index_file, index_file->len + size);
+    memset (index_file->data + index_file->len - size, i, size);
+  }
+  footer = edit_unit_offsets[N_EDIT_UNITS] = index_file->len;
+
+  segment = g_byte_array_new ();
+  memset (buf, 0x42, 12);
+  GST_WRITE_UINT16_BE (buf, 0x3c0a);
+  GST_WRITE_UINT16_BE (buf + 2, 16);
+  g_byte_array_append (segment, buf, 4);
+  g_byte_array_append (segment, mxf_essence, 16);
+  append_tag (segment, 0x3f0b, 8, G_GUINT64_CONSTANT (0x0000000500000001));
+  append_tag (segment, 0x3f0c, 8, 0);
+  append_tag (segment, 0x3f0d, 8, N_EDIT_UNITS);
+  append_tag (segment, 0x3f05, 4, cbr ? 20 + edit_unit_size (cbr, 0) : 0);
+  append_tag (segment, 0x3f06, 4, 0x81);
+  append_tag (segment, 0x3f07, 4, 1);
+  append_tag (segment, 0x3f08, 1, 0);
+  append_tag (segment, 0x3f0e, 1, 0);
+  if (!cbr) {
+    GST_WRITE_UINT16_BE (buf, 0x3f0a);
+    GST_WRITE_UINT16_BE (buf + 2, 8 + 11 * N_EDIT_UNITS);
+    GST_WRITE_UINT32_BE (buf + 4, N_EDIT_UNITS);
+    GST_WRITE_UINT32_BE (buf + 8, 11);
+    g_byte_array_append (segment, buf, 12);
+    for (i = 0; i < N_EDIT_UNITS; i++) {
+      buf[0] = buf[1] = 0;
+      buf[2] = 0x80;
+      GST_WRITE_UINT64_BE (buf + 3,
+          edit_unit_offsets[i] - edit_unit_offsets[0]);
+      g_byte_array_append (segment, buf, 11);
+    }
+  }
+
+  g_byte_array_append (index_file, FOOTER_PACK, FOOTER_PACK_SIZE);
+  GST_WRITE_UINT64_BE (index_file->data + footer + 28, footer);
+  GST_WRITE_UINT64_BE (index_file->data + footer + 36, 0);
+  GST_WRITE_UINT64_BE (index_file->data + footer + 44, footer);
+  GST_WRITE_UINT64_BE (index_file->data + footer + 60, 20 + segment->len);
+  GST_WRITE_UINT64_BE (index_file->data + 44, footer);
+
+  append_klv_header (index_file, INDEX_TABLE_SEGMENT_KEY, segment->len);
+  g_byte_array_append (index_file, segment->data, segment->len);
+  g_byte_array_free (segment, TRUE);
+
+  append_klv_header (index_file, RANDOM_INDEX_PACK_KEY, 28);
+  GST_WRITE_UINT32_BE (buf, 1);
+  GST_WRITE_UINT64_BE (buf + 4, 0);
+  g_byte_array_append (index_file, buf, 12);
+  GST_WRITE_UINT32_BE (buf, 0);
+  GST_WRITE_UINT64_BE (buf + 4, footer);
+  g_byte_array_append (index_file, buf, 12);
+  GST_WRITE_UINT32_BE (buf, 48);
+  g_byte_array_append (index_file, buf, 4);
+
+  index_file_size = index_file->len;
+}
+
+static GstFlowReturn
+_index_src_getrange (GstPad * pad, guint64 offset, guint length,
+    GstBuffer ** buffer)
+{
+  guint i;
+
+  g_mutex_lock (index_lock);
+  if (offset + length > index_file_size) {
+    g_mutex_unlock (index_lock);
+    return GST_FLOW_UNEXPECTED;
+  }
+
+  /* the essence of the edit units that were seeked over */
+  for (i = 0; seeked && i < SEEK_EDIT_UNIT; i++) {
+    if (offset >= edit_unit_offsets[i] + 20 &&
+        offset < edit_unit_offsets[i + 1])
+      early_reads++;
+  }
+  g_mutex_unlock (index_lock);
+
+  *buffer = gst_buffer_new ();
+  GST_BUFFER_DATA (*buffer) = index_file->data + offset;
+  GST_BUFFER_SIZE (*buffer) = length;
+
+  return GST_FLOW_OK;
+}
+
+static gboolean
+_index_src_query (GstPad * pad, GstQuery * query)
+{
+  GstFormat fmt;
+
+  if (GST_QUERY_TYPE (query) != GST_QUERY_DURATION)
+    return FALSE;
+
+  gst_query_parse_duration (query, &fmt, NULL);
+
+  if (fmt != GST_FORMAT_BYTES)
+    return FALSE;
+
+  g_mutex_lock (index_lock);
+  gst_query_set_duration (query, fmt, index_file_size);
+  g_mutex_unlock (index_lock);
+
+  return TRUE;
+}
+
+/* records the edit unit of every buffer, and blocks on the first one until
+ * the seek flushes */
+static GstFlowReturn
+_index_sink_chain (GstPad * pad, GstBuffer * buffer)
+{
+  guint8 edit_unit = GST_BUFFER_DATA (buffer)[0];
+
+  g_mutex_lock (index_lock);
+  g_array_append_val (received, edit_unit);
+  g_cond_broadcast (index_cond);
+  while (blocking)
+    g_cond_wait (index_cond, index_lock);
+  g_mutex_unlock (index_lock);
+
+  gst_buffer_unref (buffer);
+
+  return GST_FLOW_OK;
+}
+
+static gboolean
+_index_sink_event (GstPad * pad, GstEvent * event)
+{
+  g_mutex_lock (index_lock);
+  if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_START)
+    blocking = FALSE;
+  else if (GST_EVENT_TYPE (event) == GST_EVENT_EOS)
+    have_eos = TRUE;
+  g_cond_broadcast (index_cond);
+  g_mutex_unlock (index_lock);
+
+  gst_event_unref (event);
+
+  return TRUE;
+}
+
+static GstElement *
+setup_index_demux (gboolean follow)
+{
+  GstElement *mxfdemux;
+  GstPad *sinkpad;
+
+  index_lock = g_mutex_new ();
+  index_cond = g_cond_new ();
+  received = g_array_new (FALSE, FALSE, sizeof (guint8));
+  seeked = FALSE;
+  early_reads = 0;
+  have_eos = FALSE;
+
+  mxfdemux = gst_element_factory_make ("mxfdemux", NULL);
+  fail_unless (mxfdemux != NULL);
+  g_object_set (mxfdemux, "follow", follow, "follow-interval",
+      10 * GST_MSECOND, NULL);
+  g_signal_connect (mxfdemux, "pad-added", G_CALLBACK (_pad_added), NULL);
+  sinkpad = gst_element_get_static_pad (mxfdemux, "sink");
+
+  mysinkpad = gst_pad_new_from_static_template (&mysinktemplate, "sink");
+  gst_pad_set_chain_function (mysinkpad, _index_sink_chain);
+  gst_pad_set_event_function (mysinkpad, _index_sink_event);
+  mysrcpad = gst_pad_new_from_static_template (&mysrctemplate, "src");
+  gst_pad_set_getrange_function (mysrcpad, _index_src_getrange);
+  gst_pad_set_query_function (mysrcpad, _index_src_query);
+
+  fail_unless (gst_pad_link (mysrcpad, sinkpad) == GST_PAD_LINK_OK);
+  gst_object_unref (sinkpad);
+
+  gst_pad_set_active (mysinkpad, TRUE);
+  gst_pad_set_active (mysrcpad, TRUE);
+
+  gst_element_set_state (mxfdemux, GST_STATE_PLAYING);
+
+  return mxfdemux;
+}
+
+static void
+teardown_index_demux (GstElement * mxfdemux)
+{
+  gst_element_set_state (mxfdemux, GST_STATE_NULL);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_pad_set_active (mysrcpad, FALSE);
+
+  gst_object_unref (mxfdemux);
+  gst_object_unref (mysinkpad);
+  gst_object_unref (mysrcpad);
+  g_array_free (received, TRUE);
+  g_cond_free (index_cond);
+  g_mutex_free (index_lock);
+  g_byte_array_free (index_file, TRUE);
+}
+
+static void
+seek_to_edit_unit (GstElement * mxfdemux, guint edit_unit)
+{
+  fail_unless (gst_element_send_event (mxfdemux,
+          gst_event_new_seek (1.0, GST_FORMAT_TIME,
+              GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_ACCURATE,
+              GST_SEEK_TYPE_SET, edit_unit * 200 * GST_MSECOND,
+              GST_SEEK_TYPE_NONE, -1)));
+}
+
+static void
+check_index_seek (gboolean cbr)
+{
+  GstElement *mxfdemux;
+  guint i, first;
+
+  create_index_file (cbr, 0);
+  blocking = TRUE;
+  mxfdemux = setup_index_demux (FALSE);
+
+  g_mutex_lock (index_lock);
+  while (received->len == 0)
+    g_cond_wait (index_cond, index_lock);
+  fail_unless_equals_int (g_array_index (received, guint8, 0), 0);
+  first = received->len;
+  seeked = TRUE;
+  g_mutex_unlock (index_lock);
+
+  seek_to_edit_unit (mxfdemux, SEEK_EDIT_UNIT);
+
+  g_mutex_lock (index_lock);
+  while (!have_eos)
+    g_cond_wait (index_cond, index_lock);
+  g_mutex_unlock (index_lock);
+
+  /* playback continued at the seek position, without reading the essence
+   * in front of it */
+  fail_unless_equals_int (received->len - first,
+      N_EDIT_UNITS - SEEK_EDIT_UNIT);
+  for (i = first; i < received->len; i++)
+    fail_unless_equals_int (g_array_index (received, guint8, i),
+        SEEK_EDIT_UNIT + i - first);
+  fail_unless_equals_int (early_reads, 0);
+
+  teardown_index_demux (mxfdemux);
+}
+
+GST_START_TEST (test_index_seek_cbr)
+{
+  check_index_seek (TRUE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_index_seek_vbr)
+{
+  check_index_seek (FALSE);
+}
+
+GST_END_TEST;
+
+/* makes @size bytes of the file available and waits until @n_received
+ * buffers were received */
+static void
+grow_index_file (guint size, guint n_received)
+{
+  g_mutex_lock (index_lock);
+  index_file_size = size;
+  while (received->len < n_received)
+    g_cond_wait (index_cond, index_lock);
+  g_mutex_unlock (index_lock);
+}
+
+static gint64
+wait_for_duration (GstElement * mxfdemux, gint64 expected)
+{
+  GstFormat fmt = GST_FORMAT_TIME;
+  gint64 duration = -1;
+  guint i;
+
+  for (i = 0; i < 500 && duration != expected; i++) {
+    g_usleep (10 * G_USEC_PER_SEC / 1000);
+    if (!gst_element_query_duration (mxfdemux, &fmt, &duration))
+      duration = -1;
+  }
+
+  return duration;
+}
+
+/* a file that is still being written, without footer partition and with
+ * unknown durations in the header metadata */
+GST_START_TEST (test_follow)
+{
+  GstElement *mxfdemux;
+  guint i;
+
+  create_index_file (FALSE, 0);
+  GST_WRITE_UINT64_BE (index_file->data + 44, 0);
+  patch_durations (index_file->data, G_MAXUINT64);
+  index_file_size = edit_unit_offsets[4];
+
+  blocking = FALSE;
+  mxfdemux = setup_index_demux (TRUE);
+
+  grow_index_file (edit_unit_offsets[4], 4);
+  fail_unless_equals_uint64 (wait_for_duration (mxfdemux,
+          4 * 200 * GST_MSECOND), 4 * 200 * GST_MSECOND);
+
+  grow_index_file (edit_unit_offsets[N_EDIT_UNITS], N_EDIT_UNITS);
+  fail_unless_equals_uint64 (wait_for_duration (mxfdemux,
+          N_EDIT_UNITS * 200 * GST_MSECOND), N_EDIT_UNITS * 200 * GST_MSECOND);
+
+  /* seeking inside of what was written so far */
+  seek_to_edit_unit (mxfdemux, SEEK_EDIT_UNIT);
+  grow_index_file (edit_unit_offsets[N_EDIT_UNITS],
+      2 * N_EDIT_UNITS - SEEK_EDIT_UNIT);
+  fail_if (have_eos);
+
+  for (i = 0; i < received->len; i++)
+    fail_unless_equals_int (g_array_index (received, guint8, i),
+        i < N_EDIT_UNITS ? i : SEEK_EDIT_UNIT + i - N_EDIT_UNITS);
+
+  /* the footer partition finishes the file */
+  g_mutex_lock (index_lock);
+  index_file_size = index_file->len;
+  while (!have_eos)
+    g_cond_wait (index_cond, index_lock);
+  g_mutex_unlock (index_lock);
+
+  fail_unless_equals_int (received->len, 2 * N_EDIT_UNITS - SEEK_EDIT_UNIT);
+
+  teardown_index_demux (mxfdemux);
+}
+
+GST_END_TEST;
+
+/* time until the first buffer with a header of tens of thousands of sets,
+ * all of which are parsed and resolved before playback starts */
+GST_START_TEST (test_large_header)
+{
+  static const guint n_sets[] = { 0, 5000, 50000 };
+  GstElement *mxfdemux;
+  GTimer *timer;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (n_sets); i++) {
+    create_index_file (FALSE, n_sets[i]);
+    blocking = FALSE;
+
+    timer = g_timer_new ();
+    mxfdemux = setup_index_demux (FALSE);
+
+    g_mutex_lock (index_lock);
+    while (received->len == 0)
+      g_cond_wait (index_cond, index_lock);
+    g_mutex_unlock (index_lock);
+
+    GST_INFO ("%u additional metadata sets: first buffer after %f s",
+        n_sets[i], g_timer_elapsed (timer, NULL));
+    g_timer_destroy (timer);
+
+    g_mutex_lock (index_lock);
+    while (!have_eos)
+      g_cond_wait (index_cond, index_lock);
+    g_mutex_unlock (index_lock);
+
+    fail_unless_equals_int (received->len, N_EDIT_UNITS);
+
+    teardown_index_demux (mxfdemux);
+  }
+}
+
+GST_END_TEST;
+
 static Suite *
 mxfdemux_suite (void)
 {
@@ -266,6 +771,10 @@ mxfdemux_suite (void)
   tcase_set_timeout (tc_chain, 180);
   tcase_add_test (tc_chain, test_pull);
   tcase_add_test (tc_chain, test_push);
+  tcase_add_test (tc_chain, test_index_seek_cbr);
+  tcase_add_test (tc_chain, test_index_seek_vbr);
+  tcase_add_test (tc_chain, test_follow);
+  tcase_add_test (tc_chain, test_large_header);
 
   return s;
 }
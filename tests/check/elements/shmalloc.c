@@ -0,0 +1,266 @@
+/* GStreamer
+ *
+ * unit tests for the block allocator of the shm elements
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+
+#include "shmalloc.h"
+
+/* a used block is aligned and found from its first and its last byte */
+static void
+check_block (ShmAllocSpace * space, ShmAllocBlock * block, unsigned long size)
+{
+  unsigned long offset = shm_alloc_space_alloc_block_get_offset (block);
+
+  fail_unless_equals_int (offset % SHM_ALLOC_GRANULE, 0);
+  fail_unless (shm_alloc_space_block_get (space, offset) == block);
+  fail_unless (shm_alloc_space_block_get (space, offset + size - 1) == block);
+}
+
+/* the biggest block that could be allocated right now */
+static unsigned long
+get_largest_free (ShmAllocSpace * space)
+{
+  unsigned long fits = 0;
+  unsigned long too_big = shm_alloc_space_get_max_block_size (space) + 1;
+  ShmAllocBlock *block;
+
+  while (too_big - fits > 1) {
+    unsigned long size = fits + (too_big - fits) / 2;
+
+    block = shm_alloc_space_alloc_block (space, size);
+    if (block) {
+      shm_alloc_space_block_dec (block);
+      fits = size;
+    } else {
+      too_big = size;
+    }
+  }
+
+  return fits;
+}
+
+GST_START_TEST (test_alloc_free)
+{
+  ShmAllocSpace *space;
+  ShmAllocBlock *a, *b, *c;
+  unsigned long offset;
+
+  space = shm_alloc_space_new (16 * SHM_ALLOC_GRANULE);
+
+  a = shm_alloc_space_alloc_block (space, 1);
+  b = shm_alloc_space_alloc_block (space, 3 * SHM_ALLOC_GRANULE);
+  c = shm_alloc_space_alloc_block (space, 2 * SHM_ALLOC_GRANULE + 1);
+  fail_unless (a && b && c);
+  check_block (space, a, 1);
+  check_block (space, b, 3 * SHM_ALLOC_GRANULE);
+  check_block (space, c, 2 * SHM_ALLOC_GRANULE + 1);
+  fail_unless_equals_int (get_largest_free (space), 9 * SHM_ALLOC_GRANULE);
+
+  /* lookups from the start and from inside of a block */
+  offset = shm_alloc_space_alloc_block_get_offset (b);
+  fail_unless (shm_alloc_space_block_get (space, offset) == b);
+  fail_unless (shm_alloc_space_block_get (space,
+          offset + 2 * SHM_ALLOC_GRANULE + 10) == b);
+  offset = shm_alloc_space_alloc_block_get_offset (c);
+  fail_unless (shm_alloc_space_block_get (space, offset + 1) == c);
+  fail_unless (shm_alloc_space_block_get (space,
+          16 * SHM_ALLOC_GRANULE) == NULL);
+
+  /* too big */
+  fail_unless (shm_alloc_space_alloc_block (space,
+          11 * SHM_ALLOC_GRANULE) == NULL);
+
+  shm_alloc_space_block_inc (b);
+  shm_alloc_space_block_dec (b);
+  fail_unless (shm_alloc_space_block_get (space,
+          shm_alloc_space_alloc_block_get_offset (b)) == b);
+  offset = shm_alloc_space_alloc_block_get_offset (b);
+  shm_alloc_space_block_dec (b);
+  fail_unless (shm_alloc_space_block_get (space, offset) == NULL);
+  check_block (space, a, 1);
+  check_block (space, c, 2 * SHM_ALLOC_GRANULE + 1);
+
+  /* everything merged back */
+  shm_alloc_space_block_dec (a);
+  shm_alloc_space_block_dec (c);
+  fail_unless_equals_int (get_largest_free (space), 16 * SHM_ALLOC_GRANULE);
+
+  shm_alloc_space_free (space);
+}
+
+GST_END_TEST;
+
+/* spaces that aren't a multiple of the granule size can be filled up to
+ * their last byte, even when smaller than a granule */
+GST_START_TEST (test_partial_granule)
+{
+  ShmAllocSpace *space;
+  ShmAllocBlock *a, *b;
+
+  space = shm_alloc_space_new (100);
+  fail_unless_equals_int (shm_alloc_space_get_max_block_size (space), 100);
+  fail_unless (shm_alloc_space_alloc_block (space, 101) == NULL);
+  a = shm_alloc_space_alloc_block (space, 100);
+  fail_unless (a != NULL);
+  fail_unless (shm_alloc_space_block_get (space, 99) == a);
+  fail_unless (shm_alloc_space_block_get (space, 100) == NULL);
+  check_block (space, a, 100);
+  shm_alloc_space_block_dec (a);
+  shm_alloc_space_free (space);
+
+  space = shm_alloc_space_new (4 * SHM_ALLOC_GRANULE + 10);
+  a = shm_alloc_space_alloc_block (space, 4 * SHM_ALLOC_GRANULE + 10);
+  fail_unless (a != NULL);
+  shm_alloc_space_block_dec (a);
+  fail_unless_equals_int (get_largest_free (space), 4 * SHM_ALLOC_GRANULE + 10);
+
+  /* the tail only holds 10 bytes */
+  a = shm_alloc_space_alloc_block (space, 4 * SHM_ALLOC_GRANULE);
+  fail_unless (a != NULL);
+  fail_unless (shm_alloc_space_alloc_block (space, 11) == NULL);
+  b = shm_alloc_space_alloc_block (space, 10);
+  fail_unless (b != NULL);
+  fail_unless_equals_int (shm_alloc_space_alloc_block_get_offset (b),
+      4 * SHM_ALLOC_GRANULE);
+  check_block (space, a, 4 * SHM_ALLOC_GRANULE);
+  check_block (space, b, 10);
+  shm_alloc_space_block_dec (a);
+  shm_alloc_space_block_dec (b);
+  fail_unless_equals_int (get_largest_free (space), 4 * SHM_ALLOC_GRANULE + 10);
+
+  shm_alloc_space_free (space);
+}
+
+GST_END_TEST;
+
+#define N_READERS 8
+#define N_FRAMES 20000
+#define MAX_PENDING 64
+
+typedef struct
+{
+  ShmAllocBlock *block;
+  unsigned long size;
+  guint refs;
+  guint release[N_READERS];
+} Frame;
+
+/* A writer sending frames of varying sizes to readers that each release
+ * them after a different delay, like shmsrc clients draining at different
+ * speeds */
+GST_START_TEST (test_slow_readers)
+{
+  ShmAllocSpace *space;
+  Frame frames[MAX_PENDING];
+  guint n_frames = 0;
+  guint tick, i, r;
+  guint failed = 0;
+  unsigned long largest, total, used;
+  gdouble fragmentation = 0.0;
+  GTimer *timer;
+
+  space = shm_alloc_space_new (64 * 1024 * 1024);
+  g_random_set_seed (42);
+
+  timer = g_timer_new ();
+  for (tick = 0; tick < N_FRAMES; tick++) {
+    /* readers release what they are done with */
+    for (i = 0; i < n_frames;) {
+      gboolean done = FALSE;
+
+      for (r = 0; r < N_READERS; r++) {
+        if (frames[i].release[r] == tick) {
+          done = --frames[i].refs == 0;
+          shm_alloc_space_block_dec (frames[i].block);
+        }
+      }
+      if (done)
+        frames[i] = frames[--n_frames];
+      else
+        i++;
+    }
+
+    if (n_frames == MAX_PENDING)
+      continue;
+
+    /* a frame of around 1MiB, every reader holds a reference */
+    frames[n_frames].size = g_random_int_range (512 * 1024, 2 * 1024 * 1024);
+    frames[n_frames].block = shm_alloc_space_alloc_block (space,
+        frames[n_frames].size);
+    if (!frames[n_frames].block) {
+      failed++;
+      continue;
+    }
+    frames[n_frames].refs = N_READERS;
+    for (r = 0; r < N_READERS; r++) {
+      frames[n_frames].release[r] = tick + 1 + r * g_random_int_range (1, 4);
+      shm_alloc_space_block_inc (frames[n_frames].block);
+    }
+    /* the writer is done with it */
+    shm_alloc_space_block_dec (frames[n_frames].block);
+    n_frames++;
+
+    if (tick % 100 == 0) {
+      used = 0;
+      for (i = 0; i < n_frames; i++) {
+        check_block (space, frames[i].block, frames[i].size);
+        used += GST_ROUND_UP_N (frames[i].size, SHM_ALLOC_GRANULE);
+      }
+      total = 64 * 1024 * 1024 - used;
+      largest = get_largest_free (space);
+      if (total > 0)
+        fragmentation = MAX (fragmentation, 1.0 - (gdouble) largest / total);
+    }
+  }
+  GST_INFO ("%u frames in %f s, %u allocations failed, worst fragmentation "
+      "%f", N_FRAMES, g_timer_elapsed (timer, NULL), failed, fragmentation);
+  g_timer_destroy (timer);
+
+  /* drop the references the readers still hold */
+  while (n_frames > 0) {
+    n_frames--;
+    for (r = 0; r < N_READERS; r++)
+      if (frames[n_frames].release[r] >= tick)
+        shm_alloc_space_block_dec (frames[n_frames].block);
+  }
+
+  /* everything merged back */
+  fail_unless_equals_int (get_largest_free (space), 64 * 1024 * 1024);
+
+  shm_alloc_space_free (space);
+}
+
+GST_END_TEST;
+
+static Suite *
+shmalloc_suite (void)
+{
+  Suite *s = suite_create ("shmalloc");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_alloc_free);
+  tcase_add_test (tc_chain, test_partial_granule);
+  tcase_add_test (tc_chain, test_slow_readers);
+
+  return s;
+}
+
+GST_CHECK_MAIN (shmalloc);
@@ -0,0 +1,320 @@
+/* GStreamer
+ *
+ * unit tests for the control protocol of the shm elements
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "shmpipe.h"
+
+#define MAX_CLIENTS 16
+#define N_BUFFERS 20000
+#define BUFFER_SIZE 64
+/* the writer only looks at the acks every so many buffers */
+#define ACK_INTERVAL 16
+
+typedef struct
+{
+  ShmPipe *writer;
+  ShmClient *server_clients[MAX_CLIENTS];
+  ShmPipe *clients[MAX_CLIENTS];
+  guint n_clients;
+
+  /* number of messages read from the sockets */
+  guint writer_messages;
+  guint client_messages;
+} Pipes;
+
+static gboolean
+can_read (int fd)
+{
+  struct pollfd pfd = { fd, POLLIN, 0 };
+
+  return poll (&pfd, 1, 0) > 0 && (pfd.revents & POLLIN);
+}
+
+static void
+writer_recv (Pipes * p, guint i)
+{
+  while (can_read (sp_writer_get_client_fd (p->server_clients[i]))) {
+    fail_unless_equals_int (sp_writer_recv (p->writer, p->server_clients[i]),
+        0);
+    p->writer_messages++;
+  }
+}
+
+/* like shmsrc, look in the ring first and only then at the socket */
+static long int
+client_recv (Pipes * p, guint i, char **buf)
+{
+  long int size;
+
+  for (;;) {
+    size = sp_client_recv_ring (p->clients[i], buf);
+    fail_if (size < 0);
+    if (*buf)
+      return size;
+
+    fail_unless (can_read (sp_get_fd (p->clients[i])));
+    size = sp_client_recv (p->clients[i], buf);
+    p->client_messages++;
+    fail_if (size < 0);
+    if (size > 0)
+      return size;
+  }
+}
+
+static void
+setup_pipes (Pipes * p, guint n_clients, guint ring_size)
+{
+  gchar *path;
+  guint i;
+
+  memset (p, 0, sizeof (Pipes));
+  p->n_clients = n_clients;
+
+  path = g_strdup_printf ("/tmp/shmpipe-test-%d", getpid ());
+  p->writer = sp_writer_create (path, 1024 * 1024, S_IRUSR | S_IWUSR);
+  fail_unless (p->writer != NULL);
+  g_free (path);
+  sp_writer_set_ring_size (p->writer, ring_size);
+
+  for (i = 0; i < n_clients; i++) {
+    char *buf = NULL;
+
+    p->clients[i] = sp_client_open (sp_writer_get_path (p->writer));
+    fail_unless (p->clients[i] != NULL);
+    p->server_clients[i] = sp_writer_accept_client (p->writer);
+    fail_unless (p->server_clients[i] != NULL);
+
+    /* new shm area, then the ring handshake */
+    fail_unless_equals_int (sp_client_recv (p->clients[i], &buf), 0);
+    if (ring_size > 0) {
+      fail_unless_equals_int (sp_client_recv (p->clients[i], &buf), 0);
+      fail_unless (can_read (sp_writer_get_client_fd (p->server_clients[i])));
+      fail_unless_equals_int (sp_writer_recv (p->writer,
+              p->server_clients[i]), 0);
+      fail_unless_equals_int (sp_client_recv (p->clients[i], &buf), 0);
+    }
+    fail_if (can_read (sp_get_fd (p->clients[i])));
+  }
+}
+
+static void
+teardown_pipes (Pipes * p)
+{
+  guint i;
+
+  for (i = 0; i < p->n_clients; i++)
+    sp_close (p->clients[i]);
+  sp_close (p->writer);
+}
+
+static gdouble
+run_pipes (Pipes * p)
+{
+  GTimer *timer;
+  ShmBlock *block;
+  char *buf;
+  gdouble elapsed;
+  guint n, i;
+
+  timer = g_timer_new ();
+  for (n = 0; n < N_BUFFERS; n++) {
+    block = sp_writer_alloc_block (p->writer, BUFFER_SIZE);
+    fail_unless (block != NULL);
+    buf = sp_writer_block_get_buf (block);
+    memset (buf, n & 0xff, BUFFER_SIZE);
+    fail_unless_equals_int (sp_writer_send_buf (p->writer, buf, BUFFER_SIZE,
+            n), p->n_clients);
+    sp_writer_free_block (block);
+
+    for (i = 0; i < p->n_clients; i++) {
+      char *rbuf = NULL;
+
+      fail_unless_equals_int (client_recv (p, i, &rbuf), BUFFER_SIZE);
+      fail_unless_equals_int ((guint8) rbuf[0], n & 0xff);
+      fail_unless (sp_client_recv_finish (p->clients[i], rbuf) > 0);
+    }
+
+    if (n % ACK_INTERVAL == ACK_INTERVAL - 1)
+      for (i = 0; i < p->n_clients; i++)
+        writer_recv (p, i);
+  }
+  for (i = 0; i < p->n_clients; i++)
+    writer_recv (p, i);
+  elapsed = g_timer_elapsed (timer, NULL);
+  g_timer_destroy (timer);
+
+  fail_if (sp_writer_pending_writes (p->writer));
+
+  return elapsed;
+}
+
+GST_START_TEST (test_socket_and_ring)
+{
+  Pipes socket_pipes, ring_pipes;
+  guint n_clients;
+  gdouble elapsed;
+
+  for (n_clients = 1; n_clients <= MAX_CLIENTS; n_clients *= 2) {
+    setup_pipes (&socket_pipes, n_clients, 0);
+    elapsed = run_pipes (&socket_pipes);
+    GST_INFO ("socket, %2u clients: %.0f buffers/s, %u + %u messages",
+        n_clients, N_BUFFERS * n_clients / elapsed,
+        socket_pipes.writer_messages, socket_pipes.client_messages);
+
+    setup_pipes (&ring_pipes, n_clients, 256);
+    elapsed = run_pipes (&ring_pipes);
+    GST_INFO ("ring,   %2u clients: %.0f buffers/s, %u + %u messages",
+        n_clients, N_BUFFERS * n_clients / elapsed,
+        ring_pipes.writer_messages, ring_pipes.client_messages);
+
+    /* one ack per buffer and client over the socket, against one wake up
+     * per batch of acks */
+    fail_unless_equals_int (socket_pipes.writer_messages,
+        N_BUFFERS * n_clients);
+    fail_unless (ring_pipes.writer_messages <=
+        (N_BUFFERS / ACK_INTERVAL + 1) * n_clients);
+    /* the clients never went idle, so were never woken up */
+    fail_unless_equals_int (ring_pipes.client_messages, 0);
+
+    teardown_pipes (&socket_pipes);
+    teardown_pipes (&ring_pipes);
+  }
+}
+
+GST_END_TEST;
+
+/* a client that doesn't keep up misses buffers instead of blocking the
+ * writer, and gets woken up once it went idle */
+GST_START_TEST (test_ring_full)
+{
+  Pipes p;
+  ShmBlock *block;
+  char *buf, *rbuf;
+  guint n;
+
+  setup_pipes (&p, 1, 4);
+
+  block = sp_writer_alloc_block (p.writer, BUFFER_SIZE);
+  buf = sp_writer_block_get_buf (block);
+  for (n = 0; n < BUFFER_SIZE; n++)
+    buf[n] = n;
+  for (n = 0; n < 4; n++)
+    fail_unless_equals_int (sp_writer_send_buf (p.writer, buf + n, 1, n), 1);
+  fail_unless_equals_int (sp_writer_send_buf (p.writer, buf + 4, 1, 4), 0);
+
+  for (n = 0; n < 4; n++) {
+    fail_unless_equals_int (client_recv (&p, 0, &rbuf), 1);
+    fail_unless_equals_int (rbuf[0], n);
+    fail_unless (sp_client_recv_finish (p.clients[0], rbuf) > 0);
+  }
+
+  /* the ring is empty, the client goes idle */
+  fail_unless_equals_int (sp_client_recv_ring (p.clients[0], &rbuf), 0);
+  fail_unless (rbuf == NULL);
+  fail_if (can_read (sp_get_fd (p.clients[0])));
+
+  fail_unless_equals_int (sp_writer_send_buf (p.writer, buf + 5, 1, 5), 1);
+  fail_unless (can_read (sp_get_fd (p.clients[0])));
+  fail_unless_equals_int (sp_client_recv (p.clients[0], &rbuf), 0);
+  fail_if (can_read (sp_get_fd (p.clients[0])));
+  fail_unless_equals_int (client_recv (&p, 0, &rbuf), 1);
+  fail_unless (sp_client_recv_finish (p.clients[0], rbuf) > 0);
+
+  sp_writer_free_block (block);
+  writer_recv (&p, 0);
+  fail_if (sp_writer_pending_writes (p.writer));
+
+  teardown_pipes (&p);
+}
+
+GST_END_TEST;
+
+/* a buffer from an area created after the ring was started stays in the
+ * ring until the client read the new area from the socket */
+GST_START_TEST (test_ring_resize)
+{
+  Pipes p;
+  ShmBlock *old_block, *block;
+  char *buf, *rbuf;
+
+  setup_pipes (&p, 1, 16);
+
+  old_block = sp_writer_alloc_block (p.writer, BUFFER_SIZE);
+  buf = sp_writer_block_get_buf (old_block);
+  memset (buf, 1, BUFFER_SIZE);
+  fail_unless_equals_int (sp_writer_send_buf (p.writer, buf, BUFFER_SIZE, 0),
+      1);
+  sp_writer_free_block (old_block);
+
+  fail_unless_equals_int (sp_writer_resize (p.writer, 2 * 1024 * 1024), 1);
+
+  block = sp_writer_alloc_block (p.writer, BUFFER_SIZE);
+  fail_unless (block != NULL);
+  buf = sp_writer_block_get_buf (block);
+  memset (buf, 2, BUFFER_SIZE);
+  fail_unless_equals_int (sp_writer_send_buf (p.writer, buf, BUFFER_SIZE, 1),
+      1);
+  sp_writer_free_block (block);
+
+  fail_unless_equals_int (sp_client_recv_ring (p.clients[0], &rbuf),
+      BUFFER_SIZE);
+  fail_unless_equals_int (rbuf[0], 1);
+  fail_unless (sp_client_recv_finish (p.clients[0], rbuf) > 0);
+
+  /* the new area isn't known yet, the buffer stays in the ring */
+  fail_unless_equals_int (sp_client_recv_ring (p.clients[0], &rbuf), 0);
+  fail_unless (rbuf == NULL);
+  fail_unless_equals_int (sp_client_recv_ring (p.clients[0], &rbuf), 0);
+  fail_unless (rbuf == NULL);
+
+  fail_unless_equals_int (client_recv (&p, 0, &rbuf), BUFFER_SIZE);
+  fail_unless_equals_int (rbuf[0], 2);
+  fail_unless (sp_client_recv_finish (p.clients[0], rbuf) > 0);
+  fail_if (can_read (sp_get_fd (p.clients[0])));
+
+  writer_recv (&p, 0);
+  fail_if (sp_writer_pending_writes (p.writer));
+
+  teardown_pipes (&p);
+}
+
+GST_END_TEST;
+
+static Suite *
+shmpipe_suite (void)
+{
+  Suite *s = suite_create ("shmpipe");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_set_timeout (tc_chain, 60);
+  tcase_add_test (tc_chain, test_socket_and_ring);
+  tcase_add_test (tc_chain, test_ring_full);
+  tcase_add_test (tc_chain, test_ring_resize);
+
+  return s;
+}
+
+GST_CHECK_MAIN (shmpipe);
@@ -0,0 +1,332 @@
+/* GStreamer
+ *
+ * unit tests for the unweighted and the multithreaded measuring of ssim
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+
+#include <math.h>
+#include <stdlib.h>
+
+static GstPad *orgsrcpad, *modsrcpad, *mysinkpad;
+static GstBus *bus;
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+/* widths multiple of 8, so that the lines of the planes aren't padded */
+#define SMALL_WIDTH 176
+#define SMALL_HEIGHT 144
+#define LARGE_WIDTH 1920
+#define LARGE_HEIGHT 1080
+
+static GstElement *
+setup_ssim (gint window_type, gint ssim_type, guint n_threads)
+{
+  GstElement *ssim;
+  GstPad *pad;
+
+  ssim = gst_check_setup_element ("ssim");
+  g_object_set (ssim, "window-type", window_type, "ssim-type", ssim_type,
+      "n-threads", n_threads, NULL);
+  bus = gst_bus_new ();
+  gst_element_set_bus (ssim, bus);
+
+  orgsrcpad = gst_pad_new_from_static_template (&srctemplate, "orgsrc");
+  pad = gst_element_get_request_pad (ssim, "original");
+  fail_unless_equals_int (gst_pad_link (orgsrcpad, pad), GST_PAD_LINK_OK);
+  gst_object_unref (pad);
+
+  modsrcpad = gst_pad_new_from_static_template (&srctemplate, "modsrc");
+  pad = gst_element_get_request_pad (ssim, "modified0");
+  fail_unless_equals_int (gst_pad_link (modsrcpad, pad), GST_PAD_LINK_OK);
+  gst_object_unref (pad);
+
+  mysinkpad = gst_pad_new_from_static_template (&sinktemplate, "sink");
+  gst_pad_set_chain_function (mysinkpad, gst_check_chain_func);
+  pad = gst_element_get_static_pad (ssim, "src0");
+  fail_unless_equals_int (gst_pad_link (pad, mysinkpad), GST_PAD_LINK_OK);
+  gst_object_unref (pad);
+
+  gst_pad_set_active (orgsrcpad, TRUE);
+  gst_pad_set_active (modsrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+  fail_unless_equals_int (gst_element_set_state (ssim, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+
+  return ssim;
+}
+
+static void
+cleanup_ssim (GstElement * ssim)
+{
+  gst_element_set_state (ssim, GST_STATE_NULL);
+  gst_pad_set_active (orgsrcpad, FALSE);
+  gst_pad_set_active (modsrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_object_unref (orgsrcpad);
+  gst_object_unref (modsrcpad);
+  gst_object_unref (mysinkpad);
+  gst_bus_set_flushing (bus, TRUE);
+  gst_object_unref (bus);
+  gst_check_teardown_element (ssim);
+}
+
+/* an I420 frame, with a Y plane of random values, @org being modified
+ * like a lossy encoder would if given */
+static GstBuffer *
+make_frame (gint width, gint height, GstBuffer * org)
+{
+  GstBuffer *buf;
+  GstCaps *caps;
+  guint8 *data;
+  gint i;
+
+  buf = gst_buffer_new_and_alloc (width * height * 3 / 2);
+  data = GST_BUFFER_DATA (buf);
+  for (i = 0; i < width * height; i++) {
+    if (org == NULL) {
+      data[i] = g_random_int_range (0, 256);
+    } else {
+      gint value = GST_BUFFER_DATA (org)[i] + g_random_int_range (-8, 9);
+
+      data[i] = CLAMP (value, 0, 255);
+    }
+  }
+  memset (data + width * height, 128, width * height / 2);
+
+  caps = gst_caps_new_simple ("video/x-raw-yuv",
+      "format", GST_TYPE_FOURCC, GST_MAKE_FOURCC ('I', '4', '2', '0'),
+      "width", G_TYPE_INT, width, "height", G_TYPE_INT, height,
+      "framerate", GST_TYPE_FRACTION, 25, 1, NULL);
+  gst_buffer_set_caps (buf, caps);
+  gst_caps_unref (caps);
+  GST_BUFFER_TIMESTAMP (buf) = 0;
+  GST_BUFFER_DURATION (buf) = GST_SECOND / 25;
+
+  return buf;
+}
+
+static gpointer
+push_original (gpointer data)
+{
+  return GINT_TO_POINTER (gst_pad_push (orgsrcpad, data));
+}
+
+/* collectpads blocks a pad until the buffers of all pads are there, so the
+ * original is pushed from another thread.  Returns the mean SSIM and the
+ * SSIM map in @map */
+static gfloat
+measure (GstBuffer * org, GstBuffer * mod, GstBuffer ** map,
+    gdouble * elapsed)
+{
+  GstMessage *message;
+  GThread *thread;
+  GTimer *timer;
+  gfloat mean;
+
+  timer = g_timer_new ();
+  thread = g_thread_create (push_original, gst_buffer_ref (org), TRUE, NULL);
+  fail_unless_equals_int (gst_pad_push (modsrcpad, gst_buffer_ref (mod)),
+      GST_FLOW_OK);
+  fail_unless_equals_int (GPOINTER_TO_INT (g_thread_join (thread)),
+      GST_FLOW_OK);
+  *elapsed = g_timer_elapsed (timer, NULL);
+  g_timer_destroy (timer);
+
+  fail_unless_equals_int (g_list_length (buffers), 1);
+  *map = buffers->data;
+  buffers = g_list_delete_link (buffers, buffers);
+
+  message = gst_bus_pop_filtered (bus, GST_MESSAGE_ELEMENT);
+  fail_unless (message != NULL);
+  fail_unless (gst_structure_has_name (message->structure, "SSIM"));
+  mean = g_value_get_float (gst_structure_get_value (message->structure,
+          "mean"));
+  gst_message_unref (message);
+
+  return mean;
+}
+
+/* SSIM over unweighted 11x11 windows, computed pixel by pixel */
+static gdouble
+reference_ssim (const guint8 * org, const guint8 * mod, gint width,
+    gint height, gboolean canonical, guint8 * map)
+{
+  const gdouble c1 = 0.01 * 255 * 0.01 * 255, c2 = 0.03 * 255 * 0.03 * 255;
+  gdouble summ = 0;
+  gint x, y, i, j;
+
+  for (y = 0; y < height; y++) {
+    for (x = 0; x < width; x++) {
+      gint x0 = MAX (x - 5, 0), x1 = MIN (x + 5, width - 1);
+      gint y0 = MAX (y - 5, 0), y1 = MIN (y + 5, height - 1);
+      gdouble n = (x1 - x0 + 1) * (y1 - y0 + 1);
+      gdouble mu_o = 128, mu_m = 128, sigma_o = 0, sigma_m = 0, sigma_om = 0;
+      gdouble index;
+
+      if (canonical) {
+        mu_o = mu_m = 0;
+        for (j = y0; j <= y1; j++) {
+          for (i = x0; i <= x1; i++) {
+            mu_o += org[j * width + i];
+            mu_m += mod[j * width + i];
+          }
+        }
+        mu_o /= n;
+        mu_m /= n;
+      }
+      for (j = y0; j <= y1; j++) {
+        for (i = x0; i <= x1; i++) {
+          gdouble o = org[j * width + i] - mu_o, m = mod[j * width + i] - mu_m;
+
+          sigma_o += o * o;
+          sigma_m += m * m;
+          sigma_om += o * m;
+        }
+      }
+      index = (2 * mu_o * mu_m + c1) * (2 * sigma_om / n + c2) /
+          ((mu_o * mu_o + mu_m * mu_m + c1) * (sigma_o / n + sigma_m / n +
+              c2));
+      map[y * width + x] = 127 + (gfloat) index * 128;
+      summ += index;
+    }
+  }
+
+  return summ / (width * height);
+}
+
+static void
+check_unweighted (gint ssim_type)
+{
+  GstElement *ssim;
+  GstBuffer *org, *mod, *map;
+  guint8 *ref_map;
+  gdouble ref_mean, elapsed;
+  gfloat mean;
+  gint i;
+
+  g_random_set_seed (1);
+  org = make_frame (SMALL_WIDTH, SMALL_HEIGHT, NULL);
+  mod = make_frame (SMALL_WIDTH, SMALL_HEIGHT, org);
+
+  ref_map = g_malloc (SMALL_WIDTH * SMALL_HEIGHT);
+  ref_mean = reference_ssim (GST_BUFFER_DATA (org), GST_BUFFER_DATA (mod),
+      SMALL_WIDTH, SMALL_HEIGHT, ssim_type == 0, ref_map);
+
+  ssim = setup_ssim (0, ssim_type, 1);
+  mean = measure (org, mod, &map, &elapsed);
+  cleanup_ssim (ssim);
+
+  GST_INFO ("ssim-type %d: mean %f, reference %f", ssim_type, mean, ref_mean);
+  fail_unless (fabs (mean - ref_mean) < 1e-5);
+  for (i = 0; i < SMALL_WIDTH * SMALL_HEIGHT; i++)
+    fail_unless (abs (GST_BUFFER_DATA (map)[i] - ref_map[i]) <= 1);
+
+  gst_buffer_unref (map);
+  g_free (ref_map);
+  gst_buffer_unref (org);
+  gst_buffer_unref (mod);
+}
+
+GST_START_TEST (test_unweighted)
+{
+  check_unweighted (0);
+  check_unweighted (1);
+}
+
+GST_END_TEST;
+
+static void
+check_threads (gint window_type, gint ssim_type)
+{
+  static const guint n_threads[] = { 2, 4, 7 };
+  GstElement *ssim;
+  GstBuffer *org, *mod, *ref_map, *map;
+  gdouble ref_elapsed, elapsed;
+  gfloat ref_mean, mean;
+  guint i;
+
+  g_random_set_seed (1);
+  org = make_frame (LARGE_WIDTH, LARGE_HEIGHT, NULL);
+  mod = make_frame (LARGE_WIDTH, LARGE_HEIGHT, org);
+
+  ssim = setup_ssim (window_type, ssim_type, 1);
+  ref_mean = measure (org, mod, &ref_map, &ref_elapsed);
+  cleanup_ssim (ssim);
+  GST_INFO ("window-type %d, ssim-type %d, 1 thread: %f s per frame",
+      window_type, ssim_type, ref_elapsed);
+
+  for (i = 0; i < G_N_ELEMENTS (n_threads); i++) {
+    ssim = setup_ssim (window_type, ssim_type, n_threads[i]);
+    mean = measure (org, mod, &map, &elapsed);
+    cleanup_ssim (ssim);
+    GST_INFO ("window-type %d, ssim-type %d, %u threads: %f s per frame, "
+        "speedup %.2f", window_type, ssim_type, n_threads[i], elapsed,
+        ref_elapsed / elapsed);
+
+    /* the bands give the same map, only the sum is added up differently */
+    fail_unless (fabs (mean - ref_mean) < 1e-5);
+    fail_unless (memcmp (GST_BUFFER_DATA (map), GST_BUFFER_DATA (ref_map),
+            LARGE_WIDTH * LARGE_HEIGHT) == 0);
+    gst_buffer_unref (map);
+  }
+
+  gst_buffer_unref (ref_map);
+  gst_buffer_unref (org);
+  gst_buffer_unref (mod);
+}
+
+GST_START_TEST (test_threads_unweighted)
+{
+  check_threads (0, 0);
+  check_threads (0, 1);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_threads_gauss)
+{
+  check_threads (1, 0);
+  check_threads (1, 1);
+}
+
+GST_END_TEST;
+
+static Suite *
+ssim_suite (void)
+{
+  Suite *s = suite_create ("ssim");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_set_timeout (tc_chain, 300);
+  tcase_add_test (tc_chain, test_unweighted);
+  tcase_add_test (tc_chain, test_threads_unweighted);
+  tcase_add_test (tc_chain, test_threads_gauss);
+
+  return s;
+}
+
+GST_CHECK_MAIN (ssim);
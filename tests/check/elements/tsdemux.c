@@ -0,0 +1,256 @@
+/* GStreamer
+ *
+ * unit test for tsdemux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <string.h>
+
+#define PMT_PID 0x100
+#define AUDIO_PID 0x101
+#define OTHER_PID 0x200
+
+/* number of packets following the one starting a PES packet */
+#define N_CONTINUATION 8
+#define N_OTHER 10
+
+#define PES_HEADER_SIZE 14
+
+static GstPad *mysrcpad, *mysinkpad;
+static guint n_buffers;
+static guint8 continuity[0x2000];
+
+static GstStaticPadTemplate mysrctemplate =
+GST_STATIC_PAD_TEMPLATE ("src", GST_PAD_SRC, GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("video/mpegts, systemstream = (boolean) true, "
+        "packetsize = (int) 188"));
+
+static GstStaticPadTemplate mysinktemplate =
+GST_STATIC_PAD_TEMPLATE ("sink", GST_PAD_SINK, GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static guint32
+crc32_mpeg (const guint8 * data, guint len)
+{
+  guint32 crc = 0xffffffff;
+  guint i, j;
+
+  for (i = 0; i < len; i++) {
+    crc ^= (guint32) data[i] << 24;
+    for (j = 0; j < 8; j++)
+      crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+  }
+
+  return crc;
+}
+
+static guint8 *
+write_header (guint8 * data, guint16 pid, gboolean start)
+{
+  data[0] = 0x47;
+  data[1] = (start ? 0x40 : 0x00) | (pid >> 8);
+  data[2] = pid & 0xff;
+  data[3] = 0x10 | (continuity[pid]++ & 0x0f);
+
+  return data + 4;
+}
+
+/* a packet holding one section, whose CRC is filled in here */
+static void
+write_section (guint8 * data, guint16 pid, const guint8 * section, guint len)
+{
+  guint32 crc;
+
+  memset (data, 0xff, 188);
+  data = write_header (data, pid, TRUE);
+  *data++ = 0;
+  memcpy (data, section, len);
+  crc = crc32_mpeg (data, len);
+  GST_WRITE_UINT32_BE (data + len, crc);
+}
+
+static void
+write_pat (guint8 * data)
+{
+  static const guint8 pat[] = {
+    0x00, 0xb0, 0x0d, 0x00, 0x01, 0xc1, 0x00, 0x00,
+    0x00, 0x01, 0xe0 | (PMT_PID >> 8), PMT_PID & 0xff
+  };
+
+  write_section (data, 0, pat, sizeof (pat));
+}
+
+static void
+write_pmt (guint8 * data)
+{
+  static const guint8 pmt[] = {
+    0x02, 0xb0, 0x12, 0x00, 0x01, 0xc1, 0x00, 0x00,
+    0xe0 | (AUDIO_PID >> 8), AUDIO_PID & 0xff, 0xf0, 0x00,
+    0x03, 0xe0 | (AUDIO_PID >> 8), AUDIO_PID & 0xff, 0xf0, 0x00
+  };
+
+  write_section (data, PMT_PID, pmt, sizeof (pmt));
+}
+
+static void
+write_pes_start (guint8 * data, guint64 pts, guint8 fill)
+{
+  data = write_header (data, AUDIO_PID, TRUE);
+  data[0] = 0x00;
+  data[1] = 0x00;
+  data[2] = 0x01;
+  data[3] = 0xc0;
+  data[4] = 0x00;
+  data[5] = 0x00;
+  data[6] = 0x80;
+  data[7] = 0x80;
+  data[8] = 0x05;
+  data[9] = 0x21 | ((pts >> 29) & 0x0e);
+  data[10] = (pts >> 22) & 0xff;
+  data[11] = ((pts >> 14) & 0xfe) | 0x01;
+  data[12] = (pts >> 7) & 0xff;
+  data[13] = ((pts << 1) & 0xfe) | 0x01;
+  memset (data + PES_HEADER_SIZE, fill, 184 - PES_HEADER_SIZE);
+}
+
+static void
+write_payload (guint8 * data, guint16 pid, guint8 fill)
+{
+  data = write_header (data, pid, FALSE);
+  memset (data, fill, 184);
+}
+
+static GstFlowReturn
+_sink_chain (GstPad * pad, GstBuffer * buffer)
+{
+  guint8 fill = n_buffers + 1;
+  guint i;
+
+  /* only the first PES packet has continuation packets */
+  if (n_buffers == 0)
+    fail_unless_equals_int (GST_BUFFER_SIZE (buffer),
+        184 - PES_HEADER_SIZE + N_CONTINUATION * 184);
+  else
+    fail_unless_equals_int (GST_BUFFER_SIZE (buffer), 184 - PES_HEADER_SIZE);
+
+  for (i = 0; i < GST_BUFFER_SIZE (buffer); i++)
+    fail_unless_equals_int (GST_BUFFER_DATA (buffer)[i], fill);
+
+  n_buffers++;
+  gst_buffer_unref (buffer);
+
+  return GST_FLOW_OK;
+}
+
+static void
+_pad_added (GstElement * element, GstPad * pad, gpointer user_data)
+{
+  fail_unless (gst_pad_link (pad, mysinkpad) == GST_PAD_LINK_OK);
+}
+
+/* The PMT and the first packets of its stream arrive in the same batch of
+ * the packetizer, they must not be dropped by the PID filter. Packets of
+ * other PIDs after that are */
+GST_START_TEST (test_pmt_and_stream_in_one_batch)
+{
+  GstElement *tsdemux;
+  GstPad *sinkpad;
+  GstBuffer *buffer;
+  GstCaps *caps;
+  guint8 *data;
+  guint64 filtered;
+  guint i;
+
+  n_buffers = 0;
+  memset (continuity, 0, sizeof (continuity));
+
+  tsdemux = gst_element_factory_make ("tsdemux", NULL);
+  fail_unless (tsdemux != NULL);
+  g_signal_connect (tsdemux, "pad-added", G_CALLBACK (_pad_added), NULL);
+
+  mysinkpad = gst_pad_new_from_static_template (&mysinktemplate, "sink");
+  gst_pad_set_chain_function (mysinkpad, _sink_chain);
+  mysrcpad = gst_pad_new_from_static_template (&mysrctemplate, "src");
+
+  sinkpad = gst_element_get_static_pad (tsdemux, "sink");
+  fail_unless (gst_pad_link (mysrcpad, sinkpad) == GST_PAD_LINK_OK);
+  gst_object_unref (sinkpad);
+
+  gst_pad_set_active (mysinkpad, TRUE);
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_element_set_state (tsdemux, GST_STATE_PLAYING);
+
+  caps = gst_caps_copy (gst_pad_template_get_caps (gst_static_pad_template_get
+          (&mysrctemplate)));
+
+  /* PAT, PMT and the first PES packet in one buffer, well below the batch
+   * size */
+  buffer = gst_buffer_new_and_alloc ((3 + N_CONTINUATION + 1) * 188);
+  gst_buffer_set_caps (buffer, caps);
+  data = GST_BUFFER_DATA (buffer);
+  write_pat (data);
+  write_pmt (data + 188);
+  write_pes_start (data + 2 * 188, 90000, 1);
+  for (i = 0; i < N_CONTINUATION; i++)
+    write_payload (data + (3 + i) * 188, AUDIO_PID, 1);
+  write_payload (data + (3 + N_CONTINUATION) * 188, OTHER_PID, 0xff);
+  fail_unless (gst_pad_push (mysrcpad, buffer) == GST_FLOW_OK);
+
+  g_object_get (tsdemux, "filtered-packets", &filtered, NULL);
+  fail_unless_equals_int (filtered, 0);
+
+  /* The next PES packets push out the previous ones, the packets of the
+   * other PID are dropped now that the PMT is known */
+  buffer = gst_buffer_new_and_alloc ((N_OTHER + 2) * 188);
+  gst_buffer_set_caps (buffer, caps);
+  data = GST_BUFFER_DATA (buffer);
+  for (i = 0; i < N_OTHER; i++)
+    write_payload (data + i * 188, OTHER_PID, 0xff);
+  write_pes_start (data + N_OTHER * 188, 93600, 2);
+  write_pes_start (data + (N_OTHER + 1) * 188, 97200, 3);
+  fail_unless (gst_pad_push (mysrcpad, buffer) == GST_FLOW_OK);
+
+  fail_unless_equals_int (n_buffers, 2);
+  g_object_get (tsdemux, "filtered-packets", &filtered, NULL);
+  fail_unless_equals_int (filtered, N_OTHER);
+
+  gst_caps_unref (caps);
+  gst_element_set_state (tsdemux, GST_STATE_NULL);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_pad_set_active (mysrcpad, FALSE);
+
+  gst_object_unref (tsdemux);
+  gst_object_unref (mysinkpad);
+  gst_object_unref (mysrcpad);
+}
+
+GST_END_TEST;
+
+static Suite *
+tsdemux_suite (void)
+{
+  Suite *s = suite_create ("tsdemux");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_pmt_and_stream_in_one_batch);
+
+  return s;
+}
+
+GST_CHECK_MAIN (tsdemux);
@@ -117,8 +117,9 @@ cleanup_vp8dec (GstElement * bin)
 
 GST_START_TEST (test_decode_simple)
 {
-  GstElement *bin;
+  GstElement *bin, *vp8dec;
   GstBuffer *buffer;
+  guint64 allocated, reused;
   gint i;
   GList *l;
 
@@ -158,6 +159,15 @@ GST_START_TEST (test_decode_simple)
             GST_PAD_CAPS (srcpad)));
   }
 
+  /* Every frame is finished right away, so the frames are reused */
+  vp8dec = gst_bin_get_by_name (GST_BIN (bin), "vp8dec");
+  fail_unless (vp8dec != NULL);
+  g_object_get (vp8dec, "frames-allocated", &allocated, "frames-reused",
+      &reused, NULL);
+  fail_unless (allocated + reused >= 20);
+  fail_unless (allocated < 20);
+  gst_object_unref (vp8dec);
+
   cleanup_vp8dec (bin);
 }
 
@@ -150,6 +150,65 @@ GST_START_TEST (test_h264_parse_slice_dpa)
 
 GST_END_TEST;
 
+/* 320x240 baseline SPS with timing info, num_units_in_tick 1000 and
+ * time_scale 12 make 0x00 0x00 0x00 0x03 that is escaped to
+ * 0x00 0x00 0x03 0x00 0x03, where the second 0x03 is data */
+static guint8 sps_epb[] = {
+  0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0xc0, 0x1e, 0xda, 0x05, 0x07, 0xe8,
+  0x40, 0x00, 0x00, 0xfa, 0x00, 0x00, 0x03, 0x00, 0x03, 0x21
+};
+
+/* the same SPS with num_units_in_tick 1 << 26 and time_scale 1, the long
+ * run of zero bits is escaped with three emulation prevention bytes in a
+ * row */
+static guint8 sps_epb_run[] = {
+  0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0xc0, 0x1e, 0xda, 0x05, 0x07, 0xe8,
+  0x41, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x61
+};
+
+static void
+check_sps_timing (const guint8 * data, gsize size, guint32 num_units_in_tick,
+    guint32 time_scale)
+{
+  GstH264ParserResult res;
+  GstH264NalUnit nalu;
+  GstH264SPS sps;
+  GstH264NalParser *parser = gst_h264_nal_parser_new ();
+
+  res = gst_h264_parser_identify_nalu_unchecked (parser, data, 0, size, &nalu);
+  assert_equals_int (res, GST_H264_PARSER_OK);
+  assert_equals_int (nalu.type, GST_H264_NAL_SPS);
+
+  res = gst_h264_parser_parse_sps (parser, &nalu, &sps, TRUE);
+  assert_equals_int (res, GST_H264_PARSER_OK);
+  assert_equals_int (sps.profile_idc, 66);
+  assert_equals_int (sps.level_idc, 30);
+  assert_equals_int (sps.width, 320);
+  assert_equals_int (sps.height, 240);
+  assert_equals_int (sps.vui_parameters.timing_info_present_flag, 1);
+  assert_equals_uint64 (sps.vui_parameters.num_units_in_tick,
+      num_units_in_tick);
+  assert_equals_uint64 (sps.vui_parameters.time_scale, time_scale);
+  assert_equals_int (sps.vui_parameters.fixed_frame_rate_flag, 1);
+  assert_equals_int (sps.vui_parameters.bitstream_restriction_flag, 0);
+
+  gst_h264_nal_parser_free (parser);
+}
+
+GST_START_TEST (test_h264_parse_sps_epb)
+{
+  check_sps_timing (sps_epb, sizeof (sps_epb), 1000, 12);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_h264_parse_sps_epb_run)
+{
+  check_sps_timing (sps_epb_run, sizeof (sps_epb_run), 1 << 26, 1);
+}
+
+GST_END_TEST;
+
 static Suite *
 h264parser_suite (void)
 {
@@ -159,6 +218,8 @@ h264parser_suite (void)
 
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_h264_parse_slice_dpa);
+  tcase_add_test (tc_chain, test_h264_parse_sps_epb);
+  tcase_add_test (tc_chain, test_h264_parse_sps_epb_run);
 
   return s;
 }
@@ -1,5 +1,6 @@
-/* MPEG-PS muxer plugin for GStreamer
- * Copyright 2008 Lin YANG <oxcsnicho@gmail.com>
+/* GStreamer
+ *
+ * unit tests for the shared CRC-32/MPEG-2 implementation
  *
  * This library is free software; you can redistribute it and/or
  * modify it under the terms of the GNU Library General Public
@@ -16,31 +17,11 @@
  * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
  * Boston, MA 02111-1307, USA.
  */
-/*
- * Unless otherwise indicated, Source Code is licensed under MIT license.
- * See further explanation attached in License Statement (distributed in the file
- * LICENSE).
- *
- * Permission is hereby granted, free of charge, to any person obtaining a copy of
- * this software and associated documentation files (the "Software"), to deal in
- * the Software without restriction, including without limitation the rights to
- * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
- * of the Software, and to permit persons to whom the Software is furnished to do
- * so, subject to the following conditions:
- *
- * The above copyright notice and this permission notice shall be included in all
- * copies or substantial portions of the Software.
- *
- * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
- * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
- * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
- * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
- * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
- * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
- * SOFTWARE.
- */
+#include <gst/check/gstcheck.h>
+#include <gst/gst-mpeg-crc.h>
 
-static guint32 crc_tab[256] = {
+/* the byte-at-a-time table the muxers and demuxers used to carry */
+static const guint32 crc_tab[256] = {
   0x00000000, 0x04c11db7, 0x09823b6e, 0x0d4326d9, 0x130476dc, 0x17c56b6b,
   0x1a864db2, 0x1e475005, 0x2608edb8, 0x22c9f00f, 0x2f8ad6d6, 0x2b4bcb61,
   0x350c9b64, 0x31cd86d3, 0x3c8ea00a, 0x384fbdbd, 0x4c11db70, 0x48d0c6c7,
@@ -86,15 +67,118 @@ static guint32 crc_tab[256] = {
   0xbcb4666d, 0xb8757bda, 0xb5365d03, 0xb1f740b4
 };
 
+
 static guint32
-calc_crc32 (guint8 *data, guint datalen)
+reference_crc32 (const guint8 * data, guint datalen)
 {
   guint i;
   guint32 crc = 0xffffffff;
 
-  for (i=0; i<datalen; i++) {
+  for (i = 0; i < datalen; i++)
     crc = (crc << 8) ^ crc_tab[((crc >> 24) ^ *data++) & 0xff];
-  }
 
   return crc;
 }
+
+/* PAT with one program (number 1, PMT PID 0x1000) and its CRC_32 */
+static const guint8 pat_section[] = {
+  0x00, 0xb0, 0x0d, 0x00, 0x01, 0xc1, 0x00, 0x00,
+  0x00, 0x01, 0xf0, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+GST_START_TEST (test_crc_tables)
+{
+  gint i;
+
+  gst_mpeg_crc_init ();
+
+  for (i = 0; i < 256; i++)
+    fail_unless_equals_int (gst_mpeg_crc_tab[0][i], crc_tab[i]);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_crc_check_value)
+{
+  const gchar *check = "123456789";
+
+  fail_unless_equals_int (gst_mpeg_crc32 ((const guint8 *) check, 9),
+      0x0376e6e7);
+  fail_unless_equals_int (gst_mpeg_crc32 ((const guint8 *) check, 0),
+      0xffffffff);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_crc_matches_reference)
+{
+  guint8 data[1031];
+  guint i, len;
+
+  for (i = 0; i < sizeof (data); i++)
+    data[i] = g_random_int_range (0, 256);
+
+  /* all lengths around the 8 byte blocks, and unaligned starts */
+  for (len = 0; len < 64; len++) {
+    fail_unless_equals_int (gst_mpeg_crc32 (data, len),
+        reference_crc32 (data, len));
+    fail_unless_equals_int (gst_mpeg_crc32 (data + 3, len),
+        reference_crc32 (data + 3, len));
+  }
+
+  fail_unless_equals_int (gst_mpeg_crc32 (data, sizeof (data)),
+      reference_crc32 (data, sizeof (data)));
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_crc_section_residue)
+{
+  guint8 section[sizeof (pat_section)];
+  guint32 crc;
+
+  memcpy (section, pat_section, sizeof (section));
+  crc = gst_mpeg_crc32 (section, sizeof (section) - 4);
+  GST_WRITE_UINT32_BE (section + sizeof (section) - 4, crc);
+
+  /* a section including its CRC_32 yields 0 */
+  fail_unless_equals_int (gst_mpeg_crc32 (section, sizeof (section)), 0);
+
+  section[5] ^= 0x02;
+  fail_if (gst_mpeg_crc32 (section, sizeof (section)) == 0);
+}
+
+GST_END_TEST;
+
+static Suite *
+mpegcrc_suite (void)
+{
+  Suite *s = suite_create ("MPEG CRC");
+
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_crc_tables);
+  tcase_add_test (tc_chain, test_crc_check_value);
+  tcase_add_test (tc_chain, test_crc_matches_reference);
+  tcase_add_test (tc_chain, test_crc_section_residue);
+
+  return s;
+}
+
+int
+main (int argc, char **argv)
+{
+  int nf;
+
+  Suite *s = mpegcrc_suite ();
+  SRunner *sr = srunner_create (s);
+
+  gst_check_init (&argc, &argv);
+
+  srunner_run_all (sr, CK_NORMAL);
+  nf = srunner_ntests_failed (sr);
+  srunner_free (sr);
+
+  return nf;
+}
@@ -0,0 +1,231 @@
+/* GStreamer
+ *
+ * unit tests and benchmark for the start code scanning of the codecparsers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/codecparsers/gsth264parser.h>
+#include <gst/codecparsers/gstmpeg4parser.h>
+#include <gst/codecparsers/gstmpegvideoparser.h>
+#include <gst/codecparsers/gstvc1parser.h>
+
+#define STREAM_SIZE (32 * 1024 * 1024)
+
+typedef struct
+{
+  guint8 *data;
+  guint size;
+
+  /* offsets of the 0x000001 of all packets */
+  guint *offsets;
+  guint n_packets;
+} Stream;
+
+/* An elementary stream of packets of random sizes starting with @type.
+ * The payload has runs of zero bytes like real streams and is escaped
+ * with emulation prevention bytes, so that it contains no start codes */
+static void
+make_stream (Stream * stream, guint8 type)
+{
+  guint8 *p, *end;
+  guint n_zeros;
+
+  g_random_set_seed (0x1234);
+
+  stream->data = g_malloc (STREAM_SIZE);
+  stream->offsets = g_new (guint, STREAM_SIZE / 1000 + 1);
+  stream->n_packets = 0;
+
+  p = stream->data;
+  end = stream->data + STREAM_SIZE - 6;
+  while (p < end) {
+    guint8 *packet_end = p + g_random_int_range (1000, 100000);
+
+    if (packet_end > end)
+      packet_end = end;
+
+    stream->offsets[stream->n_packets++] = p - stream->data;
+    *p++ = 0x00;
+    *p++ = 0x00;
+    *p++ = 0x01;
+    *p++ = type;
+
+    n_zeros = 0;
+    while (p < packet_end) {
+      guint8 byte = (g_random_int_range (0, 16) == 0) ? 0 : g_random_int ();
+
+      if (n_zeros >= 2 && byte <= 0x03) {
+        *p++ = 0x03;
+        n_zeros = 0;
+        continue;
+      }
+      n_zeros = (byte == 0x00) ? n_zeros + 1 : 0;
+      *p++ = byte;
+    }
+    /* rbsp_trailing_bits */
+    *p++ = 0x80;
+  }
+  stream->size = p - stream->data;
+}
+
+static void
+free_stream (Stream * stream)
+{
+  g_free (stream->data);
+  g_free (stream->offsets);
+}
+
+static void
+log_speed (const gchar * parser, Stream * stream, GTimer * timer)
+{
+  GST_INFO ("%s: %u packets, %.1f MB/s", parser, stream->n_packets,
+      stream->size / g_timer_elapsed (timer, NULL) / (1024 * 1024));
+}
+
+GST_START_TEST (test_h264)
+{
+  GstH264NalParser *parser;
+  GstH264NalUnit nalu;
+  Stream stream;
+  GTimer *timer;
+  guint offset = 0, n = 0;
+
+  make_stream (&stream, 0x41);
+  parser = gst_h264_nal_parser_new ();
+
+  timer = g_timer_new ();
+  while (gst_h264_parser_identify_nalu (parser, stream.data, offset,
+          stream.size, &nalu) == GST_H264_PARSER_OK) {
+    fail_unless_equals_int (nalu.sc_offset, stream.offsets[n]);
+    fail_unless_equals_int (nalu.type, GST_H264_NAL_SLICE);
+    offset = nalu.offset + nalu.size;
+    n++;
+  }
+  log_speed ("h264", &stream, timer);
+  g_timer_destroy (timer);
+
+  /* the end of the last one isn't known */
+  fail_unless_equals_int (n, stream.n_packets - 1);
+
+  gst_h264_nal_parser_free (parser);
+  free_stream (&stream);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_mpeg4)
+{
+  GstMpeg4Packet packet;
+  Stream stream;
+  GTimer *timer;
+  guint offset = 0, n = 0;
+
+  make_stream (&stream, GST_MPEG4_VIDEO_OBJ_PLANE);
+
+  timer = g_timer_new ();
+  while (gst_mpeg4_parse (&packet, FALSE, NULL, stream.data, offset,
+          stream.size) == GST_MPEG4_PARSER_OK) {
+    fail_unless_equals_int (packet.offset - 3, stream.offsets[n]);
+    fail_unless_equals_int (packet.type, GST_MPEG4_VIDEO_OBJ_PLANE);
+    offset = packet.offset + packet.size;
+    n++;
+  }
+  log_speed ("mpeg4", &stream, timer);
+  g_timer_destroy (timer);
+
+  fail_unless_equals_int (n, stream.n_packets - 1);
+
+  free_stream (&stream);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_vc1)
+{
+  GstVC1BDU bdu;
+  Stream stream;
+  GTimer *timer;
+  guint offset = 0, n = 0;
+
+  make_stream (&stream, GST_VC1_FRAME);
+
+  timer = g_timer_new ();
+  while (gst_vc1_identify_next_bdu (stream.data + offset,
+          stream.size - offset, &bdu) == GST_VC1_PARSER_OK) {
+    fail_unless_equals_int (offset + bdu.sc_offset, stream.offsets[n]);
+    fail_unless_equals_int (bdu.type, GST_VC1_FRAME);
+    offset += bdu.offset + bdu.size;
+    n++;
+  }
+  log_speed ("vc1", &stream, timer);
+  g_timer_destroy (timer);
+
+  fail_unless_equals_int (n, stream.n_packets - 1);
+
+  free_stream (&stream);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_mpeg_video)
+{
+  GstMpegVideoTypeOffsetSize *packet;
+  Stream stream;
+  GTimer *timer;
+  GList *list, *l;
+  guint n = 0;
+
+  make_stream (&stream, GST_MPEG_VIDEO_PACKET_PICTURE);
+
+  timer = g_timer_new ();
+  list = gst_mpeg_video_parse (stream.data, stream.size, 0);
+  log_speed ("mpegvideo", &stream, timer);
+  g_timer_destroy (timer);
+
+  for (l = list; l; l = l->next, n++) {
+    packet = l->data;
+    fail_unless_equals_int (packet->offset - 4, stream.offsets[n]);
+    fail_unless_equals_int (packet->type, GST_MPEG_VIDEO_PACKET_PICTURE);
+    g_free (packet);
+  }
+  g_list_free (list);
+
+  fail_unless_equals_int (n, stream.n_packets);
+
+  free_stream (&stream);
+}
+
+GST_END_TEST;
+
+static Suite *
+startcodes_suite (void)
+{
+  Suite *s = suite_create ("startcodes");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_set_timeout (tc_chain, 60);
+  tcase_add_test (tc_chain, test_h264);
+  tcase_add_test (tc_chain, test_mpeg4);
+  tcase_add_test (tc_chain, test_vc1);
+  tcase_add_test (tc_chain, test_mpeg_video);
+
+  return s;
+}
+
+GST_CHECK_MAIN (startcodes);
@@ -21,7 +21,9 @@
  */
 
 #include <gst/check/gstcheck.h>
+#include <glib/gstdio.h>
 #include <string.h>
+#include <unistd.h>
 
 static const gchar *
 get_mpeg2enc_element_name (void)
@@ -260,6 +262,82 @@ GST_START_TEST (test_multiple_av_streams)
 
 GST_END_TEST;
 
+/* Body partitions every 2 seconds, each with the index table of the one
+ * before, and the remaining index entries in the footer */
+GST_START_TEST (test_index_seek)
+{
+  GstElement *pipeline, *sink;
+  GstBuffer *buf = NULL;
+  gchar *filename, *pipeline_string, *contents;
+  gsize size;
+  guint32 rip_size;
+  guint8 *rip;
+  guint rip_slen;
+  gint fd;
+
+  fd = g_file_open_tmp ("mxf-index-XXXXXX", &filename, NULL);
+  fail_unless (fd >= 0);
+  close (fd);
+
+  pipeline_string = g_strdup_printf ("videotestsrc num-buffers=250 ! "
+      "video/x-raw-yuv,format=(GstFourcc)v308,width=64,height=48,framerate=25/1 ! "
+      "mxfmux name=mux partition-interval=2000000000 ! "
+      "filesink location=\"%s\"", filename);
+  pipeline = gst_parse_launch (pipeline_string, NULL);
+  fail_unless (pipeline != NULL);
+  g_free (pipeline_string);
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+  gst_message_unref (gst_bus_poll (GST_ELEMENT_BUS (pipeline),
+          GST_MESSAGE_EOS | GST_MESSAGE_ERROR, -1));
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS);
+  gst_object_unref (pipeline);
+
+  /* header, five body and the footer partition in the random index pack */
+  fail_unless (g_file_get_contents (filename, &contents, &size, NULL));
+  rip_size = GST_READ_UINT32_BE (contents + size - 4);
+  fail_unless (rip_size < size);
+  rip = (guint8 *) contents + size - rip_size;
+  rip_slen = (rip[16] & 0x80) ? 1 + (rip[16] & 0x7f) : 1;
+  fail_unless_equals_int ((rip_size - 16 - rip_slen - 4) / 12, 7);
+  g_free (contents);
+
+  pipeline_string = g_strdup_printf ("filesrc location=\"%s\" ! "
+      "mxfdemux ! fakesink name=sink", filename);
+  pipeline = gst_parse_launch (pipeline_string, NULL);
+  fail_unless (pipeline != NULL);
+  g_free (pipeline_string);
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  fail_unless (sink != NULL);
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PAUSED) != GST_STATE_CHANGE_FAILURE);
+  fail_unless (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE) == GST_STATE_CHANGE_SUCCESS);
+
+  fail_unless (gst_element_seek_simple (pipeline, GST_FORMAT_TIME,
+          GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_KEY_UNIT, 7 * GST_SECOND));
+  fail_unless (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE) == GST_STATE_CHANGE_SUCCESS);
+
+  /* all frames are keyframes, the seek ends up exactly at the frame */
+  g_object_get (sink, "last-buffer", &buf, NULL);
+  fail_unless (buf != NULL);
+  fail_unless_equals_uint64 (GST_BUFFER_TIMESTAMP (buf), 7 * GST_SECOND);
+  gst_buffer_unref (buf);
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS);
+  gst_object_unref (sink);
+  gst_object_unref (pipeline);
+
+  g_unlink (filename);
+  g_free (filename);
+}
+
+GST_END_TEST;
+
 static Suite *
 mxf_suite (void)
 {
@@ -275,6 +353,7 @@ mxf_suite (void)
   tcase_add_test (tc_chain, test_jpeg2000_alaw);
   tcase_add_test (tc_chain, test_dnxhd_mp3);
   tcase_add_test (tc_chain, test_multiple_av_streams);
+  tcase_add_test (tc_chain, test_index_seek);
 
   return s;
 }